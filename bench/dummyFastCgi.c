@@ -0,0 +1,323 @@
+/* Dummy FastCGI application for fastcgi_pass
+ * Author: 			Ben Tomlin
+ * Student Id:		btomlin
+ * Student Nbr:		834198
+ * Date:			Oct 2026
+ *
+ * A minimal FastCGI responder on a Unix socket. It multiplexes requests on
+ * a connection (announced in FCGI_GET_VALUES_RESULT), each answered from its
+ * own thread so their output interleaves. What is served depends on
+ * PATH_INFO;
+ *
+ * 	/size/<n>		<n> bytes of a repeating pattern, in 4000 byte records
+ * 	/delay/<ms>		A short body after <ms> milliseconds
+ * 	/status/<code>	An empty response with that status
+ * 	/stderr			A line on FCGI_STDERR, which the server logs
+ *
+ * Every response carries X-Script-Name, X-Path-Info and X-Query-String as
+ * received, and X-FastCGI-Connection, a number per accepted connection;
+ *
+ * 	./dummyFastCgi /tmp/app.sock &
+ * 	echo "fastcgi_pass ^/app unix:/tmp/app.sock" > app.conf
+ * 	./server 8080 /srv/www app.conf
+ * 	curl -i localhost:8080/app/size/100000
+ *
+ * 	args:
+ * 		./dummyFastCgi [-1] socketPath
+ * 	-1 serves one request per connection at a time, as many applications do
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "../http/fastCgi.h"
+
+#define EUSAGE		 5
+#define ELISTEN		 11
+#define MAX_ID		 256	// Highest request id handled
+#define PARAMS_MAX	 16384
+#define OUTPUT_CHUNK 4000
+
+typedef struct connection {
+	int fd;
+	long id;
+	pthread_mutex_t writeLock;
+	int users;				// Reading thread and running requests
+	pthread_mutex_t lock;
+} connection_t;
+
+typedef struct job {
+	connection_t* c;
+	int id;
+	char params[PARAMS_MAX];
+	int length;
+	volatile int aborted;
+} job_t;
+
+static int multiplexed=1;
+
+void* _serve(void* arg);
+void* _answer(void* arg);
+void _release(connection_t* c);
+char* _param(job_t* j, char* name, char* value, int size);
+int _record(connection_t* c, int type, int id, char* content, int length);
+int _readFull(int fd, void* buffer, int length);
+int _sendAll(int fd, char* bytes, long length);
+
+
+int main(int argc, char* argv[]) {
+	struct sockaddr_un address;
+	pthread_t thread;
+	connection_t* c;
+	char* path=argv[argc-1];
+	long nextId=1;
+	int fd;
+
+	if (argc==3&&strcmp(argv[1], "-1")==0) {
+		multiplexed=0;
+	} else if (argc!=2) {
+		fprintf(stderr, "usage: %s [-1] socketPath\n", argv[0]);
+		exit(EUSAGE);
+	}
+	signal(SIGPIPE, SIG_IGN);
+
+	memset(&address, 0, sizeof(address));
+	address.sun_family=AF_UNIX;
+	strncpy(address.sun_path, path, sizeof(address.sun_path)-1);
+	unlink(path);
+	fd=socket(AF_UNIX, SOCK_STREAM, 0);
+	if (bind(fd, (struct sockaddr*)&address, sizeof(address))!=0
+			||listen(fd, 128)!=0) {
+		perror("listen");
+		exit(ELISTEN);
+	}
+
+	while (1) {
+		c=calloc(1, sizeof(connection_t));
+		if ((c->fd=accept(fd, NULL, NULL))<0) {
+			free(c);
+			continue;
+		}
+		c->id=nextId++;
+		c->users=1;
+		pthread_mutex_init(&c->writeLock, NULL);
+		pthread_mutex_init(&c->lock, NULL);
+		pthread_create(&thread, NULL, _serve, c);
+		pthread_detach(thread);
+	}
+}
+
+
+void* _serve(void* arg) {
+	/* Read records on a connection, starting a thread per complete request */
+	connection_t* c=arg;
+	job_t* jobs[MAX_ID+1]={NULL};
+	unsigned char header[FCGI_HEADER_LEN];
+	char content[FCGI_MAX_CONTENT+256];
+	char values[64];
+	pthread_t thread;
+	job_t* j;
+	int length;
+	int id;
+
+	while (_readFull(c->fd, header, FCGI_HEADER_LEN)) {
+		id=header[2]<<8|header[3];
+		length=header[4]<<8|header[5];
+		if (!_readFull(c->fd, content, length+header[6])||id>MAX_ID) {
+			break;
+		}
+		j=jobs[id];
+		switch (header[1]) {
+			case FCGI_GET_VALUES:
+				length=snprintf(values, sizeof(values),
+						"%c%cFCGI_MPXS_CONNS%d%c%cFCGI_MAX_REQS32", 15, 1,
+						multiplexed, 13, 2);
+				_record(c, FCGI_GET_VALUES_RESULT, 0, values, length);
+				break;
+			case FCGI_BEGIN_REQUEST:
+				jobs[id]=calloc(1, sizeof(job_t));
+				jobs[id]->c=c;
+				jobs[id]->id=id;
+				break;
+			case FCGI_PARAMS:
+				if (j!=NULL&&j->length+length<=PARAMS_MAX) {
+					memcpy(j->params+j->length, content, length);
+					j->length+=length;
+				}
+				break;
+			case FCGI_STDIN:
+				if (j!=NULL&&length==0) {
+					pthread_mutex_lock(&c->lock);
+					c->users++;
+					pthread_mutex_unlock(&c->lock);
+					jobs[id]=NULL;
+					pthread_create(&thread, NULL, _answer, j);
+					pthread_detach(thread);
+				}
+				break;
+			case FCGI_ABORT_REQUEST:
+				if (j!=NULL) {
+					j->aborted=1;
+				}
+				break;
+		}
+	}
+	shutdown(c->fd, SHUT_RDWR);
+	_release(c);
+	return(NULL);
+}
+
+
+void* _answer(void* arg) {
+	/* Respond to a request, then end it */
+	job_t* j=arg;
+	char script[256];
+	char pathInfo[256];
+	char query[256];
+	char header[1024];
+	char bytes[OUTPUT_CHUNK];
+	char end[8]={0};
+	long n=0;
+	int i;
+
+	_param(j, "SCRIPT_NAME", script, sizeof(script));
+	_param(j, "PATH_INFO", pathInfo, sizeof(pathInfo));
+	_param(j, "QUERY_STRING", query, sizeof(query));
+	snprintf(header, sizeof(header), "X-Script-Name: %s\r\n"
+			"X-Path-Info: %s\r\nX-Query-String: %s\r\n"
+			"X-FastCGI-Connection: %ld\r\n", script, pathInfo, query,
+			j->c->id);
+
+	if (sscanf(pathInfo, "/status/%ld", &n)==1) {
+		snprintf(header+strlen(header), sizeof(header)-strlen(header),
+				"Status: %ld Dummy\r\n\r\n", n);
+		n=0;
+	} else if (sscanf(pathInfo, "/delay/%ld", &n)==1) {
+		struct timespec delay={n/1000, (n%1000)*1000000};
+		nanosleep(&delay, NULL);
+		strcat(header, "Content-Type: text/plain\r\n\r\n");
+		n=0;
+		_record(j->c, FCGI_STDOUT, j->id, header, strlen(header));
+		strcpy(header, "delayed\n");
+	} else if (strcmp(pathInfo, "/stderr")==0) {
+		_record(j->c, FCGI_STDERR, j->id, "dummy error\n", 12);
+		strcat(header, "Content-Type: text/plain\r\n\r\nlogged\n");
+	} else if (sscanf(pathInfo, "/size/%ld", &n)==1) {
+		snprintf(header+strlen(header), sizeof(header)-strlen(header),
+				"Content-Type: application/octet-stream\r\n"
+				"Content-Length: %ld\r\n\r\n", n);
+	} else {
+		strcat(header, "Status: 404 Not Found\r\n\r\n");
+	}
+	_record(j->c, FCGI_STDOUT, j->id, header, strlen(header));
+
+	for (i=0; i<OUTPUT_CHUNK; i++) {
+		bytes[i]='0'+i%10;
+	}
+	while (n>0&&!j->aborted) {
+		i=n<OUTPUT_CHUNK?n:OUTPUT_CHUNK;
+		if (!_record(j->c, FCGI_STDOUT, j->id, bytes, i)) {
+			break;
+		}
+		n-=i;
+	}
+	_record(j->c, FCGI_STDOUT, j->id, NULL, 0);
+	_record(j->c, FCGI_END_REQUEST, j->id, end, sizeof(end));
+	_release(j->c);
+	free(j);
+	return(NULL);
+}
+
+
+void _release(connection_t* c) {
+	int last;
+	pthread_mutex_lock(&c->lock);
+	last=(--c->users==0);
+	pthread_mutex_unlock(&c->lock);
+	if (last) {
+		close(c->fd);
+		free(c);
+	}
+}
+
+
+char* _param(job_t* j, char* name, char* value, int size) {
+	/* Copy the value of parameter <name> into <value>, "" if absent */
+	unsigned char* p=(unsigned char*)j->params;
+	unsigned char* end=p+j->length;
+	long lengths[2];
+	int i;
+
+	*value='\0';
+	while (p<end) {
+		for (i=0; i<2; i++) {
+			if (*p<128) {
+				lengths[i]=*p++;
+			} else {
+				lengths[i]=(long)(p[0]&0x7f)<<24|p[1]<<16|p[2]<<8|p[3];
+				p+=4;
+			}
+		}
+		if (lengths[0]==strlen(name)&&memcmp(p, name, lengths[0])==0) {
+			snprintf(value, size, "%.*s", (int)lengths[1],
+					(char*)p+lengths[0]);
+			break;
+		}
+		p+=lengths[0]+lengths[1];
+	}
+	return(value);
+}
+
+
+int _record(connection_t* c, int type, int id, char* content, int length) {
+	/* Send one record, whole, on <c> */
+	unsigned char header[FCGI_HEADER_LEN]={FCGI_VERSION_1, type, id>>8,
+		id&0xff, length>>8, length&0xff, 0, 0};
+	int ok;
+
+	pthread_mutex_lock(&c->writeLock);
+	ok=_sendAll(c->fd, (char*)header, FCGI_HEADER_LEN)
+			&&_sendAll(c->fd, content, length);
+	pthread_mutex_unlock(&c->writeLock);
+	return(ok);
+}
+
+
+int _readFull(int fd, void* buffer, int length) {
+	int done=0;
+	ssize_t n;
+	while (done<length) {
+		n=recv(fd, (char*)buffer+done, length-done, 0);
+		if (n<0&&errno==EINTR) {
+			continue;
+		} else if (n<=0) {
+			return(0);
+		}
+		done+=n;
+	}
+	return(1);
+}
+
+
+int _sendAll(int fd, char* bytes, long length) {
+	ssize_t n;
+	while (length>0) {
+		n=send(fd, bytes, length, 0);
+		if (n<0&&errno==EINTR) {
+			continue;
+		} else if (n<=0) {
+			return(0);
+		}
+		bytes+=n;
+		length-=n;
+	}
+	return(1);
+}
@@ -0,0 +1,221 @@
+/* Dummy upstream for proxy_pass
+ * Author: 			Ben Tomlin
+ * Student Id:		btomlin
+ * Student Nbr:		834198
+ * Date:			Oct 2026
+ *
+ * A minimal HTTP/1.1 backend to proxy to, serving keep-alive connections on
+ * a thread each. The body of each response is <n> bytes of a repeating
+ * pattern, framed per the path;
+ *
+ * 	/size/<n>		Content-Length
+ * 	/chunked/<n>	Transfer-Encoding: chunked, in chunks of up to 1000 bytes
+ * 	/close/<n>		Neither, the connection is closed after the body
+ *
+ * any other path is a 404. Every response carries X-Upstream-Connection, a
+ * number per accepted connection, so the reuse of pooled connections shows;
+ *
+ * 	./dummyUpstream 9000 &
+ * 	echo "proxy_pass /app 127.0.0.1:9000" > proxy.conf
+ * 	./server 8080 /srv/www proxy.conf
+ * 	curl -i localhost:8080/app/size/100000
+ *
+ * 	args:
+ * 		./dummyUpstream port
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#define EUSAGE		 5
+#define ELISTEN		 11
+#define REQUEST_MAX	 8192
+#define CHUNK_MAX	 1000
+#define FRAME_LENGTH 0
+#define FRAME_CHUNKED 1
+#define FRAME_CLOSE	 2
+
+typedef struct client {
+	int fd;
+	long id;
+} client_t;
+
+void* _serve(void* arg);
+int _respond(client_t* c, char* request);
+int _sendBody(int fd, long n, int frame);
+int _sendAll(int fd, char* bytes, long length);
+
+
+int main(int argc, char* argv[]) {
+	struct sockaddr_in address;
+	pthread_t thread;
+	client_t* c;
+	long nextId=1;
+	int on=1;
+	int fd;
+
+	if (argc!=2) {
+		fprintf(stderr, "usage: %s port\n", argv[0]);
+		exit(EUSAGE);
+	}
+	signal(SIGPIPE, SIG_IGN);
+
+	memset(&address, 0, sizeof(address));
+	address.sin_family=AF_INET;
+	address.sin_addr.s_addr=htonl(INADDR_LOOPBACK);
+	address.sin_port=htons(atoi(argv[1]));
+	fd=socket(AF_INET, SOCK_STREAM, 0);
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+	if (bind(fd, (struct sockaddr*)&address, sizeof(address))!=0
+			||listen(fd, 128)!=0) {
+		perror("listen");
+		exit(ELISTEN);
+	}
+
+	while (1) {
+		c=malloc(sizeof(client_t));
+		if ((c->fd=accept(fd, NULL, NULL))<0) {
+			free(c);
+			continue;
+		}
+		c->id=nextId++;
+		pthread_create(&thread, NULL, _serve, c);
+		pthread_detach(thread);
+	}
+}
+
+
+void* _serve(void* arg) {
+	/* Answer requests on a connection until it is closed */
+	client_t* c=arg;
+	char buffer[REQUEST_MAX+1];
+	char* end;
+	int length=0;
+	ssize_t n;
+
+	while (1) {
+		buffer[length]='\0';
+		while ((end=strstr(buffer, "\r\n\r\n"))!=NULL) {
+			if (!_respond(c, buffer)) {
+				goto done;
+			}
+			end+=4;
+			length-=end-buffer;
+			memmove(buffer, end, length+1);
+		}
+		if (length==REQUEST_MAX) {
+			break;
+		}
+		n=recv(c->fd, buffer+length, REQUEST_MAX-length, 0);
+		if (n<=0) {
+			break;
+		}
+		length+=n;
+	}
+done:
+	close(c->fd);
+	free(c);
+	return(NULL);
+}
+
+
+int _respond(client_t* c, char* request) {
+	/**
+	 * Answer the request at the start of <request>.
+	 *
+	 * RETURN:
+	 * 	0 if the connection is to be closed
+	 */
+	char header[512];
+	char path[256];
+	int frame=-1;
+	long n=0;
+
+	if (sscanf(request, "GET %255s HTTP/1.", path)!=1) {
+		return(0);
+	}
+	if (sscanf(path, "/%*[^/]/size/%ld", &n)==1) {
+		frame=FRAME_LENGTH;
+	} else if (sscanf(path, "/%*[^/]/chunked/%ld", &n)==1) {
+		frame=FRAME_CHUNKED;
+	} else if (sscanf(path, "/%*[^/]/close/%ld", &n)==1) {
+		frame=FRAME_CLOSE;
+	}
+
+	if (frame<0||n<0) {
+		snprintf(header, sizeof(header), "HTTP/1.1 404 Not Found\r\n"
+				"X-Upstream-Connection: %ld\r\nContent-Length: 0\r\n\r\n",
+				c->id);
+		return(_sendAll(c->fd, header, strlen(header)));
+	}
+	snprintf(header, sizeof(header), "HTTP/1.1 200 OK\r\n"
+			"Content-Type: application/octet-stream\r\n"
+			"X-Upstream-Connection: %ld\r\n", c->id);
+	if (frame==FRAME_LENGTH) {
+		snprintf(header+strlen(header), sizeof(header)-strlen(header),
+				"Content-Length: %ld\r\n\r\n", n);
+	} else if (frame==FRAME_CHUNKED) {
+		strcat(header, "Transfer-Encoding: chunked\r\n\r\n");
+	} else {
+		strcat(header, "Connection: close\r\n\r\n");
+	}
+	if (!_sendAll(c->fd, header, strlen(header))
+			||!_sendBody(c->fd, n, frame)) {
+		return(0);
+	}
+	return(frame!=FRAME_CLOSE);
+}
+
+
+int _sendBody(int fd, long n, int frame) {
+	/* <n> bytes of "0123456789" repeated, chunked if <frame> says so */
+	char bytes[CHUNK_MAX];
+	char size[32];
+	long length;
+	int i;
+
+	for (i=0; i<CHUNK_MAX; i++) {
+		bytes[i]='0'+i%10;
+	}
+	while (n>0) {
+		length=n<CHUNK_MAX?n:CHUNK_MAX;
+		if (frame==FRAME_CHUNKED) {
+			snprintf(size, sizeof(size), "%lx\r\n", length);
+			if (!_sendAll(fd, size, strlen(size))) {
+				return(0);
+			}
+		}
+		if (!_sendAll(fd, bytes, length)
+				||(frame==FRAME_CHUNKED&&!_sendAll(fd, "\r\n", 2))) {
+			return(0);
+		}
+		n-=length;
+	}
+	if (frame==FRAME_CHUNKED) {
+		return(_sendAll(fd, "0\r\n\r\n", 5));
+	}
+	return(1);
+}
+
+
+int _sendAll(int fd, char* bytes, long length) {
+	ssize_t n;
+	while (length>0) {
+		n=send(fd, bytes, length, 0);
+		if (n<0&&errno==EINTR) {
+			continue;
+		} else if (n<=0) {
+			return(0);
+		}
+		bytes+=n;
+		length-=n;
+	}
+	return(1);
+}
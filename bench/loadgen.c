@@ -0,0 +1,396 @@
+/* HTTP load generator
+ * Author: 			Ben Tomlin
+ * Student Id:		btomlin
+ * Student Nbr:		834198
+ * Date:			Oct 2026
+ *
+ * Drives a server with GET requests from a number of connections and reports
+ * throughput and latency percentiles.
+ *
+ * Closed loop (the default) sends each connection's next request as soon as
+ * the last response arrived. Open loop (-r) sends at a constant total rate,
+ * each request timed from when it was scheduled to be sent rather than when
+ * it was, so a stalled server is charged for the requests it held up
+ * (no coordinated omission).
+ *
+ * Keep-alive (-k) reuses a connection while the server allows it, otherwise
+ * every request gets a new connection.
+ *
+ * 	args:
+ * 		./loadgen [-c connections] [-d seconds] [-r rate] [-k] [-u urlFile]
+ * 				host port [path]
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include "../utility/bool.h"
+#include "../utility/metrics.h"
+#include "urlMix.h"
+
+#define EUSAGE				5
+#define ERESOLVE			9
+#define DEFAULT_CONNECTIONS 8
+#define DEFAULT_SECONDS		10
+#define DEFAULT_PATH		"/"
+#define RESPONSE_BUFFER		65536
+
+typedef struct worker {
+	pthread_t thread;
+	unsigned int seed;
+	int socketFd;				// Kept open between requests with keep-alive
+	long interval;				// Open loop, ns between this worker's sends
+	histogram_t latency;
+	unsigned long requests;
+	unsigned long bytes;
+	unsigned long errors;
+	unsigned long statuses[6];	// By class, 1xx to 5xx, [0] unparseable
+} worker_t;
+
+static struct addrinfo* server;
+static char* host;
+static int keepAlive;
+static long endTime;
+
+void* runWorker(void* worker);
+int doRequest(worker_t* w, char* path);
+int connectToServer();
+int readResponse(int socketFd, int* status, long* bytes, int* mayReuse);
+long nowNs();
+void sleepUntil(long t);
+void report(worker_t* workers, int nWorkers, double seconds, long rate);
+void printUsage();
+
+
+int
+main(int argc, char* argv[]) {
+	int nWorkers=DEFAULT_CONNECTIONS;
+	int seconds=DEFAULT_SECONDS;
+	long rate=0;
+	char* urlFile=NULL;
+	struct addrinfo hints;
+	worker_t* workers;
+	long start;
+	int option;
+	int i;
+
+	while ((option=getopt(argc, argv, "c:d:r:ku:"))!=-1) {
+		switch (option) {
+		case 'c':
+			nWorkers=atoi(optarg);
+			break;
+		case 'd':
+			seconds=atoi(optarg);
+			break;
+		case 'r':
+			rate=atol(optarg);
+			break;
+		case 'k':
+			keepAlive=true;
+			break;
+		case 'u':
+			urlFile=optarg;
+			break;
+		default:
+			printUsage();
+		}
+	}
+	if (argc-optind<2||argc-optind>3||nWorkers<1||seconds<1||rate<0) {
+		printUsage();
+	}
+
+	host=argv[optind];
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family=AF_UNSPEC;
+	hints.ai_socktype=SOCK_STREAM;
+	if (getaddrinfo(host, argv[optind+1], &hints, &server)!=0) {
+		fprintf(stderr, "Could not resolve %s:%s\n", host, argv[optind+1]);
+		exit(ERESOLVE);
+	}
+
+	if (urlFile!=NULL) {
+		loadUrlMix(urlFile);
+	} else {
+		addUrl(argc-optind==3?argv[optind+2]:DEFAULT_PATH, 1);
+	}
+
+	workers=calloc(nWorkers, sizeof(worker_t));
+	start=nowNs();
+	endTime=start+seconds*1000000000L;
+	for (i=0; i<nWorkers; i++) {
+		workers[i].seed=i+1;
+		workers[i].socketFd=-1;
+		workers[i].interval=rate>0?1000000000L*nWorkers/rate:0;
+		pthread_create(&workers[i].thread, NULL, runWorker, &workers[i]);
+	}
+	for (i=0; i<nWorkers; i++) {
+		pthread_join(workers[i].thread, NULL);
+	}
+
+	report(workers, nWorkers, (nowNs()-start)/1e9, rate);
+	freeaddrinfo(server);
+	free(workers);
+	return(0);
+}
+
+
+void* runWorker(void* worker) {
+	/**
+	 * Issue requests until the run ends. Open loop workers send on a fixed
+	 * schedule and measure from the scheduled time.
+	 */
+	worker_t* w=worker;
+	long scheduled=nowNs()+(w->interval>0?rand_r(&w->seed)%w->interval:0);
+	long start;
+
+	/* Open loop runs until every request scheduled in the run was sent,
+	 * even if running behind, so the backlog is not left out */
+	while (true) {
+		if (w->interval>0) {
+			if (scheduled>=endTime) {
+				break;
+			}
+			sleepUntil(scheduled);
+			start=scheduled;
+			scheduled+=w->interval;
+		} else if ((start=nowNs())>=endTime) {
+			break;
+		}
+		if (doRequest(w, pickUrl(&w->seed))) {
+			histogramRecord(&w->latency, nowNs()-start);
+		}
+	}
+	if (w->socketFd>=0) {
+		close(w->socketFd);
+	}
+	return(NULL);
+}
+
+
+int doRequest(worker_t* w, char* path) {
+	/**
+	 * Send one GET and read its whole response, reconnecting as required
+	 *
+	 * RETURN:
+	 * 	true if a response was read
+	 */
+	char request[MAX_URL+256];
+	int length;
+	int status;
+	int mayReuse;
+	long bytes;
+	int attempt;
+
+	length=snprintf(request, sizeof(request), "GET %s HTTP/1.0\r\nHost: %s\r\n"
+			"User-Agent: loadgen\r\n%s\r\n", path, host,
+			keepAlive?"Connection: keep-alive\r\n":"");
+
+	/* A reused connection may have been closed by the server, retry once */
+	for (attempt=0; attempt<2; attempt++) {
+		if (w->socketFd<0) {
+			w->socketFd=connectToServer();
+			if (w->socketFd<0) {
+				w->errors++;
+				return(false);
+			}
+			attempt=1;
+		}
+		if (send(w->socketFd, request, length, MSG_NOSIGNAL)==length
+				&&readResponse(w->socketFd, &status, &bytes, &mayReuse)) {
+			break;
+		}
+		close(w->socketFd);
+		w->socketFd=-1;
+		if (attempt==1) {
+			w->errors++;
+			return(false);
+		}
+	}
+
+	w->requests++;
+	w->bytes+=bytes;
+	w->statuses[(status>=100&&status<600)?status/100:0]++;
+	if (!keepAlive||!mayReuse) {
+		close(w->socketFd);
+		w->socketFd=-1;
+	}
+	return(true);
+}
+
+
+int connectToServer() {
+	struct addrinfo* a;
+	int one=1;
+	int s;
+
+	for (a=server; a!=NULL; a=a->ai_next) {
+		s=socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+		if (s<0) {
+			continue;
+		}
+		if (connect(s, a->ai_addr, a->ai_addrlen)==0) {
+			setsockopt(s, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+			return(s);
+		}
+		close(s);
+	}
+	return(-1);
+}
+
+
+int readResponse(int socketFd, int* status, long* bytes, int* mayReuse) {
+	/**
+	 * Read a response: the header up to its blank line (LF or CRLF), then
+	 * Content-Length bytes of entity, or up to the close without one.
+	 *
+	 * RETURN:
+	 * 	true if a whole response was read. <bytes> is the entity length and
+	 * 	<mayReuse> whether the connection can carry another request.
+	 */
+	char buffer[RESPONSE_BUFFER];
+	char* headerEnd=NULL;
+	char* entityStart=NULL;
+	char* crlf;
+	char* field;
+	long contentLength=-1;
+	long have=0;
+	long entity;
+	ssize_t n;
+	int persistent=false;
+
+	/* Header */
+	while (headerEnd==NULL) {
+		if (have==RESPONSE_BUFFER-1) {
+			return(false);
+		}
+		n=recv(socketFd, buffer+have, RESPONSE_BUFFER-1-have, 0);
+		if (n<=0) {
+			return(false);
+		}
+		have+=n;
+		buffer[have]='\0';
+		headerEnd=strstr(buffer, "\n\n");
+		crlf=strstr(buffer, "\r\n\r\n");
+		if (crlf!=NULL&&(headerEnd==NULL||crlf<headerEnd)) {
+			headerEnd=crlf;
+			entityStart=crlf+4;
+		} else if (headerEnd!=NULL) {
+			entityStart=headerEnd+2;
+		}
+	}
+	*headerEnd='\0';
+
+	*status=0;
+	sscanf(buffer, "HTTP/%*d.%*d %d", status);
+	for (field=strchr(buffer, '\n'); field!=NULL; field=strchr(field, '\n')) {
+		field++;
+		if (strncasecmp(field, "Content-Length:", 15)==0) {
+			contentLength=atol(field+15);
+		} else if (strncasecmp(field, "Connection:", 11)==0) {
+			persistent=(strcasestr(field, "keep-alive")!=NULL);
+		}
+	}
+
+	/* Entity */
+	entity=have-(entityStart-buffer);
+	while (contentLength<0||entity<contentLength) {
+		n=recv(socketFd, buffer, RESPONSE_BUFFER, 0);
+		if (n<0) {
+			return(false);
+		}
+		if (n==0) {
+			if (contentLength>=0) {
+				return(false); // Closed early
+			}
+			break;
+		}
+		entity+=n;
+	}
+	*bytes=entity;
+	*mayReuse=persistent&&contentLength>=0;
+	return(true);
+}
+
+
+long nowNs() {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return(t.tv_sec*1000000000L+t.tv_nsec);
+}
+
+
+void sleepUntil(long t) {
+	struct timespec target;
+	target.tv_sec=t/1000000000L;
+	target.tv_nsec=t%1000000000L;
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &target, NULL)
+			==EINTR);
+}
+
+
+void report(worker_t* workers, int nWorkers, double seconds, long rate) {
+	histogram_t* all=calloc(1, sizeof(histogram_t));
+	unsigned long requests=0;
+	unsigned long bytes=0;
+	unsigned long errors=0;
+	unsigned long statuses[6]={0};
+	int i;
+	int j;
+
+	for (i=0; i<nWorkers; i++) {
+		histogramMerge(all, &workers[i].latency);
+		requests+=workers[i].requests;
+		bytes+=workers[i].bytes;
+		errors+=workers[i].errors;
+		for (j=0; j<6; j++) {
+			statuses[j]+=workers[i].statuses[j];
+		}
+	}
+
+	fprintf(stdout, "%s loop, %d connections%s, %.1f s", rate>0?"open":"closed",
+			nWorkers, keepAlive?" (keep-alive)":"", seconds);
+	if (rate>0) {
+		fprintf(stdout, ", target %ld req/s", rate);
+	}
+	fprintf(stdout, "\n%lu requests, %lu errors, %.1f req/s, %.2f MB/s\n",
+			requests, errors, requests/seconds, bytes/seconds/1e6);
+	fprintf(stdout, "status 2xx %lu  3xx %lu  4xx %lu  5xx %lu  other %lu\n",
+			statuses[2], statuses[3], statuses[4], statuses[5],
+			statuses[0]+statuses[1]);
+	fprintf(stdout, "latency [us]  mean %.1f  p50 %.1f  p90 %.1f  p99 %.1f"
+			"  p99.9 %.1f  max %.1f\n",
+			all->count>0?all->sum/1000.0/all->count:0.0,
+			histogramPercentile(all, 50)/1000.0,
+			histogramPercentile(all, 90)/1000.0,
+			histogramPercentile(all, 99)/1000.0,
+			histogramPercentile(all, 99.9)/1000.0, all->max/1000.0);
+	free(all);
+}
+
+
+void printUsage() {
+	fprintf(stdout, "\nUSAGE:\n");
+	fprintf(stdout, "./loadgen [-c connections] [-d seconds] [-r rate] [-k]"
+			" [-u urlFile] host port [path]\n\n");
+	fprintf(stdout, "-c: Concurrent connections, default %d\n",
+			DEFAULT_CONNECTIONS);
+	fprintf(stdout, "-d: Run time in seconds, default %d\n", DEFAULT_SECONDS);
+	fprintf(stdout, "-r: Open loop at this many requests per second in total,"
+			" closed loop if absent\n");
+	fprintf(stdout, "-k: Keep connections alive where the server allows\n");
+	fprintf(stdout, "-u: URL mix, one \"[weight] path\" per line\n");
+	fprintf(stdout, "path: Path requested without -u, default %s\n\n",
+			DEFAULT_PATH);
+	exit(EUSAGE);
+}
@@ -0,0 +1,58 @@
+#!/bin/sh
+# Synthetic benchmark document root
+# Author: 			Ben Tomlin
+# Student Id:		btomlin
+# Student Nbr:		834198
+# Date:			Oct 2026
+#
+# Writes small (1k), medium (64k) and large (4m) files of deterministic text
+# under <documentRoot>, plus a loadgen URL mix <documentRoot>/urls.txt
+# weighted towards the small files, so runs are reproducible.
+#
+# 	args:
+# 		./bench/makeDocroot.sh documentRoot
+
+set -e
+
+if [ $# -ne 1 ]; then
+	echo "USAGE: $0 documentRoot" >&2
+	exit 5
+fi
+ROOT=$1
+mkdir -p "$ROOT/small" "$ROOT/medium" "$ROOT/large"
+
+# makeFile path bytes seed
+makeFile() {
+	awk -v bytes="$2" -v seed="$3" 'BEGIN {
+		srand(seed)
+		while (written < bytes) {
+			line = ""
+			for (i = 0; i < 12; i++) {
+				line = line sprintf("%08x ", int(rand() * 4294967296))
+			}
+			printf "%s\n", line
+			written += length(line) + 1
+		}
+	}' | head -c "$2" > "$1"
+}
+
+for i in $(seq 1 100); do
+	makeFile "$ROOT/small/file$i.txt" 1024 "$i"
+done
+for i in $(seq 1 20); do
+	makeFile "$ROOT/medium/file$i.css" 65536 "$((1000 + i))"
+done
+for i in 1 2; do
+	makeFile "$ROOT/large/file$i.js" 4194304 "$((2000 + i))"
+done
+makeFile "$ROOT/index.html" 4096 0
+
+{
+	echo "# weight path"
+	echo "20 /index.html"
+	for i in $(seq 1 100); do echo "1 /small/file$i.txt"; done
+	for i in $(seq 1 20); do echo "1 /medium/file$i.css"; done
+	for i in 1 2; do echo "1 /large/file$i.js"; done
+} > "$ROOT/urls.txt"
+
+echo "Document root written to $ROOT, URL mix in $ROOT/urls.txt"
@@ -0,0 +1,367 @@
+/* Hot path microbenchmarks
+ * Author: 			Ben Tomlin
+ * Student Id:		btomlin
+ * Student Nbr:		834198
+ * Date:			Oct 2026
+ *
+ * Times request line parsing, URI to path resolution, MIME type lookup,
+ * fdReadLine() and byteString operations in isolation, reporting per
+ * operation:
+ *
+ * 	ns/op - wall time
+ * 	allocs/op - malloc(), calloc() and realloc() calls, counted by wrapping
+ * 		the glibc allocator
+ * 	instructions/op - user space instructions retired, from a
+ * 		perf_event_open() counter where the kernel allows it
+ *
+ * With -j every benchmark is printed as one JSON object per line, for
+ * comparing runs between commits. Build the server objects with the flags
+ * under test, ie make CFLAG=-O2 bench.
+ *
+ * 	args:
+ * 		./microBench [-j] [-n iterations] [benchmark]
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "../http/http.h"
+#include "../http/httpStructures.h"
+#include "../http/mimeTypes.h"
+#include "../utility/byteString.h"
+#include "../utility/tcpSocketIo.h"
+#include "../utility/bool.h"
+#include "../config.h"
+
+#define EUSAGE				 5
+#define DEFAULT_ITERATIONS	 200000
+#define WARMUP_DIVISOR		 10	// Untimed warm up iterations, 1/10th of the run
+#define READLINE_BATCH		 32	// Requests queued on the socketpair at once
+#define BENCH_ROOT			 "/srv/www"
+
+typedef struct benchmark {
+	char* name;
+	void (*setup)();
+	void (*op)();
+	void (*teardown)();
+} benchmark_t;
+
+/* Internal to http.c, linked from http.o */
+int _parseRequestLine(char* requestLine, request_t *r);
+int _assemblePathFromURI(char* uri, char* rootPath, char* path, int pathSize);
+char* _getMimeType(char* fPath);
+
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t n, size_t size);
+void* __libc_realloc(void* p, size_t size);
+
+static long allocations;
+static int perfFd=-1;
+static int pair[2];
+static int queued;
+static int opIndex;
+
+static char* requestLines[]={
+	"GET /index.html HTTP/1.0",
+	"GET /static/js/app.3f9a1c.js HTTP/1.1",
+	"GET /images/hello%20world.png HTTP/1.0",
+	"GET /",
+	NULL
+};
+static char* uris[]={
+	"/index.html",
+	"/static/js/app.3f9a1c.js",
+	"/a/b/c/d/e/f/style.css?v=12",
+	"/docs/./guide/../api//index.html",
+	NULL
+};
+static char* paths[]={
+	"/srv/www/index.html",
+	"/srv/www/app.js",
+	"/srv/www/fonts/a.WOFF2",
+	"/srv/www/README",
+	NULL
+};
+static char* cannedRequest=
+	"GET /index.html HTTP/1.0\r\n"
+	"Host: localhost\r\n"
+	"User-Agent: microBench\r\n"
+	"Accept-Encoding: gzip, br\r\n"
+	"\r\n";
+static int cannedLines=5;
+
+void* malloc(size_t size);
+void* calloc(size_t n, size_t size);
+void* realloc(void* p, size_t size);
+int openInstructionCounter();
+long readInstructions();
+long nowNs();
+void runBenchmark(benchmark_t* b, long iterations, int json);
+void opParseRequestLine();
+void opAssemblePath();
+void opGetMimeType();
+void setupReadLine();
+void opReadLine();
+void teardownReadLine();
+void opByteString();
+void setupMimeTypes();
+void printUsage();
+
+static benchmark_t benchmarks[]={
+	{"parseRequestLine", NULL, opParseRequestLine, NULL},
+	{"assemblePathFromURI", NULL, opAssemblePath, NULL},
+	{"getMimeType", setupMimeTypes, opGetMimeType, NULL},
+	{"fdReadLine", setupReadLine, opReadLine, teardownReadLine},
+	{"byteString", NULL, opByteString, NULL},
+	{NULL, NULL, NULL, NULL}
+};
+
+
+int
+main(int argc, char* argv[]) {
+	long iterations=DEFAULT_ITERATIONS;
+	int json=false;
+	int option;
+	benchmark_t* b;
+
+	while ((option=getopt(argc, argv, "jn:"))!=-1) {
+		switch (option) {
+		case 'j':
+			json=true;
+			break;
+		case 'n':
+			iterations=atol(optarg);
+			break;
+		default:
+			printUsage();
+		}
+	}
+	if (argc-optind>1||iterations<1) {
+		printUsage();
+	}
+
+	initConfig();
+	perfFd=openInstructionCounter();
+	if (!json) {
+		fprintf(stdout, "%-22s %12s %12s %14s\n", "benchmark", "ns/op",
+				"allocs/op", "instructions/op");
+	}
+	for (b=benchmarks; b->name!=NULL; b++) {
+		if (optind<argc&&strcmp(argv[optind], b->name)!=0) {
+			continue;
+		}
+		runBenchmark(b, iterations, json);
+	}
+	return(0);
+}
+
+
+/* glibc allocator wrappers, counting allocations */
+void* malloc(size_t size) {
+	allocations++;
+	return(__libc_malloc(size));
+}
+
+void* calloc(size_t n, size_t size) {
+	allocations++;
+	return(__libc_calloc(n, size));
+}
+
+void* realloc(void* p, size_t size) {
+	allocations++;
+	return(__libc_realloc(p, size));
+}
+
+
+int openInstructionCounter() {
+	/* User space instructions retired by this thread, -1 if unavailable */
+	struct perf_event_attr attr;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.size=sizeof(attr);
+	attr.type=PERF_TYPE_HARDWARE;
+	attr.config=PERF_COUNT_HW_INSTRUCTIONS;
+	attr.disabled=1;
+	attr.exclude_kernel=1;
+	attr.exclude_hv=1;
+	return(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+
+long readInstructions() {
+	long count=0;
+	if (perfFd<0||read(perfFd, &count, sizeof(count))!=sizeof(count)) {
+		return(-1);
+	}
+	return(count);
+}
+
+
+long nowNs() {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return(t.tv_sec*1000000000L+t.tv_nsec);
+}
+
+
+void runBenchmark(benchmark_t* b, long iterations, int json) {
+	long warmup=iterations/WARMUP_DIVISOR;
+	long allocationsBefore;
+	long instructions=-1;
+	long start;
+	long elapsed;
+	double perOp;
+	long i;
+
+	if (b->setup!=NULL) {
+		b->setup();
+	}
+	for (i=0; i<warmup; i++) {
+		b->op();
+	}
+
+	if (perfFd>=0) {
+		ioctl(perfFd, PERF_EVENT_IOC_RESET, 0);
+		ioctl(perfFd, PERF_EVENT_IOC_ENABLE, 0);
+	}
+	allocationsBefore=allocations;
+	start=nowNs();
+	for (i=0; i<iterations; i++) {
+		b->op();
+	}
+	elapsed=nowNs()-start;
+	if (perfFd>=0) {
+		ioctl(perfFd, PERF_EVENT_IOC_DISABLE, 0);
+		instructions=readInstructions();
+	}
+	allocationsBefore=allocations-allocationsBefore;
+
+	if (b->teardown!=NULL) {
+		b->teardown();
+	}
+
+	perOp=(double)elapsed/iterations;
+	if (json) {
+		fprintf(stdout, "{\"benchmark\":\"%s\",\"iterations\":%ld,"
+				"\"ns_per_op\":%.2f,\"allocs_per_op\":%.2f,"
+				"\"instructions_per_op\":", b->name, iterations, perOp,
+				(double)allocationsBefore/iterations);
+		if (instructions>=0) {
+			fprintf(stdout, "%.1f}\n", (double)instructions/iterations);
+		} else {
+			fprintf(stdout, "null}\n");
+		}
+	} else if (instructions>=0) {
+		fprintf(stdout, "%-22s %12.1f %12.2f %14.1f\n", b->name, perOp,
+				(double)allocationsBefore/iterations,
+				(double)instructions/iterations);
+	} else {
+		fprintf(stdout, "%-22s %12.1f %12.2f %14s\n", b->name, perOp,
+				(double)allocationsBefore/iterations, "n/a");
+	}
+}
+
+
+void opParseRequestLine() {
+	/* Parse into a fresh request, freeing it after (as _getRequest does) */
+	request_t* r=initRequest();
+	char* line=requestLines[opIndex++%4];
+	_parseRequestLine(line, r);
+	freeRequest(r);
+	free(r);
+}
+
+
+void opAssemblePath() {
+	char path[PATH_MAX];
+	_assemblePathFromURI(uris[opIndex++%4], BENCH_ROOT, path, PATH_MAX);
+}
+
+
+void setupMimeTypes() {
+	initMimeTypes(MIME_TYPES_PATH);
+}
+
+
+void opGetMimeType() {
+	_getMimeType(paths[opIndex++%4]);
+}
+
+
+void setupReadLine() {
+	socketpair(AF_UNIX, SOCK_STREAM, 0, pair);
+	queued=0;
+}
+
+
+void opReadLine() {
+	/**
+	 * Read one whole request, line by line. Requests are queued on the
+	 * socketpair READLINE_BATCH at a time, so one write() is shared by that
+	 * many operations.
+	 */
+	int i;
+	if (queued==0) {
+		for (i=0; i<READLINE_BATCH; i++) {
+			if (write(pair[1], cannedRequest, strlen(cannedRequest))<0) {
+				return;
+			}
+		}
+		queued=READLINE_BATCH;
+	}
+	for (i=0; i<cannedLines; i++) {
+		free(fdReadLine(pair[0]));
+	}
+	queued--;
+}
+
+
+void teardownReadLine() {
+	/* Drain what is left so the module's leftover buffer is released */
+	while (queued>0) {
+		opReadLine();
+	}
+	close(pair[0]);
+	close(pair[1]);
+}
+
+
+void opByteString() {
+	/* Build a small header block by appends, copy it, free both */
+	byteString_t* b=bsInit();
+	byteString_t* copy;
+
+	bsAppend(b, "HTTP/1.0 200 OK\n", 16);
+	bsAppend(b, "Content-Type: text/html\n", 24);
+	bsAppend(b, "Content-Length: 4096\n", 21);
+	bsAppend(b, "\n", 1);
+	copy=bsCopy(b);
+	bsFree(b);
+	bsFree(copy);
+	free(b);
+	free(copy);
+}
+
+
+void printUsage() {
+	benchmark_t* b;
+	fprintf(stdout, "\nUSAGE:\n");
+	fprintf(stdout, "./microBench [-j] [-n iterations] [benchmark]\n\n");
+	fprintf(stdout, "-j: One JSON object per benchmark\n");
+	fprintf(stdout, "-n: Timed iterations, default %d\n", DEFAULT_ITERATIONS);
+	fprintf(stdout, "benchmark: Run only this one of");
+	for (b=benchmarks; b->name!=NULL; b++) {
+		fprintf(stdout, " %s", b->name);
+	}
+	fprintf(stdout, "\n\n");
+	exit(EUSAGE);
+}
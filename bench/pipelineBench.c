@@ -0,0 +1,224 @@
+/* In process request pipeline benchmark
+ * Author: 			Ben Tomlin
+ * Student Id:		btomlin
+ * Student Nbr:		834198
+ * Date:			Oct 2026
+ *
+ * Pushes canned requests through processRequest() over socketpair()s from a
+ * number of threads, so parse, path resolution and send are measured without
+ * the TCP stack, accept() or the concierge adding noise. Each worker has a
+ * drain thread reading responses off the far end of its pair.
+ *
+ * Point it at a docroot on tmpfs to keep the disk out too;
+ *
+ * 	./bench/makeDocroot.sh /dev/shm/benchroot
+ * 	./pipelineBench -u /dev/shm/benchroot/urls.txt /dev/shm/benchroot
+ *
+ * 	args:
+ * 		./pipelineBench [-t threads] [-d seconds] [-u urlFile] [-c configFile]
+ * 				documentRoot [path]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+
+#include "../http/http.h"
+#include "../http/mimeTypes.h"
+#include "../http/responseCache.h"
+#include "../utility/openFileCache.h"
+#include "../utility/metrics.h"
+#include "../utility/bool.h"
+#include "../config.h"
+#include "urlMix.h"
+
+#define EUSAGE			 5
+#define ESOCKETPAIR		 11
+#define DEFAULT_THREADS	 4
+#define DEFAULT_SECONDS	 5
+#define DEFAULT_PATH	 "/index.html"
+#define DRAIN_BUFFER	 65536
+
+typedef struct worker {
+	pthread_t thread;
+	pthread_t drain;
+	int pair[2];				// [0] handed to processRequest, [1] drained
+	unsigned int seed;
+	histogram_t latency;
+	unsigned long requests;
+	unsigned long bytes;		// Read by the drain thread
+} worker_t;
+
+static char* documentRoot;
+static long endTime;
+
+void* runWorker(void* worker);
+void* drainResponses(void* worker);
+long nowNs();
+void report(worker_t* workers, int nWorkers, double seconds);
+void printUsage();
+
+
+int
+main(int argc, char* argv[]) {
+	int nWorkers=DEFAULT_THREADS;
+	int seconds=DEFAULT_SECONDS;
+	char* urlFile=NULL;
+	char* configFile=NULL;
+	worker_t* workers;
+	long start;
+	int option;
+	int i;
+
+	while ((option=getopt(argc, argv, "t:d:u:c:"))!=-1) {
+		switch (option) {
+		case 't':
+			nWorkers=atoi(optarg);
+			break;
+		case 'd':
+			seconds=atoi(optarg);
+			break;
+		case 'u':
+			urlFile=optarg;
+			break;
+		case 'c':
+			configFile=optarg;
+			break;
+		default:
+			printUsage();
+		}
+	}
+	if (argc-optind<1||argc-optind>2||nWorkers<1||seconds<1) {
+		printUsage();
+	}
+	documentRoot=argv[optind];
+
+	/* Same start up as the server, less the listener and loggers */
+	initConfig();
+	if (configFile!=NULL) {
+		loadConfig(configFile);
+	}
+	openFileCacheInit(serverConfig.openFileCache, serverConfig.openFileValid,
+			serverConfig.openFileInactive);
+	initMimeTypes(serverConfig.mimeTypes);
+	initResponseCache(serverConfig.responseCacheSize,
+			serverConfig.responseCacheMaxFile);
+	initMetrics();
+
+	if (urlFile!=NULL) {
+		loadUrlMix(urlFile);
+	} else {
+		addUrl(argc-optind==2?argv[optind+1]:DEFAULT_PATH, 1);
+	}
+
+	workers=calloc(nWorkers, sizeof(worker_t));
+	start=nowNs();
+	endTime=start+seconds*1000000000L;
+	for (i=0; i<nWorkers; i++) {
+		if (socketpair(AF_UNIX, SOCK_STREAM, 0, workers[i].pair)!=0) {
+			fprintf(stderr, "Could not create a socketpair\n");
+			exit(ESOCKETPAIR);
+		}
+		workers[i].seed=i+1;
+		pthread_create(&workers[i].drain, NULL, drainResponses, &workers[i]);
+		pthread_create(&workers[i].thread, NULL, runWorker, &workers[i]);
+	}
+	for (i=0; i<nWorkers; i++) {
+		pthread_join(workers[i].thread, NULL);
+		pthread_join(workers[i].drain, NULL);
+	}
+
+	report(workers, nWorkers, (nowNs()-start)/1e9);
+	free(workers);
+	return(0);
+}
+
+
+void* runWorker(void* worker) {
+	/**
+	 * Write a request into the pair and have processRequest() answer it,
+	 * until the run ends. The drain thread keeps the pair from filling.
+	 */
+	worker_t* w=worker;
+	char request[MAX_URL+128];
+	int length;
+	long start;
+
+	while ((start=nowNs())<endTime) {
+		length=snprintf(request, sizeof(request), "GET %s HTTP/1.0\r\n"
+				"Host: localhost\r\nUser-Agent: pipelineBench\r\n\r\n",
+				pickUrl(&w->seed));
+		if (write(w->pair[1], request, length)!=length) {
+			break;
+		}
+		processRequest(w->pair[0], documentRoot);
+		histogramRecord(&w->latency, nowNs()-start);
+		w->requests++;
+	}
+	shutdown(w->pair[0], SHUT_WR);
+	return(NULL);
+}
+
+
+void* drainResponses(void* worker) {
+	/* Read and count response bytes until the worker shuts its end */
+	worker_t* w=worker;
+	char buffer[DRAIN_BUFFER];
+	ssize_t n;
+
+	while ((n=read(w->pair[1], buffer, DRAIN_BUFFER))>0) {
+		w->bytes+=n;
+	}
+	return(NULL);
+}
+
+
+long nowNs() {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return(t.tv_sec*1000000000L+t.tv_nsec);
+}
+
+
+void report(worker_t* workers, int nWorkers, double seconds) {
+	histogram_t* all=calloc(1, sizeof(histogram_t));
+	unsigned long requests=0;
+	unsigned long bytes=0;
+	int i;
+
+	for (i=0; i<nWorkers; i++) {
+		histogramMerge(all, &workers[i].latency);
+		requests+=workers[i].requests;
+		bytes+=workers[i].bytes;
+	}
+	fprintf(stdout, "%d threads, %.1f s\n", nWorkers, seconds);
+	fprintf(stdout, "%lu requests, %.1f req/s, %.2f MB/s\n", requests,
+			requests/seconds, bytes/seconds/1e6);
+	fprintf(stdout, "processRequest [us]  mean %.1f  p50 %.1f  p90 %.1f"
+			"  p99 %.1f  p99.9 %.1f  max %.1f\n",
+			all->count>0?all->sum/1000.0/all->count:0.0,
+			histogramPercentile(all, 50)/1000.0,
+			histogramPercentile(all, 90)/1000.0,
+			histogramPercentile(all, 99)/1000.0,
+			histogramPercentile(all, 99.9)/1000.0, all->max/1000.0);
+	free(all);
+}
+
+
+void printUsage() {
+	fprintf(stdout, "\nUSAGE:\n");
+	fprintf(stdout, "./pipelineBench [-t threads] [-d seconds] [-u urlFile]"
+			" [-c configFile] documentRoot [path]\n\n");
+	fprintf(stdout, "-t: Threads calling processRequest(), default %d\n",
+			DEFAULT_THREADS);
+	fprintf(stdout, "-d: Run time in seconds, default %d\n", DEFAULT_SECONDS);
+	fprintf(stdout, "-u: URL mix, one \"[weight] path\" per line\n");
+	fprintf(stdout, "-c: Server configuration file, see config.c\n");
+	fprintf(stdout, "path: Path requested without -u, default %s\n\n",
+			DEFAULT_PATH);
+	exit(EUSAGE);
+}
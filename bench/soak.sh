@@ -0,0 +1,137 @@
+#!/bin/sh
+# Memory soak test
+# Author: 			Ben Tomlin
+# Student Id:		btomlin
+# Student Nbr:		834198
+# Date:			Oct 2026
+#
+# Runs the server under load for <rounds> rounds of <seconds> each, sampling
+# /server-status between rounds, and fails if memory is not flat once warm:
+#
+# 	- per request allocations (requests, read ahead, worker threads) must be
+# 	  back to those of the status request itself while idle
+# 	- the caches' live bytes and the resident size must not grow past the
+# 	  first round's by more than the slack
+#
+# Then stops the server with SIGTERM and fails if it does not exit cleanly,
+# so leaks found by LeakSanitizer or valgrind at exit fail the run too;
+#
+# 	make clean && make CFLAG="-g -fsanitize=address" && make loadgen
+# 	./bench/makeDocroot.sh /tmp/benchroot
+# 	./bench/soak.sh -r 30 -d 60 /tmp/benchroot
+#
+# 	args:
+# 		./bench/soak.sh [-r rounds] [-d seconds] [-c connections]
+# 				[-s slackPercent] [-v] documentRoot
+# 	-v runs the server under valgrind --leak-check=full
+
+ROUNDS=10
+SECONDS_PER_ROUND=30
+CONNECTIONS=16
+SLACK=10
+VALGRIND=
+PORT=${SOAK_PORT:-18080}
+
+# A smaller ASan quarantine lets the resident size of a sanitized build settle
+export ASAN_OPTIONS=${ASAN_OPTIONS:-quarantine_size_mb=16}
+
+while getopts "r:d:c:s:v" option; do
+	case $option in
+		r) ROUNDS=$OPTARG ;;
+		d) SECONDS_PER_ROUND=$OPTARG ;;
+		c) CONNECTIONS=$OPTARG ;;
+		s) SLACK=$OPTARG ;;
+		v) VALGRIND="valgrind --leak-check=full --errors-for-leak-kinds=definite --error-exitcode=23" ;;
+		*) exit 5 ;;
+	esac
+done
+shift $((OPTIND - 1))
+if [ $# -ne 1 ] || [ ! -f "$1/urls.txt" ]; then
+	echo "USAGE: $0 [-r rounds] [-d seconds] [-c connections]" \
+		"[-s slackPercent] [-v] documentRoot (from makeDocroot.sh)" >&2
+	exit 5
+fi
+ROOT=$1
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+# Every subsystem that allocates per request or per entry: files, listings,
+# missing files and the status page
+cat > "$WORK/soak.conf" <<EOF
+server_status on
+autoindex on
+log_level error
+EOF
+cp "$ROOT/urls.txt" "$WORK/urls.txt"
+{
+	echo "4 /small/"
+	echo "4 /medium/"
+	echo "4 /missing.html"
+	echo "1 /server-status"
+} >> "$WORK/urls.txt"
+
+$VALGRIND ./server "$PORT" "$ROOT" "$WORK/soak.conf" > "$WORK/server.log" 2>&1 &
+SERVER=$!
+sleep 2
+
+# sample file - write "pool count bytes" lines, and "resident bytes"
+sample() {
+	curl -s "localhost:$PORT/server-status?format=prometheus" | awk '
+		/^httpserver_memory_live_allocations/ {
+			split($1, a, "\""); count[a[2]] = $2 }
+		/^httpserver_memory_live_bytes/ {
+			split($1, a, "\""); bytes[a[2]] = $2 }
+		/^httpserver_resident_memory_bytes/ { print "resident", $2 }
+		END { for (p in count) print p, count[p], bytes[p] }' > "$1"
+}
+
+failed=0
+round=1
+while [ "$round" -le "$ROUNDS" ]; do
+	./loadgen -c "$CONNECTIONS" -d "$SECONDS_PER_ROUND" -u "$WORK/urls.txt" \
+		localhost "$PORT" | head -2 | tail -1
+	sleep 1
+	sample "$WORK/round$round"
+	if [ ! -s "$WORK/round$round" ]; then
+		echo "Round $round: no status page, server gone?" >&2
+		failed=1
+		break
+	fi
+	awk -v round="$round" -v slack="$SLACK" '
+		FNR == NR { if ($1 == "resident") rss0 = $2; else base[$1] = $3; next }
+		$1 == "resident" { rss = $2; next }
+		{
+			total += $3; total0 += base[$1]
+			line = line sprintf(" %s %d/%d", $1, $2, $3)
+			# Idle, only the status request itself is live
+			if (($1 == "request" && $2 > 2) || ($1 == "readahead" && $2 > 1) \
+					|| ($1 == "thread" && $2 > 1)) {
+				printf "Round %d: %s has %d live allocations when idle\n",
+					round, $1, $2
+				bad = 1
+			}
+		}
+		END {
+			printf "Round %d: resident %d KB, live %d KB:%s\n", round,
+				rss / 1024, total / 1024, line
+			limit = 1 + slack / 100
+			if (total > total0 * limit + 65536 || rss > rss0 * limit) {
+				printf "Round %d: memory grew past the first round by over" \
+					" %d%%\n", round, slack
+				bad = 1
+			}
+			exit bad
+		}' "$WORK/round1" "$WORK/round$round" || failed=1
+	round=$((round + 1))
+done
+
+kill -TERM "$SERVER"
+wait "$SERVER"
+status=$?
+if [ "$status" -ne 0 ]; then
+	echo "Server exited with $status:" >&2
+	tail -40 "$WORK/server.log" >&2
+	failed=1
+fi
+[ "$failed" -eq 0 ] && echo "Memory flat over $ROUNDS rounds"
+exit "$failed"
@@ -0,0 +1,119 @@
+/* URI path resolution microbenchmark
+ * Author: 			Ben Tomlin
+ * Student Id:		btomlin
+ * Student Nbr:		834198
+ * Date:			Oct 2026
+ *
+ * Compares the regex based URI to path resolution the server used to do
+ * (extractMatch(PATH) then malloc and concatenate onto the root) with the
+ * single pass canonicalizePath() into a stack buffer.
+ *
+ * 	args:
+ * 		./uriBench [iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+
+#include "../http/http.h"
+#include "../http/uriPath.h"
+#include "../utility/regexTool.h"
+
+#define DEFAULT_ITERATIONS 200000
+#define ROOT "/srv/www"
+
+static char* uris[] = {
+	"/index.html",
+	"/static/js/app.3f9a1c.js",
+	"/a/b/c/d/e/f/style.css?v=12",
+	"/images/hello%20world.png",
+	"/docs/./guide/../api//index.html",
+	NULL
+};
+
+char* legacyResolve(char* uri, char* rootPath);
+char* canonicalResolve(char* uri, char* rootPath, char* path, int pathSize);
+double elapsedNs(struct timespec* start, struct timespec* end);
+
+
+int
+main(int argc, char* argv[]) {
+	long iterations=(argc>1)?atol(argv[1]):DEFAULT_ITERATIONS;
+	struct timespec start;
+	struct timespec end;
+	char path[PATH_MAX];
+	char* legacy;
+	long sink=0;
+	long i;
+	int u;
+
+	fprintf(stdout, "%-40s %-36s %s\n", "uri", "legacy", "canonical");
+	for (u=0; uris[u]!=NULL; u++) {
+		legacy=legacyResolve(uris[u], ROOT);
+		fprintf(stdout, "%-40s %-36s %s\n", uris[u],
+				legacy!=NULL?legacy:"(none)",
+				canonicalResolve(uris[u], ROOT, path, PATH_MAX)!=NULL?
+						path:"(rejected)");
+		free(legacy);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i=0; i<iterations; i++) {
+		for (u=0; uris[u]!=NULL; u++) {
+			legacy=legacyResolve(uris[u], ROOT);
+			sink+=(legacy!=NULL);
+			free(legacy);
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	fprintf(stdout, "\nlegacy    %10.1f ns/op\n",
+			elapsedNs(&start, &end)/(iterations*u));
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i=0; i<iterations; i++) {
+		for (u=0; uris[u]!=NULL; u++) {
+			sink+=(canonicalResolve(uris[u], ROOT, path, PATH_MAX)!=NULL);
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	fprintf(stdout, "canonical %10.1f ns/op\n",
+			elapsedNs(&start, &end)/(iterations*u));
+
+	return(sink==0);
+}
+
+
+char* legacyResolve(char* uri, char* rootPath) {
+	/* The previous _assemblePathFromURI(), allocating the returned path */
+	char* uriPath;
+	char* path;
+
+	if (extractMatch(PATH, uri, &uriPath)==NULL) {
+		return(NULL);
+	}
+	path=malloc(strlen(rootPath)+2+strlen(uriPath));
+	strcpy(path, rootPath);
+	strcat(path, "/");
+	strcat(path, uriPath);
+	free(uriPath);
+	return(path);
+}
+
+
+char* canonicalResolve(char* uri, char* rootPath, char* path, int pathSize) {
+	/* The current _assemblePathFromURI(), writing into <path> */
+	int rootLength=strlen(rootPath);
+	memcpy(path, rootPath, rootLength);
+	if (canonicalizePath(uri, path+rootLength, pathSize-rootLength)<0) {
+		return(NULL);
+	}
+	return(path);
+}
+
+
+double elapsedNs(struct timespec* start, struct timespec* end) {
+	return((end->tv_sec-start->tv_sec)*1e9+(end->tv_nsec-start->tv_nsec));
+}
@@ -0,0 +1,83 @@
+/*
+ * Author: 			Ben Tomlin
+ * Student Id:		btomlin
+ * Student Nbr:		834198
+ * Date:			Oct 2026
+ *
+ * Weighted set of request paths shared by the benchmark drivers, read from a
+ * file of "[weight] path" lines (see bench/makeDocroot.sh).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "urlMix.h"
+
+typedef struct url {
+	char* path;
+	int weight;
+} url_t;
+
+static url_t* urls;
+static int nUrls;
+static int totalWeight;
+
+
+void loadUrlMix(char* path) {
+	/**
+	 * Load the URL mix, one "[weight] path" per line; '#' starts a comment.
+	 * Paths are requested in proportion to their weight (default 1).
+	 *
+	 * Terminates with EURLFILE if the file is unreadable or empty
+	 */
+	char line[MAX_URL];
+	char* first;
+	char* second;
+	FILE* f=fopen(path, "r");
+
+	if (f==NULL) {
+		fprintf(stderr, "Could not open URL file %s\n", path);
+		exit(EURLFILE);
+	}
+	while (fgets(line, MAX_URL, f)!=NULL) {
+		first=strtok(line, " \t\r\n");
+		if (first==NULL||first[0]=='#') {
+			continue;
+		}
+		second=strtok(NULL, " \t\r\n");
+		if (second!=NULL) {
+			addUrl(second, atoi(first));
+		} else {
+			addUrl(first, 1);
+		}
+	}
+	fclose(f);
+	if (nUrls==0) {
+		fprintf(stderr, "No URLs in %s\n", path);
+		exit(EURLFILE);
+	}
+}
+
+
+void addUrl(char* path, int weight) {
+	if (weight<1) {
+		return;
+	}
+	urls=realloc(urls, sizeof(url_t)*(nUrls+1));
+	urls[nUrls].path=strdup(path);
+	urls[nUrls].weight=weight;
+	totalWeight+=weight;
+	nUrls++;
+}
+
+
+char* pickUrl(unsigned int* seed) {
+	/* Weighted random choice, <seed> is the caller's rand_r() state */
+	int r=rand_r(seed)%totalWeight;
+	int i;
+	for (i=0; r>=urls[i].weight; i++) {
+		r-=urls[i].weight;
+	}
+	return(urls[i].path);
+}
@@ -0,0 +1,18 @@
+/*
+ * Author: 			Ben Tomlin
+ * Student Id:		btomlin
+ * Student Nbr:		834198
+ * Date:			Oct 2026
+ */
+
+#ifndef BENCH_URLMIX_H_
+#define BENCH_URLMIX_H_
+
+#define EURLFILE 7
+#define MAX_URL	 2048
+
+void loadUrlMix(char* path);
+void addUrl(char* path, int weight);
+char* pickUrl(unsigned int* seed);
+
+#endif /* BENCH_URLMIX_H_ */
@@ -0,0 +1,506 @@
+/*
+ * Author: 			Ben Tomlin
+ * Student Id:		btomlin
+ * Student Nbr:		834198
+ * Date:			Oct 2026
+ *
+ * Server configuration file. One directive per line, arguments separated by
+ * whitespace, '#' starts a comment;
+ *
+ * 	gzip on
+ * 	gzip_cache_size 64m
+ * 	listen [::1]:8443 backlog=1024 nodelay sndbuf=256k
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <limits.h>
+
+#include "config.h"
+#include "utility/bool.h"
+#include "utility/logger.h"
+
+config_t serverConfig;
+
+typedef struct directive {
+	char* name;
+	int (*set)(void* field, char** args, int nArgs);
+	void* field;
+} directive_t;
+
+int _setFlag(void* field, char** args, int nArgs);
+int _setInt(void* field, char** args, int nArgs);
+int _setCount(void* field, char** args, int nArgs);
+int _setPositive(void* field, char** args, int nArgs);
+int _setGzipLevel(void* field, char** args, int nArgs);
+int _setSize(void* field, char** args, int nArgs);
+int _setString(void* field, char** args, int nArgs);
+int _setLogLevel(void* field, char** args, int nArgs);
+int _setAccessLogFormat(void* field, char** args, int nArgs);
+int _setLimitResponse(void* field, char** args, int nArgs);
+int _setListen(void* field, char** args, int nArgs);
+int _setListenOption(listener_t* l, char* option);
+int _setProxyPass(void* field, char** args, int nArgs);
+int _setFastCgiPass(void* field, char** args, int nArgs);
+int _setCacheControl(void* field, char** args, int nArgs);
+int _setCacheAge(void* field, char** args, int nArgs);
+int _parseSize(char* s, long* size);
+int _splitArgs(char* line, char** args);
+void _applyDirective(char** args, int nArgs, int lineNumber);
+void _handleConfigError(char* message, int lineNumber);
+
+static directive_t directives[] = {
+	{"gzip", _setFlag, &serverConfig.gzip},
+	{"gzip_level", _setGzipLevel, &serverConfig.gzipLevel},
+	{"gzip_min_length", _setSize, &serverConfig.gzipMinLength},
+	{"gzip_cache_size", _setSize, &serverConfig.gzipCacheSize},
+	{"gzip_cache_max_file", _setSize, &serverConfig.gzipCacheMaxFile},
+	{"response_cache_size", _setSize, &serverConfig.responseCacheSize},
+	{"response_cache_max_file", _setSize, &serverConfig.responseCacheMaxFile},
+	{"open_file_cache", _setCount, &serverConfig.openFileCache},
+	{"open_file_cache_valid", _setInt, &serverConfig.openFileValid},
+	{"open_file_cache_inactive", _setPositive, &serverConfig.openFileInactive},
+	{"not_found_cache", _setInt, &serverConfig.notFoundCache},
+	{"not_found_cache_valid", _setInt, &serverConfig.notFoundCacheValid},
+	{"mime_types", _setString, &serverConfig.mimeTypes},
+	{"pack", _setString, &serverConfig.pack},
+	{"index", _setString, &serverConfig.index},
+	{"autoindex", _setFlag, &serverConfig.autoindex},
+	{"log_level", _setLogLevel, &serverConfig.logLevel},
+	{"log_file", _setString, &serverConfig.logFile},
+	{"access_log", _setString, &serverConfig.accessLog},
+	{"access_log_format", _setAccessLogFormat, &serverConfig.accessLogFormat},
+	{"server_status", _setFlag, &serverConfig.serverStatus},
+	{"listen", _setListen, &serverConfig.listeners},
+	{"idle_timeout", _setInt, &serverConfig.idleTimeout},
+	{"header_timeout", _setInt, &serverConfig.headerTimeout},
+	{"send_timeout", _setInt, &serverConfig.sendTimeout},
+	{"limit_conn", _setInt, &serverConfig.limitConn},
+	{"limit_rate", _setInt, &serverConfig.limitRate},
+	{"limit_burst", _setInt, &serverConfig.limitBurst},
+	{"limit_response", _setLimitResponse, &serverConfig.limitResponse},
+	{"ssl_certificate", _setString, &serverConfig.sslCertificate},
+	{"ssl_certificate_key", _setString, &serverConfig.sslCertificateKey},
+	{"ssl_session_cache", _setInt, &serverConfig.sslSessionCache},
+	{"ssl_session_timeout", _setInt, &serverConfig.sslSessionTimeout},
+	{"ssl_session_tickets", _setFlag, &serverConfig.sslSessionTickets},
+	{"ssl_ktls", _setFlag, &serverConfig.sslKtls},
+	{"proxy_pass", _setProxyPass, &serverConfig.proxyRoutes},
+	{"proxy_keepalive", _setPositive, &serverConfig.proxyKeepalive},
+	{"proxy_timeout", _setPositive, &serverConfig.proxyTimeout},
+	{"fastcgi_pass", _setFastCgiPass, &serverConfig.fastCgiRoutes},
+	{"fastcgi_connections", _setPositive, &serverConfig.fastCgiConnections},
+	{"fastcgi_timeout", _setPositive, &serverConfig.fastCgiTimeout},
+	{"cache_control", _setCacheControl, &serverConfig.cacheRules},
+	{"cache_fingerprinted", _setCacheAge, &serverConfig.cacheFingerprinted},
+	{"disk_threads", _setInt, &serverConfig.diskThreads},
+	{NULL, NULL, NULL}
+};
+
+
+void initConfig() {
+	/* Load compiled in defaults. Call before loadConfig() */
+	serverConfig.gzip=DEFAULT_GZIP;
+	serverConfig.gzipLevel=DEFAULT_GZIP_LEVEL;
+	serverConfig.gzipMinLength=DEFAULT_GZIP_MIN_LENGTH;
+	serverConfig.gzipCacheSize=DEFAULT_GZIP_CACHE_SIZE;
+	serverConfig.gzipCacheMaxFile=DEFAULT_GZIP_CACHE_MAX_FILE;
+	serverConfig.responseCacheSize=DEFAULT_RESPONSE_CACHE_SIZE;
+	serverConfig.responseCacheMaxFile=DEFAULT_RESPONSE_CACHE_MAX_FILE;
+	serverConfig.openFileCache=DEFAULT_OPEN_FILE_CACHE;
+	serverConfig.openFileValid=DEFAULT_OPEN_FILE_VALID;
+	serverConfig.openFileInactive=DEFAULT_OPEN_FILE_INACTIVE;
+	serverConfig.notFoundCache=DEFAULT_NOT_FOUND_CACHE;
+	serverConfig.notFoundCacheValid=DEFAULT_NOT_FOUND_CACHE_VALID;
+	serverConfig.mimeTypes=strdup(DEFAULT_MIME_TYPES);
+	serverConfig.pack=DEFAULT_PACK;
+	serverConfig.index=strdup(DEFAULT_INDEX);
+	serverConfig.autoindex=DEFAULT_AUTOINDEX;
+	serverConfig.logLevel=DEFAULT_LOG_LEVEL;
+	serverConfig.logFile=DEFAULT_LOG_FILE;
+	serverConfig.accessLog=DEFAULT_ACCESS_LOG;
+	serverConfig.accessLogFormat=DEFAULT_ACCESS_LOG_FORMAT;
+	serverConfig.serverStatus=DEFAULT_SERVER_STATUS;
+	serverConfig.listeners=DEFAULT_LISTENERS;
+	serverConfig.idleTimeout=DEFAULT_IDLE_TIMEOUT;
+	serverConfig.headerTimeout=DEFAULT_HEADER_TIMEOUT;
+	serverConfig.sendTimeout=DEFAULT_SEND_TIMEOUT;
+	serverConfig.limitConn=DEFAULT_LIMIT_CONN;
+	serverConfig.limitRate=DEFAULT_LIMIT_RATE;
+	serverConfig.limitBurst=DEFAULT_LIMIT_BURST;
+	serverConfig.limitResponse=DEFAULT_LIMIT_RESPONSE;
+	serverConfig.sslCertificate=DEFAULT_SSL_CERTIFICATE;
+	serverConfig.sslCertificateKey=DEFAULT_SSL_CERTIFICATE_KEY;
+	serverConfig.sslSessionCache=DEFAULT_SSL_SESSION_CACHE;
+	serverConfig.sslSessionTimeout=DEFAULT_SSL_SESSION_TIMEOUT;
+	serverConfig.sslSessionTickets=DEFAULT_SSL_SESSION_TICKETS;
+	serverConfig.sslKtls=DEFAULT_SSL_KTLS;
+	serverConfig.proxyRoutes=DEFAULT_PROXY_ROUTES;
+	serverConfig.proxyKeepalive=DEFAULT_PROXY_KEEPALIVE;
+	serverConfig.proxyTimeout=DEFAULT_PROXY_TIMEOUT;
+	serverConfig.fastCgiRoutes=DEFAULT_FASTCGI_ROUTES;
+	serverConfig.fastCgiConnections=DEFAULT_FASTCGI_CONNECTIONS;
+	serverConfig.fastCgiTimeout=DEFAULT_FASTCGI_TIMEOUT;
+	serverConfig.cacheRules=DEFAULT_CACHE_RULES;
+	serverConfig.cacheFingerprinted=DEFAULT_CACHE_FINGERPRINTED;
+	serverConfig.diskThreads=DEFAULT_DISK_THREADS;
+}
+
+
+void loadConfig(char* path) {
+	/**
+	 * Read configuration file <path> into serverConfig, overriding defaults.
+	 *
+	 * Terminates with ECONFIG if the file cannot be read or a line is invalid
+	 */
+	char line[CONFIG_MAXLINE];
+	char* args[CONFIG_MAXARGS];
+	int nArgs;
+	int lineNumber=0;
+	FILE* f=fopen(path, "r");
+
+	if (f==NULL) {
+		logError("Could not open configuration file %s", path);
+		exit(ECONFIG);
+	}
+
+	while (fgets(line, CONFIG_MAXLINE, f)!=NULL) {
+		lineNumber++;
+		nArgs=_splitArgs(line, args);
+		if (nArgs>0) {
+			_applyDirective(args, nArgs, lineNumber);
+		}
+	}
+	fclose(f);
+
+	/* A result larger than the gzip cache is never kept, so stream those */
+	if (serverConfig.gzipCacheMaxFile>serverConfig.gzipCacheSize) {
+		serverConfig.gzipCacheMaxFile=serverConfig.gzipCacheSize;
+	}
+}
+
+
+int _splitArgs(char* line, char** args) {
+	/**
+	 * Split <line> in place on whitespace into <args>, dropping any comment.
+	 *
+	 * RETURN:
+	 * 	number of arguments found (the directive name included)
+	 */
+	char* comment=strchr(line, '#');
+	char* token;
+	int n=0;
+
+	if (comment!=NULL) {
+		*comment='\0';
+	}
+	for (token=strtok(line, " \t\r\n"); token!=NULL&&n<CONFIG_MAXARGS;
+			token=strtok(NULL, " \t\r\n")) {
+		args[n++]=token;
+	}
+	return(n);
+}
+
+
+void _applyDirective(char** args, int nArgs, int lineNumber) {
+	/* Find the directive named by args[0] and set it from the remaining args */
+	directive_t* d;
+	for (d=directives; d->name!=NULL; d++) {
+		if (strcmp(d->name, args[0])==0) {
+			if (!d->set(d->field, args+1, nArgs-1)) {
+				_handleConfigError("Invalid arguments to directive", lineNumber);
+			}
+			return;
+		}
+	}
+	_handleConfigError("Unknown directive", lineNumber);
+}
+
+
+int _setFlag(void* field, char** args, int nArgs) {
+	/* "on" or "off" */
+	if (nArgs!=1) {
+		return(false);
+	}
+	if (strcasecmp(args[0], "on")==0) {
+		*(int*)field=true;
+	} else if (strcasecmp(args[0], "off")==0) {
+		*(int*)field=false;
+	} else {
+		return(false);
+	}
+	return(true);
+}
+
+
+int _setInt(void* field, char** args, int nArgs) {
+	char* end;
+	if (nArgs!=1) {
+		return(false);
+	}
+	*(int*)field=strtol(args[0], &end, 10);
+	return(*end=='\0');
+}
+
+
+int _setCount(void* field, char** args, int nArgs) {
+	/* An integer of at least 0 */
+	return(_setInt(field, args, nArgs)&&*(int*)field>=0);
+}
+
+
+int _setPositive(void* field, char** args, int nArgs) {
+	/* An integer of at least 1 */
+	return(_setInt(field, args, nArgs)&&*(int*)field>=1);
+}
+
+
+int _setGzipLevel(void* field, char** args, int nArgs) {
+	/* A zlib level, 1 (fastest) to 9 (smallest) */
+	return(_setInt(field, args, nArgs)&&*(int*)field>=1&&*(int*)field<=9);
+}
+
+
+int _setSize(void* field, char** args, int nArgs) {
+	if (nArgs!=1) {
+		return(false);
+	}
+	return(_parseSize(args[0], (long*)field));
+}
+
+
+int _setString(void* field, char** args, int nArgs) {
+	if (nArgs!=1) {
+		return(false);
+	}
+	free(*(char**)field);
+	*(char**)field=strdup(args[0]);
+	return(true);
+}
+
+
+int _setLogLevel(void* field, char** args, int nArgs) {
+	/* error, warn, info or debug */
+	if (nArgs!=1||parseLogLevel(args[0])<0) {
+		return(false);
+	}
+	*(int*)field=parseLogLevel(args[0]);
+	return(true);
+}
+
+
+int _setAccessLogFormat(void* field, char** args, int nArgs) {
+	/* common, combined or json */
+	if (nArgs!=1||parseAccessLogFormat(args[0])<0) {
+		return(false);
+	}
+	*(int*)field=parseAccessLogFormat(args[0]);
+	return(true);
+}
+
+
+int _setLimitResponse(void* field, char** args, int nArgs) {
+	/* 429 or close */
+	if (nArgs!=1||parseLimitResponse(args[0])<0) {
+		return(false);
+	}
+	*(int*)field=parseLimitResponse(args[0]);
+	return(true);
+}
+
+
+int _setListen(void* field, char** args, int nArgs) {
+	/**
+	 * An address (see listener.c) then options, appended to the list;
+	 *
+	 * 	backlog=n defer_accept=seconds fastopen=n sndbuf=size rcvbuf=size
+	 * 	nodelay ipv6only
+	 */
+	listener_t** tail=field;
+	listener_t* l;
+	int i;
+
+	if (nArgs<1) {
+		return(false);
+	}
+	l=initListener();
+	if (!parseListenAddress(args[0], l)) {
+		free(l);
+		return(false);
+	}
+	for (i=1; i<nArgs; i++) {
+		if (!_setListenOption(l, args[i])) {
+			free(l);
+			return(false);
+		}
+	}
+	while (*tail!=NULL) {
+		tail=&(*tail)->next;
+	}
+	*tail=l;
+	return(true);
+}
+
+
+int _setListenOption(listener_t* l, char* option) {
+	/* One name or name=value listen option into <l> */
+	char* value=strchr(option, '=');
+	char* end;
+	long n;
+
+	if (value==NULL) {
+		if (strcmp(option, "nodelay")==0) {
+			l->noDelay=true;
+		} else if (strcmp(option, "ipv6only")==0) {
+			l->ipv6Only=true;
+		} else if (strcmp(option, "ssl")==0) {
+			l->tls=true;
+		} else {
+			return(false);
+		}
+		return(true);
+	}
+
+	*value++='\0';
+	if (strcmp(option, "sndbuf")==0||strcmp(option, "rcvbuf")==0) {
+		if (!_parseSize(value, &n)||n>INT_MAX) {
+			return(false);
+		}
+	} else {
+		n=strtol(value, &end, 10);
+		if (end==value||*end!='\0'||n<0||n>INT_MAX) {
+			return(false);
+		}
+	}
+
+	if (strcmp(option, "backlog")==0&&n>0) {
+		l->backlog=n;
+	} else if (strcmp(option, "defer_accept")==0) {
+		l->deferAccept=n;
+	} else if (strcmp(option, "fastopen")==0) {
+		l->fastOpen=n;
+	} else if (strcmp(option, "sndbuf")==0) {
+		l->sendBuffer=n;
+	} else if (strcmp(option, "rcvbuf")==0) {
+		l->receiveBuffer=n;
+	} else {
+		return(false);
+	}
+	return(true);
+}
+
+
+int _setProxyPass(void* field, char** args, int nArgs) {
+	/* A URI prefix then an upstream address (see proxy.c), appended */
+	proxyRoute_t** tail=field;
+	proxyRoute_t* route;
+
+	if (nArgs!=2) {
+		return(false);
+	}
+	route=malloc(sizeof(proxyRoute_t));
+	if (!parseProxyRoute(args[0], args[1], route)) {
+		free(route);
+		return(false);
+	}
+	while (*tail!=NULL) {
+		tail=&(*tail)->next;
+	}
+	*tail=route;
+	return(true);
+}
+
+
+int _setFastCgiPass(void* field, char** args, int nArgs) {
+	/* A path pattern (POSIX ERE) then an application address, appended */
+	fastCgiRoute_t** tail=field;
+	fastCgiRoute_t* route;
+
+	if (nArgs!=2) {
+		return(false);
+	}
+	route=malloc(sizeof(fastCgiRoute_t));
+	if (!parseFastCgiRoute(args[0], args[1], route)) {
+		free(route);
+		return(false);
+	}
+	while (*tail!=NULL) {
+		tail=&(*tail)->next;
+	}
+	*tail=route;
+	return(true);
+}
+
+
+int _setCacheControl(void* field, char** args, int nArgs) {
+	/* A pattern (see cachePolicy.c), an age or off, then immutable */
+	cacheRule_t** tail=field;
+	cacheRule_t* rule;
+
+	if (nArgs<2||nArgs>3) {
+		return(false);
+	}
+	rule=malloc(sizeof(cacheRule_t));
+	if (!parseCacheRule(args[0], args[1], nArgs==3?args[2]:NULL, rule)) {
+		free(rule);
+		return(false);
+	}
+	while (*tail!=NULL) {
+		tail=&(*tail)->next;
+	}
+	*tail=rule;
+	return(true);
+}
+
+
+int _setCacheAge(void* field, char** args, int nArgs) {
+	/* A duration, ie "1y", or off */
+	if (nArgs!=1) {
+		return(false);
+	}
+	if (strcmp(args[0], "off")==0) {
+		*(long*)field=CACHE_AGE_OFF;
+		return(true);
+	}
+	return(parseCacheAge(args[0], field));
+}
+
+
+int _parseSize(char* s, long* size) {
+	/**
+	 * Parse a byte count with an optional k, m or g suffix, ie "64m"
+	 *
+	 * RETURN:
+	 * 	true if <s> was a valid size, which is written into <size>
+	 */
+	char* end;
+	long n=strtol(s, &end, 10);
+
+	switch (*end) {
+	case 'k': case 'K':
+		n*=1024;
+		end++;
+		break;
+	case 'm': case 'M':
+		n*=1024*1024;
+		end++;
+		break;
+	case 'g': case 'G':
+		n*=1024*1024*1024L;
+		end++;
+		break;
+	}
+	if (end==s||*end!='\0'||n<0) {
+		return(false);
+	}
+	*size=n;
+	return(true);
+}
+
+
+void _handleConfigError(char* message, int lineNumber) {
+	logError("%s, configuration line %d", message, lineNumber);
+	exit(ECONFIG);
+}
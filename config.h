@@ -0,0 +1,158 @@
+/*
+ * Author: 			Ben Tomlin
+ * Student Id:		btomlin
+ * Student Nbr:		834198
+ * Date:			Oct 2026
+ */
+
+#ifndef CONFIG_H_
+#define CONFIG_H_
+
+#include "utility/logger.h"
+#include "http/accessLog.h"
+#include "utility/listener.h"
+#include "utility/rateLimit.h"
+#include "http/proxy.h"
+#include "http/fastCgi.h"
+#include "http/cachePolicy.h"
+
+#define ECONFIG 		  31 // Configuration file missing or invalid
+#define CONFIG_MAXLINE  1024 // Longest configuration line
+#define CONFIG_MAXARGS  16	 // Most arguments to a single directive
+
+/* Defaults used for any directive absent from the configuration file */
+#define DEFAULT_GZIP				0
+#define DEFAULT_GZIP_LEVEL		6
+#define DEFAULT_GZIP_MIN_LENGTH	1024
+#define DEFAULT_GZIP_CACHE_SIZE	(32*1024*1024)
+#define DEFAULT_GZIP_CACHE_MAX_FILE (1024*1024) // Larger files are streamed
+#define DEFAULT_OPEN_FILE_CACHE	256	 // Files held open, 0 disables
+#define DEFAULT_OPEN_FILE_VALID	5	 // Seconds before an entry is rechecked
+#define DEFAULT_OPEN_FILE_INACTIVE 60 // Seconds before an unused entry closes
+#define DEFAULT_NOT_FOUND_CACHE	4096 // Missing URIs remembered, 0 disables
+#define DEFAULT_NOT_FOUND_CACHE_VALID 60 // Seconds a missing URI is trusted
+#define DEFAULT_MIME_TYPES		"/etc/mime.types"
+#define DEFAULT_INDEX			"index.html"
+#define DEFAULT_AUTOINDEX		0
+#define DEFAULT_LOG_LEVEL		LOG_INFO
+#define DEFAULT_LOG_FILE		NULL // Standard output
+#define DEFAULT_ACCESS_LOG		NULL // No access log
+#define DEFAULT_ACCESS_LOG_FORMAT ACCESSLOG_COMBINED
+#define DEFAULT_SERVER_STATUS	0
+#define DEFAULT_LISTENERS		NULL // Only the port argument
+#define DEFAULT_IDLE_TIMEOUT	10	 // Seconds to the end of the request line
+#define DEFAULT_HEADER_TIMEOUT	10	 // Seconds to the end of the header
+#define DEFAULT_SEND_TIMEOUT	30	 // Seconds between writes of the response
+#define DEFAULT_LIMIT_CONN		0	 // Connections per client, 0 unlimited
+#define DEFAULT_LIMIT_RATE		0	 // Requests per second per client, 0 unlimited
+#define DEFAULT_LIMIT_BURST		10
+#define DEFAULT_LIMIT_RESPONSE	LIMIT_RESPONSE_429
+#define DEFAULT_RESPONSE_CACHE_SIZE (16*1024*1024)
+#define DEFAULT_RESPONSE_CACHE_MAX_FILE (64*1024) // Larger files are sendfile()d
+#define DEFAULT_PACK			NULL // Serve from the document root only
+#define DEFAULT_SSL_CERTIFICATE	NULL
+#define DEFAULT_SSL_CERTIFICATE_KEY NULL // In the certificate file
+#define DEFAULT_SSL_SESSION_CACHE 20480 // Sessions resumable by id
+#define DEFAULT_SSL_SESSION_TIMEOUT 300 // Seconds a session may be resumed
+#define DEFAULT_SSL_SESSION_TICKETS 1
+#define DEFAULT_SSL_KTLS		1
+#define DEFAULT_PROXY_ROUTES	NULL // Nothing proxied
+#define DEFAULT_PROXY_KEEPALIVE	8	 // Idle connections kept per upstream
+#define DEFAULT_PROXY_TIMEOUT	30	 // Seconds to connect, send or read upstream
+#define DEFAULT_FASTCGI_ROUTES	NULL // No applications
+#define DEFAULT_FASTCGI_CONNECTIONS 4 // Persistent connections per application
+#define DEFAULT_FASTCGI_TIMEOUT	30	 // Seconds to a response header
+#define DEFAULT_CACHE_RULES		NULL // No freshness headers
+#define DEFAULT_CACHE_FINGERPRINTED CACHE_AGE_OFF // Hashed names, opt in
+#define DEFAULT_DISK_THREADS	4	 // Reading cold files, 0 reads on the worker
+
+typedef struct config config_t;
+
+struct config {
+	/* On the fly compression */
+	int gzip;					// Compress responses without a .gz sibling
+	int gzipLevel;				// zlib compression level [1, 9]
+	long gzipMinLength;			// Smallest file worth compressing [bytes]
+	long gzipCacheSize;			// Memory bound of compressed results [bytes]
+	long gzipCacheMaxFile;		// Largest file whose result is cached [bytes]
+
+	/* Whole serialized responses of small files */
+	long responseCacheSize;		// Memory bound [bytes], 0 disables
+	long responseCacheMaxFile;	// Largest entity cached [bytes]
+
+	/* Open file descriptor & stat cache */
+	int openFileCache;
+	int openFileValid;
+	int openFileInactive;
+
+	/* URIs recently found missing, see notFoundCache.c */
+	int notFoundCache;
+	int notFoundCacheValid;
+
+	/* Extension to MIME type table loaded over the built in defaults */
+	char* mimeTypes;
+
+	/* Pack file served ahead of the document root, see packFile.c */
+	char* pack;
+
+	/* Directory requests */
+	char* index;				// File served for a directory
+	int autoindex;				// List directories without an index file
+
+	/* Server log */
+	int logLevel;				// Most verbose level written, see logger.h
+	char* logFile;				// Appended to, NULL for standard output
+
+	/* Access log */
+	char* accessLog;			// Appended to, NULL disables
+	int accessLogFormat;		// See accessLog.h
+
+	/* Serve metrics at STATUS_URI, see serverStatus.h */
+	int serverStatus;
+
+	/* Listeners opened besides the port argument, in configured order */
+	listener_t* listeners;
+
+	/* Connection deadlines [seconds], 0 disables. See deadline.c */
+	int idleTimeout;
+	int headerTimeout;
+	int sendTimeout;
+
+	/* Per client limits, see rateLimit.c */
+	int limitConn;
+	int limitRate;
+	int limitBurst;
+	int limitResponse;			// LIMIT_RESPONSE_429 or LIMIT_RESPONSE_CLOSE
+
+	/* TLS for listeners with the ssl option, see tls.c */
+	char* sslCertificate;		// PEM chain, the server certificate first
+	char* sslCertificateKey;	// PEM key, NULL if in the certificate file
+	int sslSessionCache;		// 0 disables resumption by session id
+	int sslSessionTimeout;
+	int sslSessionTickets;
+	int sslKtls;				// Kernel TLS where supported, for sendfile()
+
+	/* Reverse proxy, see proxy.c */
+	proxyRoute_t* proxyRoutes;	// Matched in configured order
+	int proxyKeepalive;			// Idle connections pooled per upstream
+	int proxyTimeout;			// Upstream socket timeout [seconds]
+
+	/* FastCGI applications, see fastCgi.c */
+	fastCgiRoute_t* fastCgiRoutes;	// Matched in configured order
+	int fastCgiConnections;		// Persistent connections per application
+	int fastCgiTimeout;			// Wait for a connection or header [seconds]
+
+	/* Freshness of static responses, see cachePolicy.c */
+	cacheRule_t* cacheRules;	// First match applies
+	long cacheFingerprinted;	// [seconds], CACHE_AGE_OFF disables
+
+	/* Cold file reads, see diskIo.c */
+	int diskThreads;
+};
+
+extern config_t serverConfig;
+
+void initConfig();
+void loadConfig(char* path);
+
+#endif /* CONFIG_H_ */
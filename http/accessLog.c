@@ -0,0 +1,406 @@
+/*
+ * Author: 			Ben Tomlin
+ * Student Id:		btomlin
+ * Student Nbr:		834198
+ * Date:			Oct 2026
+ *
+ * Access log in Common, Combined or JSON lines format.
+ *
+ * Request threads format their record on the stack and copy it into a byte
+ * ring they own, without locking or a system call. A flusher thread gathers
+ * every ring into a single writev() every ACCESSLOG_FLUSH_US. A thread whose
+ * ring is full, or that found no free ring, writes its record directly.
+ *
+ * SIGHUP reopens the log file (after logrotate has moved it), records still
+ * buffered at that point go to the old file.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "accessLog.h"
+#include "./../utility/logger.h"
+#include "./../utility/bool.h"
+
+typedef struct accessBuffer {
+	atomic_int owned;			// Claimed by a live thread
+	atomic_ulong head;			// Bytes ever appended by the owner
+	atomic_ulong tail;			// Bytes ever written out by the flusher
+	time_t timeSecond;			// Second <timeText> was formatted for
+	char timeText[40];
+	char bytes[ACCESSLOG_BUFFER_SIZE];
+} accessBuffer_t;
+
+static char* formatNames[]={"common", "combined", "json"};
+static accessBuffer_t buffers[ACCESSLOG_BUFFERS];
+static char* logPath;
+static int logFd=-1;
+static int logFormat;
+static volatile sig_atomic_t reopenRequested;
+static pthread_t flusher;
+static pthread_key_t threadBuffer;
+static pthread_mutex_t writeLock=PTHREAD_MUTEX_INITIALIZER;
+
+int _openAccessLog();
+void _onHangup(int signal);
+void _accessBufferRelease(void* buffer);
+accessBuffer_t* _accessBufferGet();
+int _formatAccessRecord(accessRecord_t* r, accessBuffer_t* b, char* out,
+		int outSize);
+char* _formatTime(accessBuffer_t* b, time_t second);
+void _peerAddress(int socketFd, char* out, int outSize);
+int _put(char* out, int outSize, int n, const char* format, ...);
+int _putEscaped(char* out, int outSize, int n, char* s, int json);
+void _writeRecord(char* record, int length);
+void _flushBuffers();
+void* _accessLogFlusher(void* unused);
+void _flushAtExit();
+
+
+int parseAccessLogFormat(char* name) {
+	/* Format named <name> (common, combined, json), -1 if unknown */
+	int i;
+	for (i=ACCESSLOG_COMMON; i<=ACCESSLOG_JSON; i++) {
+		if (strcmp(name, formatNames[i])==0) {
+			return(i);
+		}
+	}
+	return(-1);
+}
+
+
+void initAccessLog(char* path, int format) {
+	/**
+	 * Open access log <path> for appending and start the flusher.
+	 *
+	 * Terminates with EACCESSLOG if the file cannot be opened
+	 */
+	struct sigaction hangup;
+
+	logPath=strdup(path);
+	logFormat=format;
+	logFd=_openAccessLog();
+	if (logFd<0) {
+		logError("Could not open access log %s", path);
+		exit(EACCESSLOG);
+	}
+	pthread_key_create(&threadBuffer, _accessBufferRelease);
+
+	memset(&hangup, 0, sizeof(hangup));
+	hangup.sa_handler=_onHangup;
+	hangup.sa_flags=SA_RESTART;
+	sigaction(SIGHUP, &hangup, NULL);
+
+	atexit(_flushAtExit);
+	pthread_create(&flusher, NULL, _accessLogFlusher, NULL);
+}
+
+
+int accessLogEnabled() {
+	return(logFd>=0);
+}
+
+
+void accessLogWrite(accessRecord_t* r) {
+	/* Log a served request, buffering it in the calling thread's ring */
+	char record[ACCESSLOG_MAXRECORD];
+	accessBuffer_t* b=_accessBufferGet();
+	unsigned long head;
+	unsigned long offset;
+	int length;
+	int first;
+
+	length=_formatAccessRecord(r, b, record, ACCESSLOG_MAXRECORD);
+	if (b==NULL) {
+		_writeRecord(record, length);
+		return;
+	}
+
+	head=atomic_load_explicit(&b->head, memory_order_relaxed);
+	if (ACCESSLOG_BUFFER_SIZE-(head-atomic_load_explicit(&b->tail,
+			memory_order_acquire))<length) {
+		_writeRecord(record, length);
+		return;
+	}
+
+	/* Copy in, wrapping around the end of the ring */
+	offset=head&(ACCESSLOG_BUFFER_SIZE-1);
+	first=ACCESSLOG_BUFFER_SIZE-offset;
+	if (first>length) {
+		first=length;
+	}
+	memcpy(b->bytes+offset, record, first);
+	memcpy(b->bytes, record+first, length-first);
+	atomic_store_explicit(&b->head, head+length, memory_order_release);
+}
+
+
+int _openAccessLog() {
+	return(open(logPath, O_WRONLY|O_APPEND|O_CREAT|O_CLOEXEC, 0644));
+}
+
+
+void _onHangup(int signal) {
+	reopenRequested=true;
+}
+
+
+accessBuffer_t* _accessBufferGet() {
+	/* Ring owned by the calling thread, claiming a free one on first use */
+	accessBuffer_t* b=pthread_getspecific(threadBuffer);
+	int expected;
+	int i;
+
+	if (b!=NULL) {
+		return(b);
+	}
+	for (i=0; i<ACCESSLOG_BUFFERS; i++) {
+		expected=false;
+		if (atomic_compare_exchange_strong(&buffers[i].owned, &expected,
+				true)) {
+			pthread_setspecific(threadBuffer, &buffers[i]);
+			return(&buffers[i]);
+		}
+	}
+	return(NULL);
+}
+
+
+void _accessBufferRelease(void* buffer) {
+	/* Thread exit, the flusher still writes out anything left in the ring */
+	atomic_store_explicit(&((accessBuffer_t*)buffer)->owned, false,
+			memory_order_release);
+}
+
+
+int _formatAccessRecord(accessRecord_t* r, accessBuffer_t* b, char* out,
+		int outSize) {
+	/**
+	 * Render <r> as one log line in the configured format.
+	 *
+	 * RETURN:
+	 * 	length of the line written into <out>, newline included
+	 */
+	accessBuffer_t local;
+	char peer[INET6_ADDRSTRLEN];
+	char* timeText;
+	int json=(logFormat==ACCESSLOG_JSON);
+	int n;
+
+	if (b==NULL) {
+		local.timeSecond=0;
+		b=&local;
+	}
+	timeText=_formatTime(b, r->start.tv_sec);
+	_peerAddress(r->socketFd, peer, sizeof(peer));
+	outSize-=1; // Room for the newline, even if truncated
+
+	if (json) {
+		n=_put(out, outSize, 0, "{\"time\":\"%s\",\"remote\":\"%s\","
+				"\"method\":\"", timeText, peer);
+		n=_putEscaped(out, outSize, n, r->method, json);
+		n=_put(out, outSize, n, "\",\"uri\":\"");
+		n=_putEscaped(out, outSize, n, r->uri, json);
+		n=_put(out, outSize, n, "\",\"protocol\":\"");
+		n=_putEscaped(out, outSize, n, r->httpVersion, json);
+		n=_put(out, outSize, n, "\",\"status\":%s,\"bytes\":%ld,"
+				"\"duration_us\":%ld,\"referer\":\"", r->status, r->bytes,
+				r->durationUs);
+		n=_putEscaped(out, outSize, n, r->referrer, json);
+		n=_put(out, outSize, n, "\",\"user_agent\":\"");
+		n=_putEscaped(out, outSize, n, r->userAgent, json);
+		n=_put(out, outSize, n, "\"}");
+	} else {
+		n=_put(out, outSize, 0, "%s - - [%s] \"", peer, timeText);
+		n=_putEscaped(out, outSize, n, r->method, json);
+		n=_put(out, outSize, n, " ");
+		n=_putEscaped(out, outSize, n, r->uri, json);
+		n=_put(out, outSize, n, " ");
+		n=_putEscaped(out, outSize, n, r->httpVersion, json);
+		n=_put(out, outSize, n, "\" %s %ld", r->status, r->bytes);
+		if (logFormat==ACCESSLOG_COMBINED) {
+			n=_put(out, outSize, n, " \"");
+			n=_putEscaped(out, outSize, n, r->referrer, json);
+			n=_put(out, outSize, n, "\" \"");
+			n=_putEscaped(out, outSize, n, r->userAgent, json);
+			n=_put(out, outSize, n, "\"");
+		}
+		n=_put(out, outSize, n, " %ld", r->durationUs);
+	}
+
+	out[n++]='\n';
+	return(n);
+}
+
+
+char* _formatTime(accessBuffer_t* b, time_t second) {
+	/* Request time in the format's style, formatted once per second */
+	struct tm t;
+	if (b->timeSecond!=second) {
+		localtime_r(&second, &t);
+		strftime(b->timeText, sizeof(b->timeText),
+				logFormat==ACCESSLOG_JSON?"%Y-%m-%dT%H:%M:%S%z":
+						"%d/%b/%Y:%H:%M:%S %z", &t);
+		b->timeSecond=second;
+	}
+	return(b->timeText);
+}
+
+
+void _peerAddress(int socketFd, char* out, int outSize) {
+	/* Text form of the connected peer's address, "-" if not an IP socket */
+	struct sockaddr_storage address;
+	socklen_t length=sizeof(address);
+
+	strcpy(out, "-");
+	if (getpeername(socketFd, (struct sockaddr*)&address, &length)!=0) {
+		return;
+	}
+	if (address.ss_family==AF_INET) {
+		inet_ntop(AF_INET, &((struct sockaddr_in*)&address)->sin_addr, out,
+				outSize);
+	} else if (address.ss_family==AF_INET6) {
+		inet_ntop(AF_INET6, &((struct sockaddr_in6*)&address)->sin6_addr, out,
+				outSize);
+	}
+}
+
+
+int _put(char* out, int outSize, int n, const char* format, ...) {
+	/**
+	 * snprintf() onto the end of the first <n> bytes of <out>.
+	 *
+	 * RETURN:
+	 * 	new length, clamped to outSize-1 if the output was truncated
+	 */
+	va_list args;
+	int written;
+
+	va_start(args, format);
+	written=vsnprintf(out+n, outSize-n, format, args);
+	va_end(args);
+	return((written<0||n+written>=outSize)?outSize-1:n+written);
+}
+
+
+int _putEscaped(char* out, int outSize, int n, char* s, int json) {
+	/**
+	 * Append <s>, escaping quotes, backslashes and control bytes (\xHH in
+	 * CLF, \u00HH in JSON) so a client cannot forge log lines. NULL is
+	 * logged as "-". Stops short rather than split an escape.
+	 *
+	 * RETURN:
+	 * 	new length of <out>
+	 */
+	unsigned char c;
+
+	if (s==NULL) {
+		s="-";
+	}
+	for (; *s!='\0'&&n<outSize-7; s++) {
+		c=*s;
+		if (c=='"'||c=='\\') {
+			out[n++]='\\';
+			out[n++]=c;
+		} else if (c<0x20||c>=0x7f) {
+			n+=sprintf(out+n, json?"\\u%04x":"\\x%02X", c);
+		} else {
+			out[n++]=c;
+		}
+	}
+	out[n]='\0';
+	return(n);
+}
+
+
+void _writeRecord(char* record, int length) {
+	/* Slow path, write a single record now */
+	pthread_mutex_lock(&writeLock);
+	if (write(logFd, record, length)!=length) {
+		logWarn("Access log write failed");
+	}
+	pthread_mutex_unlock(&writeLock);
+}
+
+
+void _flushBuffers() {
+	/* Write every buffered record out in one writev(), serialised with
+	 * the direct writers, the reopen and the exit flush */
+	struct iovec parts[2*ACCESSLOG_BUFFERS];
+	unsigned long heads[ACCESSLOG_BUFFERS];
+	unsigned long tail;
+	unsigned long offset;
+	unsigned long length;
+	int nParts=0;
+	int i;
+
+	pthread_mutex_lock(&writeLock);
+	for (i=0; i<ACCESSLOG_BUFFERS; i++) {
+		heads[i]=atomic_load_explicit(&buffers[i].head, memory_order_acquire);
+		tail=atomic_load_explicit(&buffers[i].tail, memory_order_relaxed);
+		length=heads[i]-tail;
+		if (length==0) {
+			continue;
+		}
+		offset=tail&(ACCESSLOG_BUFFER_SIZE-1);
+		parts[nParts].iov_base=buffers[i].bytes+offset;
+		parts[nParts].iov_len=length;
+		if (offset+length>ACCESSLOG_BUFFER_SIZE) {
+			parts[nParts].iov_len=ACCESSLOG_BUFFER_SIZE-offset;
+			nParts++;
+			parts[nParts].iov_base=buffers[i].bytes;
+			parts[nParts].iov_len=length-(ACCESSLOG_BUFFER_SIZE-offset);
+		}
+		nParts++;
+	}
+	if (nParts>0&&writev(logFd, parts, nParts)<0) {
+		logWarn("Access log write failed");
+	}
+
+	/* Written (or lost to a failed write), hand the space back */
+	for (i=0; i<ACCESSLOG_BUFFERS; i++) {
+		atomic_store_explicit(&buffers[i].tail, heads[i],
+				memory_order_release);
+	}
+	pthread_mutex_unlock(&writeLock);
+}
+
+
+void* _accessLogFlusher(void* unused) {
+	int fd;
+	while (true) {
+		usleep(ACCESSLOG_FLUSH_US);
+		_flushBuffers();
+
+		if (reopenRequested) {
+			reopenRequested=false;
+			fd=_openAccessLog();
+			if (fd<0) {
+				logError("Could not reopen access log %s", logPath);
+				continue;
+			}
+			pthread_mutex_lock(&writeLock);
+			close(logFd);
+			logFd=fd;
+			pthread_mutex_unlock(&writeLock);
+			logInfo("Reopened access log %s", logPath);
+		}
+	}
+	return(NULL);
+}
+
+
+void _flushAtExit() {
+	_flushBuffers();
+}
@@ -0,0 +1,43 @@
+/*
+ * Author: 			Ben Tomlin
+ * Student Id:		btomlin
+ * Student Nbr:		834198
+ * Date:			Oct 2026
+ */
+
+#ifndef HTTP_ACCESSLOG_H_
+#define HTTP_ACCESSLOG_H_
+
+#include <time.h>
+
+#define ACCESSLOG_COMMON	 0	// Common Log Format
+#define ACCESSLOG_COMBINED	 1	// Common, then referrer and user agent
+#define ACCESSLOG_JSON		 2	// One JSON object per line
+
+#define ACCESSLOG_BUFFERS	  16		   // Per thread buffers, more threads write directly
+#define ACCESSLOG_BUFFER_SIZE (128*1024) // Bytes per buffer, a power of two
+#define ACCESSLOG_MAXRECORD	  4096	   // Longer records are truncated
+#define ACCESSLOG_FLUSH_US	  100000	   // Interval the flusher writes buffers out at
+#define EACCESSLOG			  35		   // Access log could not be opened
+
+typedef struct accessRecord accessRecord_t;
+
+struct accessRecord {
+	int socketFd;				// Peer address is read from this
+	struct timespec start;		// Wall clock time the request arrived
+	long durationUs;
+	char* method;
+	char* uri;
+	char* httpVersion;
+	char* status;
+	long bytes;					// Entity bytes sent
+	char* referrer;
+	char* userAgent;
+};
+
+int parseAccessLogFormat(char* name);
+void initAccessLog(char* path, int format);
+int accessLogEnabled();
+void accessLogWrite(accessRecord_t* r);
+
+#endif /* HTTP_ACCESSLOG_H_ */
@@ -0,0 +1,278 @@
+/*
+ * Author: 			Ben Tomlin
+ * Student Id:		btomlin
+ * Student Nbr:		834198
+ * Date:			Oct 2026
+ *
+ * Freshness (Cache-Control and Expires) of static responses, so clients and
+ * shared caches keep assets rather than refetching or revalidating them.
+ *
+ * Files whose URI path holds a content hash (fingerprinted, as asset
+ * pipelines name them) never change under that name, so are sent with
+ * cache_fingerprinted's far future age and "immutable". Other responses take
+ * the first cache_control rule, in configured order, matching their URI path
+ * prefix, file extension or MIME type; no rule, no headers.
+ *
+ * Expires is Cache-Control for HTTP/1.0 caches. It is rounded down to
+ * CACHE_EXPIRES_STEP, erring early, so responses only change (and so miss the
+ * response cache) once a step rather than every second.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <limits.h>
+#include <time.h>
+
+#include "cachePolicy.h"
+#include "uriPath.h"
+#include "./../utility/bool.h"
+#include "./../config.h"
+
+int _cacheRuleMatches(cacheRule_t* rule, char* path, char* servedPath,
+		char* contentType);
+int _cacheHashToken(char* token, int length);
+char* _cacheExpires(long maxAge);
+
+
+int parseCacheRule(char* pattern, char* age, char* option, cacheRule_t* rule) {
+	/**
+	 * Rule giving responses matching <pattern> <age> (see parseCacheAge(), or
+	 * "off" for no headers), and "immutable" if <option> says so.
+	 *
+	 * 	/static/	URI paths under the prefix
+	 * 	.css		Served file names with the extension
+	 * 	image/png	MIME type, or every image type with a trailing '*'
+	 *
+	 * RETURN:
+	 * 	false if the pattern, age or option is malformed
+	 */
+	if (*pattern=='/') {
+		rule->match=CACHE_MATCH_PREFIX;
+	} else if (*pattern=='.'&&pattern[1]!='\0') {
+		rule->match=CACHE_MATCH_EXTENSION;
+	} else if (strchr(pattern, '/')!=NULL) {
+		rule->match=CACHE_MATCH_TYPE;
+	} else {
+		return(false);
+	}
+	if (strcmp(age, "off")==0) {
+		rule->maxAge=CACHE_AGE_OFF;
+	} else if (!parseCacheAge(age, &rule->maxAge)) {
+		return(false);
+	}
+	if (option!=NULL&&(strcmp(option, "immutable")!=0
+			||rule->maxAge==CACHE_AGE_OFF)) {
+		return(false);
+	}
+
+	if (rule->maxAge==0) {
+		strcpy(rule->cacheControl, "no-cache");
+	} else {
+		snprintf(rule->cacheControl, CACHE_MAXHEADER, "max-age=%ld%s",
+				rule->maxAge, option!=NULL?", immutable":"");
+	}
+	rule->pattern=strdup(pattern);
+	rule->patternLength=strlen(pattern);
+	if (rule->match==CACHE_MATCH_TYPE&&pattern[rule->patternLength-1]=='*') {
+		rule->patternLength--;	// Compare "image/" only
+	}
+	rule->next=NULL;
+	return(true);
+}
+
+
+int parseCacheAge(char* s, long* seconds) {
+	/**
+	 * Parse a duration with an optional s, m, h, d, w or y suffix, ie "30d"
+	 *
+	 * RETURN:
+	 * 	true if <s> was a valid duration, which is written into <seconds>
+	 */
+	char* end;
+	long n=strtol(s, &end, 10);
+
+	switch (*end) {
+	case 's':
+		end++;
+		break;
+	case 'm':
+		n*=60;
+		end++;
+		break;
+	case 'h':
+		n*=60*60;
+		end++;
+		break;
+	case 'd':
+		n*=24*60*60;
+		end++;
+		break;
+	case 'w':
+		n*=7*24*60*60;
+		end++;
+		break;
+	case 'y':
+		n*=365*24*60*60L;
+		end++;
+		break;
+	}
+	if (end==s||*end!='\0'||n<0) {
+		return(false);
+	}
+	*seconds=n;
+	return(true);
+}
+
+
+void cachePolicyApply(char* uri, char* servedPath, char* contentType,
+		char** cacheControl, char** expires) {
+	/**
+	 * Set the freshness headers of a 200 response.
+	 *
+	 * ARGUMENT:
+	 * 	uri - as requested
+	 * 	servedPath - path of the file served, the index for a directory
+	 * 	contentType - of the entity
+	 * 	cacheControl, expires - set to allocated values, if any apply
+	 */
+	char path[PATH_MAX];
+	char value[CACHE_MAXHEADER];
+	cacheRule_t* rule;
+
+	if (canonicalizePath(uri, path, PATH_MAX)<0) {
+		return;
+	}
+	if (serverConfig.cacheFingerprinted!=CACHE_AGE_OFF
+			&&isFingerprinted(path)) {
+		snprintf(value, CACHE_MAXHEADER, "max-age=%ld, immutable",
+				serverConfig.cacheFingerprinted);
+		*cacheControl=strdup(value);
+		*expires=_cacheExpires(serverConfig.cacheFingerprinted);
+		return;
+	}
+	for (rule=serverConfig.cacheRules; rule!=NULL; rule=rule->next) {
+		if (_cacheRuleMatches(rule, path, servedPath, contentType)) {
+			if (rule->maxAge!=CACHE_AGE_OFF) {
+				*cacheControl=strdup(rule->cacheControl);
+				*expires=_cacheExpires(rule->maxAge);
+			}
+			return;
+		}
+	}
+}
+
+
+int isFingerprinted(char* path) {
+	/**
+	 * True if the file name of URI <path> holds a content hash, as
+	 * name.HASH.ext or name-HASH.ext. The hash is at least
+	 * CACHE_FINGERPRINT_MIN characters of either hex with both digits and
+	 * letters (app.3f9a2c1b.js, main-5d41402abc4b2a76.css) or base64url with
+	 * digits and both cases but no run of CACHE_FINGERPRINT_RUN lower case
+	 * letters (index-BXk3d9Qa.js).
+	 *
+	 * NOTE:
+	 * 	Directory names, names without a separator before the extension
+	 * 	(iPhone15Pro.html), dates (all digits) and words do not match
+	 */
+	char* name=strrchr(path, '/');
+	char* extension;
+	char* token;
+
+	name=name!=NULL?name+1:path;
+	extension=strrchr(name, '.');
+	if (extension==NULL||extension==name) {
+		return(false);
+	}
+	for (token=extension; token>name; token--) {
+		if (token[-1]=='.'||token[-1]=='-') {
+			break;
+		}
+	}
+	if (token==name) {
+		return(false);
+	}
+	return(extension-token>=CACHE_FINGERPRINT_MIN
+			&&_cacheHashToken(token, extension-token));
+}
+
+
+int _cacheHashToken(char* token, int length) {
+	/* True if <token> looks like a hash, see isFingerprinted() */
+	int digits=0;
+	int hexLetters=0;
+	int upper=0;
+	int lower=0;
+	int lowerRun=0;
+	int longestRun=0;
+	int i;
+
+	for (i=0; i<length; i++) {
+		if (islower((unsigned char)token[i])) {
+			lower++;
+			hexLetters+=(token[i]<='f');
+			lowerRun++;
+			if (lowerRun>longestRun) {
+				longestRun=lowerRun;
+			}
+			continue;
+		}
+		lowerRun=0;
+		if (isdigit((unsigned char)token[i])) {
+			digits++;
+		} else if (isupper((unsigned char)token[i])) {
+			upper++;
+		} else if (token[i]!='_') {
+			return(false);
+		}
+	}
+	if (digits==0) {
+		return(false);
+	}
+	return((hexLetters>0&&hexLetters==length-digits)
+			||(upper>0&&lower>0&&longestRun<CACHE_FINGERPRINT_RUN));
+}
+
+
+int _cacheRuleMatches(cacheRule_t* rule, char* path, char* servedPath,
+		char* contentType) {
+	int length;
+
+	switch (rule->match) {
+		case CACHE_MATCH_PREFIX:
+			return(strncmp(path, rule->pattern, rule->patternLength)==0);
+		case CACHE_MATCH_EXTENSION:
+			length=strlen(servedPath);
+			return(length>=rule->patternLength
+					&&strcasecmp(servedPath+length-rule->patternLength,
+					rule->pattern)==0);
+		case CACHE_MATCH_TYPE:
+			return(contentType!=NULL&&strncasecmp(contentType, rule->pattern,
+					rule->patternLength)==0
+					&&(rule->pattern[rule->patternLength]=='*'
+					||contentType[rule->patternLength]=='\0'
+					||contentType[rule->patternLength]==';'));
+	}
+	return(false);
+}
+
+
+char* _cacheExpires(long maxAge) {
+	/**
+	 * Expires value <maxAge> from now, an allocated HTTP-date. Rounded down
+	 * whatever the age, a short age may already have expired for HTTP/1.0
+	 * caches; HTTP/1.1 ones go by max-age.
+	 */
+	char date[CACHE_MAXHEADER];
+	time_t now=time(NULL);
+	struct tm t;
+
+	now-=now%CACHE_EXPIRES_STEP;
+	now+=maxAge;
+	gmtime_r(&now, &t);
+	strftime(date, CACHE_MAXHEADER, "%a, %d %b %Y %H:%M:%S GMT", &t);
+	return(strdup(date));
+}
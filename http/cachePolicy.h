@@ -0,0 +1,37 @@
+/*
+ * Author: 			Ben Tomlin
+ * Student Id:		btomlin
+ * Student Nbr:		834198
+ * Date:			Oct 2026
+ */
+
+#ifndef HTTP_CACHEPOLICY_H_
+#define HTTP_CACHEPOLICY_H_
+
+#define CACHE_MATCH_PREFIX	  0	 // "/static/", URI paths under it
+#define CACHE_MATCH_EXTENSION 1	 // ".css", served file names ending in it
+#define CACHE_MATCH_TYPE	  2	 // "image/png" or "image/*", by MIME type
+#define CACHE_AGE_OFF		  -1 // A rule sending no caching headers
+#define CACHE_EXPIRES_STEP	  60 // Expires rounded down to [seconds]
+#define CACHE_FINGERPRINT_MIN 8	 // Shortest token taken as a content hash
+#define CACHE_FINGERPRINT_RUN 3	 // Lower case run making a token a word
+#define CACHE_MAXHEADER		  64
+
+typedef struct cacheRule cacheRule_t;
+
+struct cacheRule {			// Freshness of responses matching a pattern
+	int match;				// CACHE_MATCH_
+	char* pattern;
+	int patternLength;
+	long maxAge;			// [seconds], CACHE_AGE_OFF for no headers
+	char cacheControl[CACHE_MAXHEADER];
+	cacheRule_t* next;
+};
+
+int parseCacheRule(char* pattern, char* age, char* option, cacheRule_t* rule);
+int parseCacheAge(char* s, long* seconds);
+void cachePolicyApply(char* uri, char* servedPath, char* contentType,
+		char** cacheControl, char** expires);
+int isFingerprinted(char* path);
+
+#endif /* HTTP_CACHEPOLICY_H_ */
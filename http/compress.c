@@ -0,0 +1,373 @@
+/*
+ * Author: 			Ben Tomlin
+ * Student Id:		btomlin
+ * Student Nbr:		834198
+ * Date:			Oct 2026
+ *
+ * On the fly gzip for files without a precompressed sibling.
+ *
+ * Results for files up to gzip_cache_max_file are kept in an LRU cache bounded
+ * by gzip_cache_size, keyed by path and mtime, so each version of a file is
+ * compressed once. Requests missing on a file already being compressed wait
+ * for that job rather than starting their own. Larger files are compressed
+ * chunk by chunk straight into the socket, so memory use stays bounded.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <zlib.h>
+
+#include "compress.h"
+#include "./../config.h"
+#include "./../utility/bool.h"
+#include "./../utility/hash.h"
+#include "./../utility/logger.h"
+#include "./../utility/filesystem.h"
+#include "./../utility/tcpSocketIo.h"
+#include "./../utility/metrics.h"
+
+static char* compressibleTypes[] = {
+	"application/javascript", "application/json", "application/xml",
+	"application/wasm", "image/svg+xml", "image/x-icon", NULL
+};
+
+/* Cache state, all guarded by cacheLock */
+static gzipEntry_t* buckets[GZIP_CACHE_BUCKETS];
+static gzipEntry_t* lruHead; // Most recently used
+static gzipEntry_t* lruTail;
+static long cacheBytes;
+static pthread_mutex_t cacheLock=PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t jobDone=PTHREAD_COND_INITIALIZER;
+
+gzipEntry_t* _gzipCacheFind(char* path);
+void _gzipCacheInsert(gzipEntry_t* e);
+void _gzipCacheUnlink(gzipEntry_t* e);
+void _gzipLruPushFront(gzipEntry_t* e);
+void _gzipLruRemove(gzipEntry_t* e);
+void _gzipCacheEvict();
+void _freeGzipEntry(gzipEntry_t* e);
+int _gzipCompressFile(gzipEntry_t* e, int fd);
+
+
+int isCompressibleType(char* mimeType) {
+	/* True if responses of <mimeType> are worth compressing */
+	int i;
+	if (mimeType==NULL) {
+		return(false);
+	}
+	if (strncasecmp(mimeType, "text/", 5)==0) {
+		return(true);
+	}
+	for (i=0; compressibleTypes[i]!=NULL; i++) {
+		if (strcasecmp(mimeType, compressibleTypes[i])==0) {
+			return(true);
+		}
+	}
+	return(false);
+}
+
+
+gzipEntry_t* gzipCacheAcquire(char* path, int fd, struct stat* s) {
+	/**
+	 * Get the gzip compressed content of <path>, compressing it if required.
+	 *
+	 * ARGUMENT:
+	 * 	path - file to compress, the cache key
+	 * 	fd - descriptor open on path, only read with pread()
+	 * 	s - current stat of the file, cached results older than it are discarded
+	 *
+	 * RETURN:
+	 * 	Ready cache entry, to be handed back with gzipCacheRelease() once
+	 * 	sent. NULL if the file could not be compressed; send it as is.
+	 */
+	gzipEntry_t* e;
+	int ok;
+
+	pthread_mutex_lock(&cacheLock);
+	e=_gzipCacheFind(path);
+
+	/* File changed since it was compressed */
+	if (e!=NULL&&(e->mtime!=s->st_mtime||e->size!=s->st_size)) {
+		_gzipCacheUnlink(e);
+		e=NULL;
+	}
+
+	/* Hit, or another request is already compressing this file */
+	if (e!=NULL) {
+		e->refCount++;
+		_gzipLruRemove(e);
+		_gzipLruPushFront(e);
+		while (e->state==GZ_PENDING) {
+			pthread_cond_wait(&jobDone, &cacheLock);
+		}
+		if (e->state==GZ_FAILED) {
+			pthread_mutex_unlock(&cacheLock);
+			gzipCacheRelease(e);
+			return(NULL);
+		}
+		pthread_mutex_unlock(&cacheLock);
+		metricsCount(COUNT_GZIP_HIT, 1);
+		return(e);
+	}
+
+	/* Miss, publish a pending entry so concurrent misses wait on this job */
+	e=calloc(1, sizeof(gzipEntry_t));
+	e->path=strdup(path);
+	metricsAllocated(MEM_GZIP, sizeof(gzipEntry_t)+strlen(path)+1);
+	e->mtime=s->st_mtime;
+	e->size=s->st_size;
+	e->state=GZ_PENDING;
+	e->refCount=1;
+	_gzipCacheInsert(e);
+	pthread_mutex_unlock(&cacheLock);
+	metricsCount(COUNT_GZIP_MISS, 1);
+
+	ok=_gzipCompressFile(e, fd);
+
+	pthread_mutex_lock(&cacheLock);
+	if (ok&&e->length<=serverConfig.gzipCacheSize) {
+		e->state=GZ_READY;
+		if (e->linked) {
+			cacheBytes+=e->length;
+			_gzipCacheEvict();
+		}
+	} else {
+		e->state=GZ_FAILED;
+		if (e->linked) {
+			_gzipCacheUnlink(e);
+		}
+	}
+	pthread_cond_broadcast(&jobDone);
+	pthread_mutex_unlock(&cacheLock);
+
+	if (e->state==GZ_FAILED) {
+		gzipCacheRelease(e);
+		return(NULL);
+	}
+	return(e);
+}
+
+
+void gzipCacheRelease(void* entry) {
+	/* Drop a reference taken by gzipCacheAcquire() */
+	gzipEntry_t* e=entry;
+	int unused;
+
+	pthread_mutex_lock(&cacheLock);
+	e->refCount--;
+	unused=(e->refCount==0&&!e->linked);
+	pthread_mutex_unlock(&cacheLock);
+
+	if (unused) {
+		_freeGzipEntry(e);
+	}
+}
+
+
+int _gzipCompressFile(gzipEntry_t* e, int fd) {
+	/**
+	 * Deflate e->size bytes of <fd> into e->data, reading the file in
+	 * GZIP_CHUNK pieces.
+	 *
+	 * RETURN:
+	 * 	true on success
+	 */
+	z_stream z;
+	char in[GZIP_CHUNK];
+	off_t offset=0;
+	ssize_t nRead;
+	int flush;
+	int status=Z_OK;
+	uLong bound;
+
+	memset(&z, 0, sizeof(z));
+	if (deflateInit2(&z, serverConfig.gzipLevel, Z_DEFLATED, GZIP_WINDOW,
+			GZIP_MEMLEVEL, Z_DEFAULT_STRATEGY)!=Z_OK) {
+		return(false);
+	}
+
+	/* Output never exceeds the bound, so it is allocated once */
+	bound=deflateBound(&z, e->size);
+	e->data=malloc(bound);
+	z.next_out=(unsigned char*)e->data;
+	z.avail_out=bound;
+
+	do {
+		nRead=pread(fd, in, GZIP_CHUNK, offset);
+		if (nRead<0) {
+			handleFileReadError();
+			break;
+		}
+		offset+=nRead;
+		flush=(nRead==0||offset>=e->size)?Z_FINISH:Z_NO_FLUSH;
+		z.next_in=(unsigned char*)in;
+		z.avail_in=nRead;
+		status=deflate(&z, flush);
+	} while (flush!=Z_FINISH&&status==Z_OK);
+
+	deflateEnd(&z);
+	if (status!=Z_STREAM_END) {
+		return(false);
+	}
+	e->length=z.total_out;
+	e->data=realloc(e->data, e->length>0?e->length:1);
+	if (e->length>0) {
+		metricsAllocated(MEM_GZIP, e->length);
+	}
+	return(true);
+}
+
+
+int sendGzipStream(int socketFd, int fd, off_t length, long* sent) {
+	/**
+	 * Gzip <length> bytes of <fd> into <socketFd> as they are read,
+	 * GZIP_CHUNK bytes at a time. <fd> is only read with pread().
+	 *
+	 * Used for files too large to cache; the length is not known upfront so
+	 * the response must be delimited by closing the connection. The number
+	 * of compressed bytes sent is written into <sent>.
+	 *
+	 * RETURN:
+	 * 	SENDOK, or ESEND if reading, compressing or sending failed
+	 */
+	z_stream z;
+	char in[GZIP_CHUNK];
+	char out[GZIP_CHUNK];
+	off_t offset=0;
+	ssize_t nRead;
+	int flush;
+	int status;
+
+	*sent=0;
+	memset(&z, 0, sizeof(z));
+	if (deflateInit2(&z, serverConfig.gzipLevel, Z_DEFLATED, GZIP_WINDOW,
+			GZIP_MEMLEVEL, Z_DEFAULT_STRATEGY)!=Z_OK) {
+		return(ESEND);
+	}
+
+	do {
+		nRead=pread(fd, in, GZIP_CHUNK, offset);
+		if (nRead<0) {
+			handleFileReadError();
+			deflateEnd(&z);
+			return(ESEND);
+		}
+		offset+=nRead;
+		flush=(nRead==0||offset>=length)?Z_FINISH:Z_NO_FLUSH;
+		z.next_in=(unsigned char*)in;
+		z.avail_in=nRead;
+
+		/* Drain all output this input produces */
+		do {
+			z.next_out=(unsigned char*)out;
+			z.avail_out=GZIP_CHUNK;
+			status=deflate(&z, flush);
+			if (sendBytes(socketFd, out, GZIP_CHUNK-z.avail_out)==ESEND) {
+				deflateEnd(&z);
+				return(ESEND);
+			}
+			*sent+=GZIP_CHUNK-z.avail_out;
+		} while (z.avail_out==0);
+	} while (flush!=Z_FINISH);
+
+	deflateEnd(&z);
+	return(status==Z_STREAM_END?SENDOK:ESEND);
+}
+
+
+gzipEntry_t* _gzipCacheFind(char* path) {
+	gzipEntry_t* e=buckets[hashString(path)%GZIP_CACHE_BUCKETS];
+	for (; e!=NULL; e=e->hashNext) {
+		if (strcmp(e->path, path)==0) {
+			return(e);
+		}
+	}
+	return(NULL);
+}
+
+
+void _gzipCacheInsert(gzipEntry_t* e) {
+	unsigned long b=hashString(e->path)%GZIP_CACHE_BUCKETS;
+	e->hashNext=buckets[b];
+	buckets[b]=e;
+	e->linked=true;
+	_gzipLruPushFront(e);
+}
+
+
+void _gzipCacheUnlink(gzipEntry_t* e) {
+	/**
+	 * Remove <e> from the cache. It is freed now if unused, otherwise by the
+	 * last gzipCacheRelease().
+	 */
+	gzipEntry_t** p=&buckets[hashString(e->path)%GZIP_CACHE_BUCKETS];
+	while (*p!=e) {
+		p=&((*p)->hashNext);
+	}
+	*p=e->hashNext;
+	_gzipLruRemove(e);
+	e->linked=false;
+	if (e->state==GZ_READY) {
+		cacheBytes-=e->length;
+	}
+	if (e->refCount==0) {
+		_freeGzipEntry(e);
+	}
+}
+
+
+void _gzipCacheEvict() {
+	/* Unlink least recently used finished entries until within budget */
+	gzipEntry_t* e=lruTail;
+	gzipEntry_t* prev;
+	while (cacheBytes>serverConfig.gzipCacheSize&&e!=NULL) {
+		prev=e->lruPrev;
+		if (e->state!=GZ_PENDING) {
+			_gzipCacheUnlink(e);
+		}
+		e=prev;
+	}
+}
+
+
+void _gzipLruPushFront(gzipEntry_t* e) {
+	e->lruPrev=NULL;
+	e->lruNext=lruHead;
+	if (lruHead!=NULL) {
+		lruHead->lruPrev=e;
+	}
+	lruHead=e;
+	if (lruTail==NULL) {
+		lruTail=e;
+	}
+}
+
+
+void _gzipLruRemove(gzipEntry_t* e) {
+	if (e->lruPrev!=NULL) {
+		e->lruPrev->lruNext=e->lruNext;
+	} else {
+		lruHead=e->lruNext;
+	}
+	if (e->lruNext!=NULL) {
+		e->lruNext->lruPrev=e->lruPrev;
+	} else {
+		lruTail=e->lruPrev;
+	}
+	e->lruPrev=NULL;
+	e->lruNext=NULL;
+}
+
+
+void _freeGzipEntry(gzipEntry_t* e) {
+	if (e->length>0) {
+		metricsFreed(MEM_GZIP, e->length);
+	}
+	metricsFreed(MEM_GZIP, sizeof(gzipEntry_t)+strlen(e->path)+1);
+	free(e->path);
+	free(e->data);
+	free(e);
+}
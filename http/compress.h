@@ -0,0 +1,44 @@
+/*
+ * Author: 			Ben Tomlin
+ * Student Id:		btomlin
+ * Student Nbr:		834198
+ * Date:			Oct 2026
+ */
+
+#ifndef HTTP_COMPRESS_H_
+#define HTTP_COMPRESS_H_
+
+#include <time.h>
+#include <sys/stat.h>
+
+#define GZIP_CHUNK		 16384  // Read/deflate granularity [bytes]
+#define GZIP_CACHE_BUCKETS 1024
+#define GZIP_WINDOW		 (15+16) // zlib windowBits, +16 selects a gzip wrapper
+#define GZIP_MEMLEVEL	 8
+
+#define GZ_PENDING 0 // Being compressed, wait on the cache condition
+#define GZ_READY   1
+#define GZ_FAILED  2
+
+typedef struct gzipEntry gzipEntry_t;
+
+struct gzipEntry {	 // Compressed copy of a file, shared between requests
+	char* path;
+	time_t mtime;	 // mtime & size of the file when it was compressed
+	off_t size;
+	char* data;
+	long length;
+	int state;
+	int refCount;	 // Requests using data. Freed at zero once unlinked
+	int linked;		 // Still reachable through the cache
+	gzipEntry_t *hashNext;
+	gzipEntry_t *lruPrev;
+	gzipEntry_t *lruNext;
+};
+
+int isCompressibleType(char* mimeType);
+gzipEntry_t* gzipCacheAcquire(char* path, int fd, struct stat* s);
+void gzipCacheRelease(void* entry);
+int sendGzipStream(int socketFd, int fd, off_t length, long* sent);
+
+#endif /* HTTP_COMPRESS_H_ */
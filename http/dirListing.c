@@ -0,0 +1,306 @@
+/*
+ * Author: 			Ben Tomlin
+ * Student Id:		btomlin
+ * Student Nbr:		834198
+ * Date:			Oct 2026
+ *
+ * Autoindex pages for directories without an index file.
+ *
+ * Generated HTML is cached per directory and regenerated only when the
+ * directory mtime changes (an entry was added, removed or renamed), so a
+ * large directory is not rescanned on every request. At most DIRLISTING_MAX
+ * directories are kept, the least recently used is dropped first.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "dirListing.h"
+#include "./../utility/byteString.h"
+#include "./../utility/hash.h"
+#include "./../utility/bool.h"
+#include "./../utility/metrics.h"
+
+static dirListing_t* buckets[DIRLISTING_BUCKETS];
+static int nEntries;
+static pthread_mutex_t cacheLock=PTHREAD_MUTEX_INITIALIZER;
+
+dirListing_t* _dirListingFind(char* path);
+void _dirListingInsert(dirListing_t* d);
+void _dirListingUnlink(dirListing_t* d);
+void _dirListingEvict();
+void _freeDirListing(dirListing_t* d);
+int _generateListing(dirListing_t* d, char* displayPath);
+void _appendString(byteString_t* b, char* s);
+void _appendHtmlEscaped(byteString_t* b, char* s);
+void _appendUrlEscaped(byteString_t* b, char* s);
+
+
+dirListing_t* dirListingAcquire(char* dirPath, char* displayPath) {
+	/**
+	 * Get the autoindex page of directory <dirPath>, generating it if it is
+	 * not cached or the directory changed since.
+	 *
+	 * ARGUMENT:
+	 * 	dirPath - filesystem path of the directory, the cache key
+	 * 	displayPath - path shown in the page title, ie "/images/"
+	 *
+	 * RETURN:
+	 * 	Listing to be handed back with dirListingRelease() once sent. NULL
+	 * 	if the directory cannot be read.
+	 */
+	struct stat s;
+	dirListing_t* d;
+	dirListing_t* existing;
+
+	if (stat(dirPath, &s)!=0||!S_ISDIR(s.st_mode)) {
+		return(NULL);
+	}
+
+	pthread_mutex_lock(&cacheLock);
+	d=_dirListingFind(dirPath);
+	if (d!=NULL&&(d->mtime.tv_sec!=s.st_mtim.tv_sec
+			||d->mtime.tv_nsec!=s.st_mtim.tv_nsec)) {
+		_dirListingUnlink(d);
+		d=NULL;
+	}
+	if (d!=NULL) {
+		d->refCount++;
+		d->lastUsed=time(NULL);
+		pthread_mutex_unlock(&cacheLock);
+		metricsCount(COUNT_DIRLISTING_HIT, 1);
+		return(d);
+	}
+	pthread_mutex_unlock(&cacheLock);
+	metricsCount(COUNT_DIRLISTING_MISS, 1);
+
+	/* Generate outside the lock, readdir of a large directory is slow */
+	d=calloc(1, sizeof(dirListing_t));
+	d->path=strdup(dirPath);
+	metricsAllocated(MEM_DIRLISTING, sizeof(dirListing_t)+strlen(dirPath)+1);
+	d->mtime=s.st_mtim;
+	d->refCount=1;
+	d->lastUsed=time(NULL);
+	if (!_generateListing(d, displayPath)) {
+		_freeDirListing(d);
+		return(NULL);
+	}
+
+	pthread_mutex_lock(&cacheLock);
+	existing=_dirListingFind(dirPath);
+	if (existing!=NULL) {
+		_dirListingUnlink(existing);
+	}
+	_dirListingInsert(d);
+	_dirListingEvict();
+	pthread_mutex_unlock(&cacheLock);
+	return(d);
+}
+
+
+void dirListingRelease(void* listing) {
+	/* Drop a reference taken by dirListingAcquire() */
+	dirListing_t* d=listing;
+	int unused;
+
+	pthread_mutex_lock(&cacheLock);
+	d->refCount--;
+	unused=(d->refCount==0&&!d->linked);
+	pthread_mutex_unlock(&cacheLock);
+
+	if (unused) {
+		_freeDirListing(d);
+	}
+}
+
+
+int _generateListing(dirListing_t* d, char* displayPath) {
+	/**
+	 * Scan d->path and render its entries, sorted by name, into d->html
+	 *
+	 * RETURN:
+	 * 	true on success
+	 */
+	struct dirent** entries;
+	struct stat s;
+	byteString_t* b;
+	char* entryPath;
+	char line[128];
+	int isDir;
+	int nameWidth;
+	int padding;
+	int n;
+	int i;
+
+	n=scandir(d->path, &entries, NULL, alphasort);
+	if (n<0) {
+		return(false);
+	}
+
+	b=bsInit();
+	_appendString(b, "<html>\n<head><title>Index of ");
+	_appendHtmlEscaped(b, displayPath);
+	_appendString(b, "</title></head>\n<body>\n<h1>Index of ");
+	_appendHtmlEscaped(b, displayPath);
+	_appendString(b, "</h1>\n<hr>\n<pre>\n");
+
+	/* Nothing above the document root, its ".." would be a 400 */
+	for (i=0; i<n; i++) {
+		if (strcmp(entries[i]->d_name, ".")==0
+				||(strcmp(entries[i]->d_name, "..")==0
+				&&strcmp(displayPath, "/")==0)) {
+			free(entries[i]);
+			continue;
+		}
+		entryPath=malloc(strlen(d->path)+strlen(entries[i]->d_name)+2);
+		sprintf(entryPath, "%s/%s", d->path, entries[i]->d_name);
+		if (stat(entryPath, &s)!=0) {
+			memset(&s, 0, sizeof(s));
+		}
+		isDir=S_ISDIR(s.st_mode);
+		free(entryPath);
+
+		_appendString(b, "<a href=\"");
+		_appendUrlEscaped(b, entries[i]->d_name);
+		_appendString(b, isDir?"/\">":"\">");
+		_appendHtmlEscaped(b, entries[i]->d_name);
+		_appendString(b, isDir?"/</a>":"</a>");
+
+		/* Align the size column regardless of the name length */
+		nameWidth=strlen(entries[i]->d_name)+isDir;
+		padding=(nameWidth<DIRLISTING_NAMEWIDTH)?
+				DIRLISTING_NAMEWIDTH-nameWidth:1;
+		if (isDir) {
+			snprintf(line, sizeof(line), "%*s%20s\n", padding, "", "-");
+		} else {
+			snprintf(line, sizeof(line), "%*s%20ld\n", padding, "",
+					(long)s.st_size);
+		}
+		_appendString(b, line);
+		free(entries[i]);
+	}
+	free(entries);
+
+	_appendString(b, "</pre>\n<hr>\n</body>\n</html>\n");
+	d->html=b->string;
+	d->length=b->length;
+	free(b);
+	metricsAllocated(MEM_DIRLISTING, d->length);
+	return(true);
+}
+
+
+void _appendString(byteString_t* b, char* s) {
+	bsAppend(b, s, strlen(s));
+}
+
+
+void _appendHtmlEscaped(byteString_t* b, char* s) {
+	/* Append <s> with the HTML special characters escaped */
+	for (; *s!='\0'; s++) {
+		switch (*s) {
+		case '<':
+			_appendString(b, "&lt;");
+			break;
+		case '>':
+			_appendString(b, "&gt;");
+			break;
+		case '&':
+			_appendString(b, "&amp;");
+			break;
+		case '"':
+			_appendString(b, "&quot;");
+			break;
+		default:
+			bsAppend(b, s, 1);
+		}
+	}
+}
+
+
+void _appendUrlEscaped(byteString_t* b, char* s) {
+	/* Append <s> percent encoded, leaving only unreserved characters as is */
+	char escape[4];
+	for (; *s!='\0'; s++) {
+		if ((*s>='a'&&*s<='z')||(*s>='A'&&*s<='Z')||(*s>='0'&&*s<='9')
+				||strchr("-_.~", *s)!=NULL) {
+			bsAppend(b, s, 1);
+		} else {
+			snprintf(escape, sizeof(escape), "%%%02X", (unsigned char)*s);
+			bsAppend(b, escape, 3);
+		}
+	}
+}
+
+
+dirListing_t* _dirListingFind(char* path) {
+	dirListing_t* d=buckets[hashString(path)%DIRLISTING_BUCKETS];
+	for (; d!=NULL; d=d->hashNext) {
+		if (strcmp(d->path, path)==0) {
+			return(d);
+		}
+	}
+	return(NULL);
+}
+
+
+void _dirListingInsert(dirListing_t* d) {
+	unsigned long b=hashString(d->path)%DIRLISTING_BUCKETS;
+	d->hashNext=buckets[b];
+	buckets[b]=d;
+	d->linked=true;
+	nEntries++;
+}
+
+
+void _dirListingUnlink(dirListing_t* d) {
+	/* Remove <d> from the cache, freeing it now if no response holds it */
+	dirListing_t** p=&buckets[hashString(d->path)%DIRLISTING_BUCKETS];
+	while (*p!=d) {
+		p=&((*p)->hashNext);
+	}
+	*p=d->hashNext;
+	d->linked=false;
+	nEntries--;
+	if (d->refCount==0) {
+		_freeDirListing(d);
+	}
+}
+
+
+void _dirListingEvict() {
+	/**
+	 * Drop the least recently used listing while over DIRLISTING_MAX. The
+	 * cache is small, so a scan is cheaper than maintaining an LRU list.
+	 */
+	dirListing_t* oldest;
+	dirListing_t* d;
+	int i;
+
+	while (nEntries>DIRLISTING_MAX) {
+		oldest=NULL;
+		for (i=0; i<DIRLISTING_BUCKETS; i++) {
+			for (d=buckets[i]; d!=NULL; d=d->hashNext) {
+				if (oldest==NULL||d->lastUsed<oldest->lastUsed) {
+					oldest=d;
+				}
+			}
+		}
+		_dirListingUnlink(oldest);
+	}
+}
+
+
+void _freeDirListing(dirListing_t* d) {
+	if (d->html!=NULL) {
+		metricsFreed(MEM_DIRLISTING, d->length);
+	}
+	metricsFreed(MEM_DIRLISTING, sizeof(dirListing_t)+strlen(d->path)+1);
+	free(d->path);
+	free(d->html);
+	free(d);
+}
@@ -0,0 +1,33 @@
+/*
+ * Author: 			Ben Tomlin
+ * Student Id:		btomlin
+ * Student Nbr:		834198
+ * Date:			Oct 2026
+ */
+
+#ifndef HTTP_DIRLISTING_H_
+#define HTTP_DIRLISTING_H_
+
+#include <time.h>
+
+#define DIRLISTING_BUCKETS  256
+#define DIRLISTING_MAX	  64 // Directories whose listing is kept
+#define DIRLISTING_NAMEWIDTH 50 // Listing column the sizes are aligned after
+
+typedef struct dirListing dirListing_t;
+
+struct dirListing {		// Generated autoindex page of one directory
+	char* path;
+	struct timespec mtime; // Directory mtime the page was generated from
+	char* html;
+	long length;
+	int refCount;		// Responses sending html. Freed at zero once unlinked
+	int linked;
+	time_t lastUsed;
+	dirListing_t *hashNext;
+};
+
+dirListing_t* dirListingAcquire(char* dirPath, char* displayPath);
+void dirListingRelease(void* listing);
+
+#endif /* HTTP_DIRLISTING_H_ */
@@ -0,0 +1,155 @@
+/*
+ * Author: 			Ben Tomlin
+ * Student Id:		btomlin
+ * Student Nbr:		834198
+ * Date:			Oct 2026
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "encoding.h"
+#include "./../utility/bool.h"
+
+/* Preference order when the client accepts several codings equally */
+static char* precompressedCodings[] = {ENCODING_BR, ENCODING_GZIP};
+static char* precompressedSuffixes[] = {SUFFIX_BR, SUFFIX_GZIP};
+#define N_PRECOMPRESSED 2
+
+double _codingQuality(char* acceptEncoding, char* coding);
+char* _siblingPath(char* path, char* suffix);
+
+
+double _codingQuality(char* acceptEncoding, char* coding) {
+	/**
+	 * Find the quality value the client gave <coding> in an Accept-Encoding
+	 * field value, ie "gzip;q=0.8, br, *;q=0"
+	 *
+	 * RETURN:
+	 * 	q value of the coding, the wildcard q value if the coding is not
+	 * 	listed, or 0 if neither is listed.
+	 *
+	 * NOTE:
+	 * 	Does not allocate, the field value is scanned in place.
+	 */
+	double wildcard=0;
+	double q;
+	int matched;
+	int isWildcard;
+	int tokenLength;
+	char* p=acceptEncoding;
+
+	while (*p!='\0') {
+
+		/* Coding token */
+		p+=strspn(p, " \t,");
+		tokenLength=strcspn(p, " \t,;");
+		if (tokenLength==0) {
+			break;
+		}
+		matched=(tokenLength==strlen(coding)
+				&&strncasecmp(p, coding, tokenLength)==0);
+		isWildcard=(tokenLength==1&&*p=='*');
+		p+=tokenLength;
+
+		/* Parameters, only q is meaningful */
+		q=1;
+		while (*(p+=strspn(p, " \t"))==';') {
+			p+=1+strspn(p+1, " \t");
+			if ((*p=='q'||*p=='Q')&&*(p+1)=='=') {
+				q=strtod(p+2, NULL);
+			}
+			p+=strcspn(p, ";,");
+		}
+
+		if (matched) {
+			return(q);
+		} else if (isWildcard) {
+			wildcard=q;
+		}
+	}
+	return(wildcard);
+}
+
+
+int acceptsEncoding(char* acceptEncoding, char* coding) {
+	/**
+	 * Return true if an Accept-Encoding field value permits <coding>
+	 */
+	if (acceptEncoding==NULL) {
+		return(false);
+	}
+	return(_codingQuality(acceptEncoding, coding)>0);
+}
+
+
+char* _siblingPath(char* path, char* suffix) {
+	/* Return allocated <path><suffix>, to be freed by the caller */
+	char* sibling=malloc(strlen(path)+strlen(suffix)+1);
+	strcpy(sibling, path);
+	strcat(sibling, suffix);
+	return(sibling);
+}
+
+
+openFile_t*
+findPrecompressed(openFile_t* original, char* acceptEncoding, char** coding,
+		int* hasVariant) {
+	/**
+	 * Find a precompressed sibling of <original> (path.br, path.gz) that the
+	 * client will accept.
+	 *
+	 * A sibling is only eligible if it is a regular file at least as new as
+	 * the original, so a stale sibling left behind by an edit is never served.
+	 * Siblings are looked up through the open file cache, which also caches
+	 * their absence.
+	 *
+	 * ARGUMENT:
+	 * 	original - open file cache entry of the requested file
+	 * 	acceptEncoding - value of the request Accept-Encoding header, or NULL
+	 * 	coding - set to the content coding of the returned sibling
+	 * 	hasVariant - set true if any eligible sibling exists, regardless of
+	 * 	whether the client accepts it. The response then needs a Vary header.
+	 *
+	 * RETURN:
+	 * 	Open file cache entry of the sibling to serve, to be released by the
+	 * 	caller. NULL if the original file should be served.
+	 */
+	openFile_t* variant;
+	openFile_t* chosen=NULL;
+	char* sibling;
+	double q;
+	double bestQ=0;
+	int i;
+
+	*hasVariant=false;
+	*coding=NULL;
+
+	for (i=0; i<N_PRECOMPRESSED; i++) {
+		sibling=_siblingPath(original->path, precompressedSuffixes[i]);
+		variant=openFileAcquire(sibling);
+		free(sibling);
+		if (variant==NULL) {
+			continue;
+		}
+		if (variant->st.st_mtime<original->st.st_mtime) {
+			openFileRelease(variant);
+			continue;
+		}
+		*hasVariant=true;
+
+		/* Keep the first (preferred) coding among equal quality values */
+		q=(acceptEncoding==NULL)?0:
+				_codingQuality(acceptEncoding, precompressedCodings[i]);
+		if (q>bestQ) {
+			openFileRelease(chosen);
+			chosen=variant;
+			bestQ=q;
+			*coding=precompressedCodings[i];
+		} else {
+			openFileRelease(variant);
+		}
+	}
+	return(chosen);
+}
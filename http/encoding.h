@@ -0,0 +1,23 @@
+/*
+ * Author: 			Ben Tomlin
+ * Student Id:		btomlin
+ * Student Nbr:		834198
+ * Date:			Oct 2026
+ */
+
+#ifndef HTTP_ENCODING_H_
+#define HTTP_ENCODING_H_
+
+#define ENCODING_BR	  "br"
+#define ENCODING_GZIP   "gzip"
+#define SUFFIX_BR	  ".br"
+#define SUFFIX_GZIP	  ".gz"
+#define VARY_ENCODING   "Accept-Encoding"
+
+#include "./../utility/openFileCache.h"
+
+int acceptsEncoding(char* acceptEncoding, char* coding);
+openFile_t* findPrecompressed(openFile_t* original, char* acceptEncoding,
+		char** coding, int* hasVariant);
+
+#endif /* HTTP_ENCODING_H_ */
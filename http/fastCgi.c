@@ -0,0 +1,898 @@
+/*
+ * Author: 			Ben Tomlin
+ * Student Id:		btomlin
+ * Student Nbr:		834198
+ * Date:			Oct 2026
+ *
+ * FastCGI responder for configured path patterns.
+ *
+ * Each application is kept a small pool of persistent connections, opened on
+ * demand up to fastcgi_connections and never closed by the server, so there
+ * is no fork or connect per request. An application that answers
+ * FCGI_GET_VALUES with FCGI_MPXS_CONNS has requests multiplexed over each
+ * connection, up to its FCGI_MAX_REQS; others take one request at a time.
+ *
+ * Every connection has a reader thread, which demultiplexes the records the
+ * application sends; FCGI_STDOUT of a request is written into a pipe the
+ * request's worker thread reads, the response header parsed off the front
+ * and the remainder spliced straight on to the client socket. A request's
+ * pipe holds FASTCGI_PIPE_SIZE, beyond which a slow client holds up the
+ * other requests on its connection until its send deadline passes.
+ */
+
+#define _GNU_SOURCE	// splice(), pipe2(), F_SETPIPE_SZ
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "fastCgi.h"
+#include "uriPath.h"
+#include "./../utility/bool.h"
+#include "./../utility/byteString.h"
+#include "./../utility/listener.h"
+#include "./../utility/logger.h"
+#include "./../utility/metrics.h"
+#include "./../utility/deadline.h"
+#include "./../utility/tcpSocketIo.h"
+#include "./../utility/tls.h"
+#include "./../config.h"
+
+fastCgiConnection_t* _fastCgiAcquire(fastCgiBackend_t* b,
+		fastCgiExchange_t* x, int* status);
+fastCgiConnection_t* _fastCgiConnect(fastCgiBackend_t* b);
+int _fastCgiProbe(int fd);
+void* _fastCgiRead(void* connection);
+void _fastCgiOutput(fastCgiConnection_t* c, int id, char* content,
+		int length);
+void _fastCgiEnd(fastCgiConnection_t* c, int id, unsigned char* body);
+void _fastCgiClosed(fastCgiConnection_t* c);
+void _fastCgiDrop(fastCgiConnection_t* c, int* freeConnection);
+void _fastCgiFree(fastCgiConnection_t* c);
+byteString_t* _fastCgiRequest(request_t* r, fastCgiRoute_t* route, int id,
+		char* rootPath, int clientFd);
+void _fastCgiRecord(byteString_t* b, int type, int id, char* content,
+		int length);
+void _fastCgiParam(byteString_t* b, char* name, char* value);
+void _fastCgiLength(byteString_t* b, int length);
+void _fastCgiAddress(byteString_t* b, char* name, char* portName,
+		struct sockaddr_storage* address);
+int _fastCgiSend(fastCgiConnection_t* c, byteString_t* records);
+int _fastCgiReadHeader(fastCgiExchange_t* x);
+int _fastCgiParseHeader(fastCgiExchange_t* x, int length);
+int _fastCgiHeaderLength(fastCgiExchange_t* x);
+int _fastCgiReadFull(int fd, void* buffer, int length);
+int _fastCgiCopy(fastCgiExchange_t* x, int clientFd, long* sent);
+
+/* Routes to the same address share a backend, and so its connections */
+static fastCgiBackend_t* backends;
+
+
+int parseFastCgiRoute(char* pattern, char* address, fastCgiRoute_t* route) {
+	/**
+	 * Send URI paths matching POSIX ERE <pattern> to the application at
+	 * <address>, given as for listen (see listener.c) but naming a host.
+	 *
+	 * RETURN:
+	 * 	false if the pattern or address is malformed
+	 */
+	listener_t* l=initListener();
+	fastCgiBackend_t* b;
+
+	if (!parseListenAddress(address, l)||l->wildcard
+			||regcomp(&route->regex, pattern, REG_EXTENDED)!=0) {
+		free(l);
+		return(false);
+	}
+	for (b=backends; b!=NULL&&strcmp(b->address, l->address)!=0; b=b->next);
+	if (b==NULL) {
+		b=calloc(1, sizeof(fastCgiBackend_t));
+		strcpy(b->address, l->address);
+		b->sockAddr=l->sockAddr;
+		b->sockAddrLength=l->sockAddrLength;
+		pthread_mutex_init(&b->lock, NULL);
+		pthread_cond_init(&b->available, NULL);
+		b->next=backends;
+		backends=b;
+	}
+	free(l);
+
+	route->pattern=strdup(pattern);
+	route->backend=b;
+	route->next=NULL;
+	return(true);
+}
+
+
+fastCgiRoute_t* fastCgiMatch(fastCgiRoute_t* routes, char* uri) {
+	/**
+	 * First of <routes> whose pattern matches the canonical path of <uri>.
+	 *
+	 * RETURN:
+	 * 	route, NULL if the URI is not for an application
+	 */
+	char path[PATH_MAX];
+	fastCgiRoute_t* route;
+
+	if (routes==NULL||canonicalizePath(uri, path, PATH_MAX)<0) {
+		return(NULL);
+	}
+	for (route=routes; route!=NULL; route=route->next) {
+		if (regexec(&route->regex, path, 0, NULL, 0)==0) {
+			return(route);
+		}
+	}
+	return(NULL);
+}
+
+
+fastCgiExchange_t* fastCgiForward(request_t* r, fastCgiRoute_t* route,
+		char* rootPath, int clientFd, int* status) {
+	/**
+	 * Start request <r> from <clientFd> on the application of <route> and
+	 * read the response header.
+	 *
+	 * RETURN:
+	 * 	The exchange, to send the body of with fastCgiSendBody() and release
+	 * 	with fastCgiRelease(). NULL if the application could not be reached
+	 * 	or gave no valid response, with <status> set to 502 or 504.
+	 */
+	long start=metricsNow();
+	fastCgiExchange_t* x=calloc(1, sizeof(fastCgiExchange_t));
+	byteString_t* records;
+	int sent;
+
+	if (pipe2(x->pipe, O_CLOEXEC)!=0) {
+		logWarn("Could not create a FastCGI output pipe: %s",
+				strerror(errno));
+		free(x);
+		*status=502;
+		return(NULL);
+	}
+	fcntl(x->pipe[1], F_SETPIPE_SZ, FASTCGI_PIPE_SIZE);
+
+	if (_fastCgiAcquire(route->backend, x, status)==NULL) {
+		fastCgiRelease(x);
+		x=NULL;
+	} else {
+		records=_fastCgiRequest(r, route, x->id, rootPath, clientFd);
+		sent=_fastCgiSend(x->connection, records);
+		bsFree(records);
+		free(records);
+		*status=sent?_fastCgiReadHeader(x):502;
+		if (*status!=0) {
+			fastCgiRelease(x);
+			x=NULL;
+		}
+	}
+	metricsRecord(STAGE_UPSTREAM, start);
+
+	if (x==NULL) {
+		metricsCount(COUNT_UPSTREAM_FAILED, 1);
+		logWarn("FastCGI %s failed for %s", route->backend->address, r->uri);
+	}
+	return(x);
+}
+
+
+long fastCgiSendBody(fastCgiExchange_t* x, int clientFd) {
+	/**
+	 * Forward the rest of the application's output to <clientFd>, until it
+	 * ends the request.
+	 *
+	 * RETURN:
+	 * 	body bytes sent
+	 */
+	long sent=0;
+	ssize_t n;
+
+	if (x->end>x->start) {
+		if (sendBytes(clientFd, x->buffer+x->start, x->end-x->start)
+				!=SENDOK) {
+			return(0);
+		}
+		sent=x->end-x->start;
+		x->start=x->end;
+	}
+
+	/* A TLS session must encrypt the bytes itself */
+	while (!tlsActive()) {
+		n=splice(x->pipe[0], NULL, clientFd, NULL, FASTCGI_PIPE_SIZE,
+				SPLICE_F_MOVE|SPLICE_F_MORE);
+		if (n<0&&errno==EINTR) {
+			continue;
+		} else if (n<0&&errno==EINVAL) {
+			break;	// Not a descriptor splice() can write to
+		} else if (n<=0) {
+			return(sent);
+		}
+		sent+=n;
+		deadlineProgress();
+	}
+	_fastCgiCopy(x, clientFd, &sent);
+	return(sent);
+}
+
+
+int _fastCgiCopy(fastCgiExchange_t* x, int clientFd, long* sent) {
+	/* fastCgiSendBody() through the exchange buffer. True on completion */
+	ssize_t n;
+
+	while (true) {
+		n=read(x->pipe[0], x->buffer, FASTCGI_HEADER_MAX);
+		if (n<0&&errno==EINTR) {
+			continue;
+		} else if (n<=0) {
+			return(n==0);
+		} else if (sendBytes(clientFd, x->buffer, n)!=SENDOK) {
+			return(false);
+		}
+		*sent+=n;
+	}
+}
+
+
+void fastCgiRelease(fastCgiExchange_t* x) {
+	/**
+	 * Finish with exchange <x>. The application is told to abort the
+	 * request if it has not yet ended it.
+	 */
+	fastCgiConnection_t* c;
+	fastCgiBackend_t* b;
+	char body[8]={0};
+	byteString_t* record;
+	int freeExchange;
+	int freeConnection=false;
+
+	if (x==NULL) {
+		return;
+	}
+	c=x->connection;
+
+	/* The reader thread gets EPIPE for any more output, rather than block */
+	close(x->pipe[0]);
+	if (c==NULL) {
+		close(x->pipe[1]);
+		free(x->code);
+		free(x->phrase);
+		free(x->header);
+		free(x);
+		return;
+	}
+	b=c->backend;
+
+	pthread_mutex_lock(&b->lock);
+	if (x->refs>1&&!c->dead) {
+		pthread_mutex_unlock(&b->lock);
+		record=bsInit();
+		_fastCgiRecord(record, FCGI_ABORT_REQUEST, x->id, body, 0);
+		_fastCgiSend(c, record);
+		bsFree(record);
+		free(record);
+		pthread_mutex_lock(&b->lock);
+	}
+	x->discard=true;
+	freeExchange=(--x->refs==0);
+	_fastCgiDrop(c, &freeConnection);
+	pthread_mutex_unlock(&b->lock);
+
+	free(x->code);
+	free(x->phrase);
+	free(x->header);
+	x->code=NULL;
+	x->phrase=NULL;
+	x->header=NULL;
+	if (freeExchange) {
+		free(x);
+	}
+	if (freeConnection) {
+		_fastCgiFree(c);
+	}
+}
+
+
+fastCgiConnection_t* _fastCgiAcquire(fastCgiBackend_t* b,
+		fastCgiExchange_t* x, int* status) {
+	/**
+	 * Register <x> on a connection to <b> with a free request slot, opening
+	 * one if the pool has room, else waiting up to fastcgi_timeout.
+	 *
+	 * RETURN:
+	 * 	the connection, NULL on failure with <status> 502 or 504
+	 */
+	fastCgiConnection_t* c=NULL;
+	struct timespec until;
+	int id;
+
+	clock_gettime(CLOCK_REALTIME, &until);
+	until.tv_sec+=serverConfig.fastCgiTimeout;
+
+	pthread_mutex_lock(&b->lock);
+	while (c==NULL) {
+		for (c=b->connections; c!=NULL; c=c->next) {
+			if (!c->dead&&c->active<c->capacity) {
+				break;
+			}
+		}
+		if (c==NULL&&b->nConnections<serverConfig.fastCgiConnections) {
+			b->nConnections++;
+			pthread_mutex_unlock(&b->lock);
+			c=_fastCgiConnect(b);
+			pthread_mutex_lock(&b->lock);
+			if (c==NULL) {
+				b->nConnections--;
+				pthread_mutex_unlock(&b->lock);
+				*status=502;
+				return(NULL);
+			}
+			c->next=b->connections;
+			b->connections=c;
+		} else if (c==NULL&&pthread_cond_timedwait(&b->available, &b->lock,
+				&until)==ETIMEDOUT) {
+			pthread_mutex_unlock(&b->lock);
+			logWarn("No FastCGI connection to %s free within %d s",
+					b->address, serverConfig.fastCgiTimeout);
+			*status=504;
+			return(NULL);
+		}
+	}
+
+	for (id=1; c->requests[id]!=NULL; id++);
+	c->requests[id]=x;
+	c->active++;
+	c->users++;
+	x->connection=c;
+	x->id=id;
+	x->refs=2;
+	pthread_mutex_unlock(&b->lock);
+	return(c);
+}
+
+
+fastCgiConnection_t* _fastCgiConnect(fastCgiBackend_t* b) {
+	/* New connection to <b> with its reader thread, NULL on failure */
+	fastCgiConnection_t* c;
+	struct timeval timeout={serverConfig.fastCgiTimeout, 0};
+	pthread_t reader;
+	int fd=socket(b->sockAddr.ss_family, SOCK_STREAM|SOCK_CLOEXEC, 0);
+
+	if (fd<0) {
+		logWarn("Could not create socket for %s: %s", b->address,
+				strerror(errno));
+		return(NULL);
+	}
+	setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+	if (connect(fd, (struct sockaddr*)&b->sockAddr, b->sockAddrLength)!=0) {
+		logWarn("Could not connect to %s: %s", b->address, strerror(errno));
+		close(fd);
+		return(NULL);
+	}
+
+	c=calloc(1, sizeof(fastCgiConnection_t));
+	c->fd=fd;
+	c->backend=b;
+	c->capacity=_fastCgiProbe(fd);
+	c->users=1;
+	pthread_mutex_init(&c->writeLock, NULL);
+	if (pthread_create(&reader, NULL, _fastCgiRead, c)!=0) {
+		logWarn("Could not start a FastCGI reader for %s", b->address);
+		close(fd);
+		free(c);
+		return(NULL);
+	}
+	pthread_detach(reader);
+	metricsAllocated(MEM_UPSTREAM, sizeof(fastCgiConnection_t));
+	logDebug("FastCGI connection to %s, at most %d requests at once",
+			b->address, c->capacity);
+	return(c);
+}
+
+
+int _fastCgiProbe(int fd) {
+	/**
+	 * Ask the application on <fd> whether it multiplexes connections.
+	 *
+	 * RETURN:
+	 * 	requests to run at once on the connection, 1 if it does not answer
+	 */
+	struct timeval timeout={0, FASTCGI_PROBE_MS*1000};
+	struct timeval none={0, 0};
+	unsigned char header[FCGI_HEADER_LEN];
+	char content[FCGI_MAX_CONTENT+256];
+	byteString_t* query=bsInit();
+	byteString_t* names=bsInit();
+	int capacity=1;
+	int multiplexed=false;
+	int length;
+	int i;
+	int nameLength;
+	int valueLength;
+
+	_fastCgiParam(names, "FCGI_MPXS_CONNS", "");
+	_fastCgiParam(names, "FCGI_MAX_REQS", "");
+	_fastCgiRecord(query, FCGI_GET_VALUES, 0, names->string, names->length);
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+	if (send(fd, query->string, query->length, MSG_NOSIGNAL)==query->length
+			&&_fastCgiReadFull(fd, header, FCGI_HEADER_LEN)
+			&&header[1]==FCGI_GET_VALUES_RESULT
+			&&_fastCgiReadFull(fd, content, (header[4]<<8|header[5])+header[6])) {
+		length=header[4]<<8|header[5];
+
+		/* Name-value pairs, all lengths under 128 for these names */
+		for (i=0; i+2<=length; i+=2+nameLength+valueLength) {
+			nameLength=(unsigned char)content[i];
+			valueLength=(unsigned char)content[i+1];
+			if (nameLength>127||valueLength>127
+					||i+2+nameLength+valueLength>length) {
+				break;
+			}
+			if (nameLength==15&&strncmp(content+i+2, "FCGI_MPXS_CONNS",
+					15)==0) {
+				multiplexed=(valueLength>0&&content[i+2+nameLength]=='1');
+			} else if (nameLength==13&&strncmp(content+i+2, "FCGI_MAX_REQS",
+					13)==0&&valueLength<16) {
+				content[i+2+nameLength+valueLength]='\0';
+				capacity=atoi(content+i+2+nameLength);
+			}
+		}
+		capacity=!multiplexed?1:(capacity<1||capacity>FASTCGI_MAX_REQUESTS)
+				?FASTCGI_MAX_REQUESTS:capacity;
+	}
+
+	/* The reader thread waits on the connection for as long as it is open */
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &none, sizeof(none));
+	bsFree(query);
+	free(query);
+	bsFree(names);
+	free(names);
+	return(capacity);
+}
+
+
+void* _fastCgiRead(void* connection) {
+	/* Reader thread of a connection, dispatching records until it closes */
+	fastCgiConnection_t* c=connection;
+	unsigned char header[FCGI_HEADER_LEN];
+	char content[FCGI_MAX_CONTENT+256];
+	int length;
+	int id;
+
+	while (_fastCgiReadFull(c->fd, header, FCGI_HEADER_LEN)) {
+		id=header[2]<<8|header[3];
+		length=header[4]<<8|header[5];
+		if (header[0]!=FCGI_VERSION_1
+				||!_fastCgiReadFull(c->fd, content, length+header[6])) {
+			break;
+		}
+		switch (header[1]) {
+			case FCGI_STDOUT:
+				_fastCgiOutput(c, id, content, length);
+				break;
+			case FCGI_STDERR:
+				while (length>0&&(content[length-1]=='\n'
+						||content[length-1]=='\r')) {
+					length--;
+				}
+				logWarn("FastCGI %s: %.*s", c->backend->address, length,
+						content);
+				break;
+			case FCGI_END_REQUEST:
+				if (length>=8) {
+					_fastCgiEnd(c, id, (unsigned char*)content);
+				}
+				break;
+		}
+	}
+	_fastCgiClosed(c);
+	return(NULL);
+}
+
+
+void _fastCgiOutput(fastCgiConnection_t* c, int id, char* content,
+		int length) {
+	/* Pass FCGI_STDOUT <content> of request <id> to its worker */
+	fastCgiExchange_t* x=NULL;
+	ssize_t n;
+
+	pthread_mutex_lock(&c->backend->lock);
+	if (id>0&&id<=FASTCGI_MAX_REQUESTS) {
+		x=c->requests[id];
+	}
+	pthread_mutex_unlock(&c->backend->lock);
+
+	/* The exchange lives until the request ends, this thread holding a
+	 * reference; only this thread closes the write end */
+	while (x!=NULL&&!x->discard&&length>0) {
+		n=write(x->pipe[1], content, length);
+		if (n<0&&errno==EINTR) {
+			continue;
+		} else if (n<0) {
+			x->discard=true;	// EPIPE, the worker has finished
+			break;
+		}
+		content+=n;
+		length-=n;
+	}
+}
+
+
+void _fastCgiEnd(fastCgiConnection_t* c, int id, unsigned char* body) {
+	/* FCGI_END_REQUEST of request <id>, freeing its slot */
+	fastCgiBackend_t* b=c->backend;
+	fastCgiExchange_t* x=NULL;
+
+	if (body[4]==FCGI_CANT_MPX_CONN) {
+		logWarn("FastCGI %s does not multiplex after all", b->address);
+	}
+	pthread_mutex_lock(&b->lock);
+	if (body[4]==FCGI_CANT_MPX_CONN) {
+		c->capacity=1;
+	}
+	if (id>0&&id<=FASTCGI_MAX_REQUESTS&&(x=c->requests[id])!=NULL) {
+		c->requests[id]=NULL;
+		c->active--;
+		close(x->pipe[1]);	// The worker sees the end of output
+		if (--x->refs==0) {
+			free(x);
+		}
+		pthread_cond_signal(&b->available);
+	}
+	pthread_mutex_unlock(&b->lock);
+}
+
+
+void _fastCgiClosed(fastCgiConnection_t* c) {
+	/* Connection <c> closed or failed, ending every request on it */
+	fastCgiBackend_t* b=c->backend;
+	fastCgiConnection_t** p;
+	fastCgiExchange_t* x;
+	int freeConnection=false;
+	int id;
+
+	logDebug("FastCGI connection to %s closed", b->address);
+	pthread_mutex_lock(&b->lock);
+	c->dead=true;
+	for (p=&b->connections; *p!=NULL; p=&(*p)->next) {
+		if (*p==c) {
+			*p=c->next;
+			b->nConnections--;
+			break;
+		}
+	}
+	for (id=1; id<=FASTCGI_MAX_REQUESTS; id++) {
+		if ((x=c->requests[id])!=NULL) {
+			c->requests[id]=NULL;
+			close(x->pipe[1]);
+			if (--x->refs==0) {
+				free(x);
+			}
+		}
+	}
+	c->active=0;
+	pthread_cond_broadcast(&b->available);
+	_fastCgiDrop(c, &freeConnection);
+	pthread_mutex_unlock(&b->lock);
+	if (freeConnection) {
+		_fastCgiFree(c);
+	}
+}
+
+
+void _fastCgiDrop(fastCgiConnection_t* c, int* freeConnection) {
+	/* Drop a user of <c>, under the backend lock */
+	*freeConnection=(--c->users==0);
+}
+
+
+void _fastCgiFree(fastCgiConnection_t* c) {
+	close(c->fd);
+	pthread_mutex_destroy(&c->writeLock);
+	free(c);
+	metricsFreed(MEM_UPSTREAM, sizeof(fastCgiConnection_t));
+}
+
+
+byteString_t* _fastCgiRequest(request_t* r, fastCgiRoute_t* route, int id,
+		char* rootPath, int clientFd) {
+	/* Records starting request <id>; begin, parameters and empty input */
+	byteString_t* records=bsInit();
+	byteString_t* params=bsInit();
+	char begin[8]={0, FCGI_RESPONDER, FCGI_KEEP_CONN, 0, 0, 0, 0, 0};
+	char path[PATH_MAX];
+	char script[PATH_MAX];
+	char file[PATH_MAX];
+	struct sockaddr_storage address;
+	socklen_t length;
+	regmatch_t match;
+	char* query=strchr(r->uri, '?');
+	int offset;
+
+	query=(query!=NULL)?strndup(query+1, strcspn(query+1, "#")):strdup("");
+
+	/* The end of the match splits the path, so "^/app" takes /app/x as
+	 * script /app with path info /x */
+	canonicalizePath(r->uri, path, PATH_MAX);
+	match.rm_eo=strlen(path);
+	regexec(&route->regex, path, 1, &match, 0);
+	snprintf(script, PATH_MAX, "%.*s", (int)match.rm_eo, path);
+	snprintf(file, PATH_MAX, "%s%s", rootPath, script);
+
+	_fastCgiParam(params, "GATEWAY_INTERFACE", "CGI/1.1");
+	_fastCgiParam(params, "SERVER_SOFTWARE", "httpserver");
+	_fastCgiParam(params, "SERVER_PROTOCOL", r->httpVersion);
+	_fastCgiParam(params, "REQUEST_METHOD", r->method);
+	_fastCgiParam(params, "REQUEST_URI", r->uri);
+	_fastCgiParam(params, "DOCUMENT_ROOT", rootPath);
+	_fastCgiParam(params, "SCRIPT_NAME", script);
+	_fastCgiParam(params, "SCRIPT_FILENAME", file);
+	_fastCgiParam(params, "PATH_INFO", path+match.rm_eo);
+	_fastCgiParam(params, "QUERY_STRING", query);
+	free(query);
+	_fastCgiParam(params, "CONTENT_LENGTH", "");
+	_fastCgiParam(params, "CONTENT_TYPE", "");
+	if (tlsActive()) {
+		_fastCgiParam(params, "HTTPS", "on");
+	}
+	length=sizeof(address);
+	if (getpeername(clientFd, (struct sockaddr*)&address, &length)==0) {
+		_fastCgiAddress(params, "REMOTE_ADDR", "REMOTE_PORT", &address);
+	}
+	length=sizeof(address);
+	if (getsockname(clientFd, (struct sockaddr*)&address, &length)==0) {
+		_fastCgiAddress(params, "SERVER_ADDR", "SERVER_PORT", &address);
+	}
+	_fastCgiParam(params, "HTTP_USER_AGENT", r->rqHeader->userAgent);
+	_fastCgiParam(params, "HTTP_REFERER", r->rqHeader->referrer);
+	_fastCgiParam(params, "HTTP_ACCEPT_ENCODING",
+			r->rqHeader->acceptEncoding);
+	_fastCgiParam(params, "HTTP_AUTHORIZATION", r->rqHeader->authorization);
+	_fastCgiParam(params, "HTTP_FROM", r->rqHeader->from);
+	_fastCgiParam(params, "HTTP_IF_MODIFIED_SINCE",
+			r->rqHeader->ifModifiedSince);
+	_fastCgiParam(params, "HTTP_PRAGMA", r->gHeader->pragma);
+
+	_fastCgiRecord(records, FCGI_BEGIN_REQUEST, id, begin, sizeof(begin));
+	for (offset=0; offset<params->length; offset+=FCGI_MAX_CONTENT) {
+		_fastCgiRecord(records, FCGI_PARAMS, id, params->string+offset,
+				params->length-offset>FCGI_MAX_CONTENT?FCGI_MAX_CONTENT:
+				params->length-offset);
+	}
+	_fastCgiRecord(records, FCGI_PARAMS, id, NULL, 0);
+	_fastCgiRecord(records, FCGI_STDIN, id, NULL, 0);
+	bsFree(params);
+	free(params);
+	return(records);
+}
+
+
+void _fastCgiRecord(byteString_t* b, int type, int id, char* content,
+		int length) {
+	/* Append a record of <length> bytes of <content>, padded to 8 bytes */
+	char padding[8]={0};
+	unsigned char header[FCGI_HEADER_LEN]={FCGI_VERSION_1, type, id>>8,
+		id&0xff, length>>8, length&0xff, (8-length%8)%8, 0};
+
+	bsAppend(b, header, FCGI_HEADER_LEN);
+	if (length>0) {
+		bsAppend(b, content, length);
+	}
+	bsAppend(b, padding, header[6]);
+}
+
+
+void _fastCgiParam(byteString_t* b, char* name, char* value) {
+	/* Append a name-value pair, unless the value is unset (NULL) */
+	if (value!=NULL) {
+		_fastCgiLength(b, strlen(name));
+		_fastCgiLength(b, strlen(value));
+		bsAppend(b, name, strlen(name));
+		bsAppend(b, value, strlen(value));
+	}
+}
+
+
+void _fastCgiLength(byteString_t* b, int length) {
+	/* Name-value pair length; one byte under 128, else four */
+	unsigned char bytes[4]={(length>>24)|0x80, length>>16, length>>8, length};
+
+	if (length<128) {
+		bytes[0]=length;
+		bsAppend(b, bytes, 1);
+	} else {
+		bsAppend(b, bytes, 4);
+	}
+}
+
+
+void _fastCgiAddress(byteString_t* b, char* name, char* portName,
+		struct sockaddr_storage* address) {
+	/* Append the address and port parameters of an IP socket <address> */
+	char host[INET6_ADDRSTRLEN];
+	char port[8];
+
+	if (address->ss_family==AF_INET) {
+		inet_ntop(AF_INET, &((struct sockaddr_in*)address)->sin_addr, host,
+				sizeof(host));
+		snprintf(port, sizeof(port), "%d",
+				ntohs(((struct sockaddr_in*)address)->sin_port));
+	} else if (address->ss_family==AF_INET6) {
+		inet_ntop(AF_INET6, &((struct sockaddr_in6*)address)->sin6_addr, host,
+				sizeof(host));
+		snprintf(port, sizeof(port), "%d",
+				ntohs(((struct sockaddr_in6*)address)->sin6_port));
+	} else {
+		return;
+	}
+	_fastCgiParam(b, name, host);
+	_fastCgiParam(b, portName, port);
+}
+
+
+int _fastCgiSend(fastCgiConnection_t* c, byteString_t* records) {
+	/**
+	 * Send <records> on <c>, not interleaved with any other request's.
+	 *
+	 * RETURN:
+	 * 	false if the connection failed, which is then shut down
+	 */
+	long sent=0;
+	ssize_t n;
+
+	pthread_mutex_lock(&c->writeLock);
+	while (sent<records->length) {
+		n=send(c->fd, records->string+sent, records->length-sent,
+				MSG_NOSIGNAL);
+		if (n<0&&errno==EINTR) {
+			continue;
+		} else if (n<0) {
+			break;
+		}
+		sent+=n;
+	}
+	pthread_mutex_unlock(&c->writeLock);
+
+	/* A partial record would corrupt the stream, the reader closes it */
+	if (sent<records->length) {
+		logWarn("Could not send to FastCGI %s: %s", c->backend->address,
+				strerror(errno));
+		shutdown(c->fd, SHUT_RDWR);
+		return(false);
+	}
+	return(true);
+}
+
+
+int _fastCgiReadHeader(fastCgiExchange_t* x) {
+	/**
+	 * Read the CGI response header from the request's output.
+	 *
+	 * RETURN:
+	 * 	0 once parsed, else 504 on a timeout or 502 on a malformed or missing
+	 * 	header
+	 */
+	struct pollfd p={x->pipe[0], POLLIN, 0};
+	int length;
+	ssize_t n;
+
+	while ((length=_fastCgiHeaderLength(x))==0) {
+		if (x->end==FASTCGI_HEADER_MAX) {
+			logWarn("FastCGI response header too long");
+			return(502);
+		}
+		n=poll(&p, 1, serverConfig.fastCgiTimeout*1000);
+		if (n<0&&errno==EINTR) {
+			continue;
+		} else if (n==0) {
+			return(504);
+		}
+		n=read(x->pipe[0], x->buffer+x->end, FASTCGI_HEADER_MAX-x->end);
+		if (n<0&&errno==EINTR) {
+			continue;
+		} else if (n<=0) {
+			return(502);	// Ended, or the connection closed, with no header
+		}
+		x->end+=n;
+	}
+	return(_fastCgiParseHeader(x, length)?0:502);
+}
+
+
+int _fastCgiHeaderLength(fastCgiExchange_t* x) {
+	/* Bytes of buffered header up to its blank line, 0 if partial */
+	char* p=x->buffer;
+	char* end=x->buffer+x->end;
+	char* newline;
+
+	while ((newline=memchr(p, '\n', end-p))!=NULL) {
+		if (newline==p||(newline==p+1&&*p=='\r')) {
+			return(newline+1-x->buffer);
+		}
+		p=newline+1;
+	}
+	return(0);
+}
+
+
+int _fastCgiParseHeader(fastCgiExchange_t* x, int length) {
+	/**
+	 * Take the status from the <length> byte CGI header (RFC 3875 6.3) at
+	 * the front of the buffer, keeping the other fields for the client.
+	 *
+	 * RETURN:
+	 * 	false if the header is malformed
+	 */
+	byteString_t* out=bsInit();
+	char* header=strndup(x->buffer, length);
+	char* location=NULL;
+	char* line;
+	char* save;
+	char* colon;
+	char* value;
+	int code;
+
+	for (line=strtok_r(header, "\r\n", &save); line!=NULL;
+			line=strtok_r(NULL, "\r\n", &save)) {
+		if ((colon=strchr(line, ':'))==NULL) {
+			break;
+		}
+		*colon='\0';
+		value=colon+1+strspn(colon+1, " \t");
+		if (strcasecmp(line, "Status")==0) {
+			code=atoi(value);
+			if (code<100||code>599||strlen(value)<3) {
+				break;
+			}
+			free(x->code);
+			free(x->phrase);
+			x->code=strndup(value, 3);
+			x->phrase=strdup(value[3]==' '?value+4:"");
+			continue;
+		} else if (strcasecmp(line, "Location")==0) {
+			location=value;
+		}
+		bsAppend(out, line, strlen(line));
+		bsAppend(out, ": ", 2);
+		bsAppend(out, value, strlen(value));
+		bsAppend(out, "\n", 1);
+	}
+
+	if (line==NULL&&x->code==NULL) {
+		x->code=strdup(location!=NULL?"302":"200");
+		x->phrase=strdup(location!=NULL?"Found":"OK");
+	}
+	bsAppend(out, "", 1);
+	x->header=out->string;
+	x->start=length;
+	free(out);
+	free(header);
+	return(line==NULL);
+}
+
+
+int _fastCgiReadFull(int fd, void* buffer, int length) {
+	/* Read exactly <length> bytes from <fd>. False if it closed or failed */
+	int done=0;
+	ssize_t n;
+
+	while (done<length) {
+		n=recv(fd, (char*)buffer+done, length-done, 0);
+		if (n<0&&errno==EINTR) {
+			continue;
+		} else if (n<=0) {
+			return(false);
+		}
+		done+=n;
+	}
+	return(true);
+}
@@ -0,0 +1,97 @@
+/*
+ * Author: 			Ben Tomlin
+ * Student Id:		btomlin
+ * Student Nbr:		834198
+ * Date:			Oct 2026
+ */
+
+#ifndef HTTP_FASTCGI_H_
+#define HTTP_FASTCGI_H_
+
+#include <pthread.h>
+#include <regex.h>
+#include <sys/socket.h>
+
+#include "httpStructures.h"
+
+/* Protocol, FastCGI 1.0 */
+#define FCGI_VERSION_1			1
+#define FCGI_HEADER_LEN			8
+#define FCGI_MAX_CONTENT		65535
+#define FCGI_BEGIN_REQUEST		1	// Record types
+#define FCGI_ABORT_REQUEST		2
+#define FCGI_END_REQUEST		3
+#define FCGI_PARAMS				4
+#define FCGI_STDIN				5
+#define FCGI_STDOUT				6
+#define FCGI_STDERR				7
+#define FCGI_GET_VALUES			9
+#define FCGI_GET_VALUES_RESULT	10
+#define FCGI_RESPONDER			1	// Role
+#define FCGI_KEEP_CONN			1	// Begin request flag
+#define FCGI_REQUEST_COMPLETE	0	// End request protocol statuses
+#define FCGI_CANT_MPX_CONN		1
+
+#define FASTCGI_MAX_REQUESTS	64	 // Most multiplexed on one connection
+#define FASTCGI_HEADER_MAX		8192 // Longest CGI response header
+#define FASTCGI_PIPE_SIZE		(256*1024) // Output buffered per request
+#define FASTCGI_PROBE_MS		1000 // Wait for an answer to FCGI_GET_VALUES
+#define FASTCGI_MAXADDRESS		128
+
+typedef struct fastCgiBackend fastCgiBackend_t;
+typedef struct fastCgiConnection fastCgiConnection_t;
+typedef struct fastCgiRoute fastCgiRoute_t;
+typedef struct fastCgiExchange fastCgiExchange_t;
+
+struct fastCgiBackend {		// An application, and its persistent connections
+	char address[FASTCGI_MAXADDRESS];	// As configured, for messages
+	struct sockaddr_storage sockAddr;
+	socklen_t sockAddrLength;
+	pthread_mutex_t lock;		// Guards all of the backend's connections
+	pthread_cond_t available;	// A request slot was freed
+	fastCgiConnection_t* connections;
+	int nConnections;			// Including those being opened
+	fastCgiBackend_t* next;
+};
+
+struct fastCgiConnection {
+	int fd;
+	fastCgiBackend_t* backend;
+	pthread_mutex_t writeLock;	// Keeps each request's records together
+	int capacity;				// Concurrent requests, 1 unless multiplexing
+	int active;
+	int dead;					// Closed by the application, no new requests
+	int users;					// Reader thread and unreleased exchanges
+	fastCgiExchange_t* requests[FASTCGI_MAX_REQUESTS+1];	// By request id
+	fastCgiConnection_t* next;
+};
+
+struct fastCgiRoute {			// Paths matching pattern go to backend
+	char* pattern;
+	regex_t regex;				// End of match splits SCRIPT_NAME, PATH_INFO
+	fastCgiBackend_t* backend;
+	fastCgiRoute_t* next;
+};
+
+struct fastCgiExchange {		// A request on a connection, and its output
+	fastCgiConnection_t* connection;
+	int id;
+	int pipe[2];				// FCGI_STDOUT, written by the reader thread
+	int refs;					// Worker and, until the request ends, reader
+	int discard;				// The worker stopped reading, drop output
+	char* code;
+	char* phrase;
+	char* header;				// Fields for the client, "Name: value\n"
+	char buffer[FASTCGI_HEADER_MAX];	// Read from the pipe, not yet sent
+	int start;
+	int end;
+};
+
+int parseFastCgiRoute(char* pattern, char* address, fastCgiRoute_t* route);
+fastCgiRoute_t* fastCgiMatch(fastCgiRoute_t* routes, char* uri);
+fastCgiExchange_t* fastCgiForward(request_t* r, fastCgiRoute_t* route,
+		char* rootPath, int clientFd, int* status);
+long fastCgiSendBody(fastCgiExchange_t* x, int clientFd);
+void fastCgiRelease(fastCgiExchange_t* x);
+
+#endif /* HTTP_FASTCGI_H_ */
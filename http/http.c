@@ -8,40 +8,80 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 #include "httpStructures.h"
 #include "./../utility/tcpSocketIo.h"
 #include "./../utility/filesystem.h"
 #include "./../utility/logger.h"
 #include "./../utility/regexTool.h"
+#include "./../utility/openFileCache.h"
+#include "encoding.h"
+#include "compress.h"
+#include "responseCache.h"
+#include "packFile.h"
+#include "mimeTypes.h"
+#include "dirListing.h"
+#include "uriPath.h"
+#include "accessLog.h"
+#include "serverStatus.h"
+#include "proxy.h"
+#include "fastCgi.h"
+#include "cachePolicy.h"
+#include "notFoundCache.h"
+#include "./../utility/metrics.h"
+#include "./../utility/probes.h"
+#include "./../utility/deadline.h"
 #include "http.h"
-
-#define MIME_JS "application/javascript"
-#define MIME_HTML "text/html"
-#define MIME_CSS "text/css"
-#define MIME_JPEG "image/jpeg"
-#define MIME_DEFAULT "application/octet-stream$"
-#define MATCH_MIME_JS "\\.js$"
-#define MATCH_MIME_HTML "\\.html$"
-#define MATCH_MIME_CSS "\\.css$"
-#define MATCH_MIME_JPEG "\\.jpg$"
+#include "./../config.h"
 
 #define EINVALID_REQUEST 19 // Request was malformed
 #define REQUESTOK 23 // Request line is valid
+#define MAX_HEADER_LINES 64 // Header lines read beyond this are ignored
+#define NOT_FOUND_RESPONSE "HTTP/1.0 404 Not Found\n\n" // Serialized whole
 
 void _handleInvalidPath();
 
 int _parseRequestLine(char* requestLine, request_t *r);
-response_t* _getResponse(request_t *r, char* rootPath);
+int _parseKnownMissing(char* requestLine, request_t *r);
+int _isPlainNotFound(response_t* r);
+response_t* _getResponse(request_t *r, char* rootPath, int socketFd);
 request_t *_getRequest(int socketFd);
 void _httpGet(request_t *r, response_t *response, char* rootPath);
+int _httpGetPacked(request_t *r, response_t *response);
+void _httpGetStatus(response_t *response, int format);
+void _httpProxy(request_t *r, response_t *response, proxyRoute_t* route,
+		int socketFd);
+void _httpFastCgi(request_t *r, response_t *response, fastCgiRoute_t* route,
+		char* rootPath, int socketFd);
+void _httpGetDirectory(request_t *r, response_t *response, char* dirPath,
+		char* rootPath);
+void _serveFile(request_t *r, response_t *response, openFile_t* file);
+void _setStatus(response_t *response, char* code, char* phrase);
 char* _getMimeType(char* fPath);
-char* _assemblePathFromURI(char* uri, char* rootPath);
+openFile_t* _negotiateEncoding(request_t *r, response_t *response,
+		openFile_t* file);
+void _compressOnTheFly(request_t *r, response_t *response);
+int _assemblePathFromURI(char* uri, char* rootPath, char* path, int pathSize);
 char* _longToString(long l);
 
+int _readRequestHeaders(int socketFd, request_t *r);
 void _parseRequestHeader(char* headerLine, request_t *r);
+char** _requestHeaderField(request_t *r, char* name);
 void _parseRequestEntity(request_t* r, int socketFd);
-void _sendResponse(response_t* r, int socketFd);
+long _sendResponse(response_t* r, int socketFd);
+void _logAccess(int socketFd, request_t* r, response_t* rs, long sent,
+		struct timespec* start);
+void _serializeHeader(response_t* r, byteString_t* header);
+int _sendCachedResponse(response_t* r, int socketFd, byteString_t* header,
+		long* sent);
+responseEntry_t* _buildCachedResponse(response_t* r, byteString_t* header);
+void _appendHeader(byteString_t* header, char* name, char* value);
 
 
 void processRequest(int socketFd, char* rootPath) {
@@ -52,24 +92,63 @@ void processRequest(int socketFd, char* rootPath) {
 	 * for mime types as specified in the assignment
 	 */
 
+	struct timespec start;
+	long sent;
+
 	/* Read request, assemble response */
+	clock_gettime(CLOCK_REALTIME, &start);
+	long parseStart=metricsNow();
+	deadlineArm(serverConfig.idleTimeout, false);
 	request_t* r=_getRequest(socketFd);
+	metricsRecord(STAGE_PARSE, parseStart);
 	if(r==NULL) {
-		mylog("Malformed request");
+		logWarn("Malformed request");
 
 		/* No handling required for malformed requests in assignment */
 		return;
 	}
+	PROBE_REQUEST_PARSED(socketFd, r->method, r->uri);
 
-	response_t* rs=_getResponse(r, rootPath);
-	freeRequest(r);free(r);
+	response_t* rs=_getResponse(r, rootPath, socketFd);
+	int status=atoi(rs->status->code);
+	PROBE_RESPONSE_STATUS(socketFd, status, r->uri);
 
 	/* Send the response.*/
-	_sendResponse(rs, socketFd);
+	deadlineArm(serverConfig.sendTimeout, true);
+	sent=_sendResponse(rs, socketFd);
+	metricsCount(COUNT_REQUESTS, 1);
+	metricsCount(COUNT_BYTES_SENT, sent);
+	metricsStatus(status);
+	if (accessLogEnabled()) {
+		_logAccess(socketFd, r, rs, sent, &start);
+	}
+	freeRequest(r);free(r);
 	freeResponse(rs);free(rs);
 }
 
 
+void _logAccess(int socketFd, request_t* r, response_t* rs, long sent,
+		struct timespec* start) {
+	/* Write the access log record of a request whose response was sent */
+	accessRecord_t record;
+	struct timespec end;
+
+	clock_gettime(CLOCK_REALTIME, &end);
+	record.socketFd=socketFd;
+	record.start=*start;
+	record.durationUs=(end.tv_sec-start->tv_sec)*1000000L+
+			(end.tv_nsec-start->tv_nsec)/1000;
+	record.method=r->method;
+	record.uri=r->uri;
+	record.httpVersion=r->httpVersion;
+	record.status=rs->status->code;
+	record.bytes=sent;
+	record.referrer=r->rqHeader->referrer;
+	record.userAgent=r->rqHeader->userAgent;
+	accessLogWrite(&record);
+}
+
+
 request_t *_getRequest(int socketFd) {
 	/**
 	 * Read a request from <socketFd> & return a request structure
@@ -87,15 +166,25 @@ request_t *_getRequest(int socketFd) {
 		return(NULL);
 	}
 
-	/* Parse request line to request structure*/
-	if(_parseRequestLine(requestLine, r)==EINVALID_REQUEST) {
+	/* Parse request line to request structure. One naming a URI known to be
+	 * missing need not be matched against the regexes */
+	if(!_parseKnownMissing(requestLine, r)
+			&&_parseRequestLine(requestLine, r)==EINVALID_REQUEST) {
 		freeRequest(r);free(r);
 		free(requestLine);
 		return(NULL);
 	}
 
-	/* Not implemented*/
-	_parseRequestHeader(requestLine, r);
+	free(requestLine);
+
+	/* Full requests carry header fields, simple (HTTP/0.9) requests do not */
+	if(strcmp(r->httpVersion, "HTTP/0.9")!=0) {
+		deadlineArm(serverConfig.headerTimeout, false);
+		if (!_readRequestHeaders(socketFd, r)) {
+			freeRequest(r);free(r);
+			return(NULL);
+		}
+	}
 
 	/* Not implemented. Reads content-length bytes from fd */
 	_parseRequestEntity(r, socketFd);
@@ -105,7 +194,7 @@ request_t *_getRequest(int socketFd) {
 
 
 response_t*
-_getResponse(request_t *r, char* rootPath) {
+_getResponse(request_t *r, char* rootPath, int socketFd) {
 	/**
 	 * Populate a response structure for a request.
 	 *
@@ -113,6 +202,7 @@ _getResponse(request_t *r, char* rootPath) {
 	 * 		request_t r - The request. Should be parsed/populated with ateast
 	 * 		a request line
 	 * 		rootPath - path to the document root
+	 * 		socketFd - the client connection, for proxied requests
 	 *
 	 * RETURN:
 	 * 		response_t *r - response structure representing server response.
@@ -129,19 +219,27 @@ _getResponse(request_t *r, char* rootPath) {
 	rs->httpVersion=strdup("HTTP/1.0");
 
 	/* Write verions into response here */
-	if(strcmp(r->method,"GET")==0) {
+	int statusFormat=serverConfig.serverStatus?statusRequestFormat(r->uri):
+			STATUS_NONE;
+	proxyRoute_t* route=proxyMatch(serverConfig.proxyRoutes, r->uri);
+	fastCgiRoute_t* application=route!=NULL?NULL:
+			fastCgiMatch(serverConfig.fastCgiRoutes, r->uri);
+	if(strcmp(r->method,"GET")==0&&statusFormat!=STATUS_NONE) {
+		_httpGetStatus(rs, statusFormat);
+	} else if(strcmp(r->method,"GET")==0&&route!=NULL) {
+		_httpProxy(r, rs, route, socketFd);
+	} else if(strcmp(r->method,"GET")==0&&application!=NULL) {
+		_httpFastCgi(r, rs, application, rootPath, socketFd);
+	} else if(strcmp(r->method,"GET")==0) {
 		_httpGet(r, rs, rootPath);
 	}
 
-	/* Find content length of entity if present */
-	if (rs->entityPath!=NULL) {
-		FILE *f = fopen(rs->entityPath, "rb");
-		if(f==NULL){
-			handleFileOpenError();
-		}
-		long fSize = getBinaryFileSize(f);
-		rs->eHeader->contentLength=fSize;
-		fclose(f);
+	/* Find content length of entity if present. Unknown if compressing it
+	 * while sending */
+	if (rs->entityBuffer!=NULL) {
+		rs->eHeader->contentLength=rs->entityBuffer->length;
+	} else if (rs->entityFile!=NULL&&!rs->compressEntity) {
+		rs->eHeader->contentLength=rs->entityFile->st.st_size;
 	}
 
 	return(rs);
@@ -163,88 +261,473 @@ void _httpGet(request_t *request, response_t *response, char* rootPath) {
 	 */
 
 	request_t*r=request;
-	char* statusCode;
-	char* statusPhrase;
-	char* resourcePath=_assemblePathFromURI((r->uri), rootPath);
-	char* contentType;
+	char resourcePath[PATH_MAX];
+	openFile_t* file;
+	long resolveStart=metricsNow();
 
-	/* Check the file exists & set response status*/
-	if(resourcePath==NULL||testFile(resourcePath, F_OK|R_OK)==FALSE) {
-		statusCode = "404";
-		statusPhrase="Not Found";
+	/* A pack answers from memory, the document root serves what it lacks */
+	if (packEnabled()&&_httpGetPacked(r, response)) {
+		metricsRecord(STAGE_RESOLVE, resolveStart);
+		return;
+	}
+
+	/* Recently found missing, see notFoundCache.c */
+	if (r->knownMissing||notFoundCacheHit(r->uri)) {
+		metricsRecord(STAGE_RESOLVE, resolveStart);
+		PROBE_PATH_RESOLVED(r->uri, "", false);
+		_setStatus(response, "404", "Not Found");
+		return;
+	}
+
+	/* Undecodable URIs and those escaping the document root */
+	if(_assemblePathFromURI(r->uri, rootPath, resourcePath, PATH_MAX)<0) {
+		_setStatus(response, "400", "Bad Request");
+		return;
+	}
+
+	/* Check the file can be opened & set response status. A cached open
+	 * file costs no syscalls here */
+	file=openFileAcquire(resourcePath);
+	metricsRecord(STAGE_RESOLVE, resolveStart);
+	PROBE_PATH_RESOLVED(r->uri, resourcePath, file!=NULL);
+	if(file!=NULL) {
+		_serveFile(r, response, file);
+
+	/* Directories are served through their index file or a listing */
+	} else if (errno==EISDIR) {
+		_httpGetDirectory(r, response, resourcePath, rootPath);
 
 	} else {
-		statusCode = "200";
-		statusPhrase="OK";
-		response->eHeader->contentType=strdup(_getMimeType(resourcePath));
-		response->entityPath=resourcePath;
+		if (errno==ENOENT||errno==ENOTDIR) {
+			notFoundCacheInsert(r->uri, resourcePath, rootPath);
+		}
+		_setStatus(response, "404", "Not Found");
 	}
+}
+
 
-	/* Set status and phrase */
-	response->status->code=malloc(strlen(statusCode)+1);
-	response->status->phrase=malloc(strlen(statusPhrase)+1);
-	strcpy(response->status->code, statusCode);
-	strcpy(response->status->phrase, statusPhrase);
+int _httpGetPacked(request_t *r, response_t *response) {
+	/**
+	 * Respond 200 with the entity the pack holds for the URI of <r>, or a
+	 * precompressed variant of it the client accepts. The entity is sent
+	 * from the pack mapping, which the response holds until freed.
+	 *
+	 * RETURN:
+	 * 	false if the pack does not hold the URI
+	 */
+	static char* codings[PACK_VARIANTS]={ENCODING_GZIP, ENCODING_BR};
+	static int preference[PACK_VARIANTS]={PACK_BR, PACK_GZIP};
+	char path[PATH_MAX];
+	int length=canonicalizePath(r->uri, path,
+			PATH_MAX-strlen(serverConfig.index));
+	pack_t* pack;
+	packEntry_t* e;
+	packBlob_t* content;
+	entityBuffer_t* b;
+	char* coding=NULL;
+	int i;
+
+	if (length<0) {
+		return(false);
+	}
+	if (path[length-1]=='/') {
+		strcpy(path+length, serverConfig.index);
+	}
+	pack=packAcquire();
+	e=packLookup(pack, path);
+	if (e==NULL) {
+		packRelease(pack);
+		return(false);
+	}
+
+	/* Caches must key on Accept-Encoding whenever variants exist */
+	content=&e->content;
+	for (i=0; i<PACK_VARIANTS; i++) {
+		if (e->variants[preference[i]].length==0) {
+			continue;
+		}
+		if (response->rsHeader->vary==NULL) {
+			response->rsHeader->vary=strdup(VARY_ENCODING);
+		}
+		if (coding==NULL&&acceptsEncoding(r->rqHeader->acceptEncoding,
+				codings[preference[i]])) {
+			coding=codings[preference[i]];
+			content=&e->variants[preference[i]];
+		}
+	}
+
+	b=malloc(sizeof(entityBuffer_t));
+	b->bytes=packBytes(pack, content);
+	b->length=content->length;
+	b->owner=pack;
+	b->release=packRelease;
+	response->entityBuffer=b;
+	response->eHeader->contentType=strndup(packBytes(pack, &e->mime),
+			e->mime.length);
+	if (coding!=NULL) {
+		response->eHeader->contentEncoding=strdup(coding);
+	}
+
+	/* Each coding of the entity is a distinct representation */
+	response->rsHeader->eTag=malloc(40);
+	sprintf(response->rsHeader->eTag, "\"%016lx%s%s\"",
+			(unsigned long)e->etag, coding!=NULL?"-":"",
+			coding!=NULL?coding:"");
+	cachePolicyApply(r->uri, path, response->eHeader->contentType,
+			&response->gHeader->cacheControl, &response->eHeader->expires);
+	PROBE_PATH_RESOLVED(r->uri, path, true);
+	_setStatus(response, "200", "OK");
+	return(true);
+}
+
+
+void _httpGetStatus(response_t *response, int format) {
+	/* Respond with the server status page in <format> */
+	entityBuffer_t* b=malloc(sizeof(entityBuffer_t));
+	byteString_t* page=renderServerStatus(format);
+
+	b->bytes=page->string;
+	b->length=page->length;
+	b->owner=page;
+	b->release=serverStatusRelease;
+	response->entityBuffer=b;
+	response->eHeader->contentType=strdup(format==STATUS_PROMETHEUS?
+			STATUS_PROMETHEUS_TYPE:STATUS_TEXT_TYPE);
+	_setStatus(response, "200", "OK");
+}
+
+
+void _httpProxy(request_t *r, response_t *response, proxyRoute_t* route,
+		int socketFd) {
+	/* Respond with what the upstream of <route> responds, see proxy.c */
+	int status;
+
+	/* The upstream socket timeouts bound the wait instead */
+	deadlineArm(0, false);
+	response->upstream=proxyForward(r, route, socketFd, &status);
+	if (response->upstream!=NULL) {
+		_setStatus(response, response->upstream->code,
+				response->upstream->phrase);
+		response->eHeader->contentLength=(response->upstream->framing==
+				PROXY_BODY_LENGTH)?response->upstream->remaining:-1L;
+	} else if (status==504) {
+		_setStatus(response, "504", "Gateway Timeout");
+	} else {
+		_setStatus(response, "502", "Bad Gateway");
+	}
+}
+
+
+void _httpFastCgi(request_t *r, response_t *response, fastCgiRoute_t* route,
+		char* rootPath, int socketFd) {
+	/* Respond with the output of the application of <route>, see fastCgi.c */
+	int status;
+
+	/* fastcgi_timeout bounds the wait instead */
+	deadlineArm(0, false);
+	response->fastCgi=fastCgiForward(r, route, rootPath, socketFd, &status);
+	if (response->fastCgi!=NULL) {
+		_setStatus(response, response->fastCgi->code,
+				response->fastCgi->phrase);
+		response->eHeader->contentLength=-1L;
+	} else if (status==504) {
+		_setStatus(response, "504", "Gateway Timeout");
+	} else {
+		_setStatus(response, "502", "Bad Gateway");
+	}
+}
+
+
+void
+_httpGetDirectory(request_t *r, response_t *response, char* dirPath,
+		char* rootPath) {
+	/**
+	 * Handle a get request resolving to directory <dirPath>.
+	 *
+	 * Serve the directory index file if present, else an autoindex listing
+	 * if enabled. URIs naming a directory without a trailing slash are
+	 * redirected to it with the slash, so relative links resolve.
+	 */
+	char* pathEnd=r->uri+strcspn(r->uri, "?;");
+	char* indexPath;
+	openFile_t* index;
+	dirListing_t* listing;
+	entityBuffer_t* b;
+
+	if (pathEnd==r->uri||*(pathEnd-1)!='/') {
+		response->rsHeader->location=malloc(strlen(r->uri)+2);
+		sprintf(response->rsHeader->location, "%.*s/%s",
+				(int)(pathEnd-r->uri), r->uri, pathEnd);
+		_setStatus(response, "301", "Moved Permanently");
+		return;
+	}
+
+	indexPath=malloc(strlen(dirPath)+strlen(serverConfig.index)+2);
+	sprintf(indexPath, "%s%s%s", dirPath,
+			dirPath[strlen(dirPath)-1]=='/'?"":"/", serverConfig.index);
+	index=openFileAcquire(indexPath);
+	free(indexPath);
+	if (index!=NULL) {
+		_serveFile(r, response, index);
+		return;
+	}
+
+	if (!serverConfig.autoindex) {
+		_setStatus(response, "403", "Forbidden");
+		return;
+	}
+
+	/* Listing titled with the path below the document root */
+	listing=dirListingAcquire(dirPath, dirPath+strlen(rootPath));
+	if (listing==NULL) {
+		_setStatus(response, "404", "Not Found");
+		return;
+	}
+	b=malloc(sizeof(entityBuffer_t));
+	b->bytes=listing->html;
+	b->length=listing->length;
+	b->owner=listing;
+	b->release=dirListingRelease;
+	response->entityBuffer=b;
+	response->eHeader->contentType=strdup(MIME_HTML);
+	_setStatus(response, "200", "OK");
+}
+
+
+void _serveFile(request_t *r, response_t *response, openFile_t* file) {
+	/**
+	 * Respond 200 with the content of <file>, or a compressed variant of it
+	 * the client accepts. The response takes over the reference to <file>.
+	 */
+	response->eHeader->contentType=strdup(_getMimeType(file->path));
+	cachePolicyApply(r->uri, file->path, response->eHeader->contentType,
+			&response->gHeader->cacheControl, &response->eHeader->expires);
+	response->entityFile=_negotiateEncoding(r, response, file);
+	response->entityPath=strdup(response->entityFile->path);
+	if (response->eHeader->contentEncoding==NULL) {
+		_compressOnTheFly(r, response);
+	}
+	_setStatus(response, "200", "OK");
+}
+
+
+void _setStatus(response_t *response, char* code, char* phrase) {
+	/* Set response status code and reason phrase */
+	response->status->code=strdup(code);
+	response->status->phrase=strdup(phrase);
 }
 
 
 char* _getMimeType(char* fPath) {
 	/**
-	 * Given a filepath, return it's mime type based on its file extension
+	 * Given a filepath, return it's mime type based on its file extension.
+	 * The table is loaded at startup, see mimeTypes.c
 	 */
-	if (isMatch(""MATCH_MIME_JS, fPath)) {
-		return(MIME_JS);
-	} else if (isMatch(MATCH_MIME_HTML, fPath)) {
-		return(MIME_HTML);
-	} else if (isMatch(MATCH_MIME_JPEG, fPath)) {
-		return(MIME_JPEG);
-	} else if (isMatch(MATCH_MIME_CSS, fPath)) {
-		return(MIME_CSS);
-	}
-	return(MIME_DEFAULT);
+	return(lookupMimeType(fPath));
+}
+
+
+openFile_t*
+_negotiateEncoding(request_t *r, response_t *response, openFile_t* file) {
+	/**
+	 * Choose between <file> and a precompressed sibling of it (path.br,
+	 * path.gz) based on the request Accept-Encoding header.
+	 *
+	 * RETURN:
+	 * 	Open file of the entity to send. <file> is released if a sibling is
+	 * 	chosen. Content-Encoding and Vary are set on the response as required.
+	 */
+	char* coding;
+	int hasVariant;
+	openFile_t* sibling=findPrecompressed(file, r->rqHeader->acceptEncoding,
+			&coding, &hasVariant);
+
+	/* Caches must key on Accept-Encoding whenever variants exist */
+	if (hasVariant) {
+		response->rsHeader->vary=strdup(VARY_ENCODING);
+	}
+
+	if (sibling==NULL) {
+		return(file);
+	}
+	response->eHeader->contentEncoding=strdup(coding);
+	openFileRelease(file);
+	return(sibling);
 }
 
 
 void
-_parseRequestHeader(char* headerLine, request_t *r) {return;}
+_compressOnTheFly(request_t *r, response_t *response) {
+	/**
+	 * Gzip the response entity if enabled, worthwhile and accepted by the
+	 * client. Small files are served from the compressed variant cache, files
+	 * too large to cache (or whose result does not fit it) are compressed
+	 * while sending.
+	 */
+	gzipEntry_t* e;
+	entityBuffer_t* b;
+	openFile_t* file=response->entityFile;
 
+	if (!serverConfig.gzip
+			||!isCompressibleType(response->eHeader->contentType)
+			||file->st.st_size<serverConfig.gzipMinLength) {
+		return;
+	}
+
+	/* Response now varies on Accept-Encoding whichever coding is sent */
+	if (response->rsHeader->vary==NULL) {
+		response->rsHeader->vary=strdup(VARY_ENCODING);
+	}
+	if (!acceptsEncoding(r->rqHeader->acceptEncoding, ENCODING_GZIP)) {
+		return;
+	}
+
+	e=NULL;
+	if (file->st.st_size<=serverConfig.gzipCacheMaxFile) {
+		e=gzipCacheAcquire(file->path, file->fd, &file->st);
+	}
+	if (e==NULL) {
+		response->compressEntity=true;
+	} else {
+		b=malloc(sizeof(entityBuffer_t));
+		b->bytes=e->data;
+		b->length=e->length;
+		b->owner=e;
+		b->release=gzipCacheRelease;
+		response->entityBuffer=b;
+	}
+	response->eHeader->contentEncoding=strdup(ENCODING_GZIP);
+}
 
-char*
-_assemblePathFromURI(char* uri, char* rootPath) {
+
+int
+_readRequestHeaders(int socketFd, request_t *r) {
+	/**
+	 * Read header lines from <socketFd> up to the blank line ending the
+	 * request header, loading each into the request structure.
+	 *
+	 * RETURN:
+	 * 	false if a line was too long (see fdReadLine()), so the request fails
+	 */
+	char* line;
+	int i;
+
+	for (i=0; i<MAX_HEADER_LINES; i++) {
+		errno=0;
+		line=fdReadLine(socketFd);
+		if (line==NULL) {
+			return(errno!=EMSGSIZE);
+		}
+
+		/* Blank line terminates the header */
+		if (strcmp(line, "\r\n")==0||strcmp(line, "\n")==0) {
+			free(line);
+			return(true);
+		}
+		_parseRequestHeader(line, r);
+		free(line);
+	}
+	logWarn("Too many request header lines, ignoring the remainder");
+	return(true);
+}
+
+
+char**
+_requestHeaderField(request_t *r, char* name) {
 	/**
-	 * Given a URI and server root path, resolve to an absolute path
-	 * Remove query and params part of the URI if any
+	 * Return the address of the request structure field storing header
+	 * <name>, or NULL if the header is not one the server keeps.
+	 *
+	 * Header names are case insensitive as per RFC1945 4.2
+	 */
+	if (strcasecmp(name, "Accept-Encoding")==0) {
+		return(&(r->rqHeader->acceptEncoding));
+	} else if (strcasecmp(name, "Authorization")==0) {
+		return(&(r->rqHeader->authorization));
+	} else if (strcasecmp(name, "From")==0) {
+		return(&(r->rqHeader->from));
+	} else if (strcasecmp(name, "If-Modified-Since")==0) {
+		return(&(r->rqHeader->ifModifiedSince));
+	} else if (strcasecmp(name, "Referer")==0) {
+		return(&(r->rqHeader->referrer));
+	} else if (strcasecmp(name, "User-Agent")==0) {
+		return(&(r->rqHeader->userAgent));
+	} else if (strcasecmp(name, "Date")==0) {
+		return(&(r->gHeader->date));
+	} else if (strcasecmp(name, "Pragma")==0) {
+		return(&(r->gHeader->pragma));
+	}
+	return(NULL);
+}
+
+
+void
+_parseRequestHeader(char* headerLine, request_t *r) {
+	/**
+	 * Load a "Name: value" header line into the request structure. Unknown
+	 * and malformed header lines are ignored.
 	 *
 	 * NOTE:
-	 * 	Caller is responsible for freeing the compiled path that is returned
+	 * 	<headerLine> is modified in place
+	 */
+	char* value;
+	char** field;
+	char* colon=strchr(headerLine, ':');
+	int valueLength;
+
+	if (colon==NULL) {
+		return;
+	}
+	*colon='\0';
+
+	/* Trim leading and trailing whitespace (including the CRLF) of value */
+	value=colon+1+strspn(colon+1, " \t");
+	valueLength=strlen(value);
+	while (valueLength>0 && strchr(" \t\r\n", value[valueLength-1])!=NULL) {
+		value[--valueLength]='\0';
+	}
+
+	field=_requestHeaderField(r, headerLine);
+	if (field!=NULL) {
+		free(*field);
+		*field=strdup(value);
+	}
+}
+
+
+int
+_assemblePathFromURI(char* uri, char* rootPath, char* path, int pathSize) {
+	/**
+	 * Given a URI and server root path, resolve to an absolute path written
+	 * into <path>. Remove query and params part of the URI if any
 	 *
-	 * RETURN:
-	 * 	allocated filepath of the uri. Null if cannot extract a valid filepath.
+	 * The URI path is decoded and normalised first (see uriPath.c), so every
+	 * spelling of a file resolves to the same path. That path is the key
+	 * of the open file, compression and listing caches.
 	 *
+	 * RETURN:
+	 * 	length of the path, or a negative URI_ error code if no valid path
+	 * 	within the root could be extracted.
 	 */
 	int rPathLength=strlen(rootPath);
-	char* uriPath;
+	int n;
 
-	/* No match found - return null */
-	if(extractMatch(PATH, uri, &uriPath)==NULL) {
+	if (rPathLength>=pathSize) {
+		return(URI_TOOLONG);
+	}
+	memcpy(path, rootPath, rPathLength);
+	n=canonicalizePath(uri, path+rPathLength, pathSize-rPathLength);
+	if (n<0) {
 		_handleInvalidPath();
-		return(NULL);
+		return(n);
 	}
-
-	/* Assemble path */
-	char* path = malloc(strlen(rootPath)+1+strlen(uriPath));
-	strcpy(path, rootPath);
-	strcat(path, "/");
-	strcat(path, uriPath);
-	free(uriPath);
-
-	return(path);
+	return(rPathLength+n);
 }
 
 
 void
 _handleInvalidPath() {
-	mylog("Could not extract a path from the given uri");
+	logDebug("Could not extract a path from the given uri");
 }
 
 
@@ -269,16 +752,71 @@ _parseRequestLine(char* requestLine, request_t *r) {
 		return(EINVALID_REQUEST);
 	}
 
+	/* The match includes the space separating the method from the URI */
+	memmove(r->uri, r->uri+1, strlen(r->uri));
+
 	/* Simple http request recieved => version is 0.9, otherwise as per request*/
 	if(NULL==extractMatch(HTTP_VERSION_REGEX, requestLine, &(r->httpVersion))){
-		char* version = "HTTP/0.9";
-		r->httpVersion = malloc(strlen(version));
-		strcpy(r->httpVersion, version);
+		r->httpVersion = strdup("HTTP/0.9");
 	}
 	return(REQUESTOK);
 }
 
 
+int
+_parseKnownMissing(char* requestLine, request_t *r) {
+	/**
+	 * Load request line "GET <uri> HTTP/<digits>.<digits>" into the request
+	 * structure without the regexes, if <uri> is in the not found cache. The
+	 * URI matched URI_REGEX when it was cached, so the line parses the same.
+	 *
+	 * RETURN:
+	 * 	true if loaded, the request is then marked knownMissing. false if the
+	 * 	line is of another form or the URI not known to be missing; parse it
+	 * 	with _parseRequestLine()
+	 *
+	 * NOTE:
+	 * 	Never with a pack, which is looked up ahead of the cache
+	 */
+	char* uri;
+	char* version;
+	int uriLength;
+	int major;
+	int minor;
+	int known;
+
+	if (!notFoundCacheEnabled()||packEnabled()
+			||strncmp(requestLine, "GET ", 4)!=0) {
+		return(false);
+	}
+	uri=requestLine+4;
+	uriLength=strcspn(uri, " ");
+	version=uri+uriLength+1;
+	if (uriLength==0||uri[uriLength]!=' '||strncmp(version, "HTTP/", 5)!=0) {
+		return(false);
+	}
+	major=strspn(version+5, "0123456789");
+	minor=strspn(version+6+major, "0123456789");
+	if (major==0||version[5+major]!='.'||minor==0
+			||strspn(version+6+major+minor, "\r\n")
+			!=strlen(version+6+major+minor)) {
+		return(false);
+	}
+
+	uri[uriLength]='\0';
+	known=notFoundCacheHit(uri);
+	uri[uriLength]=' ';
+	if (!known) {
+		return(false);
+	}
+	r->method=strdup("GET");
+	r->uri=strndup(uri, uriLength);
+	r->httpVersion=strndup(version, 6+major+minor);
+	r->knownMissing=true;
+	return(true);
+}
+
+
 void _parseRequestEntity(request_t* r, int socketFd){}
 
 
@@ -295,48 +833,203 @@ char* _longToString(long l) {
 }
 
 
-void _sendResponse(response_t* r, int socketFd) {
-	/* Serialize response structure and pipe it into socketFd */
+long _sendResponse(response_t* r, int socketFd) {
+	/**
+	 * Serialize response structure and pipe it into socketFd
+	 *
+	 * RETURN:
+	 * 	entity bytes sent, 0 if there was no entity or sending it failed
+	 */
+	long sent=0;
+	long stageStart=metricsNow();
+	byteString_t* header;
+
+	/* A plain 404 is the same bytes every time */
+	if (_isPlainNotFound(r)) {
+		sendBytes(socketFd, NOT_FOUND_RESPONSE, strlen(NOT_FOUND_RESPONSE));
+		metricsRecord(STAGE_HEADER, stageStart);
+		return(0);
+	}
+
+	/* Status line and header fields in one buffer, and so one send */
+	header=bsInit();
+	_serializeHeader(r, header);
+
+	/* Small files go out whole from the response cache */
+	if (_sendCachedResponse(r, socketFd, header, &sent)) {
+		bsFree(header);
+		free(header);
+		return(sent);
+	}
+	sendBytes(socketFd, header->string, header->length);
+	bsFree(header);
+	free(header);
+
+	/* Send Entity if exists*/
+	if (r->entityBuffer!=NULL||r->entityFile!=NULL||r->upstream!=NULL
+			||r->fastCgi!=NULL) {
+		stageStart=metricsRecord(STAGE_HEADER, stageStart);
+		PROBE_SEND_START(socketFd, r->compressEntity?-1L:
+				r->eHeader->contentLength);
+
+		/* Send the binary file from its (possibly cached) descriptor */
+		if (r->upstream!=NULL) {
+			sent=proxySendBody(r->upstream, socketFd);
+		} else if (r->fastCgi!=NULL) {
+			sent=fastCgiSendBody(r->fastCgi, socketFd);
+		} else if (r->entityBuffer!=NULL) {
+			if (sendBytes(socketFd, r->entityBuffer->bytes,
+					r->entityBuffer->length)==SENDOK) {
+				sent=r->entityBuffer->length;
+			}
+		} else if (r->compressEntity) {
+			sendGzipStream(socketFd, r->entityFile->fd,
+					r->entityFile->st.st_size, &sent);
+		} else if (sendFile(socketFd, r->entityFile->fd, 0,
+				r->eHeader->contentLength)==SENDOK) {
+			sent=r->eHeader->contentLength;
+		}
+		metricsRecord(STAGE_BODY, stageStart);
+		PROBE_SEND_END(socketFd, sent);
+	} else {
+		metricsRecord(STAGE_HEADER, stageStart);
+	}
+	return(sent);
+}
+
+
+int _isPlainNotFound(response_t* r) {
+	/* True if <r> is a 404 with no header fields or entity */
+	return(strcmp(r->status->code, "404")==0
+			&&strcmp(r->httpVersion, "HTTP/1.0")==0
+			&&r->rsHeader->location==NULL&&r->upstream==NULL
+			&&r->fastCgi==NULL&&r->entityBuffer==NULL&&r->entityFile==NULL);
+}
+
+
+void _serializeHeader(response_t* r, byteString_t* header) {
+	/**
+	 * Append what precedes the entity of response <r> to <header>; status
+	 * line, header fields and the blank line.
+	 */
+	char* contentLength;
 
 	/* Send a simple request (only the entity) if http0.9 */
 	if(strcmp(r->httpVersion, "HTTP/0.9")!=0) {
 
 		/* Status line */
-		sendString(socketFd, r->httpVersion, " ");
-		sendString(socketFd, r->status->code, " ");
-		sendString(socketFd, r->status->phrase, "\n");
-
+		bsAppend(header, r->httpVersion, strlen(r->httpVersion));
+		bsAppend(header, " ", 1);
+		_appendHeader(header, r->status->code, r->status->phrase);
 
 		/* Send headers for entity if entity exists */
 		if (strcmp(r->status->code, "200")==0) {
 
-			sendString(socketFd, "Content-Type:", " ");
-			sendString(socketFd, r->eHeader->contentType, "\n");
+			_appendHeader(header, "Content-Type:", r->eHeader->contentType);
+			_appendHeader(header, "Content-Encoding:",
+					r->eHeader->contentEncoding);
+			_appendHeader(header, "Vary:", r->rsHeader->vary);
+			_appendHeader(header, "ETag:", r->rsHeader->eTag);
+			_appendHeader(header, "Cache-Control:", r->gHeader->cacheControl);
+			_appendHeader(header, "Expires:", r->eHeader->expires);
+		}
+		_appendHeader(header, "Location:", r->rsHeader->location);
+		if (r->upstream!=NULL) {
+			bsAppend(header, r->upstream->header,
+					strlen(r->upstream->header));
+		}
+		if (r->fastCgi!=NULL) {
+			bsAppend(header, r->fastCgi->header, strlen(r->fastCgi->header));
 		}
 	}
 
-	/* Send Entity if exists*/
-	if (r->entityPath!=NULL) {
+	/* Content length header line, omitted if compressing while sending.
+	 * The end of the entity is then signalled by closing the connection */
+	if ((r->entityBuffer!=NULL||r->entityFile!=NULL)&&!r->compressEntity) {
+		contentLength=_longToString(r->eHeader->contentLength);
+		_appendHeader(header, "Content-Length:", contentLength);
+		free(contentLength);
+	}
 
-		/* Content length header line */
-		sendString(socketFd, "Content-Length: ", NULL);
-		char* contentLength=_longToString(r->eHeader->contentLength);
-		sendString(socketFd, contentLength, "\n");
+	/* Line feed between header and entity */
+	bsAppend(header, "\n", 1);
+}
 
-		/* Line feed between header and entity */
-		sendChar(socketFd, "\n");
 
-		/* Send the binary file as a stream */
-		FILE *f = fopen(r->entityPath, "rb");
-		if(f==NULL){
-			handleFileOpenError();
-		}
-		sendFile(socketFd, f, r->eHeader->contentLength);
-		fclose(f);
+int _sendCachedResponse(response_t* r, int socketFd, byteString_t* header,
+		long* sent) {
+	/**
+	 * Send the whole of 200 response <r>, <header> then its entity, with a
+	 * single send from the response cache, building the entry on a miss.
+	 *
+	 * RETURN:
+	 * 	false if the response is not one that is cached; send it as usual
+	 */
+	openFile_t* file=r->entityFile;
+	long stageStart=metricsNow();
+	responseEntry_t* e;
+
+	if (file==NULL||r->compressEntity||strcmp(r->status->code, "200")!=0
+			||strcmp(r->httpVersion, "HTTP/0.9")==0
+			||!responseCacheable(r->eHeader->contentLength)) {
+		return(false);
+	}
+	e=responseCacheAcquire(file->path, header->string, header->length,
+			&file->st);
+	if (e==NULL&&(e=_buildCachedResponse(r, header))==NULL) {
+		return(false);
+	}
 
-	/* Trailing carriage return */
-	} else {
-		sendChar(socketFd, "\n");
+	PROBE_SEND_START(socketFd, e->entityLength);
+	if (sendBytes(socketFd, e->data, e->length)==SENDOK) {
+		*sent=e->entityLength;
 	}
+	metricsRecord(STAGE_BODY, stageStart);
+	PROBE_SEND_END(socketFd, *sent);
+	responseCacheRelease(e);
+	return(true);
 }
 
+
+responseEntry_t* _buildCachedResponse(response_t* r, byteString_t* header) {
+	/**
+	 * Serialize <r> whole, <header> then the entity read from its buffer or
+	 * file, into a new response cache entry.
+	 *
+	 * RETURN:
+	 * 	NULL if the file no longer holds the entity length of bytes
+	 */
+	long length=r->eHeader->contentLength;
+	char* data=malloc(header->length+length);
+	ssize_t nRead;
+	long done=0;
+
+	memcpy(data, header->string, header->length);
+	if (r->entityBuffer!=NULL) {
+		memcpy(data+header->length, r->entityBuffer->bytes, length);
+		done=length;
+	}
+	while (done<length) {
+		nRead=pread(r->entityFile->fd, data+header->length+done,
+				length-done, done);
+		if (nRead<=0) {
+			handleFileReadError();
+			free(data);
+			return(NULL);
+		}
+		done+=nRead;
+	}
+	return(responseCacheInsert(r->entityFile->path, header->string,
+			header->length, &r->entityFile->st, data, header->length+length));
+}
+
+
+void _appendHeader(byteString_t* header, char* name, char* value) {
+	/* Append a "name value" header line, unless the value is unset (NULL) */
+	if (value!=NULL) {
+		bsAppend(header, name, strlen(name));
+		bsAppend(header, " ", 1);
+		bsAppend(header, value, strlen(value));
+		bsAppend(header, "\n", 1);
+	}
+}
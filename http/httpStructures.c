@@ -6,8 +6,19 @@
  */
 
 #include "httpStructures.h"
+#include "./../utility/bool.h"
+#include "./../utility/openFileCache.h"
+#include "proxy.h"
+#include "fastCgi.h"
+#include "./../utility/metrics.h"
 #include <stdlib.h>
 
+/* Counted as one allocation, header structures included */
+#define REQUEST_BYTES	(sizeof(request_t)+sizeof(eHeader_t)+sizeof(gHeader_t)\
+		+sizeof(rqHeader_t))
+#define RESPONSE_BYTES	(sizeof(response_t)+sizeof(status_t)\
+		+sizeof(gHeader_t)+sizeof(rsHeader_t)+sizeof(eHeader_t))
+
 eHeader_t* _initEHeader();
 gHeader_t* _initGHeader();
 rsHeader_t* _initRsHeader();
@@ -29,6 +40,8 @@ initRequest(){
 	r->method=NULL;
 	r->uri=NULL;
 	r->rqHeader=_initRqHeader();
+	r->knownMissing=false;
+	metricsAllocated(MEM_REQUEST, REQUEST_BYTES);
 	return(r);
 }
 
@@ -41,6 +54,12 @@ initResponse() {
 	r->rsHeader=_initRsHeader();
 	r->eHeader=_initEHeader();
 	r->entityPath=NULL;
+	r->entityFile=NULL;
+	r->entityBuffer=NULL;
+	r->compressEntity=false;
+	r->upstream=NULL;
+	r->fastCgi=NULL;
+	metricsAllocated(MEM_REQUEST, RESPONSE_BYTES);
 	return(r);
 }
 
@@ -55,6 +74,7 @@ _initHttpStatus(){
 void _freeHttpStatus(status_t* s) {
 	free(s->code);
 	free(s->phrase);
+	free(s);
 }
 
 rqHeader_t*
@@ -65,6 +85,7 @@ _initRqHeader() {
 	h->ifModifiedSince=NULL;
 	h->referrer=NULL;
 	h->userAgent=NULL;
+	h->acceptEncoding=NULL;
 	return(h);
 }
 
@@ -74,6 +95,8 @@ void _freeRqHeader(rqHeader_t *h) {
 	free(h->ifModifiedSince);
 	free(h->referrer);
 	free(h->userAgent);
+	free(h->acceptEncoding);
+	free(h);
 }
 
 rsHeader_t*
@@ -82,6 +105,8 @@ _initRsHeader() {
 	h->location=NULL;
 	h->server=NULL;
 	h->wWWAuthenticate=NULL;
+	h->vary=NULL;
+	h->eTag=NULL;
 	return(h);
 }
 
@@ -89,6 +114,9 @@ void _freeRsHeader(rsHeader_t *h) {
 	free(h->location);
 	free(h->server);
 	free(h->wWWAuthenticate);
+	free(h->vary);
+	free(h->eTag);
+	free(h);
 }
 
 gHeader_t*
@@ -96,12 +124,15 @@ _initGHeader() {
 	gHeader_t* h=malloc(sizeof(gHeader_t));
 	h->date=NULL;
 	h->pragma=NULL;
+	h->cacheControl=NULL;
 	return(h);
 }
 
 void _freeGHeader(gHeader_t *h) {
 	free(h->date);
 	free(h->pragma);
+	free(h->cacheControl);
+	free(h);
 }
 
 eHeader_t*
@@ -122,22 +153,36 @@ void _freeEHeader(eHeader_t* h) {
 	free(h->contentType);
 	free(h->expires);
 	free(h->lastModified);
+	free(h);
 }
 
 void freeRequest(request_t* r) {
+	/* Free what <r> holds, the caller frees <r> itself */
 	_freeGHeader(r->gHeader);
 	_freeEHeader(r->eHeader);
 	_freeRqHeader(r->rqHeader);
 	free(r->httpVersion);
 	free(r->method);
 	free(r->uri);
+	metricsFreed(MEM_REQUEST, REQUEST_BYTES);
 }
 
 void freeResponse(response_t* r) {
+	/* Free what <r> holds, the caller frees <r> itself */
 	_freeGHeader(r->gHeader);
 	_freeEHeader(r->eHeader);
 	_freeRsHeader(r->rsHeader);
 	_freeHttpStatus(r->status);
 	free(r->httpVersion);
 	free(r->entityPath);
+	openFileRelease(r->entityFile);
+	if (r->entityBuffer!=NULL) {
+		if (r->entityBuffer->release!=NULL) {
+			r->entityBuffer->release(r->entityBuffer->owner);
+		}
+		free(r->entityBuffer);
+	}
+	proxyRelease(r->upstream);
+	fastCgiRelease(r->fastCgi);
+	metricsFreed(MEM_REQUEST, RESPONSE_BYTES);
 }
@@ -14,10 +14,15 @@ typedef struct responseHeader rsHeader_t;
 typedef struct request request_t;
 typedef struct response response_t;
 typedef struct httpStatus status_t;
+typedef struct entityBuffer entityBuffer_t;
+struct openFile;
+struct proxyExchange;
+struct fastCgiExchange;
 
 struct generalHeader {
 	char* date;
 	char* pragma;
+	char* cacheControl;
 };
 
 struct requestHeader { // Request header fields
@@ -26,6 +31,7 @@ struct requestHeader { // Request header fields
 	char* ifModifiedSince;
 	char* referrer;
 	char* userAgent;
+	char* acceptEncoding;
 };
 
 struct entityHeader { // Entity header fields
@@ -41,6 +47,15 @@ struct responseHeader { // Response header fields
 	char* location;
 	char* server;
 	char* wWWAuthenticate;
+	char* vary;
+	char* eTag;
+};
+
+struct entityBuffer { // Entity held in memory rather than read from a file
+	char* bytes;
+	long length;
+	void* owner;					// Handed to release() once the response is freed
+	void (*release)(void* owner);
 };
 
 struct httpStatus {
@@ -63,11 +78,17 @@ struct request {  // Request fields
 	/* Entity header fields */
 	eHeader_t *eHeader;
 
+	int knownMissing;	// URI is in the not found cache, see notFoundCache.c
 };
 
 struct response {
 	char* httpVersion;
 	char* entityPath;
+	struct openFile *entityFile;	   // Open descriptor of entityPath
+	entityBuffer_t *entityBuffer;  // If set, sent instead of entityFile
+	int compressEntity;			// Gzip entityPath while sending it
+	struct proxyExchange *upstream;	// If set, the entity is proxied from it
+	struct fastCgiExchange *fastCgi;	// If set, the entity is the output of it
 	status_t *status;
 	gHeader_t *gHeader;
 	rsHeader_t *rsHeader;
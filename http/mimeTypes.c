@@ -0,0 +1,187 @@
+/*
+ * Author: 			Ben Tomlin
+ * Student Id:		btomlin
+ * Student Nbr:		834198
+ * Date:			Oct 2026
+ *
+ * File extension to MIME type table.
+ *
+ * Built once at startup from a compiled in default set, overridden by a
+ * standard mime.types file ("type ext ext ..." per line) if one is readable.
+ * Lookups hash the lower cased extension into an open addressing table with
+ * linear probing; they neither allocate nor lock, since the table is read
+ * only once the server is accepting connections.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "mimeTypes.h"
+#include "./../utility/hash.h"
+#include "./../utility/logger.h"
+#include "./../utility/bool.h"
+
+typedef struct mimeEntry {
+	char extension[MIME_MAXEXT]; // Lower case, empty if the slot is free
+	char* type;
+} mimeEntry_t;
+
+static mimeEntry_t table[MIME_TABLE_SIZE];
+static int nEntries;
+static char** fileTypes;	// Every type read from mime.types, even those whose
+static int nFileTypes;		// extensions a later line took, so none are lost
+
+/* Used where no mime.types file is available, or it omits an extension */
+static char* defaultTypes[][2] = {
+	{"html", "text/html"}, {"htm", "text/html"}, {"css", "text/css"},
+	{"js", "application/javascript"}, {"mjs", "application/javascript"},
+	{"json", "application/json"}, {"map", "application/json"},
+	{"xml", "application/xml"}, {"txt", "text/plain"}, {"csv", "text/csv"},
+	{"md", "text/markdown"}, {"jpg", "image/jpeg"}, {"jpeg", "image/jpeg"},
+	{"png", "image/png"}, {"gif", "image/gif"}, {"webp", "image/webp"},
+	{"avif", "image/avif"}, {"svg", "image/svg+xml"}, {"ico", "image/x-icon"},
+	{"woff", "font/woff"}, {"woff2", "font/woff2"}, {"ttf", "font/ttf"},
+	{"otf", "font/otf"}, {"wasm", "application/wasm"},
+	{"pdf", "application/pdf"}, {"zip", "application/zip"},
+	{"gz", "application/gzip"}, {"mp4", "video/mp4"}, {"webm", "video/webm"},
+	{"mp3", "audio/mpeg"}, {"ogg", "audio/ogg"}, {"wav", "audio/wav"},
+	{NULL, NULL}
+};
+
+void _loadMimeTypesFile(char* path);
+void _insertMimeType(char* extension, char* type);
+int _lowerExtension(char* extension, int length, char* lower);
+mimeEntry_t* _findSlot(char* lowerExtension, int length);
+
+
+void initMimeTypes(char* mimeTypesPath) {
+	/**
+	 * Build the extension table. Call once, before serving requests.
+	 *
+	 * ARGUMENT:
+	 * 	mimeTypesPath - mime.types file to load over the defaults. NULL or
+	 * 	an unreadable path leaves only the compiled in defaults.
+	 */
+	int i;
+	for (i=0; defaultTypes[i][0]!=NULL; i++) {
+		_insertMimeType(defaultTypes[i][0], defaultTypes[i][1]);
+	}
+	if (mimeTypesPath!=NULL) {
+		_loadMimeTypesFile(mimeTypesPath);
+	}
+}
+
+
+void _loadMimeTypesFile(char* path) {
+	/* Insert every "type ext ext ..." line of a mime.types file */
+	char line[MIME_MAXLINE];
+	char* type;
+	char* extension;
+	char* internedType;
+	FILE* f=fopen(path, "r");
+
+	if (f==NULL) {
+		logWarn("No mime.types file %s, using built in MIME types", path);
+		return;
+	}
+	while (fgets(line, MIME_MAXLINE, f)!=NULL) {
+		type=strtok(line, " \t\r\n");
+		if (type==NULL||type[0]=='#') {
+			continue;
+		}
+		internedType=NULL;
+		while ((extension=strtok(NULL, " \t\r\n"))!=NULL) {
+
+			/* One copy of the type shared by all its extensions */
+			if (internedType==NULL) {
+				internedType=strdup(type);
+				fileTypes=realloc(fileTypes, (nFileTypes+1)*sizeof(char*));
+				fileTypes[nFileTypes++]=internedType;
+			}
+			_insertMimeType(extension, internedType);
+		}
+	}
+	fclose(f);
+}
+
+
+void _insertMimeType(char* extension, char* type) {
+	/* Map <extension> to <type>, replacing any earlier mapping */
+	char lower[MIME_MAXEXT];
+	int length=strlen(extension);
+	mimeEntry_t* slot;
+
+	if (!_lowerExtension(extension, length, lower)) {
+		return;
+	}
+	slot=_findSlot(lower, length);
+	if (slot->extension[0]=='\0') {
+
+		/* Keep the table sparse enough that probes stay short */
+		if (nEntries>=MIME_TABLE_SIZE*3/4) {
+			return;
+		}
+		memcpy(slot->extension, lower, length+1);
+		nEntries++;
+	}
+	slot->type=type;
+}
+
+
+int _lowerExtension(char* extension, int length, char* lower) {
+	/**
+	 * Copy <length> bytes of <extension> lower cased into <lower>, a
+	 * MIME_MAXEXT buffer, null terminating it.
+	 *
+	 * RETURN:
+	 * 	false if the extension is empty or too long to be in the table
+	 */
+	int i;
+	if (length<=0||length>=MIME_MAXEXT) {
+		return(false);
+	}
+	for (i=0; i<length; i++) {
+		lower[i]=tolower((unsigned char)extension[i]);
+	}
+	lower[length]='\0';
+	return(true);
+}
+
+
+mimeEntry_t* _findSlot(char* lowerExtension, int length) {
+	/* Slot holding <lowerExtension>, or the free slot it would go in */
+	unsigned long i=hashBytes(lowerExtension, length)&(MIME_TABLE_SIZE-1);
+	while (table[i].extension[0]!='\0'
+			&&strcmp(table[i].extension, lowerExtension)!=0) {
+		i=(i+1)&(MIME_TABLE_SIZE-1);
+	}
+	return(&table[i]);
+}
+
+
+char* lookupMimeType(char* path) {
+	/**
+	 * Given a file path return its MIME type based on its extension, case
+	 * insensitively. MIME_DEFAULT if the extension is unknown.
+	 */
+	char lower[MIME_MAXEXT];
+	char* dot=strrchr(path, '.');
+	mimeEntry_t* slot;
+	int length;
+
+	/* No extension, or the dot belongs to a directory name */
+	if (dot==NULL||strchr(dot, '/')!=NULL) {
+		return(MIME_DEFAULT);
+	}
+	length=strlen(dot+1);
+	if (!_lowerExtension(dot+1, length, lower)) {
+		return(MIME_DEFAULT);
+	}
+	slot=_findSlot(lower, length);
+	if (slot->extension[0]=='\0') {
+		return(MIME_DEFAULT);
+	}
+	return(slot->type);
+}
@@ -0,0 +1,21 @@
+/*
+ * Author: 			Ben Tomlin
+ * Student Id:		btomlin
+ * Student Nbr:		834198
+ * Date:			Oct 2026
+ */
+
+#ifndef HTTP_MIMETYPES_H_
+#define HTTP_MIMETYPES_H_
+
+#define MIME_DEFAULT	  "application/octet-stream"
+#define MIME_HTML		  "text/html"
+#define MIME_TYPES_PATH  "/etc/mime.types"
+#define MIME_TABLE_SIZE  4096 // Open addressing slots, a power of two
+#define MIME_MAXEXT	  16   // Longest extension looked up, null byte included
+#define MIME_MAXLINE	  1024
+
+void initMimeTypes(char* mimeTypesPath);
+char* lookupMimeType(char* path);
+
+#endif /* HTTP_MIMETYPES_H_ */
@@ -0,0 +1,529 @@
+/*
+ * Author: 			Ben Tomlin
+ * Student Id:		btomlin
+ * Student Nbr:		834198
+ * Date:			Oct 2026
+ *
+ * Cache of URIs recently resolved to no file, so repeated requests for
+ * missing paths (scanners probing for /wp-login.php and the like) are
+ * answered 404 without resolving the path again, and without their failures
+ * taking the open file cache's slots from files that exist.
+ *
+ * Entries are keyed by the URI as requested. A Bloom filter of the cached
+ * URIs is tested first, without a lock, so a request for a file that exists
+ * almost never touches the cache's locks; a filter hit is confirmed in the
+ * exact entries, split into NOTFOUND_SHARDS by hash each with its own lock
+ * and an equal share of not_found_cache entries, evicted by CLOCK. The filter
+ * cannot forget a URI, so it is rebuilt from the entries once as many have
+ * been removed as the cache holds.
+ *
+ * An entry holds while nothing is created in the nearest existing directory
+ * above its path (the file itself, or the first missing directory on the way
+ * to it). That directory is watched with inotify and any change to it drops
+ * its entries; where inotify is unavailable the directory's mtime is checked
+ * on each hit instead. Entries also expire after not_found_cache_valid
+ * seconds, which covers what neither notices, such as a parent of the watched
+ * directory being renamed over.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
+#include <sys/inotify.h>
+
+#include "notFoundCache.h"
+#include "./../utility/bool.h"
+#include "./../utility/hash.h"
+#include "./../utility/logger.h"
+#include "./../utility/metrics.h"
+
+#define NOTFOUND_WATCH_EVENTS (IN_CREATE|IN_MOVED_TO|IN_DELETE_SELF\
+		|IN_MOVE_SELF|IN_ONLYDIR)
+#define NOTFOUND_ALL_WATCHES -1 // Invalidate every watched entry
+
+/* The low bits of an FNV hash only mix the low bits of each byte, so URIs
+ * differing in digits would share few shards; pick by the high bits */
+#define NOTFOUND_SHARD(hash) (((hash)>>32)%NOTFOUND_SHARDS)
+
+typedef struct notFoundShard {
+	pthread_mutex_t lock;
+	notFoundEntry_t* buckets[NOTFOUND_BUCKETS];
+	notFoundEntry_t* hand;	// Next entry the CLOCK hand looks at
+	int nEntries;
+} notFoundShard_t;
+
+static notFoundShard_t shards[NOTFOUND_SHARDS];
+static int shardMax;		// Entries each shard may hold, 0 when disabled
+static int validSeconds;
+static atomic_ulong* bloom;
+static unsigned long bloomMask;
+static atomic_long removed;	// Entries dropped since the filter was built
+static atomic_ulong generation; // Bumped by each batch of inotify events
+static int inotifyFd=-1;	// -1 checks directory mtimes instead
+static pthread_mutex_t rebuildLock=PTHREAD_MUTEX_INITIALIZER;
+
+int _notFoundLocate(notFoundEntry_t* e, char* path, int rootLength);
+int _notFoundCurrent(notFoundEntry_t* e);
+notFoundEntry_t* _notFoundFind(notFoundShard_t* shard, char* uri,
+		unsigned long hash);
+void _notFoundLink(notFoundShard_t* shard, notFoundEntry_t* e);
+void _notFoundUnlink(notFoundShard_t* shard, notFoundEntry_t* e);
+void _notFoundEvict(notFoundShard_t* shard);
+void _notFoundInvalidate(int watch);
+void* _notFoundWatcher(void* unused);
+int _bloomTest(unsigned long hash);
+void _bloomAdd(unsigned long hash);
+void _bloomRebuild();
+void _freeNotFoundEntry(notFoundEntry_t* e);
+
+
+void initNotFoundCache(int max, int valid) {
+	/**
+	 * ARGUMENT:
+	 * 	max - most URIs held, 0 disables the cache
+	 * 	valid - seconds an entry is trusted at most
+	 */
+	unsigned long bits=64;
+	pthread_t thread;
+	int i;
+
+	for (i=0; i<NOTFOUND_SHARDS; i++) {
+		pthread_mutex_init(&shards[i].lock, NULL);
+	}
+	if (max<=0) {
+		return;
+	}
+	shardMax=(max+NOTFOUND_SHARDS-1)/NOTFOUND_SHARDS;
+	validSeconds=valid;
+
+	/* A power of two, so hashes map to bits with a mask */
+	while (bits<(unsigned long)max*NOTFOUND_BLOOM_BITS) {
+		bits<<=1;
+	}
+	bloomMask=bits-1;
+	bloom=calloc(bits/64, sizeof(atomic_ulong));
+	metricsAllocated(MEM_NOTFOUND, bits/8);
+
+	inotifyFd=inotify_init1(IN_CLOEXEC);
+	if (inotifyFd<0) {
+		logWarn("inotify unavailable, checking missing paths by mtime");
+	} else if (pthread_create(&thread, NULL, _notFoundWatcher, NULL)!=0) {
+		logWarn("Could not start the not found cache watcher, checking "
+				"missing paths by mtime");
+		close(inotifyFd);
+		inotifyFd=-1;
+	} else {
+		pthread_detach(thread);
+	}
+}
+
+
+int notFoundCacheEnabled() {
+	return(shardMax>0);
+}
+
+
+int notFoundCacheHit(char* uri) {
+	/**
+	 * True if <uri> was found to name no file, and nothing has since been
+	 * created where it would be.
+	 *
+	 * NOTE:
+	 * 	An entry checked by mtime is stat()ed without holding the lock
+	 */
+	unsigned long hash;
+	notFoundShard_t* shard;
+	notFoundEntry_t* e;
+	notFoundEntry_t checked;
+	char dir[PATH_MAX];
+	int hit=false;
+
+	if (shardMax==0) {
+		return(false);
+	}
+	hash=hashString(uri);
+	if (!_bloomTest(hash)) {
+		return(false);
+	}
+	shard=&shards[NOTFOUND_SHARD(hash)];
+
+	pthread_mutex_lock(&shard->lock);
+	e=_notFoundFind(shard, uri, hash);
+	if (e!=NULL&&time(NULL)-e->inserted>=validSeconds) {
+		_notFoundUnlink(shard, e);
+		e=NULL;
+	}
+	if (e!=NULL&&e->watch<0) {
+		checked=*e;
+		strcpy(dir, e->dir);
+		checked.dir=dir;
+		pthread_mutex_unlock(&shard->lock);
+		if (_notFoundCurrent(&checked)) {
+			hit=true;
+		} else {
+
+			/* Unless another request already replaced or dropped it */
+			pthread_mutex_lock(&shard->lock);
+			e=_notFoundFind(shard, uri, hash);
+			if (e!=NULL&&e->mtime.tv_sec==checked.mtime.tv_sec
+					&&e->mtime.tv_nsec==checked.mtime.tv_nsec) {
+				_notFoundUnlink(shard, e);
+			}
+			pthread_mutex_unlock(&shard->lock);
+		}
+	} else {
+		if (e!=NULL) {
+			e->referenced=true;
+			hit=true;
+		}
+		pthread_mutex_unlock(&shard->lock);
+	}
+
+	if (hit) {
+		metricsCount(COUNT_NOTFOUND_HIT, 1);
+	}
+	if (atomic_load(&removed)>shardMax*NOTFOUND_SHARDS) {
+		_bloomRebuild();
+	}
+	return(hit);
+}
+
+
+void notFoundCacheInsert(char* uri, char* path, char* rootPath) {
+	/**
+	 * Remember that <uri> resolved to <path>, which does not exist.
+	 *
+	 * ARGUMENT:
+	 * 	rootPath - document root, the highest directory watched
+	 *
+	 * NOTE:
+	 * 	<path> is checked again once its directory is watched, so a file
+	 * 	created meanwhile is not cached as missing
+	 */
+	unsigned long started=atomic_load(&generation);
+	notFoundEntry_t* e;
+	notFoundShard_t* shard;
+	struct stat s;
+	int linked=false;
+
+	metricsCount(COUNT_NOTFOUND_MISS, 1);
+	if (shardMax==0) {
+		return;
+	}
+	e=calloc(1, sizeof(notFoundEntry_t));
+	e->uri=strdup(uri);
+	e->hash=hashString(uri);
+	e->inserted=time(NULL);
+	metricsAllocated(MEM_NOTFOUND, sizeof(notFoundEntry_t)+strlen(uri)+1);
+	if (!_notFoundLocate(e, path, strlen(rootPath))||stat(path, &s)==0
+			||(errno!=ENOENT&&errno!=ENOTDIR)) {
+		_freeNotFoundEntry(e);
+		return;
+	}
+	shard=&shards[NOTFOUND_SHARD(e->hash)];
+
+	/* Changes seen since it was watched may predate its entry, not cached */
+	pthread_mutex_lock(&shard->lock);
+	if (atomic_load(&generation)==started
+			&&_notFoundFind(shard, uri, e->hash)==NULL) {
+		_notFoundLink(shard, e);
+		_bloomAdd(e->hash);
+		_notFoundEvict(shard);
+		linked=true;
+	}
+	pthread_mutex_unlock(&shard->lock);
+
+	if (!linked) {
+		_freeNotFoundEntry(e);
+	} else if (atomic_load(&removed)>shardMax*NOTFOUND_SHARDS) {
+		_bloomRebuild();
+	}
+}
+
+
+int _notFoundLocate(notFoundEntry_t* e, char* path, int rootLength) {
+	/**
+	 * Watch the nearest existing directory above <path>, no higher than the
+	 * first <rootLength> characters, or record its mtime without inotify.
+	 *
+	 * RETURN:
+	 * 	false if no such directory could be watched or stat()ed
+	 */
+	char dir[PATH_MAX];
+	char* slash;
+	struct stat s;
+	int fd=inotifyFd;
+	int length;
+	int error;
+
+	strcpy(dir, path);
+	while (true) {
+		slash=strrchr(dir, '/');
+		if (slash==NULL) {
+			return(false);
+		}
+		length=slash-dir;
+		if (length<=rootLength) {
+			length=rootLength>0?rootLength:1;	// The root, or "/" itself
+		}
+		dir[length]='\0';
+
+		/* Without a watch each level is stat()ed, as when out of watches */
+		error=ENOSPC;
+		if (fd>=0) {
+			e->watch=inotify_add_watch(fd, dir, NOTFOUND_WATCH_EVENTS);
+			if (e->watch>=0) {
+				return(true);
+			}
+			error=errno;
+		}
+
+		/* Out of watches, or no inotify */
+		e->watch=-1;
+		if (error==ENOSPC) {
+			if (stat(dir, &s)!=0) {
+				error=errno;
+			} else if (!S_ISDIR(s.st_mode)) {
+				error=ENOTDIR;
+			} else {
+				e->dir=strdup(dir);
+				e->mtime=s.st_mtim;
+				metricsAllocated(MEM_NOTFOUND, length+1);
+				return(true);
+			}
+		}
+		if ((error!=ENOENT&&error!=ENOTDIR)||length<=rootLength) {
+			return(false);
+		}
+	}
+}
+
+
+int _notFoundCurrent(notFoundEntry_t* e) {
+	/* True if <e>'s directory has the mtime it had when <e> was cached */
+	struct stat s;
+
+	return(stat(e->dir, &s)==0&&s.st_mtim.tv_sec==e->mtime.tv_sec
+			&&s.st_mtim.tv_nsec==e->mtime.tv_nsec);
+}
+
+
+notFoundEntry_t* _notFoundFind(notFoundShard_t* shard, char* uri,
+		unsigned long hash) {
+	notFoundEntry_t* e=shard->buckets[hash%NOTFOUND_BUCKETS];
+	for (; e!=NULL; e=e->hashNext) {
+		if (e->hash==hash&&strcmp(e->uri, uri)==0) {
+			return(e);
+		}
+	}
+	return(NULL);
+}
+
+
+void _notFoundLink(notFoundShard_t* shard, notFoundEntry_t* e) {
+	/* Add <e> to the hash and just behind the hand, the last it will reach */
+	notFoundEntry_t** bucket=&shard->buckets[e->hash%NOTFOUND_BUCKETS];
+
+	e->hashNext=*bucket;
+	*bucket=e;
+	if (shard->hand==NULL) {
+		e->clockPrev=e;
+		e->clockNext=e;
+		shard->hand=e;
+	} else {
+		e->clockNext=shard->hand;
+		e->clockPrev=shard->hand->clockPrev;
+		e->clockPrev->clockNext=e;
+		shard->hand->clockPrev=e;
+	}
+	shard->nEntries++;
+}
+
+
+void _notFoundUnlink(notFoundShard_t* shard, notFoundEntry_t* e) {
+	/* Remove <e> from the cache and free it. Its filter bits stay set */
+	notFoundEntry_t** p=&shard->buckets[e->hash%NOTFOUND_BUCKETS];
+
+	while (*p!=e) {
+		p=&(*p)->hashNext;
+	}
+	*p=e->hashNext;
+
+	if (e->clockNext==e) {
+		shard->hand=NULL;
+	} else {
+		if (shard->hand==e) {
+			shard->hand=e->clockNext;
+		}
+		e->clockPrev->clockNext=e->clockNext;
+		e->clockNext->clockPrev=e->clockPrev;
+	}
+	shard->nEntries--;
+	atomic_fetch_add(&removed, 1);
+	_freeNotFoundEntry(e);
+}
+
+
+void _notFoundEvict(notFoundShard_t* shard) {
+	/* Sweep the hand until the shard holds its share of entries */
+	notFoundEntry_t* e;
+
+	while (shard->nEntries>shardMax&&shard->hand!=NULL) {
+		e=shard->hand;
+		shard->hand=e->clockNext;
+		if (e->referenced) {
+			e->referenced=false;
+		} else {
+			_notFoundUnlink(shard, e);
+		}
+	}
+}
+
+
+void _notFoundInvalidate(int watch) {
+	/* Drop the entries of inotify <watch>, or NOTFOUND_ALL_WATCHES */
+	notFoundShard_t* shard;
+	notFoundEntry_t* e;
+	notFoundEntry_t* next;
+	int n;
+	int i;
+
+	for (i=0; i<NOTFOUND_SHARDS; i++) {
+		shard=&shards[i];
+		pthread_mutex_lock(&shard->lock);
+		e=shard->hand;
+		for (n=shard->nEntries; n>0; n--) {
+			next=e->clockNext;
+			if (e->watch>=0&&(watch==NOTFOUND_ALL_WATCHES
+					||e->watch==watch)) {
+				_notFoundUnlink(shard, e);
+			}
+			e=next;
+		}
+		pthread_mutex_unlock(&shard->lock);
+	}
+}
+
+
+void* _notFoundWatcher(void* unused) {
+	/**
+	 * Drop the entries of directories as inotify reports changes to them.
+	 *
+	 * NOTE:
+	 * 	Watches are never removed; they are at most one per directory of
+	 * 	the document root, and another request may be adding an entry
+	 * 	under the same watch
+	 */
+	char events[NOTFOUND_EVENT_BUFFER]
+			__attribute__((aligned(__alignof__(struct inotify_event))));
+	struct inotify_event* event;
+	char* p;
+	ssize_t n;
+	int last;
+
+	while (true) {
+		n=read(inotifyFd, events, NOTFOUND_EVENT_BUFFER);
+		if (n<0&&errno==EINTR) {
+			continue;
+		} else if (n<=0) {
+			break;
+		}
+		atomic_fetch_add(&generation, 1);
+		last=NOTFOUND_ALL_WATCHES;
+		for (p=events; p<events+n; p+=sizeof(struct inotify_event)
+				+event->len) {
+			event=(struct inotify_event*)p;
+			if (event->mask&IN_Q_OVERFLOW) {
+				_notFoundInvalidate(NOTFOUND_ALL_WATCHES);
+			} else if (event->wd!=last) {
+				_notFoundInvalidate(event->wd);
+			}
+			last=event->wd;
+		}
+		if (atomic_load(&removed)>shardMax*NOTFOUND_SHARDS) {
+			_bloomRebuild();
+		}
+	}
+
+	/* Nothing would drop watched entries now */
+	logWarn("Not found cache watcher failed, checking missing paths by mtime");
+	inotifyFd=-1;
+	atomic_fetch_add(&generation, 1);
+	_notFoundInvalidate(NOTFOUND_ALL_WATCHES);
+	return(NULL);
+}
+
+
+int _bloomTest(unsigned long hash) {
+	/* False if no cached URI has <hash>, true if one may */
+	unsigned long step=hashCombine(hash, NOTFOUND_BLOOM_HASHES)|1;
+	unsigned long bit;
+	int i;
+
+	for (i=0; i<NOTFOUND_BLOOM_HASHES; i++) {
+		bit=(hash+i*step)&bloomMask;
+		if (!(atomic_load_explicit(&bloom[bit/64], memory_order_relaxed)
+				&(1UL<<(bit%64)))) {
+			return(false);
+		}
+	}
+	return(true);
+}
+
+
+void _bloomAdd(unsigned long hash) {
+	unsigned long step=hashCombine(hash, NOTFOUND_BLOOM_HASHES)|1;
+	unsigned long bit;
+	int i;
+
+	for (i=0; i<NOTFOUND_BLOOM_HASHES; i++) {
+		bit=(hash+i*step)&bloomMask;
+		atomic_fetch_or_explicit(&bloom[bit/64], 1UL<<(bit%64),
+				memory_order_relaxed);
+	}
+}
+
+
+void _bloomRebuild() {
+	/**
+	 * Clear the filter of removed URIs, adding back those still cached.
+	 *
+	 * NOTE:
+	 * 	Lookups meanwhile may miss an entry, and resolve the path as usual
+	 */
+	notFoundEntry_t* e;
+	int n;
+	int i;
+
+	if (pthread_mutex_trylock(&rebuildLock)!=0) {
+		return;
+	}
+	atomic_store(&removed, 0);
+	for (i=0; i<=(int)(bloomMask/64); i++) {
+		atomic_store_explicit(&bloom[i], 0, memory_order_relaxed);
+	}
+	for (i=0; i<NOTFOUND_SHARDS; i++) {
+		pthread_mutex_lock(&shards[i].lock);
+		e=shards[i].hand;
+		for (n=shards[i].nEntries; n>0; n--) {
+			_bloomAdd(e->hash);
+			e=e->clockNext;
+		}
+		pthread_mutex_unlock(&shards[i].lock);
+	}
+	pthread_mutex_unlock(&rebuildLock);
+}
+
+
+void _freeNotFoundEntry(notFoundEntry_t* e) {
+	metricsFreed(MEM_NOTFOUND, sizeof(notFoundEntry_t)+strlen(e->uri)+1
+			+(e->dir!=NULL?strlen(e->dir)+1:0));
+	free(e->uri);
+	free(e->dir);
+	free(e);
+}
@@ -0,0 +1,39 @@
+/*
+ * Author: 			Ben Tomlin
+ * Student Id:		btomlin
+ * Student Nbr:		834198
+ * Date:			Oct 2026
+ */
+
+#ifndef HTTP_NOTFOUNDCACHE_H_
+#define HTTP_NOTFOUNDCACHE_H_
+
+#include <time.h>
+
+#define NOTFOUND_SHARDS		  16
+#define NOTFOUND_BUCKETS	  256  // Hash buckets per shard
+#define NOTFOUND_BLOOM_BITS	  16   // Filter bits per entry
+#define NOTFOUND_BLOOM_HASHES 4	   // Bits set per URI
+#define NOTFOUND_EVENT_BUFFER 4096 // inotify events read at once [bytes]
+
+typedef struct notFoundEntry notFoundEntry_t;
+
+struct notFoundEntry {	// A URI recently resolved to no file
+	char* uri;			// As requested, the key
+	unsigned long hash;
+	int watch;			// inotify watch of dir, -1 if checked by its mtime
+	char* dir;			// Nearest existing directory above the path
+	struct timespec mtime; // Of dir when the URI was found missing
+	time_t inserted;
+	int referenced;		// CLOCK bit, set by hits, cleared by the hand
+	notFoundEntry_t* hashNext;
+	notFoundEntry_t* clockPrev; // Circular list swept by the CLOCK hand
+	notFoundEntry_t* clockNext;
+};
+
+void initNotFoundCache(int max, int valid);
+int notFoundCacheEnabled();
+int notFoundCacheHit(char* uri);
+void notFoundCacheInsert(char* uri, char* path, char* rootPath);
+
+#endif /* HTTP_NOTFOUNDCACHE_H_ */
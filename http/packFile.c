@@ -0,0 +1,274 @@
+/*
+ * Author: 			Ben Tomlin
+ * Student Id:		btomlin
+ * Student Nbr:		834198
+ * Date:			Oct 2026
+ *
+ * Serve a document root out of one memory mapped pack file (see packFile.h
+ * for the format, tools/mkpack.c to build one). A lookup is a hash probe in
+ * the mapped index, with no path resolution, open or stat per request, and
+ * the entity is sent straight from the mapping.
+ *
+ * To deploy a new pack, build it beside the old one and rename() it over
+ * the configured path. Requests notice the new file within PACK_RECHECK_S,
+ * map and check it, and switch to it; requests still sending from the old
+ * mapping keep it until they finish. A pack that fails its checks is logged
+ * and the old one kept.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "packFile.h"
+#include "./../utility/bool.h"
+#include "./../utility/hash.h"
+#include "./../utility/logger.h"
+
+static char* packPath;		// NULL if no pack is configured
+static pack_t* current;
+static atomic_long lastChecked;
+static struct stat rejected;	// Last invalid pack, not mapped again
+static pthread_mutex_t packLock=PTHREAD_MUTEX_INITIALIZER;
+
+pack_t* _mapPack(char* path);
+int _validPack(pack_t* p);
+int _validBlob(pack_t* p, packBlob_t* blob);
+void _unmapPack(pack_t* p);
+void _reloadPack();
+
+
+void initPack(char* path) {
+	/**
+	 * Map pack file <path> and serve from it. NULL leaves packs disabled.
+	 *
+	 * Terminates with EPACK if the pack cannot be mapped or is invalid
+	 */
+	if (path==NULL) {
+		return;
+	}
+	current=_mapPack(path);
+	if (current==NULL) {
+		logError("Could not load pack file %s", path);
+		exit(EPACK);
+	}
+	packPath=path;
+	atomic_store(&lastChecked, time(NULL));
+	logInfo("Serving %u files from pack %s", current->header->nEntries, path);
+}
+
+
+int packEnabled() {
+	return(packPath!=NULL);
+}
+
+
+pack_t* packAcquire() {
+	/**
+	 * The pack requests are served from, switching to a replacement pack
+	 * first if one has been deployed.
+	 *
+	 * RETURN:
+	 * 	Pack to hand back with packRelease() once its bytes are sent
+	 */
+	long now=time(NULL);
+	long checked=atomic_load(&lastChecked);
+	pack_t* p;
+
+	/* One request a recheck interval looks for a new pack */
+	if (now-checked>=PACK_RECHECK_S
+			&&atomic_compare_exchange_strong(&lastChecked, &checked, now)) {
+		_reloadPack();
+	}
+
+	pthread_mutex_lock(&packLock);
+	p=current;
+	p->refCount++;
+	pthread_mutex_unlock(&packLock);
+	return(p);
+}
+
+
+void packRelease(void* pack) {
+	/* Drop a reference taken by packAcquire() */
+	pack_t* p=pack;
+	int unused;
+
+	pthread_mutex_lock(&packLock);
+	p->refCount--;
+	unused=(p->refCount==0&&!p->current);
+	pthread_mutex_unlock(&packLock);
+
+	if (unused) {
+		_unmapPack(p);
+	}
+}
+
+
+packEntry_t* packLookup(pack_t* p, char* path) {
+	/**
+	 * Find canonical URI path <path> in the index of <p>.
+	 *
+	 * RETURN:
+	 * 	entry, NULL if the pack does not hold <path>
+	 */
+	size_t length=strlen(path);
+	uint64_t hash=hashBytes(path, length);
+	uint32_t mask=p->header->nSlots-1;
+	packEntry_t* e;
+	uint32_t i;
+	uint32_t probed;
+
+	/* Bounded too, should the mapped file be rewritten in place */
+	hash=hash!=0?hash:1;
+	for (i=hash&mask, probed=0; probed<=mask; i=(i+1)&mask, probed++) {
+		e=&p->index[i];
+		if (e->hash==0) {
+			return(NULL);
+		}
+		if (e->hash==hash&&e->path.length==length
+				&&memcmp(p->map+e->path.offset, path, length)==0) {
+			return(e);
+		}
+	}
+	return(NULL);
+}
+
+
+char* packBytes(pack_t* p, packBlob_t* blob) {
+	return(p->map+blob->offset);
+}
+
+
+pack_t* _mapPack(char* path) {
+	/* Map and check the pack at <path>, NULL if it is not a valid pack */
+	int fd=open(path, O_RDONLY);
+	struct stat st;
+	pack_t* p;
+
+	if (fd<0||fstat(fd, &st)!=0||st.st_size<(off_t)sizeof(packHeader_t)) {
+		if (fd>=0) {
+			close(fd);
+		}
+		return(NULL);
+	}
+	p=calloc(1, sizeof(pack_t));
+	p->size=st.st_size;
+	p->device=st.st_dev;
+	p->inode=st.st_ino;
+	p->map=mmap(NULL, p->size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (p->map==MAP_FAILED) {
+		free(p);
+		return(NULL);
+	}
+	p->header=(packHeader_t*)p->map;
+	p->index=(packEntry_t*)(p->map+sizeof(packHeader_t));
+	p->current=true;
+
+	if (!_validPack(p)) {
+		_unmapPack(p);
+		return(NULL);
+	}
+
+	/* Small files are read at random, the kernel's readahead is wasted */
+	madvise(p->map, p->size, MADV_RANDOM);
+	return(p);
+}
+
+
+int _validPack(pack_t* p) {
+	/**
+	 * Check the header, that every entry lies within the file and that the
+	 * index has as many entries as the header says, so at least one empty
+	 * slot to end a lookup's probe.
+	 */
+	packHeader_t* h=p->header;
+	packEntry_t* e;
+	uint32_t occupied=0;
+	uint32_t i;
+	int j;
+
+	if (memcmp(h->magic, PACK_MAGIC, sizeof(h->magic))!=0
+			||h->version!=PACK_VERSION||h->size!=p->size||h->nSlots==0
+			||(h->nSlots&(h->nSlots-1))!=0||h->nEntries>=h->nSlots
+			||sizeof(packHeader_t)+(uint64_t)h->nSlots*sizeof(packEntry_t)
+					>p->size) {
+		return(false);
+	}
+	for (i=0; i<h->nSlots; i++) {
+		e=&p->index[i];
+		if (e->hash==0) {
+			continue;
+		}
+		occupied++;
+		if (!_validBlob(p, &e->path)||!_validBlob(p, &e->mime)
+				||!_validBlob(p, &e->content)) {
+			return(false);
+		}
+		for (j=0; j<PACK_VARIANTS; j++) {
+			if (!_validBlob(p, &e->variants[j])) {
+				return(false);
+			}
+		}
+	}
+	return(occupied==h->nEntries);
+}
+
+
+int _validBlob(pack_t* p, packBlob_t* blob) {
+	return(blob->offset<=p->size&&blob->length<=p->size-blob->offset);
+}
+
+
+void _unmapPack(pack_t* p) {
+	munmap(p->map, p->size);
+	free(p);
+}
+
+
+void _reloadPack() {
+	/* Switch to the file now at packPath, if it is a new and valid pack */
+	struct stat st;
+	pack_t* replacement;
+	pack_t* old;
+	int unused;
+
+	if (stat(packPath, &st)!=0) {
+		logWarn("Pack file %s is missing, still serving the loaded pack",
+				packPath);
+		return;
+	}
+	if ((st.st_dev==current->device&&st.st_ino==current->inode)
+			||(st.st_dev==rejected.st_dev&&st.st_ino==rejected.st_ino
+			&&st.st_mtime==rejected.st_mtime)) {
+		return;
+	}
+	replacement=_mapPack(packPath);
+	if (replacement==NULL) {
+		rejected=st;
+		logWarn("Pack file %s is invalid, still serving the loaded pack",
+				packPath);
+		return;
+	}
+
+	pthread_mutex_lock(&packLock);
+	old=current;
+	current=replacement;
+	old->current=false;
+	unused=(old->refCount==0);
+	pthread_mutex_unlock(&packLock);
+
+	if (unused) {
+		_unmapPack(old);
+	}
+	logInfo("Serving %u files from replaced pack %s",
+			replacement->header->nEntries, packPath);
+}
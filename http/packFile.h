@@ -0,0 +1,69 @@
+/*
+ * Author: 			Ben Tomlin
+ * Student Id:		btomlin
+ * Student Nbr:		834198
+ * Date:			Oct 2026
+ */
+
+#ifndef HTTP_PACKFILE_H_
+#define HTTP_PACKFILE_H_
+
+#include <stdint.h>
+#include <sys/types.h>
+
+/* On disk format, written by tools/mkpack.c; a header, the index, then the
+ * paths, MIME types and content the index points at. Little endian. */
+#define PACK_MAGIC		 "HTTPPACK"
+#define PACK_VERSION	 1
+#define PACK_GZIP		 0	 // Precompressed variants of an entry
+#define PACK_BR			 1
+#define PACK_VARIANTS	 2
+
+#define PACK_RECHECK_S	 1	 // Seconds between checks for a replaced pack
+#define EPACK			 39	 // Pack file missing or invalid at startup
+
+typedef struct packHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t nEntries;
+	uint32_t nSlots;		// Index slots, a power of two
+	uint32_t reserved;
+	uint64_t size;			// Of the whole file, to detect truncation
+} packHeader_t;
+
+typedef struct packBlob {	// Bytes in the pack, absent if length is 0
+	uint64_t offset;
+	uint64_t length;
+} packBlob_t;
+
+typedef struct packEntry {	// One index slot, open addressed by hash
+	uint64_t hash;			// hashBytes() of path, 0 for an empty slot
+	packBlob_t path;		// Canonical URI path, ie "/css/site.css"
+	packBlob_t mime;
+	packBlob_t content;
+	packBlob_t variants[PACK_VARIANTS];
+	uint64_t etag;			// Hash of the content
+	int64_t mtime;
+} packEntry_t;
+
+typedef struct pack pack_t;
+
+struct pack {				// A mapped pack file, shared between requests
+	char* map;
+	size_t size;
+	packHeader_t* header;
+	packEntry_t* index;
+	dev_t device;			// Identity of the file mapped, to notice a swap
+	ino_t inode;
+	int refCount;			// Requests using the mapping. Unmapped at zero
+	int current;			// Still the pack new requests are served from
+};
+
+void initPack(char* path);
+int packEnabled();
+pack_t* packAcquire();
+void packRelease(void* pack);
+packEntry_t* packLookup(pack_t* p, char* path);
+char* packBytes(pack_t* p, packBlob_t* blob);
+
+#endif /* HTTP_PACKFILE_H_ */
@@ -0,0 +1,740 @@
+/*
+ * Author: 			Ben Tomlin
+ * Student Id:		btomlin
+ * Student Nbr:		834198
+ * Date:			Oct 2026
+ *
+ * Reverse proxy to application backends for configured URI prefixes.
+ *
+ * Requests are forwarded as HTTP/1.1 over keep-alive connections, which are
+ * pooled per upstream once a response has been fully read, so a request
+ * normally costs no connect. A pooled connection the backend has since
+ * closed is detected before use, or fails before any response arrives, and
+ * the request is then retried once on a new connection.
+ *
+ * The upstream response header is filtered of hop-by-hop fields and sent
+ * with the server's own status line. The body is moved from the upstream
+ * socket to the client socket with splice() through a pipe kept with each
+ * connection, never entering user space; chunked bodies are dechunked on
+ * the way, as clients of this server speak HTTP/1.0. TLS clients have the
+ * body copied through the TLS session instead.
+ *
+ * Time from forwarding the request to having the upstream response header
+ * is recorded as the upstream stage.
+ */
+
+#define _GNU_SOURCE	// splice(), pipe2()
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include "proxy.h"
+#include "uriPath.h"
+#include "./../utility/bool.h"
+#include "./../utility/byteString.h"
+#include "./../utility/listener.h"
+#include "./../utility/logger.h"
+#include "./../utility/metrics.h"
+#include "./../utility/deadline.h"
+#include "./../utility/tcpSocketIo.h"
+#include "./../utility/tls.h"
+#include "./../config.h"
+
+/* Connection specific fields, not forwarded in either direction */
+static char* hopByHop[]={"Connection", "Keep-Alive", "Proxy-Connection",
+	"Transfer-Encoding", "TE", "Trailer", "Upgrade", NULL};
+
+byteString_t* _proxyRequest(request_t* r, upstream_t* u, int clientFd);
+void _appendField(byteString_t* b, char* name, char* value);
+upstreamConnection_t* _upstreamAcquire(upstream_t* u, int fresh, int* reused);
+upstreamConnection_t* _upstreamConnect(upstream_t* u);
+int _upstreamAlive(upstreamConnection_t* c);
+void _upstreamPool(upstreamConnection_t* c);
+void _upstreamClose(upstreamConnection_t* c);
+proxyExchange_t* _upstreamExchange(upstreamConnection_t* c,
+		byteString_t* request, int* status);
+int _headerLength(upstreamConnection_t* c);
+proxyExchange_t* _parseResponseHeader(upstreamConnection_t* c, char* header);
+void _parseResponseField(proxyExchange_t* x, char* line, byteString_t* out,
+		int* chunked, long* length);
+int _isHopByHop(char* name);
+int _forward(upstreamConnection_t* c, int clientFd, long length, long* sent);
+int _forwardChunked(upstreamConnection_t* c, int clientFd, long* sent);
+int _splice(upstreamConnection_t* c, int clientFd, long length, long* sent);
+int _copy(upstreamConnection_t* c, int clientFd, long length, long* sent);
+int _readLine(upstreamConnection_t* c, char* line, int lineSize);
+int _fill(upstreamConnection_t* c);
+
+
+int parseProxyRoute(char* prefix, char* address, proxyRoute_t* route) {
+	/**
+	 * Route URI paths under <prefix> to the backend at <address>, given as
+	 * for listen (see listener.c) but naming a host.
+	 *
+	 * RETURN:
+	 * 	false if the prefix or address is malformed
+	 */
+	listener_t* l=initListener();
+	upstream_t* u;
+
+	if (*prefix!='/'||!parseListenAddress(address, l)||l->wildcard) {
+		free(l);
+		return(false);
+	}
+	u=calloc(1, sizeof(upstream_t));
+	strcpy(u->address, l->address);
+	u->sockAddr=l->sockAddr;
+	u->sockAddrLength=l->sockAddrLength;
+	pthread_mutex_init(&u->lock, NULL);
+	free(l);
+
+	route->prefix=strdup(prefix);
+	route->prefixLength=strlen(prefix);
+	route->upstream=u;
+	route->next=NULL;
+	return(true);
+}
+
+
+proxyRoute_t* proxyMatch(proxyRoute_t* routes, char* uri) {
+	/**
+	 * First of <routes> whose prefix the canonical path of <uri> falls
+	 * under, so "/app" matches "/app" and "/app/x" but not "/apple".
+	 *
+	 * RETURN:
+	 * 	route, NULL if the URI is not proxied
+	 */
+	char path[PATH_MAX];
+	proxyRoute_t* route;
+	char next;
+
+	if (routes==NULL||canonicalizePath(uri, path, PATH_MAX)<0) {
+		return(NULL);
+	}
+	for (route=routes; route!=NULL; route=route->next) {
+		next=path[route->prefixLength<PATH_MAX?route->prefixLength:0];
+		if (strncmp(path, route->prefix, route->prefixLength)==0
+				&&(route->prefix[route->prefixLength-1]=='/'
+				||next=='\0'||next=='/')) {
+			return(route);
+		}
+	}
+	return(NULL);
+}
+
+
+proxyExchange_t* proxyForward(request_t* r, proxyRoute_t* route, int clientFd,
+		int* status) {
+	/**
+	 * Forward request <r> from <clientFd> to the upstream of <route> and
+	 * read the response header.
+	 *
+	 * RETURN:
+	 * 	The exchange, to send the body of with proxySendBody() and release
+	 * 	with proxyRelease(). NULL if the upstream could not be reached or
+	 * 	gave no valid response, with <status> set to 502 or 504.
+	 */
+	long start=metricsNow();
+	byteString_t* request=_proxyRequest(r, route->upstream, clientFd);
+	upstreamConnection_t* c;
+	proxyExchange_t* x=NULL;
+	int reused=false;
+	int attempt;
+
+	for (attempt=0; attempt<2&&x==NULL; attempt++) {
+		*status=502;
+		c=_upstreamAcquire(route->upstream, attempt>0, &reused);
+		if (c==NULL) {
+			break;
+		}
+		x=_upstreamExchange(c, request, status);
+		if (x==NULL) {
+			_upstreamClose(c);
+
+			/* Only a pooled connection closed before responding is retried */
+			if (!reused||*status!=0) {
+				break;
+			}
+		}
+	}
+	bsFree(request);
+	free(request);
+	metricsRecord(STAGE_UPSTREAM, start);
+
+	if (x==NULL) {
+		*status=(*status==0)?502:*status;
+		metricsCount(COUNT_UPSTREAM_FAILED, 1);
+		logWarn("Upstream %s failed for %s", route->upstream->address, r->uri);
+	}
+	return(x);
+}
+
+
+long proxySendBody(proxyExchange_t* x, int clientFd) {
+	/**
+	 * Forward the upstream response body of <x> to <clientFd>.
+	 *
+	 * RETURN:
+	 * 	body bytes sent
+	 */
+	upstreamConnection_t* c=x->connection;
+	long sent=0;
+	int complete=true;
+
+	switch (x->framing) {
+		case PROXY_BODY_LENGTH:
+			complete=_forward(c, clientFd, x->remaining, &sent);
+			break;
+		case PROXY_BODY_CHUNKED:
+			complete=_forwardChunked(c, clientFd, &sent);
+			break;
+		case PROXY_BODY_CLOSE:
+			_forward(c, clientFd, -1, &sent);
+			complete=false;
+			break;
+	}
+
+	/* Anything beyond the response would be misread as the next one */
+	x->reusable=complete&&x->keepAlive&&c->start==c->end;
+	return(sent);
+}
+
+
+void proxyRelease(proxyExchange_t* x) {
+	/* Pool the exchange's connection if reusable, otherwise close it */
+	if (x==NULL) {
+		return;
+	}
+	if (x->reusable) {
+		_upstreamPool(x->connection);
+	} else {
+		_upstreamClose(x->connection);
+	}
+	free(x->code);
+	free(x->phrase);
+	free(x->header);
+	free(x);
+}
+
+
+byteString_t* _proxyRequest(request_t* r, upstream_t* u, int clientFd) {
+	/* Serialize <r> as the HTTP/1.1 request forwarded to <u> */
+	byteString_t* b=bsInit();
+	struct sockaddr_storage peer;
+	socklen_t length=sizeof(peer);
+	char address[INET6_ADDRSTRLEN];
+	char* host=u->address;
+
+	if (strncmp(host, UNIX_PREFIX, strlen(UNIX_PREFIX))==0) {
+		host="localhost";
+	}
+	bsAppend(b, r->method, strlen(r->method));
+	bsAppend(b, " ", 1);
+	bsAppend(b, r->uri, strlen(r->uri));
+	bsAppend(b, " HTTP/1.1\r\n", 11);
+	_appendField(b, "Host", host);
+	_appendField(b, "Connection", "keep-alive");
+
+	if (getpeername(clientFd, (struct sockaddr*)&peer, &length)==0) {
+		if (peer.ss_family==AF_INET) {
+			inet_ntop(AF_INET, &((struct sockaddr_in*)&peer)->sin_addr,
+					address, sizeof(address));
+			_appendField(b, "X-Forwarded-For", address);
+		} else if (peer.ss_family==AF_INET6) {
+			inet_ntop(AF_INET6, &((struct sockaddr_in6*)&peer)->sin6_addr,
+					address, sizeof(address));
+			_appendField(b, "X-Forwarded-For", address);
+		}
+	}
+	_appendField(b, "X-Forwarded-Proto", tlsActive()?"https":"http");
+
+	_appendField(b, "User-Agent", r->rqHeader->userAgent);
+	_appendField(b, "Referer", r->rqHeader->referrer);
+	_appendField(b, "Accept-Encoding", r->rqHeader->acceptEncoding);
+	_appendField(b, "Authorization", r->rqHeader->authorization);
+	_appendField(b, "From", r->rqHeader->from);
+	_appendField(b, "If-Modified-Since", r->rqHeader->ifModifiedSince);
+	_appendField(b, "Pragma", r->gHeader->pragma);
+	bsAppend(b, "\r\n", 2);
+	return(b);
+}
+
+
+void _appendField(byteString_t* b, char* name, char* value) {
+	/* Append a "Name: value" CRLF line, unless the value is unset (NULL) */
+	if (value!=NULL) {
+		bsAppend(b, name, strlen(name));
+		bsAppend(b, ": ", 2);
+		bsAppend(b, value, strlen(value));
+		bsAppend(b, "\r\n", 2);
+	}
+}
+
+
+upstreamConnection_t* _upstreamAcquire(upstream_t* u, int fresh, int* reused) {
+	/* A live pooled connection to <u> unless <fresh>, else a new one */
+	upstreamConnection_t* c;
+
+	pthread_mutex_lock(&u->lock);
+	while (!fresh&&(c=u->idle)!=NULL) {
+		u->idle=c->next;
+		u->nIdle--;
+		pthread_mutex_unlock(&u->lock);
+		if (_upstreamAlive(c)) {
+			*reused=true;
+			metricsCount(COUNT_UPSTREAM_REUSED, 1);
+			return(c);
+		}
+		_upstreamClose(c);
+		pthread_mutex_lock(&u->lock);
+	}
+	pthread_mutex_unlock(&u->lock);
+
+	*reused=false;
+	return(_upstreamConnect(u));
+}
+
+
+upstreamConnection_t* _upstreamConnect(upstream_t* u) {
+	/* New connection to <u>, NULL if it cannot be reached */
+	upstreamConnection_t* c;
+	struct timeval timeout={serverConfig.proxyTimeout, 0};
+	int on=true;
+	int fd=socket(u->sockAddr.ss_family, SOCK_STREAM|SOCK_CLOEXEC, 0);
+
+	if (fd<0) {
+		logWarn("Could not create socket for %s: %s", u->address,
+				strerror(errno));
+		return(NULL);
+	}
+
+	/* Bounds connecting, and every later wait on the upstream */
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+	setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+	if (u->sockAddr.ss_family!=AF_UNIX) {
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+	}
+	if (connect(fd, (struct sockaddr*)&u->sockAddr, u->sockAddrLength)!=0) {
+		logWarn("Could not connect to %s: %s", u->address, strerror(errno));
+		close(fd);
+		return(NULL);
+	}
+
+	c=malloc(sizeof(upstreamConnection_t));
+	c->fd=fd;
+	c->pipe[0]=-1;
+	c->pipe[1]=-1;
+	c->start=0;
+	c->end=0;
+	c->upstream=u;
+	c->next=NULL;
+	metricsAllocated(MEM_UPSTREAM, sizeof(upstreamConnection_t));
+	return(c);
+}
+
+
+int _upstreamAlive(upstreamConnection_t* c) {
+	/* True if an idle connection is still open, with nothing unread */
+	char b;
+	return(recv(c->fd, &b, 1, MSG_PEEK|MSG_DONTWAIT)<0
+			&&(errno==EAGAIN||errno==EWOULDBLOCK));
+}
+
+
+void _upstreamPool(upstreamConnection_t* c) {
+	/* Keep <c> idle for another request, if its upstream has room */
+	upstream_t* u=c->upstream;
+
+	c->start=0;
+	c->end=0;
+	pthread_mutex_lock(&u->lock);
+	if (u->nIdle<serverConfig.proxyKeepalive) {
+		c->next=u->idle;
+		u->idle=c;
+		u->nIdle++;
+		c=NULL;
+	}
+	pthread_mutex_unlock(&u->lock);
+	if (c!=NULL) {
+		_upstreamClose(c);
+	}
+}
+
+
+void _upstreamClose(upstreamConnection_t* c) {
+	close(c->fd);
+	if (c->pipe[0]>=0) {
+		close(c->pipe[0]);
+		close(c->pipe[1]);
+	}
+	free(c);
+	metricsFreed(MEM_UPSTREAM, sizeof(upstreamConnection_t));
+}
+
+
+proxyExchange_t* _upstreamExchange(upstreamConnection_t* c,
+		byteString_t* request, int* status) {
+	/**
+	 * Send <request> on <c> and read the response header.
+	 *
+	 * RETURN:
+	 * 	NULL on failure with <status> 504 on a timeout, 502 on any other
+	 * 	error, or 0 if the connection was closed before any response.
+	 */
+	char* header;
+	proxyExchange_t* x;
+	long sent=0;
+	ssize_t n;
+	int length;
+
+	while (sent<request->length) {
+		n=send(c->fd, request->string+sent, request->length-sent,
+				MSG_NOSIGNAL);
+		if (n<0&&errno==EINTR) {
+			continue;
+		} else if (n<0) {
+			*status=(errno==EAGAIN||errno==EWOULDBLOCK)?504:0;
+			return(NULL);
+		}
+		sent+=n;
+	}
+
+	while ((length=_headerLength(c))==0) {
+		if (c->end==PROXY_BUFFER) {
+			logWarn("Upstream %s response header too long",
+					c->upstream->address);
+			*status=502;
+			return(NULL);
+		}
+		n=recv(c->fd, c->buffer+c->end, PROXY_BUFFER-c->end, 0);
+		if (n<0&&errno==EINTR) {
+			continue;
+		} else if (n<0&&(errno==EAGAIN||errno==EWOULDBLOCK)) {
+			*status=504;
+			return(NULL);
+		} else if (n<=0) {
+			*status=(c->end==0)?0:502;
+			return(NULL);
+		}
+		c->end+=n;
+	}
+
+	header=strndup(c->buffer, length);
+	c->start=length;
+	x=_parseResponseHeader(c, header);
+	free(header);
+	if (x==NULL) {
+		logWarn("Upstream %s sent a malformed response header",
+				c->upstream->address);
+		*status=502;
+	}
+	return(x);
+}
+
+
+int _headerLength(upstreamConnection_t* c) {
+	/* Bytes of buffered response header up to its blank line, 0 if partial */
+	char* p=c->buffer;
+	char* end=c->buffer+c->end;
+	char* newline;
+
+	while ((newline=memchr(p, '\n', end-p))!=NULL) {
+		if (newline==p||(newline==p+1&&*p=='\r')) {
+			return(newline+1-c->buffer);
+		}
+		p=newline+1;
+	}
+	return(0);
+}
+
+
+proxyExchange_t* _parseResponseHeader(upstreamConnection_t* c, char* header) {
+	/**
+	 * Parse the upstream status line and fields in <header>.
+	 *
+	 * RETURN:
+	 * 	exchange on <c>, NULL if the header is malformed
+	 */
+	proxyExchange_t* x;
+	byteString_t* out;
+	char* line;
+	char* save;
+	char* phrase;
+	int chunked=false;
+	long length=-1;
+	int code;
+
+	line=strtok_r(header, "\r\n", &save);
+	if (line==NULL||strncmp(line, "HTTP/1.", 7)!=0||strlen(line)<12
+			||line[8]!=' '||(code=strtol(line+9, &phrase, 10))<100
+			||code>599||phrase!=line+12) {
+		return(NULL);
+	}
+
+	x=calloc(1, sizeof(proxyExchange_t));
+	x->connection=c;
+	x->code=strndup(line+9, 3);
+	x->phrase=strdup(phrase+strspn(phrase, " "));
+	x->keepAlive=(line[7]=='1');	// The HTTP/1.1 default
+	out=bsInit();
+
+	while ((line=strtok_r(NULL, "\r\n", &save))!=NULL) {
+		_parseResponseField(x, line, out, &chunked, &length);
+	}
+	bsAppend(out, "", 1);
+	x->header=out->string;
+	free(out);
+
+	/* Body framing, RFC 7230 3.3.3 */
+	if (code<200||code==204||code==304) {
+		x->framing=PROXY_BODY_NONE;
+	} else if (chunked) {
+		x->framing=PROXY_BODY_CHUNKED;
+	} else if (length>=0) {
+		x->framing=PROXY_BODY_LENGTH;
+		x->remaining=length;
+	} else {
+		x->framing=PROXY_BODY_CLOSE;
+		x->keepAlive=false;
+	}
+	return(x);
+}
+
+
+void _parseResponseField(proxyExchange_t* x, char* line, byteString_t* out,
+		int* chunked, long* length) {
+	/**
+	 * Apply upstream header field <line> to <x>, appending it to <out> for
+	 * the client unless it is hop-by-hop.
+	 *
+	 * NOTE:
+	 * 	<line> is modified in place
+	 */
+	char* colon=strchr(line, ':');
+	char* value;
+
+	if (colon==NULL) {
+		return;
+	}
+	*colon='\0';
+	value=colon+1+strspn(colon+1, " \t");
+
+	if (strcasecmp(line, "Connection")==0) {
+		if (strcasestr(value, "close")!=NULL) {
+			x->keepAlive=false;
+		} else if (strcasestr(value, "keep-alive")!=NULL) {
+			x->keepAlive=true;
+		}
+	} else if (strcasecmp(line, "Transfer-Encoding")==0) {
+		*chunked=(strcasestr(value, "chunked")!=NULL);
+	} else if (strcasecmp(line, "Content-Length")==0) {
+		*length=strtol(value, NULL, 10);
+	}
+
+	/* Chunked bodies are sent dechunked, of a length unknown up front */
+	if (_isHopByHop(line)||(*chunked&&strcasecmp(line, "Content-Length")==0)) {
+		return;
+	}
+	bsAppend(out, line, strlen(line));
+	bsAppend(out, ": ", 2);
+	bsAppend(out, value, strlen(value));
+	bsAppend(out, "\n", 1);
+}
+
+
+int _isHopByHop(char* name) {
+	int i;
+	for (i=0; hopByHop[i]!=NULL; i++) {
+		if (strcasecmp(name, hopByHop[i])==0) {
+			return(true);
+		}
+	}
+	return(false);
+}
+
+
+int _forward(upstreamConnection_t* c, int clientFd, long length, long* sent) {
+	/**
+	 * Forward <length> body bytes, or all until the upstream closes if -1,
+	 * from <c> to <clientFd>, adding them to <sent>.
+	 *
+	 * RETURN:
+	 * 	true if all <length> bytes were forwarded
+	 */
+	long n=c->end-c->start;
+
+	/* Bytes read along with the header go first */
+	if (length>=0&&n>length) {
+		n=length;
+	}
+	if (n>0) {
+		if (sendBytes(clientFd, c->buffer+c->start, n)!=SENDOK) {
+			return(false);
+		}
+		c->start+=n;
+		*sent+=n;
+		length-=(length>=0)?n:0;
+	}
+	if (length==0) {
+		return(true);
+	}
+
+	/* A TLS session must encrypt the bytes itself */
+	if (tlsActive()) {
+		return(_copy(c, clientFd, length, sent));
+	}
+	return(_splice(c, clientFd, length, sent));
+}
+
+
+int _forwardChunked(upstreamConnection_t* c, int clientFd, long* sent) {
+	/* Forward a chunked body's data, RFC 7230 4.1. True if complete */
+	char line[PROXY_MAXADDRESS];
+	char* end;
+	long size;
+
+	while (true) {
+		if (!_readLine(c, line, sizeof(line))) {
+			return(false);
+		}
+		size=strtol(line, &end, 16);
+		if (end==line||size<0) {
+			return(false);
+		}
+
+		/* Last chunk, then trailer fields up to a blank line */
+		if (size==0) {
+			do {
+				if (!_readLine(c, line, sizeof(line))) {
+					return(false);
+				}
+			} while (*line!='\0');
+			return(true);
+		}
+		if (!_forward(c, clientFd, size, sent)
+				||!_readLine(c, line, sizeof(line))||*line!='\0') {
+			return(false);
+		}
+	}
+}
+
+
+int _splice(upstreamConnection_t* c, int clientFd, long length, long* sent) {
+	/* _forward() from the upstream socket, through the connection's pipe */
+	ssize_t in;
+	ssize_t out;
+
+	if (c->pipe[0]<0&&pipe2(c->pipe, O_CLOEXEC)!=0) {
+		return(_copy(c, clientFd, length, sent));
+	}
+	while (length!=0) {
+		in=splice(c->fd, NULL, c->pipe[1], NULL,
+				(length<0||length>PROXY_SPLICE_CHUNK)?PROXY_SPLICE_CHUNK:length,
+				SPLICE_F_MOVE|SPLICE_F_MORE);
+		if (in<0&&errno==EINTR) {
+			continue;
+		} else if (in<=0) {
+			return(in==0&&length<0);	// End of a close delimited body
+		}
+		length-=(length>0)?in:0;
+
+		/* Bytes left in the pipe on failure close the connection */
+		while (in>0) {
+			out=splice(c->pipe[0], NULL, clientFd, NULL, in,
+					SPLICE_F_MOVE|SPLICE_F_MORE);
+			if (out<0&&errno==EINTR) {
+				continue;
+			} else if (out<=0) {
+				logDebug("Client went away during a proxied response");
+				return(false);
+			}
+			in-=out;
+			*sent+=out;
+		}
+		deadlineProgress();
+	}
+	return(true);
+}
+
+
+int _copy(upstreamConnection_t* c, int clientFd, long length, long* sent) {
+	/* _forward() through the connection buffer, for TLS clients */
+	ssize_t n;
+
+	while (length!=0) {
+		n=recv(c->fd, c->buffer, (length<0||length>PROXY_BUFFER)?
+				PROXY_BUFFER:length, 0);
+		if (n<0&&errno==EINTR) {
+			continue;
+		} else if (n<=0) {
+			return(n==0&&length<0);
+		}
+		if (sendBytes(clientFd, c->buffer, n)!=SENDOK) {
+			return(false);
+		}
+		length-=(length>0)?n:0;
+		*sent+=n;
+	}
+	return(true);
+}
+
+
+int _readLine(upstreamConnection_t* c, char* line, int lineSize) {
+	/**
+	 * Read a line from <c> into <line>, without its line ending.
+	 *
+	 * RETURN:
+	 * 	false if the upstream closed or failed first, or the line is too long
+	 */
+	char* newline;
+	int length;
+
+	while ((newline=memchr(c->buffer+c->start, '\n', c->end-c->start))
+			==NULL) {
+		if (!_fill(c)) {
+			return(false);
+		}
+	}
+	length=newline-(c->buffer+c->start);
+	if (length>0&&newline[-1]=='\r') {
+		length--;
+	}
+	if (length>=lineSize) {
+		return(false);
+	}
+	memcpy(line, c->buffer+c->start, length);
+	line[length]='\0';
+	c->start=newline+1-c->buffer;
+	return(true);
+}
+
+
+int _fill(upstreamConnection_t* c) {
+	/* Read more from the upstream into the connection buffer */
+	ssize_t n;
+
+	memmove(c->buffer, c->buffer+c->start, c->end-c->start);
+	c->end-=c->start;
+	c->start=0;
+	if (c->end==PROXY_BUFFER) {
+		return(false);
+	}
+	do {
+		n=recv(c->fd, c->buffer+c->end, PROXY_BUFFER-c->end, 0);
+	} while (n<0&&errno==EINTR);
+	if (n<=0) {
+		return(false);
+	}
+	c->end+=n;
+	return(true);
+}
@@ -0,0 +1,75 @@
+/*
+ * Author: 			Ben Tomlin
+ * Student Id:		btomlin
+ * Student Nbr:		834198
+ * Date:			Oct 2026
+ */
+
+#ifndef HTTP_PROXY_H_
+#define HTTP_PROXY_H_
+
+#include <pthread.h>
+#include <sys/socket.h>
+
+#include "httpStructures.h"
+
+#define PROXY_BUFFER		 8192		 // Upstream read buffer, and header limit
+#define PROXY_SPLICE_CHUNK	 (64*1024)	 // Most moved per splice()
+#define PROXY_MAXADDRESS	 128
+
+/* Upstream response body framing */
+#define PROXY_BODY_NONE		 0
+#define PROXY_BODY_LENGTH	 1	 // Content-Length bytes
+#define PROXY_BODY_CHUNKED	 2	 // Dechunked, the client is HTTP/1.0
+#define PROXY_BODY_CLOSE	 3	 // Until the upstream closes
+
+typedef struct upstream upstream_t;
+typedef struct upstreamConnection upstreamConnection_t;
+typedef struct proxyRoute proxyRoute_t;
+typedef struct proxyExchange proxyExchange_t;
+
+struct upstream {			// A backend, and its idle keep-alive connections
+	char address[PROXY_MAXADDRESS];	// As configured, for messages
+	struct sockaddr_storage sockAddr;
+	socklen_t sockAddrLength;
+	pthread_mutex_t lock;
+	upstreamConnection_t* idle;
+	int nIdle;
+};
+
+struct upstreamConnection {
+	int fd;
+	int pipe[2];			// splice() buffer, -1 until first used
+	char buffer[PROXY_BUFFER];	// Read from fd, not yet consumed
+	int start;
+	int end;
+	upstream_t* upstream;
+	upstreamConnection_t* next;
+};
+
+struct proxyRoute {			// URI paths under prefix go to upstream
+	char* prefix;
+	int prefixLength;
+	upstream_t* upstream;
+	proxyRoute_t* next;
+};
+
+struct proxyExchange {		// A request forwarded, its response not yet sent
+	upstreamConnection_t* connection;
+	char* code;
+	char* phrase;
+	char* header;			// Fields forwarded to the client, "Name: value\n"
+	int framing;			// PROXY_BODY_
+	long remaining;			// Body bytes still to forward if framed by length
+	int keepAlive;			// The upstream will keep the connection open
+	int reusable;			// Response fully read, the connection can be pooled
+};
+
+int parseProxyRoute(char* prefix, char* address, proxyRoute_t* route);
+proxyRoute_t* proxyMatch(proxyRoute_t* routes, char* uri);
+proxyExchange_t* proxyForward(request_t* r, proxyRoute_t* route, int clientFd,
+		int* status);
+long proxySendBody(proxyExchange_t* x, int clientFd);
+void proxyRelease(proxyExchange_t* x);
+
+#endif /* HTTP_PROXY_H_ */
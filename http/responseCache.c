@@ -0,0 +1,278 @@
+/*
+ * Author: 			Ben Tomlin
+ * Student Id:		btomlin
+ * Student Nbr:		834198
+ * Date:			Oct 2026
+ *
+ * Cache of whole serialized responses (status line, header and entity in
+ * one buffer) for entities up to response_cache_max_file, so a hit is sent
+ * with a single send() from memory.
+ *
+ * Entries are keyed by the entity file path and the serialized header, which
+ * already captures the content type, coding and length; whatever is sent in
+ * the header, the same bytes are cached. An entry is only used while the
+ * entity file's mtime, size and inode match those it was built from, and the
+ * open file cache restats files as they age, so changed files are rebuilt.
+ *
+ * The cache is split into RESPONSE_CACHE_SHARDS, picked by key hash, each
+ * with its own lock and an equal share of response_cache_size. Eviction is
+ * CLOCK; hits only set a bit, and the hand sweeping a shard's ring clears
+ * set bits and evicts the first entry found clear.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "responseCache.h"
+#include "./../utility/bool.h"
+#include "./../utility/hash.h"
+#include "./../utility/metrics.h"
+
+typedef struct responseShard {
+	pthread_mutex_t lock;
+	responseEntry_t* buckets[RESPONSE_CACHE_BUCKETS];
+	responseEntry_t* hand;	// Next entry the CLOCK hand looks at
+	long bytes;
+} responseShard_t;
+
+static responseShard_t shards[RESPONSE_CACHE_SHARDS];
+static long shardSize;		// Bytes each shard may hold, 0 when disabled
+static long maxEntity;
+
+char* _responseKey(char* path, char* header, int headerLength, int* length);
+responseEntry_t* _responseCacheFind(responseShard_t* shard, char* key,
+		int keyLength, unsigned long hash);
+int _responseCurrent(responseEntry_t* e, struct stat* s);
+void _responseCacheLink(responseShard_t* shard, responseEntry_t* e);
+void _responseCacheUnlink(responseShard_t* shard, responseEntry_t* e);
+void _responseCacheEvict(responseShard_t* shard);
+void _freeResponseEntry(responseEntry_t* e);
+
+
+void initResponseCache(long size, long maxFile) {
+	/**
+	 * ARGUMENT:
+	 * 	size - memory bound of all cached responses [bytes], 0 disables
+	 * 	maxFile - largest entity cached [bytes]
+	 */
+	int i;
+	for (i=0; i<RESPONSE_CACHE_SHARDS; i++) {
+		pthread_mutex_init(&shards[i].lock, NULL);
+	}
+	shardSize=size/RESPONSE_CACHE_SHARDS;
+	maxEntity=maxFile;
+}
+
+
+int responseCacheable(long entityLength) {
+	/* True if a response with an entity of <entityLength> bytes is cached */
+	return(shardSize>0&&entityLength<=maxEntity);
+}
+
+
+responseEntry_t* responseCacheAcquire(char* path, char* header,
+		int headerLength, struct stat* s) {
+	/**
+	 * Find the cached response with <header> for entity file <path>.
+	 *
+	 * ARGUMENT:
+	 * 	s - current stat of <path>, a response built from an older version
+	 * 	is discarded
+	 *
+	 * RETURN:
+	 * 	Entry to be handed back with responseCacheRelease() once sent, NULL
+	 * 	on a miss
+	 */
+	int keyLength;
+	char* key=_responseKey(path, header, headerLength, &keyLength);
+	unsigned long hash=hashBytes(key, keyLength);
+	responseShard_t* shard=&shards[hash%RESPONSE_CACHE_SHARDS];
+	responseEntry_t* e;
+
+	pthread_mutex_lock(&shard->lock);
+	e=_responseCacheFind(shard, key, keyLength, hash);
+	if (e!=NULL&&!_responseCurrent(e, s)) {
+		_responseCacheUnlink(shard, e);
+		e=NULL;
+	}
+	if (e!=NULL) {
+		e->referenced=true;
+		e->refCount++;
+	}
+	pthread_mutex_unlock(&shard->lock);
+	free(key);
+
+	metricsCount(e!=NULL?COUNT_RESPONSE_HIT:COUNT_RESPONSE_MISS, 1);
+	return(e);
+}
+
+
+responseEntry_t* responseCacheInsert(char* path, char* header,
+		int headerLength, struct stat* s, char* data, long length) {
+	/**
+	 * Cache response <data>, <header> followed by the entity of file <path>
+	 * as of <s>. The cache takes ownership of <data>.
+	 *
+	 * RETURN:
+	 * 	Entry holding <data>, to be handed back with responseCacheRelease()
+	 */
+	responseEntry_t* e=calloc(1, sizeof(responseEntry_t));
+	responseShard_t* shard;
+	responseEntry_t* old;
+
+	e->key=_responseKey(path, header, headerLength, &e->keyLength);
+	e->hash=hashBytes(e->key, e->keyLength);
+	e->mtime=s->st_mtim;
+	e->size=s->st_size;
+	e->inode=s->st_ino;
+	e->data=data;
+	e->length=length;
+	e->entityLength=length-headerLength;
+	e->refCount=1;
+	metricsAllocated(MEM_RESPONSE, sizeof(responseEntry_t)+e->keyLength
+			+e->length);
+	shard=&shards[e->hash%RESPONSE_CACHE_SHARDS];
+
+	pthread_mutex_lock(&shard->lock);
+
+	/* Built concurrently by another request, the newer build replaces it */
+	old=_responseCacheFind(shard, e->key, e->keyLength, e->hash);
+	if (old!=NULL) {
+		_responseCacheUnlink(shard, old);
+	}
+	if (e->length<=shardSize) {
+		_responseCacheLink(shard, e);
+		_responseCacheEvict(shard);
+	}
+	pthread_mutex_unlock(&shard->lock);
+	return(e);
+}
+
+
+void responseCacheRelease(responseEntry_t* e) {
+	/* Drop a reference taken by responseCacheAcquire() or Insert() */
+	responseShard_t* shard=&shards[e->hash%RESPONSE_CACHE_SHARDS];
+	int unused;
+
+	pthread_mutex_lock(&shard->lock);
+	e->refCount--;
+	unused=(e->refCount==0&&!e->linked);
+	pthread_mutex_unlock(&shard->lock);
+
+	if (unused) {
+		_freeResponseEntry(e);
+	}
+}
+
+
+char* _responseKey(char* path, char* header, int headerLength, int* length) {
+	/* <path>, a null byte, then <header> */
+	int pathLength=strlen(path);
+	char* key=malloc(pathLength+1+headerLength);
+
+	memcpy(key, path, pathLength+1);
+	memcpy(key+pathLength+1, header, headerLength);
+	*length=pathLength+1+headerLength;
+	return(key);
+}
+
+
+responseEntry_t* _responseCacheFind(responseShard_t* shard, char* key,
+		int keyLength, unsigned long hash) {
+	responseEntry_t* e=shard->buckets[(hash/RESPONSE_CACHE_SHARDS)
+			%RESPONSE_CACHE_BUCKETS];
+	for (; e!=NULL; e=e->hashNext) {
+		if (e->hash==hash&&e->keyLength==keyLength
+				&&memcmp(e->key, key, keyLength)==0) {
+			return(e);
+		}
+	}
+	return(NULL);
+}
+
+
+int _responseCurrent(responseEntry_t* e, struct stat* s) {
+	/* True if <e> was built from the version of the file <s> describes */
+	return(e->mtime.tv_sec==s->st_mtim.tv_sec
+			&&e->mtime.tv_nsec==s->st_mtim.tv_nsec
+			&&e->size==s->st_size&&e->inode==s->st_ino);
+}
+
+
+void _responseCacheLink(responseShard_t* shard, responseEntry_t* e) {
+	/* Add <e> to the hash and just behind the hand, the last it will reach */
+	responseEntry_t** bucket=&shard->buckets[(e->hash/RESPONSE_CACHE_SHARDS)
+			%RESPONSE_CACHE_BUCKETS];
+
+	e->hashNext=*bucket;
+	*bucket=e;
+	if (shard->hand==NULL) {
+		e->clockPrev=e;
+		e->clockNext=e;
+		shard->hand=e;
+	} else {
+		e->clockNext=shard->hand;
+		e->clockPrev=shard->hand->clockPrev;
+		e->clockPrev->clockNext=e;
+		shard->hand->clockPrev=e;
+	}
+	e->linked=true;
+	shard->bytes+=e->length;
+}
+
+
+void _responseCacheUnlink(responseShard_t* shard, responseEntry_t* e) {
+	/**
+	 * Remove <e> from the cache. It is freed now if unused, otherwise by the
+	 * last responseCacheRelease().
+	 */
+	responseEntry_t** p=&shard->buckets[(e->hash/RESPONSE_CACHE_SHARDS)
+			%RESPONSE_CACHE_BUCKETS];
+
+	while (*p!=e) {
+		p=&(*p)->hashNext;
+	}
+	*p=e->hashNext;
+
+	if (e->clockNext==e) {
+		shard->hand=NULL;
+	} else {
+		if (shard->hand==e) {
+			shard->hand=e->clockNext;
+		}
+		e->clockPrev->clockNext=e->clockNext;
+		e->clockNext->clockPrev=e->clockPrev;
+	}
+	e->linked=false;
+	shard->bytes-=e->length;
+
+	if (e->refCount==0) {
+		_freeResponseEntry(e);
+	}
+}
+
+
+void _responseCacheEvict(responseShard_t* shard) {
+	/* Sweep the hand until the shard fits its share of the cache */
+	responseEntry_t* e;
+
+	while (shard->bytes>shardSize&&shard->hand!=NULL) {
+		e=shard->hand;
+		shard->hand=e->clockNext;
+		if (e->referenced) {
+			e->referenced=false;
+		} else {
+			_responseCacheUnlink(shard, e);
+		}
+	}
+}
+
+
+void _freeResponseEntry(responseEntry_t* e) {
+	metricsFreed(MEM_RESPONSE, sizeof(responseEntry_t)+e->keyLength
+			+e->length);
+	free(e->key);
+	free(e->data);
+	free(e);
+}
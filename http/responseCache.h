@@ -0,0 +1,45 @@
+/*
+ * Author: 			Ben Tomlin
+ * Student Id:		btomlin
+ * Student Nbr:		834198
+ * Date:			Oct 2026
+ */
+
+#ifndef HTTP_RESPONSECACHE_H_
+#define HTTP_RESPONSECACHE_H_
+
+#include <time.h>
+#include <sys/stat.h>
+
+#define RESPONSE_CACHE_SHARDS  16
+#define RESPONSE_CACHE_BUCKETS 1024	// Hash buckets per shard
+
+typedef struct responseEntry responseEntry_t;
+
+struct responseEntry {	// A whole serialized response, shared between requests
+	char* key;			// Entity path, then the response header
+	int keyLength;
+	unsigned long hash;
+	struct timespec mtime;	// Entity file when the response was built
+	off_t size;
+	ino_t inode;
+	char* data;			// Header followed by the entity
+	long length;
+	long entityLength;
+	int referenced;		// CLOCK bit, set by hits, cleared by the hand
+	int refCount;		// Requests sending data. Freed at zero once unlinked
+	int linked;			// Still reachable through the cache
+	responseEntry_t* hashNext;
+	responseEntry_t* clockPrev; // Circular list swept by the CLOCK hand
+	responseEntry_t* clockNext;
+};
+
+void initResponseCache(long size, long maxFile);
+int responseCacheable(long entityLength);
+responseEntry_t* responseCacheAcquire(char* path, char* header,
+		int headerLength, struct stat* s);
+responseEntry_t* responseCacheInsert(char* path, char* header,
+		int headerLength, struct stat* s, char* data, long length);
+void responseCacheRelease(responseEntry_t* e);
+
+#endif /* HTTP_RESPONSECACHE_H_ */
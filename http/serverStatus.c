@@ -0,0 +1,262 @@
+/*
+ * Author: 			Ben Tomlin
+ * Student Id:		btomlin
+ * Student Nbr:		834198
+ * Date:			Oct 2026
+ *
+ * The /server-status page, a snapshot of the metrics module as plain text or,
+ * with ?format=prometheus, in the Prometheus text exposition format.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+#include "serverStatus.h"
+#include "./../utility/metrics.h"
+
+#define STATUS_MAXLINE		 256
+#define STATUS_LE_FIRST		 10	// Prometheus buckets from 2^10ns (~1us)
+#define STATUS_LE_LAST		 36	// to 2^36ns (~69s)
+#define STATUS_LE_STEP		 2	// every power of four
+
+#define N_CACHES			 5
+
+static char* caches[N_CACHES]={"open_file", "gzip", "dir_listing", "response",
+	"not_found"};
+static int cacheHitCounters[N_CACHES]={COUNT_OPENFILE_HIT, COUNT_GZIP_HIT,
+	COUNT_DIRLISTING_HIT, COUNT_RESPONSE_HIT, COUNT_NOTFOUND_HIT};
+
+void _statusPrintf(byteString_t* b, const char* format, ...);
+void _renderText(byteString_t* b, metricsSnapshot_t* s);
+void _renderPrometheus(byteString_t* b, metricsSnapshot_t* s);
+double _hitRate(unsigned long hits, unsigned long misses);
+
+
+int statusRequestFormat(char* uri) {
+	/**
+	 * Check whether <uri> names the status page.
+	 *
+	 * RETURN:
+	 * 	STATUS_NONE if not, else the format asked for
+	 */
+	int length=strlen(STATUS_URI);
+	char* query;
+
+	if (strncmp(uri, STATUS_URI, length)!=0
+			||(uri[length]!='\0'&&uri[length]!='?')) {
+		return(STATUS_NONE);
+	}
+	query=uri+length;
+	if (*query=='?'&&strstr(query, STATUS_PROMETHEUS_QUERY)!=NULL) {
+		return(STATUS_PROMETHEUS);
+	}
+	return(STATUS_TEXT);
+}
+
+
+byteString_t* renderServerStatus(int format) {
+	/**
+	 * Snapshot the metrics into a page in <format>.
+	 *
+	 * RETURN:
+	 * 	page to be freed with serverStatusRelease()
+	 */
+	metricsSnapshot_t* s=malloc(sizeof(metricsSnapshot_t));
+	byteString_t* b=bsInit();
+
+	metricsSnapshot(s);
+	if (format==STATUS_PROMETHEUS) {
+		_renderPrometheus(b, s);
+	} else {
+		_renderText(b, s);
+	}
+	free(s);
+	return(b);
+}
+
+
+void serverStatusRelease(void* page) {
+	bsFree(page);
+	free(page);
+}
+
+
+void _statusPrintf(byteString_t* b, const char* format, ...) {
+	char line[STATUS_MAXLINE];
+	va_list args;
+	int length;
+
+	va_start(args, format);
+	length=vsnprintf(line, STATUS_MAXLINE, format, args);
+	va_end(args);
+	bsAppend(b, line, length<STATUS_MAXLINE?length:STATUS_MAXLINE-1);
+}
+
+
+void _renderText(byteString_t* b, metricsSnapshot_t* s) {
+	/* Human readable page, latencies in microseconds */
+	histogram_t* h;
+	int i;
+
+	_statusPrintf(b, "Uptime: %ld s\n", s->uptime);
+	_statusPrintf(b, "Active connections: %ld\n", s->activeConnections);
+	_statusPrintf(b, "Requests: %lu\n", s->counters[COUNT_REQUESTS]);
+	_statusPrintf(b, "Bytes sent: %lu\n", s->counters[COUNT_BYTES_SENT]);
+	_statusPrintf(b, "Timed out connections: %lu\n",
+			s->counters[COUNT_TIMEOUTS]);
+	_statusPrintf(b, "Rate limited connections: %lu\n",
+			s->counters[COUNT_LIMITED]);
+	_statusPrintf(b, "TLS handshakes: %lu (%lu resumed, %lu kTLS)\n",
+			s->counters[COUNT_TLS_HANDSHAKES], s->counters[COUNT_TLS_RESUMED],
+			s->counters[COUNT_TLS_KTLS]);
+	_statusPrintf(b, "Upstream connections reused: %lu, failed: %lu\n",
+			s->counters[COUNT_UPSTREAM_REUSED],
+			s->counters[COUNT_UPSTREAM_FAILED]);
+	_statusPrintf(b, "Cold file ranges read by disk threads: %lu\n",
+			s->counters[COUNT_DISK_COLD]);
+
+	_statusPrintf(b, "\nResponses:\n");
+	for (i=0; i<=METRICS_MAX_STATUS-METRICS_MIN_STATUS; i++) {
+		if (s->statuses[i]>0) {
+			_statusPrintf(b, "  %d  %lu\n", i+METRICS_MIN_STATUS,
+					s->statuses[i]);
+		}
+	}
+
+	_statusPrintf(b, "\nCaches:            hits     misses  hit rate\n");
+	for (i=0; i<N_CACHES; i++) {
+		_statusPrintf(b, "  %-12s %10lu %10lu %8.1f%%\n", caches[i],
+				s->counters[cacheHitCounters[i]],
+				s->counters[cacheHitCounters[i]+1],
+				_hitRate(s->counters[cacheHitCounters[i]],
+						s->counters[cacheHitCounters[i]+1]));
+	}
+
+	_statusPrintf(b, "\nMemory:            live      bytes\n");
+	for (i=0; i<N_MEM; i++) {
+		_statusPrintf(b, "  %-12s %10ld %10ld\n", memNames[i], s->memCount[i],
+				s->memBytes[i]);
+	}
+	_statusPrintf(b, "  %-12s %21ld\n", "resident", s->residentBytes);
+
+	_statusPrintf(b, "\nStage latency [us]:\n");
+	_statusPrintf(b, "  %-11s %9s %10s %10s %10s %10s %10s %10s\n", "stage",
+			"count", "mean", "p50", "p90", "p99", "p99.9", "max");
+	for (i=0; i<N_STAGES; i++) {
+		h=&s->stages[i];
+		_statusPrintf(b, "  %-11s %9lu %10.1f %10.1f %10.1f %10.1f %10.1f "
+				"%10.1f\n", stageNames[i], h->count,
+				h->count>0?h->sum/1000.0/h->count:0.0,
+				histogramPercentile(h, 50)/1000.0,
+				histogramPercentile(h, 90)/1000.0,
+				histogramPercentile(h, 99)/1000.0,
+				histogramPercentile(h, 99.9)/1000.0, h->max/1000.0);
+	}
+}
+
+
+void _renderPrometheus(byteString_t* b, metricsSnapshot_t* s) {
+	/* Prometheus text format, latencies as histograms in seconds */
+	histogram_t* h;
+	unsigned long cumulative;
+	unsigned long bound;
+	int bucket;
+	int stage;
+	int i;
+
+	_statusPrintf(b, "# TYPE httpserver_uptime_seconds gauge\n"
+			"httpserver_uptime_seconds %ld\n", s->uptime);
+	_statusPrintf(b, "# TYPE httpserver_connections_active gauge\n"
+			"httpserver_connections_active %ld\n", s->activeConnections);
+	_statusPrintf(b, "# TYPE httpserver_requests_total counter\n"
+			"httpserver_requests_total %lu\n", s->counters[COUNT_REQUESTS]);
+	_statusPrintf(b, "# TYPE httpserver_sent_bytes_total counter\n"
+			"httpserver_sent_bytes_total %lu\n",
+			s->counters[COUNT_BYTES_SENT]);
+	_statusPrintf(b, "# TYPE httpserver_connection_timeouts_total counter\n"
+			"httpserver_connection_timeouts_total %lu\n",
+			s->counters[COUNT_TIMEOUTS]);
+	_statusPrintf(b, "# TYPE httpserver_connections_limited_total counter\n"
+			"httpserver_connections_limited_total %lu\n",
+			s->counters[COUNT_LIMITED]);
+	_statusPrintf(b, "# TYPE httpserver_tls_handshakes_total counter\n"
+			"httpserver_tls_handshakes_total %lu\n",
+			s->counters[COUNT_TLS_HANDSHAKES]);
+	_statusPrintf(b, "# TYPE httpserver_tls_resumed_total counter\n"
+			"httpserver_tls_resumed_total %lu\n",
+			s->counters[COUNT_TLS_RESUMED]);
+	_statusPrintf(b, "# TYPE httpserver_tls_ktls_total counter\n"
+			"httpserver_tls_ktls_total %lu\n", s->counters[COUNT_TLS_KTLS]);
+	_statusPrintf(b, "# TYPE httpserver_upstream_reused_total counter\n"
+			"httpserver_upstream_reused_total %lu\n",
+			s->counters[COUNT_UPSTREAM_REUSED]);
+	_statusPrintf(b, "# TYPE httpserver_upstream_failures_total counter\n"
+			"httpserver_upstream_failures_total %lu\n",
+			s->counters[COUNT_UPSTREAM_FAILED]);
+	_statusPrintf(b, "# TYPE httpserver_disk_cold_reads_total counter\n"
+			"httpserver_disk_cold_reads_total %lu\n",
+			s->counters[COUNT_DISK_COLD]);
+
+	_statusPrintf(b, "# TYPE httpserver_responses_total counter\n");
+	for (i=0; i<=METRICS_MAX_STATUS-METRICS_MIN_STATUS; i++) {
+		if (s->statuses[i]>0) {
+			_statusPrintf(b, "httpserver_responses_total{code=\"%d\"} %lu\n",
+					i+METRICS_MIN_STATUS, s->statuses[i]);
+		}
+	}
+
+	_statusPrintf(b, "# TYPE httpserver_cache_hits_total counter\n");
+	for (i=0; i<N_CACHES; i++) {
+		_statusPrintf(b, "httpserver_cache_hits_total{cache=\"%s\"} %lu\n",
+				caches[i], s->counters[cacheHitCounters[i]]);
+	}
+	_statusPrintf(b, "# TYPE httpserver_cache_misses_total counter\n");
+	for (i=0; i<N_CACHES; i++) {
+		_statusPrintf(b, "httpserver_cache_misses_total{cache=\"%s\"} %lu\n",
+				caches[i], s->counters[cacheHitCounters[i]+1]);
+	}
+
+	_statusPrintf(b, "# TYPE httpserver_memory_live_allocations gauge\n");
+	for (i=0; i<N_MEM; i++) {
+		_statusPrintf(b, "httpserver_memory_live_allocations{pool=\"%s\"} "
+				"%ld\n", memNames[i], s->memCount[i]);
+	}
+	_statusPrintf(b, "# TYPE httpserver_memory_live_bytes gauge\n");
+	for (i=0; i<N_MEM; i++) {
+		_statusPrintf(b, "httpserver_memory_live_bytes{pool=\"%s\"} %ld\n",
+				memNames[i], s->memBytes[i]);
+	}
+	_statusPrintf(b, "# TYPE httpserver_resident_memory_bytes gauge\n"
+			"httpserver_resident_memory_bytes %ld\n", s->residentBytes);
+
+	_statusPrintf(b, "# TYPE httpserver_stage_duration_seconds histogram\n");
+	for (stage=0; stage<N_STAGES; stage++) {
+		h=&s->stages[stage];
+		cumulative=0;
+		bucket=0;
+		for (i=STATUS_LE_FIRST; i<=STATUS_LE_LAST; i+=STATUS_LE_STEP) {
+			bound=1UL<<i;
+			for (; bucket<METRICS_BUCKETS
+					&&histogramBucketUpper(bucket)<bound; bucket++) {
+				cumulative+=h->buckets[bucket];
+			}
+			_statusPrintf(b, "httpserver_stage_duration_seconds_bucket"
+					"{stage=\"%s\",le=\"%g\"} %lu\n", stageNames[stage],
+					bound/1e9, cumulative);
+		}
+		_statusPrintf(b, "httpserver_stage_duration_seconds_bucket"
+				"{stage=\"%s\",le=\"+Inf\"} %lu\n", stageNames[stage],
+				h->count);
+		_statusPrintf(b, "httpserver_stage_duration_seconds_sum"
+				"{stage=\"%s\"} %.9f\n", stageNames[stage], h->sum/1e9);
+		_statusPrintf(b, "httpserver_stage_duration_seconds_count"
+				"{stage=\"%s\"} %lu\n", stageNames[stage], h->count);
+	}
+}
+
+
+double _hitRate(unsigned long hits, unsigned long misses) {
+	return(hits+misses>0?100.0*hits/(hits+misses):0.0);
+}
@@ -0,0 +1,26 @@
+/*
+ * Author: 			Ben Tomlin
+ * Student Id:		btomlin
+ * Student Nbr:		834198
+ * Date:			Oct 2026
+ */
+
+#ifndef HTTP_SERVERSTATUS_H_
+#define HTTP_SERVERSTATUS_H_
+
+#include "./../utility/byteString.h"
+
+#define STATUS_URI		  "/server-status"
+#define STATUS_PROMETHEUS_QUERY "format=prometheus"
+#define STATUS_TEXT_TYPE  "text/plain"
+#define STATUS_PROMETHEUS_TYPE "text/plain; version=0.0.4"
+
+#define STATUS_NONE		  -1 // Not a status request
+#define STATUS_TEXT		  0
+#define STATUS_PROMETHEUS 1
+
+int statusRequestFormat(char* uri);
+byteString_t* renderServerStatus(int format);
+void serverStatusRelease(void* page);
+
+#endif /* HTTP_SERVERSTATUS_H_ */
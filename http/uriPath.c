@@ -0,0 +1,150 @@
+/*
+ * Author: 			Ben Tomlin
+ * Student Id:		btomlin
+ * Student Nbr:		834198
+ * Date:			Oct 2026
+ *
+ * Request URI to canonical path.
+ *
+ * Equivalent URIs ("/a/./b", "/a//b", "/a/c/../b", "/a/%62") must resolve to
+ * one path, both so they share cache entries and so that no spelling of a
+ * path can reach outside the document root. This is done in a single pass
+ * over the URI, decoding and normalising straight into the caller's buffer.
+ */
+
+#include <string.h>
+#include <strings.h>
+
+#include "uriPath.h"
+
+int _hexValue(char c);
+int _endSegment(char* out, int n, int* segmentStart);
+
+
+int canonicalizePath(char* uri, char* out, int outSize) {
+	/**
+	 * Decode and normalise the path part of request URI <uri> into <out>.
+	 *
+	 * %XX escapes are decoded (an encoded '/' separates segments like a
+	 * literal one), empty and "." segments are dropped and ".." removes the
+	 * segment before it. Parameters, query and fragment are discarded. A
+	 * trailing slash is kept, it marks a directory request.
+	 *
+	 * ARGUMENT:
+	 * 	uri - abs_path ("/a/b?q") or absoluteURI ("http://host/a/b?q")
+	 * 	out - buffer for the null terminated canonical path, which always
+	 * 	starts with '/'
+	 * 	outSize - size of out in bytes
+	 *
+	 * RETURN:
+	 * 	Length of the canonical path, or URI_INVALID, URI_TRAVERSAL or
+	 * 	URI_TOOLONG. Nothing is allocated.
+	 */
+	char* p=uri;
+	char c;
+	int hi;
+	int lo;
+	int n=0;
+	int segmentStart;
+
+	/* absoluteURI, skip the scheme and host */
+	if (strncasecmp(p, "http://", 7)==0) {
+		p+=7+strcspn(p+7, "/?;#");
+		if (*p!='/') {
+			p="/";
+		}
+	}
+	if (*p!='/'||outSize<2) {
+		return(*p!='/'?URI_INVALID:URI_TOOLONG);
+	}
+	out[n++]='/';
+	segmentStart=n;
+	p++;
+
+	while (*p!='\0'&&*p!='?'&&*p!=';'&&*p!='#') {
+		c=*p++;
+		if (c=='%') {
+			hi=_hexValue(p[0]);
+			lo=(hi<0)?-1:_hexValue(p[1]);
+			if (lo<0||(hi==0&&lo==0)) {
+				return(URI_INVALID); // Malformed, or an embedded null byte
+			}
+			c=(char)(hi*16+lo);
+			p+=2;
+		}
+
+		if (c=='/') {
+			n=_endSegment(out, n, &segmentStart);
+			if (n<0) {
+				return(n);
+			}
+
+			/* Empty segments ("//") and the root are not written twice */
+			if (n>segmentStart||out[n-1]!='/') {
+				if (n>=outSize-1) {
+					return(URI_TOOLONG);
+				}
+				out[n++]='/';
+			}
+			segmentStart=n;
+			continue;
+		}
+		if (n>=outSize-1) {
+			return(URI_TOOLONG);
+		}
+		out[n++]=c;
+	}
+
+	/* Last segment, "." or ".." leave a directory path ending in '/' */
+	n=_endSegment(out, n, &segmentStart);
+	if (n<0) {
+		return(n);
+	}
+	out[n]='\0';
+	return(n);
+}
+
+
+int _endSegment(char* out, int n, int* segmentStart) {
+	/**
+	 * Resolve the segment out[*segmentStart, n) just completed.
+	 *
+	 * RETURN:
+	 * 	New output length: unchanged for a normal segment, the segment
+	 * 	dropped for ".", the segment and its parent dropped for "..".
+	 * 	URI_TRAVERSAL if ".." is applied at the root.
+	 */
+	int length=n-*segmentStart;
+	char* segment=out+*segmentStart;
+
+	if (length==1&&segment[0]=='.') {
+		return(*segmentStart);
+	}
+	if (length==2&&segment[0]=='.'&&segment[1]=='.') {
+		if (*segmentStart<=1) {
+			return(URI_TRAVERSAL);
+		}
+
+		/* Back over the parent segment to the slash before it */
+		n=*segmentStart-1;
+		while (n>0&&out[n-1]!='/') {
+			n--;
+		}
+		*segmentStart=n;
+		return(n);
+	}
+	return(n);
+}
+
+
+int _hexValue(char c) {
+	/* Value of hex digit <c>, -1 if it is not one */
+	if (c>='0'&&c<='9') {
+		return(c-'0');
+	} else if (c>='a'&&c<='f') {
+		return(c-'a'+10);
+	} else if (c>='A'&&c<='F') {
+		return(c-'A'+10);
+	}
+	return(-1);
+}
@@ -0,0 +1,18 @@
+/*
+ * Author: 			Ben Tomlin
+ * Student Id:		btomlin
+ * Student Nbr:		834198
+ * Date:			Oct 2026
+ */
+
+#ifndef HTTP_URIPATH_H_
+#define HTTP_URIPATH_H_
+
+/* canonicalizePath() failures, all negative */
+#define URI_INVALID   -1 // Not an absolute path, or a malformed %XX escape
+#define URI_TRAVERSAL -2 // A ".." segment would climb above the root
+#define URI_TOOLONG   -3 // Canonical path does not fit the output buffer
+
+int canonicalizePath(char* uri, char* out, int outSize);
+
+#endif /* HTTP_URIPATH_H_ */
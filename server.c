@@ -10,42 +10,74 @@
  * 	-> GET request response (404 | 200)
  * 	-> .html, .jpg, .css, .js (mime types)
  * 	-> Multiple requests with pthread
+ * 	-> Listening on IPv4, IPv6 & Unix domain sockets at once
  *
  * 	args:
- * 		./server port rootpath
+ * 		./server port rootpath [configfile]
  * 		path to root web
  * 		port
+ * 		optional configuration file, see config.c
  */
 
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <errno.h>
 #include <sys/socket.h>
+#include <poll.h>
+#include <signal.h>
 #include <pthread.h> /* -l pthread when compiling */
 #include <semaphore.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 
 #include "utility/bool.h"
 #include "server.h"
 #include "utility/tcpSocketIo.h"
+#include "utility/listener.h"
 #include "http/http.h"
 #include "utility/logger.h"
 #include "./utility/filesystem.h"
+#include "./utility/openFileCache.h"
+#include "./http/mimeTypes.h"
+#include "./http/responseCache.h"
+#include "./http/packFile.h"
+#include "./http/notFoundCache.h"
+#include "./utility/metrics.h"
+#include "./utility/probes.h"
+#include "./utility/deadline.h"
+#include "./utility/rateLimit.h"
+#include "./utility/tls.h"
+#include "./utility/diskIo.h"
+#include "config.h"
 
 
 #define SEMAPHORE_SHARE_THREADS 0 // As per man sem_init
 sem_t threadQuota; // This indicates how many more threads we can create
+int liveWorkers;	// Started and not yet exited, parked ones included
+int parkedWorkers;	// Waiting on the disk without a thread quota
+pthread_mutex_t workersLock=PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t workersDone=PTHREAD_COND_INITIALIZER; // liveWorkers fell to 0
+static size_t workerStack; // Stack size of worker threads [bytes]
+static volatile sig_atomic_t stopping; // SIGTERM or SIGINT received
 
 
 typedef struct docrootSocketPair {
 	int socket;    // socket fd connected to client
 	char* docroot; // null term string path to server root dir
+	long accepted; // metricsNow() when the connection was accepted
+	client_t* client; // Peer's rate limit entry, NULL if not limited
+	int tls;	   // Handshake TLS before reading the request
 } dsPair_t;
 
 
-void deployConcierge(int port, char* serverRoot);
+void deployConcierge(listener_t* listeners, char* serverRoot);
+listener_t* openListeners(int port);
+void startTls(listener_t* listeners);
 void printUsage();
+void startLogging();
 void validatePort(int port);
 void validateServerRoot(char* serverRoot);
 void stripTrailingSlash(char** path);
@@ -53,7 +85,12 @@ void stripTrailingChar(char** path,char c);
 dsPair_t* initDsPair(int socket, char* dRoot); // socket/rootPath pair
 void freeDsPair(dsPair_t* d);
 void waitForThreadAvailable();
+int parkThread();
+void unparkThread();
+void _workerStarted(int n);
 void* threadProcessRequest(void* dsPair);
+void onStop(int signal);
+void drainWorkers();
 
 dsPair_t* initDsPair(int socket, char* dRoot) {
 	dsPair_t *dsPair=malloc(sizeof(dsPair_t));
@@ -70,11 +107,45 @@ void freeDsPair(dsPair_t* d){
 int
 main(int argc, char* argv[]){
 
-	if (argc!=3) {
+	if (argc!=3&&argc!=4) {
 		printUsage();
 	}
 
+	/* Only the concierge takes SIGTERM and SIGINT, while it waits in ppoll(),
+	 * so they are blocked before any thread is started */
+	sigset_t stopSignals;
+	sigemptyset(&stopSignals);
+	sigaddset(&stopSignals, SIGTERM);
+	sigaddset(&stopSignals, SIGINT);
+	pthread_sigmask(SIG_BLOCK, &stopSignals, NULL);
+
+	initConfig();
+	if (argc==4) {
+		loadConfig(argv[3]);
+	}
+	/* First, the caches account their memory as they are set up */
+	initMetrics();
+	openFileCacheInit(serverConfig.openFileCache, serverConfig.openFileValid,
+			serverConfig.openFileInactive);
+	initMimeTypes(serverConfig.mimeTypes);
+	initResponseCache(serverConfig.responseCacheSize,
+			serverConfig.responseCacheMaxFile);
+	initPack(serverConfig.pack);
+	initNotFoundCache(serverConfig.notFoundCache,
+			serverConfig.notFoundCacheValid);
+	startLogging();
+	initDeadlines();
+	initRateLimit(serverConfig.limitConn, serverConfig.limitRate,
+			serverConfig.limitBurst, serverConfig.limitResponse);
+
+	/* A peer gone (or a connection shut down at its deadline) mid response
+	 * fails the send with EPIPE, rather than killing the process */
+	signal(SIGPIPE, SIG_IGN);
+	signal(SIGTERM, onStop);
+	signal(SIGINT, onStop);
+
 	sem_init(&threadQuota, SEMAPHORE_SHARE_THREADS, MAXTHREAD);
+	initDiskIo(serverConfig.diskThreads, parkThread, unparkThread);
 
 	/* Check server root valid, remove any trailing slash */
 	char* serverRoot = strdup(argv[2]);
@@ -84,8 +155,15 @@ main(int argc, char* argv[]){
 	int port = atoi(argv[1]);
 	validatePort(port);
 
-	mylog("Deploying concierge");
-	deployConcierge(port, serverRoot);
+	listener_t* listeners=openListeners(port);
+	startTls(listeners);
+	deployConcierge(listeners, serverRoot);
+
+	/* Stopped. The port's listener is ours, the rest the configuration's */
+	closeSocket(listeners->fd);
+	free(listeners);
+	free(serverRoot);
+	return(0);
 }
 
 void stripTrailingSlash(char** path){stripTrailingChar(path, '/');}
@@ -98,39 +176,176 @@ stripTrailingChar(char** path,char c) {
 	 * 	*path is null terminated
 	 */
 	int l = strlen(*path);
-	if ((*path)[l-1]==c){
+	if (l>0&&(*path)[l-1]==c){
 		(*path)[l-1]='\0';
-		*path = realloc(*path, l-1);
+		*path = realloc(*path, l); // l-1 characters and the null byte
+	}
+}
+
+listener_t*
+openListeners(int port) {
+	/**
+	 * Open a listener on every address at <port>, then each configured one.
+	 *
+	 * RETURN:
+	 * 	list of open listeners, the port's first
+	 */
+	char address[LISTEN_MAXADDRESS];
+	listener_t* l=initListener();
+	listener_t* configured;
+
+	snprintf(address, LISTEN_MAXADDRESS, "%d", port);
+	parseListenAddress(address, l);
+	l->next=serverConfig.listeners;
+	for (configured=l; configured!=NULL; configured=configured->next) {
+		openListener(configured);
+	}
+	return(l);
+}
+
+void
+startTls(listener_t* listeners) {
+	/* Load the certificate if any listener terminates TLS */
+	listener_t* l;
+	for (l=listeners; l!=NULL; l=l->next) {
+		if (l->tls) {
+			initTls(serverConfig.sslCertificate,
+					serverConfig.sslCertificateKey,
+					serverConfig.sslSessionCache,
+					serverConfig.sslSessionTimeout,
+					serverConfig.sslSessionTickets, serverConfig.sslKtls);
+			return;
+		}
 	}
 }
 
 void
-deployConcierge(int port, char* serverRoot){
+deployConcierge(listener_t* listeners, char* serverRoot){
 	/**
 	 * Deploy concierge to hand off all incoming connections to worker threads.
 	 *
-	 * RETURN:
-	 * 		integer file descriptor for soc
+	 * ARGUMENT:
+	 * 		listeners - open listeners, polled together for connections
 	 */
 
-	int socketFd=getListeningSocket(port);
+	listener_t* l;
+	struct pollfd* fds;
+	struct sockaddr_storage peer;
+	client_t* client=NULL;
+	int nListeners=0;
 	int workSocket;
 	pthread_t thread;
+	pthread_attr_t detached;
+	sigset_t waitMask;
+	long t;
+	int i;
+
+	/* Workers are never joined, their resources go when they exit */
+	pthread_attr_init(&detached);
+	pthread_attr_setdetachstate(&detached, PTHREAD_CREATE_DETACHED);
+	pthread_attr_getstacksize(&detached, &workerStack);
+	pthread_sigmask(SIG_BLOCK, NULL, &waitMask);
+	sigdelset(&waitMask, SIGTERM);
+	sigdelset(&waitMask, SIGINT);
+
+	for (l=listeners; l!=NULL; l=l->next) {
+		nListeners++;
+	}
+	fds=calloc(nListeners, sizeof(struct pollfd));
+	for (l=listeners, i=0; l!=NULL; l=l->next, i++) {
+		fds[i].fd=l->fd;
+		fds[i].events=POLLIN;
+	}
 
 	/* Recieve requests and hand them off to worker threads. */
-	while(true) {
+	while(!stopping) {
+
+		/* Wait for connections on any listener */
+		t=metricsNow();
+		if (ppoll(fds, nListeners, NULL, &waitMask)<=0) {
+			continue;
+		}
+
+		/* Accept one connection from each ready listener in turn */
+		for (l=listeners, i=0; l!=NULL; l=l->next, i++) {
+			if (!(fds[i].revents&POLLIN)
+					||(workSocket=acceptConnection(l, &peer))<0) {
+				continue;
+			}
+			t=metricsRecord(STAGE_ACCEPT, t);
+			PROBE_CONNECTION_ACCEPT(workSocket);
+
+			/* Turn away clients over their limits before taking a thread.
+			 * A TLS client could not read a plain 429, it is just closed */
+			if (rateLimitEnabled()
+					&&rateLimitAdmit(&peer, &client)!=LIMIT_OK) {
+				if (l->tls) {
+					closeSocket(workSocket);
+				} else {
+					rateLimitReject(workSocket);
+				}
+				metricsCount(COUNT_LIMITED, 1);
+				continue;
+			}
+			metricsConnectionOpened();
+			dsPair_t* d=initDsPair(workSocket, serverRoot);
+			d->accepted=t;
+			d->client=client;
+			d->tls=l->tls;
+
+			/* Block until there are we are below the thread limit*/
+			waitForThreadAvailable();
+			metricsRecord(STAGE_QUEUE, t);
+
+			/* The thread cleanup handler will close the socket & free the
+			 * dsPair*/
+			_workerStarted(1);
+			if (pthread_create(&thread, &detached, threadProcessRequest,
+					(void*)d)!=0) {
+				_workerStarted(-1);
+				logWarn("Could not start a worker thread");
+				freeDsPair(d);
+				free(d);
+				closeSocket(workSocket);
+				rateLimitRelease(client);
+				metricsConnectionClosed();
+				sem_post(&threadQuota);
+				continue;
+			}
+			metricsAllocated(MEM_THREAD, workerStack);
+		}
+	}
 
-		/* Accept connection */
-		workSocket = accept(socketFd, NULL, NULL);
-		dsPair_t* d=initDsPair(workSocket, serverRoot);
+	pthread_attr_destroy(&detached);
+	free(fds);
+	drainWorkers();
+}
 
-		/* Block until there are we are below the thread limit*/
-		waitForThreadAvailable();
+void onStop(int signal) {
+	/* Stop accepting connections, see deployConcierge() */
+	stopping=true;
+}
 
-		/* The thread cleanup handler will close the socket & free the dsPair*/
-		pthread_create(&thread, NULL, threadProcessRequest, (void*)d);
+void drainWorkers() {
+	/* Wait for the connections being served to finish, within their
+	 * deadlines. Workers parked on the disk hold no thread quota, so they are
+	 * counted rather than the quota taken */
+	logInfo("Stopping, waiting for open connections");
+	pthread_mutex_lock(&workersLock);
+	while (liveWorkers>0) {
+		pthread_cond_wait(&workersDone, &workersLock);
 	}
+	pthread_mutex_unlock(&workersLock);
+}
 
+void _workerStarted(int n) {
+	/* Count <n> workers started, or exited if negative */
+	pthread_mutex_lock(&workersLock);
+	liveWorkers+=n;
+	if (liveWorkers==0) {
+		pthread_cond_broadcast(&workersDone);
+	}
+	pthread_mutex_unlock(&workersLock);
 }
 
 void waitForThreadAvailable() {
@@ -140,6 +355,37 @@ void waitForThreadAvailable() {
 	return;
 }
 
+int parkThread() {
+	/**
+	 * Give up the calling worker's thread quota while it waits on the disk,
+	 * so the concierge may start another. At most MAXPARKED workers are
+	 * parked, so at most MAXTHREAD+MAXPARKED worker threads are alive.
+	 *
+	 * RETURN:
+	 * 	false if MAXPARKED workers already are; the caller keeps its quota
+	 */
+	int parked=false;
+
+	pthread_mutex_lock(&workersLock);
+	if (parkedWorkers<MAXPARKED) {
+		parkedWorkers++;
+		parked=true;
+	}
+	pthread_mutex_unlock(&workersLock);
+	if (parked) {
+		sem_post(&threadQuota);
+	}
+	return(parked);
+}
+
+void unparkThread() {
+	/* Take back the thread quota given up by parkThread() */
+	waitForThreadAvailable();
+	pthread_mutex_lock(&workersLock);
+	parkedWorkers--;
+	pthread_mutex_unlock(&workersLock);
+}
+
 void* threadProcessRequest(void* dsPair) {
 	/**
 	 * Handle a single http request as a separate thread.
@@ -157,17 +403,37 @@ void* threadProcessRequest(void* dsPair) {
 	dsPair_t* pathSocket=(dsPair_t*)dsPair;
 	int socketFd=pathSocket->socket;
 	char* docRoot=pathSocket->docroot;
-
-	/* Process & reply to http request */
-	processRequest(socketFd, docRoot);
+	long accepted=pathSocket->accepted;
+	client_t* client=pathSocket->client;
+	int tls=pathSocket->tls;
+
+	/* Process & reply to http request, within the configured deadlines.
+	 * The TLS handshake has the idle timeout */
+	deadlineBegin(socketFd);
+	deadlineArm(serverConfig.idleTimeout, false);
+	if (!tls||tlsAccept(socketFd)) {
+		processRequest(socketFd, docRoot);
+	}
+	tlsEnd();
+	if (deadlineEnd()) {
+		logDebug("Connection %d timed out", socketFd);
+		metricsCount(COUNT_TIMEOUTS, 1);
+	}
 
 	/* Close up the socket and free argument structure */
+	flushFdBuffer();
 	freeDsPair((dsPair_t*)dsPair);
 	free(dsPair);
+	PROBE_CONNECTION_CLOSE(socketFd);
 	closeSocket(socketFd);
+	rateLimitRelease(client);
+	metricsRecord(STAGE_CONNECTION, accepted);
+	metricsConnectionClosed();
 
 	/* Increment the available number of threads*/
+	metricsFreed(MEM_THREAD, workerStack);
 	sem_post(&threadQuota);
+	_workerStarted(-1);
 	pthread_exit(NULL);
 }
 
@@ -178,11 +444,33 @@ void validatePort(int port) {
 	 * Print usage and exit if invalid
 	 */
 	if (!(port>1023) || !(port<=65535)) {
-		mylog("Given port outside valid range [1024, 65535]");
+		logError("Given port outside valid range [1024, 65535]");
 		printUsage();
 	}
 }
 
+void startLogging() {
+	/**
+	 * Apply the configured log level and hand logging to the background
+	 * writer, appending to the configured log file if there is one. Opens
+	 * the access log if one is configured.
+	 */
+	int fd=STDOUT_FILENO;
+	setLogLevel(serverConfig.logLevel);
+	if (serverConfig.logFile!=NULL) {
+		fd=open(serverConfig.logFile, O_WRONLY|O_APPEND|O_CREAT, 0644);
+		if (fd<0) {
+			logError("Could not open log file %s", serverConfig.logFile);
+			exit(ELOGFILE);
+		}
+	}
+	initLogger(fd);
+
+	if (serverConfig.accessLog!=NULL) {
+		initAccessLog(serverConfig.accessLog, serverConfig.accessLogFormat);
+	}
+}
+
 void
 validateServerRoot(char* serverRoot){
 	/*Check the server root exists and the server process has read and
@@ -197,10 +485,11 @@ void printUsage(){
 	 * Print usage instructions and terminate with a usage error code.
 	 */
 	fprintf(stdout, "\nUSAGE:\n");
-	fprintf(stdout, "./serverExecutable serverPort documentRoot\n");
+	fprintf(stdout, "./serverExecutable serverPort documentRoot [configFile]\n");
 	fprintf(stdout, "\n");
 	fprintf(stdout, "serverPort: Port to listen on. int in [1024, 65535] \n");
 	fprintf(stdout, "documentRoot: Path so server's document root. Must");
-	fprintf(stdout, " exist and be writable\n\n");
+	fprintf(stdout, " exist and be writable\n");
+	fprintf(stdout, "configFile: Optional directives file, see config.c\n\n");
 	exit(EUSAGE);
 }
@@ -11,11 +11,13 @@
 #define RECVBUFFER_SIZE  4096
 #define MAX_READATTEMPT  5				// Max consecutive read failures allowed
 #define MAXTHREAD 8
+#define MAXPARKED 24	// Workers waiting on the disk, over MAXTHREAD
 
 #define EUSAGE 		  5
 #define EEOF	      13 // At end of file, cant read any line
 #define EREGCOMP	  23
 #define EHEADINVALID  27 // Header was invalid
 #define EPATH_INVALID 29
+#define ELOGFILE	  33 // Log file could not be opened
 
 #endif
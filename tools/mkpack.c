@@ -0,0 +1,291 @@
+/* Docroot packer
+ * Author: 			Ben Tomlin
+ * Student Id:		btomlin
+ * Student Nbr:		834198
+ * Date:			Oct 2026
+ *
+ * Build a pack file (see http/packFile.h) of every regular file under a
+ * document root, for the server to map and serve with the pack directive.
+ *
+ * Each file is an entry under its URI path, with its MIME type and a hash of
+ * its content as ETag. Fresh .gz and .br siblings (run precompress first)
+ * are also recorded as the precompressed variants of the original, sharing
+ * the sibling's content rather than storing it twice.
+ *
+ * The pack is written beside <packFile>, synced, then renamed over it, so a
+ * server serving <packFile> only ever sees a whole pack and switches to the
+ * new one on its next check.
+ *
+ * 	args:
+ * 		./mkpack documentRoot packFile [mimeTypes]
+ */
+
+#define _XOPEN_SOURCE 700
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ftw.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "../http/packFile.h"
+#include "../http/mimeTypes.h"
+#include "../utility/hash.h"
+#include "../utility/bool.h"
+
+#define EUSAGE 		 5
+#define EWALK		 7
+#define EWRITE		 9
+#define MAX_OPEN_FD	 32 // nftw directory descriptor limit
+#define PACK_ALIGN	 8	// Content offsets are aligned to this
+
+typedef struct packFile {	// A file found under the document root
+	char* path;				// Absolute path on disk
+	char* uri;				// Path below the document root, from '/'
+	struct stat st;
+	packEntry_t entry;
+} packFile_t;
+
+static packFile_t* files;
+static int nFiles;
+static int capacity;
+static int rootLength;
+
+int _collect(const char* path, const struct stat* s, int type, struct FTW* f);
+int _compareUri(const void* a, const void* b);
+packFile_t* _findFile(char* uri);
+void _linkVariants();
+int _copyContent(int out, packFile_t* file, uint64_t offset);
+void _writeAt(int fd, void* bytes, size_t length, uint64_t offset);
+uint64_t _align(uint64_t offset);
+void printUsage();
+
+
+int
+main(int argc, char* argv[]) {
+	packHeader_t header;
+	packEntry_t* index;
+	packEntry_t* e;
+	uint64_t offset;
+	uint32_t slot;
+	char* tmpPath;
+	char* mime;
+	int fd;
+	int i;
+
+	if (argc<3||argc>4) {
+		printUsage();
+	}
+	initMimeTypes(argc==4?argv[3]:MIME_TYPES_PATH);
+
+	rootLength=strlen(argv[1]);
+	while (rootLength>1&&argv[1][rootLength-1]=='/') {
+		argv[1][--rootLength]='\0';
+	}
+	if (nftw(argv[1], _collect, MAX_OPEN_FD, FTW_PHYS)!=0) {
+		fprintf(stderr, "Could not walk document root %s\n", argv[1]);
+		exit(EWALK);
+	}
+
+	/* Sorted, so the same document root always packs to the same bytes */
+	qsort(files, nFiles, sizeof(packFile_t), _compareUri);
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, PACK_MAGIC, sizeof(header.magic));
+	header.version=PACK_VERSION;
+	header.nEntries=nFiles;
+	for (header.nSlots=16; header.nSlots<nFiles*2; header.nSlots*=2);
+	index=calloc(header.nSlots, sizeof(packEntry_t));
+
+	tmpPath=malloc(strlen(argv[2])+5);
+	sprintf(tmpPath, "%s.tmp", argv[2]);
+	fd=open(tmpPath, O_WRONLY|O_CREAT|O_TRUNC, 0644);
+	if (fd<0) {
+		perror(tmpPath);
+		exit(EWRITE);
+	}
+
+	/* Paths and MIME types after the index, then the content */
+	offset=sizeof(packHeader_t)+(uint64_t)header.nSlots*sizeof(packEntry_t);
+	for (i=0; i<nFiles; i++) {
+		e=&files[i].entry;
+		mime=lookupMimeType(files[i].uri);
+		e->path.offset=offset;
+		e->path.length=strlen(files[i].uri);
+		_writeAt(fd, files[i].uri, e->path.length, offset);
+		offset+=e->path.length;
+		e->mime.offset=offset;
+		e->mime.length=strlen(mime);
+		_writeAt(fd, mime, e->mime.length, offset);
+		offset+=e->mime.length;
+	}
+	for (i=0; i<nFiles; i++) {
+		offset=_align(offset);
+		if (!_copyContent(fd, &files[i], offset)) {
+			exit(EWRITE);
+		}
+		offset+=files[i].entry.content.length;
+	}
+	header.size=offset;
+
+	_linkVariants();
+
+	/* Linear probing, as packLookup() searches */
+	for (i=0; i<nFiles; i++) {
+		e=&files[i].entry;
+		slot=e->hash&(header.nSlots-1);
+		while (index[slot].hash!=0) {
+			slot=(slot+1)&(header.nSlots-1);
+		}
+		index[slot]=*e;
+	}
+	_writeAt(fd, index, (size_t)header.nSlots*sizeof(packEntry_t),
+			sizeof(packHeader_t));
+	_writeAt(fd, &header, sizeof(header), 0);
+
+	if (ftruncate(fd, header.size)!=0||fsync(fd)!=0||close(fd)!=0
+			||rename(tmpPath, argv[2])!=0) {
+		perror(argv[2]);
+		unlink(tmpPath);
+		exit(EWRITE);
+	}
+
+	fprintf(stdout, "%d files, %lu bytes packed into %s\n", nFiles,
+			(unsigned long)header.size, argv[2]);
+
+	for (i=0; i<nFiles; i++) {
+		free(files[i].path);
+	}
+	free(files);
+	free(index);
+	free(tmpPath);
+	return(0);
+}
+
+
+int _collect(const char* path, const struct stat* s, int type, struct FTW* f) {
+	/* nftw() callback, add regular files to the list */
+	packFile_t* file;
+
+	if (type!=FTW_F||!S_ISREG(s->st_mode)) {
+		return(0);
+	}
+	if (nFiles==capacity) {
+		capacity=(capacity==0)?64:capacity*2;
+		files=realloc(files, sizeof(packFile_t)*capacity);
+	}
+	file=&files[nFiles++];
+	memset(file, 0, sizeof(packFile_t));
+	file->path=strdup(path);
+	file->uri=file->path+rootLength;
+	file->st=*s;
+	return(0);
+}
+
+
+int _compareUri(const void* a, const void* b) {
+	return(strcmp(((packFile_t*)a)->uri, ((packFile_t*)b)->uri));
+}
+
+
+packFile_t* _findFile(char* uri) {
+	/* File packed under <uri>, NULL if none. Files are sorted by uri */
+	packFile_t key;
+	key.uri=uri;
+	return(bsearch(&key, files, nFiles, sizeof(packFile_t), _compareUri));
+}
+
+
+void _linkVariants() {
+	/**
+	 * Record fresh .gz and .br siblings of each file as its precompressed
+	 * variants. A sibling older than the original is left out, as the server
+	 * does with siblings on disk.
+	 */
+	static char* suffixes[PACK_VARIANTS]={".gz", ".br"};
+	packFile_t* sibling;
+	char* uri;
+	int i;
+	int v;
+
+	for (i=0; i<nFiles; i++) {
+		uri=malloc(strlen(files[i].uri)+4);
+		for (v=0; v<PACK_VARIANTS; v++) {
+			sprintf(uri, "%s%s", files[i].uri, suffixes[v]);
+			sibling=_findFile(uri);
+			if (sibling!=NULL&&sibling->st.st_mtime>=files[i].st.st_mtime) {
+				files[i].entry.variants[v]=sibling->entry.content;
+			}
+		}
+		free(uri);
+	}
+}
+
+
+int _copyContent(int out, packFile_t* file, uint64_t offset) {
+	/**
+	 * Copy the content of <file> into the pack at <offset>, and complete its
+	 * entry with the content blob, hashes and mtime.
+	 *
+	 * RETURN:
+	 * 	false if the file could not be read
+	 */
+	packEntry_t* e=&file->entry;
+	int fd=open(file->path, O_RDONLY);
+	char* content=NULL;
+
+	if (fd<0) {
+		perror(file->path);
+		return(false);
+	}
+	if (file->st.st_size>0) {
+		content=mmap(NULL, file->st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (content==MAP_FAILED) {
+			perror(file->path);
+			close(fd);
+			return(false);
+		}
+		_writeAt(out, content, file->st.st_size, offset);
+	}
+	close(fd);
+
+	e->hash=hashBytes(file->uri, strlen(file->uri));
+	e->hash=e->hash!=0?e->hash:1;
+	e->content.offset=offset;
+	e->content.length=file->st.st_size;
+	e->etag=hashBytes(content, file->st.st_size);
+	e->mtime=file->st.st_mtime;
+	if (content!=NULL) {
+		munmap(content, file->st.st_size);
+	}
+	return(true);
+}
+
+
+void _writeAt(int fd, void* bytes, size_t length, uint64_t offset) {
+	/* Write all of <bytes> at <offset> of <fd>, terminating on failure */
+	ssize_t n;
+	while (length>0) {
+		n=pwrite(fd, bytes, length, offset);
+		if (n<=0) {
+			perror("Could not write pack");
+			exit(EWRITE);
+		}
+		bytes=(char*)bytes+n;
+		length-=n;
+		offset+=n;
+	}
+}
+
+
+uint64_t _align(uint64_t offset) {
+	return((offset+PACK_ALIGN-1)&~(uint64_t)(PACK_ALIGN-1));
+}
+
+
+void printUsage() {
+	fprintf(stderr, "Usage: ./mkpack documentRoot packFile [mimeTypes]\n");
+	exit(EUSAGE);
+}
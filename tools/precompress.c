@@ -0,0 +1,340 @@
+/* Docroot precompressor
+ * Author: 			Ben Tomlin
+ * Student Id:		btomlin
+ * Student Nbr:		834198
+ * Date:			Oct 2026
+ *
+ * Write gzip (.gz) and brotli (.br) siblings next to every compressible file
+ * under a document root, so the server can serve them without compressing
+ * per request. Files are compressed in parallel, one worker thread per core.
+ *
+ * Siblings are only (re)written when missing or older than the original, and
+ * only kept if they are smaller than the original.
+ *
+ * 	args:
+ * 		./precompress documentRoot [threads]
+ */
+
+#define _XOPEN_SOURCE 700
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ftw.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <zlib.h>
+#include <brotli/encode.h>
+
+#include "../utility/bool.h"
+
+#define EUSAGE 		 5
+#define EWALK		 7
+#define MAX_OPEN_FD	 32 // nftw directory descriptor limit
+#define GZIP_WINDOW	 (15+16) // zlib windowBits, +16 selects a gzip wrapper
+#define GZIP_MEMLEVEL 9
+
+static char* compressibleExtensions[] = {
+	".html", ".htm", ".css", ".js", ".mjs", ".json", ".svg", ".xml", ".txt",
+	".map", ".wasm", ".ico", ".csv", ".md", NULL
+};
+
+typedef struct fileList {
+	char** paths;
+	int count;
+	int capacity;
+	int next; // Index of the next file a worker should take
+	pthread_mutex_t lock;
+} fileList_t;
+
+typedef struct compressStats {
+	long filesWritten;
+	long bytesIn;
+	long bytesOut;
+} compressStats_t;
+
+static fileList_t files;
+static compressStats_t stats;
+static pthread_mutex_t statsLock=PTHREAD_MUTEX_INITIALIZER;
+
+int _isCompressible(const char* path);
+int _collect(const char* path, const struct stat* s, int type, struct FTW* f);
+char* _nextFile();
+void* _compressWorker(void* unused);
+void _compressFile(char* path);
+int _isStale(char* sibling, struct stat* original);
+char* _readFile(char* path, long size);
+void _writeSibling(char* path, char* suffix, struct stat* original,
+		unsigned char* data, size_t length);
+size_t _gzip(char* in, size_t inLength, unsigned char** out);
+size_t _brotli(char* in, size_t inLength, unsigned char** out);
+void printUsage();
+
+
+int
+main(int argc, char* argv[]) {
+	int nThreads=sysconf(_SC_NPROCESSORS_ONLN);
+	pthread_t* threads;
+	int i;
+
+	if (argc<2||argc>3) {
+		printUsage();
+	}
+	if (argc==3) {
+		nThreads=atoi(argv[2]);
+	}
+	if (nThreads<1) {
+		nThreads=1;
+	}
+
+	/* Gather the work up front so the workers just pull from a list */
+	pthread_mutex_init(&files.lock, NULL);
+	if (nftw(argv[1], _collect, MAX_OPEN_FD, FTW_PHYS)!=0) {
+		fprintf(stderr, "Could not walk document root %s\n", argv[1]);
+		exit(EWALK);
+	}
+
+	threads=malloc(sizeof(pthread_t)*nThreads);
+	for (i=0; i<nThreads; i++) {
+		pthread_create(&threads[i], NULL, _compressWorker, NULL);
+	}
+	for (i=0; i<nThreads; i++) {
+		pthread_join(threads[i], NULL);
+	}
+
+	fprintf(stdout, "%d candidate files, %ld siblings written, %ld -> %ld bytes"
+			" (%d threads)\n", files.count, stats.filesWritten, stats.bytesIn,
+			stats.bytesOut, nThreads);
+
+	for (i=0; i<files.count; i++) {
+		free(files.paths[i]);
+	}
+	free(files.paths);
+	free(threads);
+	return(0);
+}
+
+
+int _isCompressible(const char* path) {
+	/* True if <path> has an extension worth compressing */
+	const char* extension=strrchr(path, '.');
+	int i;
+
+	if (extension==NULL||strchr(extension, '/')!=NULL) {
+		return(false);
+	}
+	for (i=0; compressibleExtensions[i]!=NULL; i++) {
+		if (strcasecmp(extension, compressibleExtensions[i])==0) {
+			return(true);
+		}
+	}
+	return(false);
+}
+
+
+int _collect(const char* path, const struct stat* s, int type, struct FTW* f) {
+	/* nftw() callback, add regular compressible files to the work list */
+	if (type!=FTW_F||!S_ISREG(s->st_mode)||!_isCompressible(path)) {
+		return(0);
+	}
+	if (files.count==files.capacity) {
+		files.capacity=(files.capacity==0)?64:files.capacity*2;
+		files.paths=realloc(files.paths, sizeof(char*)*files.capacity);
+	}
+	files.paths[files.count++]=strdup(path);
+	return(0);
+}
+
+
+char* _nextFile() {
+	/* Take the next file off the work list, NULL once it is exhausted */
+	char* path=NULL;
+	pthread_mutex_lock(&files.lock);
+	if (files.next<files.count) {
+		path=files.paths[files.next++];
+	}
+	pthread_mutex_unlock(&files.lock);
+	return(path);
+}
+
+
+void* _compressWorker(void* unused) {
+	char* path;
+	while ((path=_nextFile())!=NULL) {
+		_compressFile(path);
+	}
+	return(NULL);
+}
+
+
+void _compressFile(char* path) {
+	/**
+	 * Write out of date .gz and .br siblings of <path>
+	 */
+	struct stat original;
+	unsigned char* compressed;
+	size_t length;
+	char* gzPath;
+	char* brPath;
+	char* content;
+
+	if (stat(path, &original)!=0) {
+		return;
+	}
+
+	gzPath=malloc(strlen(path)+4);
+	brPath=malloc(strlen(path)+4);
+	sprintf(gzPath, "%s.gz", path);
+	sprintf(brPath, "%s.br", path);
+
+	if (!_isStale(gzPath, &original)&&!_isStale(brPath, &original)) {
+		free(gzPath);
+		free(brPath);
+		return;
+	}
+
+	content=_readFile(path, original.st_size);
+	if (content==NULL) {
+		fprintf(stderr, "Could not read %s\n", path);
+		free(gzPath);
+		free(brPath);
+		return;
+	}
+
+	if (_isStale(gzPath, &original)) {
+		length=_gzip(content, original.st_size, &compressed);
+		_writeSibling(path, ".gz", &original, compressed, length);
+		free(compressed);
+	}
+	if (_isStale(brPath, &original)) {
+		length=_brotli(content, original.st_size, &compressed);
+		_writeSibling(path, ".br", &original, compressed, length);
+		free(compressed);
+	}
+
+	free(content);
+	free(gzPath);
+	free(brPath);
+}
+
+
+int _isStale(char* sibling, struct stat* original) {
+	/* True if <sibling> is missing or older than the original file */
+	struct stat s;
+	if (stat(sibling, &s)!=0) {
+		return(true);
+	}
+	return(s.st_mtime<original->st_mtime);
+}
+
+
+char* _readFile(char* path, long size) {
+	/* Read the whole of <path>, returning an allocated buffer or NULL */
+	FILE* f=fopen(path, "rb");
+	char* content;
+
+	if (f==NULL) {
+		return(NULL);
+	}
+	content=malloc(size>0?size:1);
+	if (size>0&&fread(content, size, 1, f)!=1) {
+		free(content);
+		content=NULL;
+	}
+	fclose(f);
+	return(content);
+}
+
+
+void _writeSibling(char* path, char* suffix, struct stat* original,
+		unsigned char* data, size_t length) {
+	/**
+	 * Write <data> to <path><suffix> by way of a temporary file, so the
+	 * server never sees a partially written sibling.
+	 *
+	 * Compression that does not make the file smaller is discarded.
+	 */
+	char* target;
+	char* temporary;
+	FILE* f;
+
+	if (length==0||length>=original->st_size) {
+		return;
+	}
+
+	target=malloc(strlen(path)+strlen(suffix)+1);
+	temporary=malloc(strlen(path)+strlen(suffix)+5);
+	sprintf(target, "%s%s", path, suffix);
+	sprintf(temporary, "%s.tmp", target);
+
+	f=fopen(temporary, "wb");
+	if (f==NULL||fwrite(data, length, 1, f)!=1) {
+		fprintf(stderr, "Could not write %s\n", temporary);
+		if (f!=NULL) {
+			fclose(f);
+			unlink(temporary);
+		}
+	} else {
+		fclose(f);
+		rename(temporary, target);
+
+		pthread_mutex_lock(&statsLock);
+		stats.filesWritten++;
+		stats.bytesIn+=original->st_size;
+		stats.bytesOut+=length;
+		pthread_mutex_unlock(&statsLock);
+	}
+	free(target);
+	free(temporary);
+}
+
+
+size_t _gzip(char* in, size_t inLength, unsigned char** out) {
+	/* Gzip <in> at maximum compression into allocated *out, return length */
+	z_stream z;
+	size_t bound;
+	size_t length=0;
+
+	memset(&z, 0, sizeof(z));
+	if (deflateInit2(&z, Z_BEST_COMPRESSION, Z_DEFLATED, GZIP_WINDOW,
+			GZIP_MEMLEVEL, Z_DEFAULT_STRATEGY)!=Z_OK) {
+		*out=NULL;
+		return(0);
+	}
+	bound=deflateBound(&z, inLength);
+	*out=malloc(bound);
+	z.next_in=(unsigned char*)in;
+	z.avail_in=inLength;
+	z.next_out=*out;
+	z.avail_out=bound;
+	if (deflate(&z, Z_FINISH)==Z_STREAM_END) {
+		length=z.total_out;
+	}
+	deflateEnd(&z);
+	return(length);
+}
+
+
+size_t _brotli(char* in, size_t inLength, unsigned char** out) {
+	/* Brotli <in> at maximum quality into allocated *out, return length */
+	size_t length=BrotliEncoderMaxCompressedSize(inLength);
+	*out=malloc(length>0?length:1);
+	if (length==0||!BrotliEncoderCompress(BROTLI_MAX_QUALITY,
+			BROTLI_DEFAULT_WINDOW, BROTLI_MODE_GENERIC, inLength,
+			(unsigned char*)in, &length, *out)) {
+		return(0);
+	}
+	return(length);
+}
+
+
+void printUsage() {
+	fprintf(stdout, "\nUSAGE:\n");
+	fprintf(stdout, "./precompress documentRoot [threads]\n");
+	fprintf(stdout, "\n");
+	fprintf(stdout, "documentRoot: Directory to precompress recursively\n");
+	fprintf(stdout, "threads: Compression threads, defaults to the number of");
+	fprintf(stdout, " online cores\n\n");
+	exit(EUSAGE);
+}
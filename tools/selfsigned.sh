@@ -0,0 +1,34 @@
+#!/bin/sh
+# Self signed certificate for trying ssl listeners locally
+# Author: 			Ben Tomlin
+# Student Id:		btomlin
+# Student Nbr:		834198
+# Date:			Oct 2026
+#
+# Writes <directory>/server.pem (certificate) and <directory>/server.key, valid
+# for localhost, 127.0.0.1 and ::1, then prints the directives to use them.
+#
+# 	args:
+# 		./tools/selfsigned.sh [directory]
+
+set -e
+dir=${1:-.}
+mkdir -p "$dir"
+
+openssl req -x509 -newkey ec -pkeyopt ec_paramgen_curve:prime256v1 -nodes \
+	-days 30 -subj "/CN=localhost" \
+	-addext "subjectAltName=DNS:localhost,IP:127.0.0.1,IP:::1" \
+	-keyout "$dir/server.key" -out "$dir/server.pem" 2>/dev/null
+
+cat <<EOF
+Wrote $dir/server.pem and $dir/server.key. In the configuration file;
+
+	listen 127.0.0.1:8443 ssl
+	ssl_certificate $dir/server.pem
+	ssl_certificate_key $dir/server.key
+
+then check with
+
+	curl --cacert $dir/server.pem https://localhost:8443/
+	openssl s_client -connect 127.0.0.1:8443 -reconnect </dev/null | grep Reused
+EOF
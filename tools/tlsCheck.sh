@@ -0,0 +1,118 @@
+#!/bin/sh
+# TLS listener check
+# Author: 			Ben Tomlin
+# Student Id:		btomlin
+# Student Nbr:		834198
+# Date:			Oct 2026
+#
+# Generates a certificate with selfsigned.sh, starts the server with an ssl
+# listener, and fails if any of these do not hold, once with session tickets
+# and once with only the session cache:
+#
+# 	- a full handshake verifies against the certificate and serves a file
+# 	- a second handshake with the first's session is resumed, for TLS 1.3
+# 	  and TLS 1.2
+# 	- a file larger than SENDFILE_CHUNK comes back byte for byte
+#
+# Then stops the server with SIGTERM and fails if it does not exit cleanly;
+#
+# 	make && ./tools/tlsCheck.sh
+#
+# 	args:
+# 		./tools/tlsCheck.sh [-p port]
+# 	-p port for plain http, the ssl listener is on port + 1
+
+PORT=${TLS_CHECK_PORT:-18180}
+LARGE_BYTES=1048583	# Over 4 SENDFILE_CHUNKs, not a multiple of one
+
+while getopts "p:" option; do
+	case $option in
+		p) PORT=$OPTARG ;;
+		*) exit 5 ;;
+	esac
+done
+shift $((OPTIND - 1))
+if [ $# -ne 0 ] || [ ! -x ./server ]; then
+	echo "USAGE: $0 [-p port] (from the directory holding ./server)" >&2
+	exit 5
+fi
+SSL_PORT=$((PORT + 1))
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+"$(dirname "$0")/selfsigned.sh" "$WORK" > /dev/null 2>&1 || {
+	echo "Could not generate a certificate" >&2
+	exit 5
+}
+mkdir "$WORK/root"
+echo "tls check" > "$WORK/root/index.html"
+head -c "$LARGE_BYTES" /dev/urandom > "$WORK/root/large.bin"
+
+failed=0
+
+# fail message - record a failed check
+fail() {
+	echo "$TICKETS: $1" >&2
+	failed=1
+}
+
+# handshake version sessionArgs... - GET /index.html, print New or Reused
+handshake() {
+	version=$1
+	shift
+	printf 'GET /index.html HTTP/1.0\r\n\r\n' | openssl s_client "$version" \
+		-connect "127.0.0.1:$SSL_PORT" -servername localhost \
+		-CAfile "$WORK/server.pem" -verify_return_error -ign_eof "$@" \
+		2> /dev/null \
+		| awk '/^(New|Reused),/ { sub(",", "", $1); session = $1 }
+			/^tls check$/ { body = 1 }
+			END { print (body ? session : "NoBody") }'
+}
+
+for TICKETS in on off; do
+	cat > "$WORK/tls.conf" <<EOF
+listen 127.0.0.1:$SSL_PORT ssl
+ssl_certificate $WORK/server.pem
+ssl_certificate_key $WORK/server.key
+ssl_session_tickets $TICKETS
+log_level error
+EOF
+	./server "$PORT" "$WORK/root" "$WORK/tls.conf" > "$WORK/server.log" 2>&1 &
+	SERVER=$!
+	sleep 1
+
+	if ! curl -sf --cacert "$WORK/server.pem" \
+			"https://localhost:$SSL_PORT/index.html" > "$WORK/index.html" \
+			|| ! cmp -s "$WORK/index.html" "$WORK/root/index.html"; then
+		fail "full handshake failed"
+	fi
+
+	for version in -tls1_3 -tls1_2; do
+		result=$(handshake "$version" -sess_out "$WORK/session")
+		if [ "$result" != "New" ]; then
+			fail "$version full handshake gave $result"
+			continue
+		fi
+		result=$(handshake "$version" -sess_in "$WORK/session")
+		if [ "$result" != "Reused" ]; then
+			fail "$version session not resumed, gave $result"
+		fi
+	done
+
+	if ! curl -sf --cacert "$WORK/server.pem" \
+			"https://localhost:$SSL_PORT/large.bin" > "$WORK/large.bin" \
+			|| ! cmp "$WORK/large.bin" "$WORK/root/large.bin"; then
+		fail "large file differs"
+	fi
+
+	kill -TERM "$SERVER"
+	wait "$SERVER"
+	status=$?
+	if [ "$status" -ne 0 ]; then
+		fail "server exited with $status:"
+		tail -40 "$WORK/server.log" >&2
+	fi
+	[ "$failed" -eq 0 ] && echo "Session tickets $TICKETS: handshake," \
+		"resumption and large file ok"
+done
+exit "$failed"
@@ -30,7 +30,7 @@ void bsAppend(byteString_t *b, void* byteChain, int length) {
 	if(b==NULL) {return;}
 	int newLength=length+b->length;
 	b->string=realloc(b->string,newLength);
-	bcopy(byteChain, b->string, length);
+	bcopy(byteChain, b->string+b->length, length);
 	b->length=newLength;
 }
 
@@ -59,6 +59,8 @@ void bsShrink(byteString_t *b, int size) {
 
 
 void bsDestruct(void* b) {
+	/* Free <b> and its string, unlike bsFree() which keeps the structure */
 	byteString_t* bs=b;
 	bsFree(bs);
+	free(bs);
 }
@@ -0,0 +1,317 @@
+/*
+ * Author: 			Ben Tomlin
+ * Student Id:		btomlin
+ * Student Nbr:		834198
+ * Date:			Oct 2026
+ *
+ * Connection deadlines on a hierarchical timer wheel.
+ *
+ * Each worker thread has one deadline for the connection it is serving,
+ * armed for the phase it is in (waiting for the request, reading headers,
+ * sending) with deadlineArm(). A phase is either a fixed
+ * budget, or renewed on every read or write that makes progress, so a slow
+ * but moving transfer is not cut off while a stalled one is.
+ *
+ * A deadline is kept in one slot of one of DEADLINE_LEVELS wheels, the level
+ * chosen by how far off it is; level 0 slots are single ticks, each higher
+ * level's slots span a whole turn of the level below. Arming and cancelling
+ * are O(1) list operations. A timer thread advances the wheel every tick,
+ * cascading a higher level's slot down as the level below wraps, and shuts
+ * down the socket of every deadline in the current level 0 slot. The worker
+ * blocked on that socket then sees end of file or EPIPE and unwinds.
+ *
+ * Until initDeadlines() (ie in benchmarks) every call is a no op.
+ */
+
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/socket.h>
+
+#include "deadline.h"
+#include "bool.h"
+#include "logger.h"
+
+static deadline_t* wheel[DEADLINE_LEVELS][DEADLINE_SLOTS];
+static atomic_ulong now;	// Ticks since initDeadlines()
+static int running=false;
+static pthread_t ticker;
+static pthread_key_t threadDeadline;
+static pthread_mutex_t wheelLock=PTHREAD_MUTEX_INITIALIZER;
+
+deadline_t* _getDeadline();
+void _releaseDeadline(void* d);
+void _link(deadline_t* d);
+void _unlink(deadline_t* d);
+void _cascade(int level);
+void _expireSlot(int slot);
+void* _ticker(void* unused);
+
+
+void initDeadlines() {
+	/* Start the timer thread, deadlines are enforced from then on */
+	pthread_key_create(&threadDeadline, _releaseDeadline);
+	running=true;
+	pthread_create(&ticker, NULL, _ticker, NULL);
+}
+
+
+void deadlineBegin(int fd) {
+	/* The calling thread is serving connection <fd>, with no deadline yet */
+	deadline_t* d=_getDeadline();
+	if (d!=NULL) {
+		d->fd=fd;
+		d->expired=false;
+	}
+}
+
+
+void deadlineArm(int seconds, int renew) {
+	/**
+	 * (Re)arm the calling thread's connection deadline <seconds> from now,
+	 * replacing any deadline already set.
+	 *
+	 * ARGUMENT:
+	 * 	seconds - 0 leaves the connection without a deadline
+	 * 	renew - push the deadline back on each deadlineProgress()
+	 */
+	deadline_t* d=_getDeadline();
+
+	if (d==NULL||d->fd<0||d->expired) {
+		return;
+	}
+	pthread_mutex_lock(&wheelLock);
+	_unlink(d);
+	d->renewSeconds=renew?seconds:0;
+	if (seconds>0) {
+		d->expires=atomic_load(&now)+seconds*1000L/DEADLINE_TICK_MS;
+		_link(d);
+	}
+	pthread_mutex_unlock(&wheelLock);
+}
+
+
+void deadlineProgress() {
+	/**
+	 * A read or write on the calling thread's connection made progress. Push
+	 * a renewable deadline back, taking the lock at most once a tick.
+	 */
+	deadline_t* d;
+	unsigned long expires;
+
+	if (!running||(d=pthread_getspecific(threadDeadline))==NULL
+			||d->renewSeconds==0) {
+		return;
+	}
+	expires=atomic_load(&now)+d->renewSeconds*1000L/DEADLINE_TICK_MS;
+	if (expires==d->expires) {
+		return;
+	}
+	pthread_mutex_lock(&wheelLock);
+	if (d->armed) {
+		_unlink(d);
+		d->expires=expires;
+		_link(d);
+	}
+	pthread_mutex_unlock(&wheelLock);
+}
+
+
+int deadlineEnd() {
+	/**
+	 * The calling thread is done with its connection, cancel its deadline.
+	 * Must be called before the socket is closed, so the timer thread never
+	 * shuts down a reused descriptor.
+	 *
+	 * RETURN:
+	 * 	true if the connection was shut down for missing its deadline
+	 */
+	deadline_t* d;
+	int expired;
+
+	if (!running||(d=pthread_getspecific(threadDeadline))==NULL) {
+		return(false);
+	}
+	pthread_mutex_lock(&wheelLock);
+	_unlink(d);
+	expired=d->expired;
+	d->fd=-1;
+	d->renewSeconds=0;
+	pthread_mutex_unlock(&wheelLock);
+	return(expired);
+}
+
+
+deadline_t* _getDeadline() {
+	/* Calling thread's deadline, created on first use. NULL if not running */
+	deadline_t* d;
+
+	if (!running) {
+		return(NULL);
+	}
+	d=pthread_getspecific(threadDeadline);
+	if (d==NULL) {
+		d=calloc(1, sizeof(deadline_t));
+		d->fd=-1;
+		pthread_setspecific(threadDeadline, d);
+	}
+	return(d);
+}
+
+
+void _releaseDeadline(void* d) {
+	/* Thread exit */
+	pthread_mutex_lock(&wheelLock);
+	_unlink(d);
+	pthread_mutex_unlock(&wheelLock);
+	free(d);
+}
+
+
+void _link(deadline_t* d) {
+	/**
+	 * Insert <d> in the slot for its expiry, on the lowest level whose turn
+	 * reaches it. Call with wheelLock held.
+	 */
+	unsigned long current=atomic_load(&now);
+	unsigned long delta;
+	deadline_t** slot;
+	int level;
+
+	if (d->expires<=current) {
+		d->expires=current+1;
+	}
+	delta=d->expires-current;
+	for (level=0; level<DEADLINE_LEVELS-1; level++) {
+		if (delta<1UL<<(DEADLINE_BITS*(level+1))) {
+			break;
+		}
+	}
+	if (delta>=1UL<<(DEADLINE_BITS*DEADLINE_LEVELS)) {
+		d->expires=current+(1UL<<(DEADLINE_BITS*DEADLINE_LEVELS))-1;
+	}
+	slot=&wheel[level][(d->expires>>(DEADLINE_BITS*level))
+			&(DEADLINE_SLOTS-1)];
+
+	d->prev=NULL;
+	d->next=*slot;
+	if (*slot!=NULL) {
+		(*slot)->prev=d;
+	}
+	*slot=d;
+	d->armed=true;
+}
+
+
+void _unlink(deadline_t* d) {
+	/* Remove <d> from the wheel if it is in it. Call with wheelLock held */
+	int level;
+	deadline_t** slot;
+
+	if (!d->armed) {
+		return;
+	}
+	if (d->prev!=NULL) {
+		d->prev->next=d->next;
+	} else {
+		/* Head of its slot, find which */
+		for (level=0; level<DEADLINE_LEVELS; level++) {
+			slot=&wheel[level][(d->expires>>(DEADLINE_BITS*level))
+					&(DEADLINE_SLOTS-1)];
+			if (*slot==d) {
+				*slot=d->next;
+				break;
+			}
+		}
+	}
+	if (d->next!=NULL) {
+		d->next->prev=d->prev;
+	}
+	d->prev=NULL;
+	d->next=NULL;
+	d->armed=false;
+}
+
+
+void _cascade(int level) {
+	/* Re-link the current slot of <level>, its deadlines are now nearer */
+	unsigned long current=atomic_load(&now);
+	int index=(current>>(DEADLINE_BITS*level))&(DEADLINE_SLOTS-1);
+	deadline_t* d=wheel[level][index];
+	deadline_t* next;
+
+	wheel[level][index]=NULL;
+	for (; d!=NULL; d=next) {
+		next=d->next;
+		d->armed=false;
+		_link(d);
+	}
+}
+
+
+void _expireSlot(int slot) {
+	/* Shut down the connection of every deadline in level 0 <slot> */
+	deadline_t* d=wheel[0][slot];
+	deadline_t* next;
+
+	wheel[0][slot]=NULL;
+	for (; d!=NULL; d=next) {
+		next=d->next;
+		d->prev=NULL;
+		d->next=NULL;
+		d->armed=false;
+		d->expired=true;
+		shutdown(d->fd, SHUT_RDWR);
+	}
+}
+
+
+void* _ticker(void* unused) {
+	/**
+	 * Timer thread. Advance the wheel a tick at a time up to the monotonic
+	 * clock, so a late wake up catches up rather than drifting.
+	 */
+	struct timespec start;
+	struct timespec wake;
+	struct timespec t;
+	unsigned long target;
+	unsigned long current;
+	int level;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	wake=start;
+	while (true) {
+		wake.tv_nsec+=DEADLINE_TICK_MS*1000000L;
+		if (wake.tv_nsec>=1000000000L) {
+			wake.tv_sec++;
+			wake.tv_nsec-=1000000000L;
+		}
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake, NULL);
+
+		clock_gettime(CLOCK_MONOTONIC, &t);
+		target=((t.tv_sec-start.tv_sec)*1000L
+				+(t.tv_nsec-start.tv_nsec)/1000000L)/DEADLINE_TICK_MS;
+
+		pthread_mutex_lock(&wheelLock);
+		while ((current=atomic_load(&now))<target) {
+			atomic_store(&now, ++current);
+
+			/* Cascade each level whose lower neighbour just wrapped */
+			for (level=1; level<DEADLINE_LEVELS; level++) {
+				if ((current&((1UL<<(DEADLINE_BITS*level))-1))!=0) {
+					break;
+				}
+				_cascade(level);
+			}
+			_expireSlot(current&(DEADLINE_SLOTS-1));
+		}
+		pthread_mutex_unlock(&wheelLock);
+
+		/* Slept through a clock jump or stall, resume from now */
+		if (wake.tv_sec<t.tv_sec-1) {
+			wake=t;
+		}
+	}
+	return(NULL);
+}
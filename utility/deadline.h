@@ -0,0 +1,34 @@
+/*
+ * Author: 			Ben Tomlin
+ * Student Id:		btomlin
+ * Student Nbr:		834198
+ * Date:			Oct 2026
+ */
+
+#ifndef UTILITY_DEADLINE_H_
+#define UTILITY_DEADLINE_H_
+
+#define DEADLINE_TICK_MS  100	// Wheel resolution
+#define DEADLINE_BITS	  6		// 64 slots per level
+#define DEADLINE_SLOTS	  (1<<DEADLINE_BITS)
+#define DEADLINE_LEVELS	  4		// Deadlines up to 64^4 ticks (~19 days)
+
+typedef struct deadline deadline_t;
+
+struct deadline {			// A worker thread's connection deadline
+	int fd;					// Connection shut down on expiry, -1 if none
+	unsigned long expires;	// Wheel tick of expiry
+	int renewSeconds;		// Pushed back this far on progress, 0 if fixed
+	int armed;				// Linked into the wheel
+	int expired;			// The connection has been shut down
+	deadline_t* prev;
+	deadline_t* next;
+};
+
+void initDeadlines();
+void deadlineBegin(int fd);
+void deadlineArm(int seconds, int renew);
+void deadlineProgress();
+int deadlineEnd();
+
+#endif /* UTILITY_DEADLINE_H_ */
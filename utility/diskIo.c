@@ -0,0 +1,234 @@
+/*
+ * Author: 			Ben Tomlin
+ * Student Id:		btomlin
+ * Student Nbr:		834198
+ * Date:			Oct 2026
+ *
+ * Disk reads of files not in the page cache, off the network workers.
+ *
+ * Before a worker sends a range of a file it checks that the range is
+ * resident, with a non blocking read (preadv2() with RWF_NOWAIT) of its first
+ * and last byte, or mincore() over a mapping where the kernel or filesystem
+ * does not support that. A resident range is sent straight away. A cold one
+ * is queued for one of a few disk threads, which read it into the page cache,
+ * and the worker gives up its place in the thread quota until they have; so
+ * connections waiting on the disk do not hold the threads hot requests need,
+ * and no more reads are in flight than there are disk threads. Each check
+ * also hints the kernel to read the following range ahead.
+ *
+ * Until initDiskIo() (ie in benchmarks), or with no disk threads, every
+ * range is taken as resident.
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+
+#include "diskIo.h"
+#include "bool.h"
+#include "logger.h"
+#include "metrics.h"
+#include "deadline.h"
+
+static int nThreads;
+static int noWait=true;		// preadv2() supports RWF_NOWAIT
+static int (*parkWorker)();
+static void (*unparkWorker)();
+static diskJob_t* head;
+static diskJob_t* tail;
+static pthread_mutex_t queueLock=PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t queued=PTHREAD_COND_INITIALIZER;
+static pthread_cond_t finished=PTHREAD_COND_INITIALIZER;
+
+int _diskResident(int fd, off_t offset, long length);
+int _diskResidentMapped(int fd, off_t offset, long length);
+void* _diskThread(void* unused);
+void _diskRead(diskJob_t* job);
+
+
+void initDiskIo(int threads, int (*park)(), void (*unpark)()) {
+	/**
+	 * Start <threads> disk threads.
+	 *
+	 * ARGUMENT:
+	 * 	park - called by a worker before it waits on the disk, to give up its
+	 * 	thread quota. Returns false if it kept it
+	 * 	unpark - called by the worker once its range is read, to take it back,
+	 * 	if park gave it up
+	 */
+	pthread_t thread;
+	int i;
+
+	parkWorker=park;
+	unparkWorker=unpark;
+	for (i=0; i<threads; i++) {
+		if (pthread_create(&thread, NULL, _diskThread, NULL)!=0) {
+			logWarn("Could not start disk thread %d", i);
+			break;
+		}
+		pthread_detach(thread);
+		nThreads++;
+	}
+}
+
+
+void diskEnsureResident(int fd, off_t offset, long length) {
+	/**
+	 * Return once <length> bytes of file <fd> from <offset> are in the page
+	 * cache, having the disk threads read them if they are not.
+	 *
+	 * NOTE:
+	 * 	Only the ends of the range are checked, pages between are taken to
+	 * 	have come in with them by readahead
+	 */
+	diskJob_t job;
+	long t;
+	int parked;
+
+	if (nThreads==0||length<=0) {
+		return;
+	}
+	posix_fadvise(fd, offset+length, length, POSIX_FADV_WILLNEED);
+	if (_diskResident(fd, offset, length)) {
+		return;
+	}
+
+	metricsCount(COUNT_DISK_COLD, 1);
+	t=metricsNow();
+	job.fd=fd;
+	job.offset=offset;
+	job.length=length;
+	job.done=false;
+	job.next=NULL;
+
+	parked=parkWorker();
+	pthread_mutex_lock(&queueLock);
+	if (tail==NULL) {
+		head=&job;
+	} else {
+		tail->next=&job;
+	}
+	tail=&job;
+	pthread_cond_signal(&queued);
+	while (!job.done) {
+		pthread_cond_wait(&finished, &queueLock);
+	}
+	pthread_mutex_unlock(&queueLock);
+	if (parked) {
+		unparkWorker();
+	}
+
+	deadlineProgress();
+	metricsRecord(STAGE_DISK, t);
+}
+
+
+int _diskResident(int fd, off_t offset, long length) {
+	/* True unless the first or last byte of the range is not cached */
+	off_t probes[2]={offset, offset+length-1};
+	char byte;
+	struct iovec v={&byte, 1};
+	int i;
+
+	if (!noWait) {
+		return(_diskResidentMapped(fd, offset, length));
+	}
+	for (i=0; i<2; i++) {
+		if (preadv2(fd, &v, 1, probes[i], RWF_NOWAIT)>=0) {
+			continue;
+		}
+		if (errno==EAGAIN) {
+			return(false);
+		}
+		if (errno==EOPNOTSUPP||errno==ENOSYS||errno==EINVAL) {
+			logInfo("RWF_NOWAIT not supported, checking residency with "
+					"mincore()");
+			noWait=false;
+			return(_diskResidentMapped(fd, offset, length));
+		}
+	}
+	return(true);
+}
+
+
+int _diskResidentMapped(int fd, off_t offset, long length) {
+	/* True if every page of the range is cached, by mincore() */
+	long page=sysconf(_SC_PAGESIZE);
+	off_t start=offset-offset%page;
+	long span=length+(offset-start);
+	long nPages=(span+page-1)/page;
+	unsigned char* vector;
+	void* map;
+	int resident=true;
+	long i;
+
+	map=mmap(NULL, span, PROT_READ, MAP_SHARED, fd, start);
+	if (map==MAP_FAILED) {
+		return(true);	// Not mappable, so not known to be cold
+	}
+	vector=malloc(nPages);
+	if (mincore(map, span, vector)==0) {
+		for (i=0; i<nPages&&resident; i++) {
+			resident=vector[i]&1;
+		}
+	}
+	free(vector);
+	munmap(map, span);
+	return(resident);
+}
+
+
+void* _diskThread(void* unused) {
+	/* Read queued ranges, oldest first */
+	diskJob_t* job;
+
+	while (true) {
+		pthread_mutex_lock(&queueLock);
+		while (head==NULL) {
+			pthread_cond_wait(&queued, &queueLock);
+		}
+		job=head;
+		head=job->next;
+		if (head==NULL) {
+			tail=NULL;
+		}
+		pthread_mutex_unlock(&queueLock);
+
+		_diskRead(job);
+
+		pthread_mutex_lock(&queueLock);
+		job->done=true;
+		pthread_cond_broadcast(&finished);
+		pthread_mutex_unlock(&queueLock);
+	}
+	return(NULL);
+}
+
+
+void _diskRead(diskJob_t* job) {
+	/**
+	 * Bring the job's range into the page cache. The whole range is asked
+	 * for at once so the kernel can issue large reads, then read through to
+	 * wait for it.
+	 */
+	char buffer[DISK_READ_BUFFER];
+	long done=0;
+	ssize_t n;
+
+	posix_fadvise(job->fd, job->offset, job->length, POSIX_FADV_WILLNEED);
+	while (done<job->length) {
+		n=pread(job->fd, buffer, job->length-done<DISK_READ_BUFFER?
+				job->length-done:DISK_READ_BUFFER, job->offset+done);
+		if (n<0&&errno==EINTR) {
+			continue;
+		} else if (n<=0) {
+			break;	// The worker's own read reports the error
+		}
+		done+=n;
+	}
+}
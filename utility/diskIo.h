@@ -0,0 +1,28 @@
+/*
+ * Author: 			Ben Tomlin
+ * Student Id:		btomlin
+ * Student Nbr:		834198
+ * Date:			Oct 2026
+ */
+
+#ifndef UTILITY_DISKIO_H_
+#define UTILITY_DISKIO_H_
+
+#include <sys/types.h>
+
+#define DISK_READ_BUFFER (64*1024)	// Read at a time by a disk thread
+
+typedef struct diskJob diskJob_t;
+
+struct diskJob {			// A range of a file to bring into the page cache
+	int fd;
+	off_t offset;
+	long length;
+	int done;
+	diskJob_t* next;
+};
+
+void initDiskIo(int threads, int (*park)(), void (*unpark)());
+void diskEnsureResident(int fd, off_t offset, long length);
+
+#endif /* UTILITY_DISKIO_H_ */
@@ -25,24 +25,23 @@ int testFile(char* path, int tests) {
 	 * NOTE:
 	 *	 Requires #include <unistd.h>
 	 */
-	mylog("Checking access for path: ");
-	mylog(path);
+	logDebug("Checking access for path: %s", path);
 	int e = access(path, tests);
 	if(e==0){
 		return(true);
 	} else {
 		switch(errno) {
 		case EACCES:
-			mylog("No read permissions or list permissions on parent.");
+			logError("No read permissions or list permissions on parent.");
 			break;
 		case ENOENT:
-			mylog("The given file path does not exist on the file system");
+			logError("The given file path does not exist on the file system");
 			break;
 		case EROFS:
-			mylog("The given file is read only");
+			logError("The given file is read only");
 			break;
 		default:
-			mylog("There is a problem with the given path");
+			logError("There is a problem with the given path");
 		}
 		return(FALSE);
 	}
@@ -61,10 +60,10 @@ long getBinaryFileSize(FILE *f) {
 }
 
 void handleFileOpenError() {
-	mylog("Failed to open file");
+	logWarn("Failed to open file");
 }
 
 void handleFileReadError(){
-	mylog("An error occured when reading a file");
+	logWarn("An error occured when reading a file");
 }
 
@@ -8,6 +8,7 @@
 #ifndef UTILITY_FILESYSTEM_H_
 #define UTILITY_FILESYSTEM_H_
 
+#include <stdio.h> //getBinaryFileSize() argument
 #include <unistd.h> //testFile() arguments
 #include "bool.h" //testFile() return values
 
@@ -0,0 +1,38 @@
+/*
+ * Author: 			Ben Tomlin
+ * Student Id:		btomlin
+ * Student Nbr:		834198
+ * Date:			Oct 2026
+ */
+
+#include "hash.h"
+
+
+unsigned long hashBytes(const void* bytes, size_t length) {
+	/* 64 bit FNV-1a hash of <length> bytes */
+	const unsigned char* b=bytes;
+	unsigned long h=FNV_OFFSET;
+	size_t i;
+	for (i=0; i<length; i++) {
+		h^=b[i];
+		h*=FNV_PRIME;
+	}
+	return(h);
+}
+
+
+unsigned long hashString(const char* s) {
+	/* 64 bit FNV-1a hash of a null terminated string */
+	unsigned long h=FNV_OFFSET;
+	for (; *s!='\0'; s++) {
+		h^=(unsigned char)*s;
+		h*=FNV_PRIME;
+	}
+	return(h);
+}
+
+
+unsigned long hashCombine(unsigned long h, unsigned long value) {
+	/* Mix <value> into hash <h>, ie a file mtime into a path hash */
+	return(hashBytes(&value, sizeof(value))^(h*FNV_PRIME));
+}
@@ -0,0 +1,20 @@
+/*
+ * Author: 			Ben Tomlin
+ * Student Id:		btomlin
+ * Student Nbr:		834198
+ * Date:			Oct 2026
+ */
+
+#ifndef UTILITY_HASH_H_
+#define UTILITY_HASH_H_
+
+#include <stddef.h>
+
+#define FNV_OFFSET 14695981039346656037UL
+#define FNV_PRIME  1099511628211UL
+
+unsigned long hashBytes(const void* bytes, size_t length);
+unsigned long hashString(const char* s);
+unsigned long hashCombine(unsigned long h, unsigned long value);
+
+#endif /* UTILITY_HASH_H_ */
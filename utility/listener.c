@@ -0,0 +1,267 @@
+/*
+ * Author: 			Ben Tomlin
+ * Student Id:		btomlin
+ * Student Nbr:		834198
+ * Date:			Oct 2026
+ *
+ * Listening sockets. Each listener is bound to one of;
+ *
+ * 	8080					every address, IPv6 dual stack where available
+ * 	*:8080, 127.0.0.1:8080	IPv4
+ * 	[::]:8080, [::1]:8080	IPv6, dual stack unless ipv6Only is set
+ * 	unix:/run/server.sock	Unix domain socket, a stale socket file is replaced
+ *
+ * and carries its own backlog and socket options. Listeners are non blocking,
+ * so the concierge can poll() them all and accept() only those ready.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include "listener.h"
+#include "bool.h"
+#include "logger.h"
+
+int _parsePort(char* s);
+void _setOption(listener_t* l, int level, int option, int value, char* name);
+void _removeStaleSocket(char* path);
+
+
+listener_t* initListener() {
+	/* Listener with default options and no address */
+	listener_t* l=calloc(1, sizeof(listener_t));
+	l->backlog=LISTEN_BACKLOG;
+	l->fd=-1;
+	return(l);
+}
+
+
+int parseListenAddress(char* address, listener_t* l) {
+	/**
+	 * Resolve <address> (see the top of this file) into <l>'s socket address.
+	 *
+	 * RETURN:
+	 * 	false if the address is malformed
+	 */
+	struct sockaddr_in* in=(struct sockaddr_in*)&l->sockAddr;
+	struct sockaddr_in6* in6=(struct sockaddr_in6*)&l->sockAddr;
+	struct sockaddr_un* un=(struct sockaddr_un*)&l->sockAddr;
+	char host[LISTEN_MAXADDRESS];
+	char* colon;
+	char* bracket;
+	int port;
+
+	if (strlen(address)>=LISTEN_MAXADDRESS) {
+		return(false);
+	}
+	strcpy(l->address, address);
+	memset(&l->sockAddr, 0, sizeof(l->sockAddr));
+	l->wildcard=false;
+
+	/* Unix domain socket path */
+	if (strncmp(address, UNIX_PREFIX, strlen(UNIX_PREFIX))==0) {
+		address+=strlen(UNIX_PREFIX);
+		if (*address=='\0'||strlen(address)>=sizeof(un->sun_path)) {
+			return(false);
+		}
+		un->sun_family=AF_UNIX;
+		strcpy(un->sun_path, address);
+		l->sockAddrLength=sizeof(struct sockaddr_un);
+		return(true);
+	}
+
+	/* Bare port, every address */
+	if (strchr(address, ':')==NULL) {
+		if ((port=_parsePort(address))<0) {
+			return(false);
+		}
+		in6->sin6_family=AF_INET6;
+		in6->sin6_addr=in6addr_any;
+		in6->sin6_port=htons(port);
+		l->sockAddrLength=sizeof(struct sockaddr_in6);
+		l->wildcard=true;
+		return(true);
+	}
+
+	/* [IPv6]:port */
+	if (*address=='[') {
+		bracket=strchr(address, ']');
+		if (bracket==NULL||bracket[1]!=':'||(port=_parsePort(bracket+2))<0) {
+			return(false);
+		}
+		memcpy(host, address+1, bracket-address-1);
+		host[bracket-address-1]='\0';
+		if (inet_pton(AF_INET6, host, &in6->sin6_addr)!=1) {
+			return(false);
+		}
+		in6->sin6_family=AF_INET6;
+		in6->sin6_port=htons(port);
+		l->sockAddrLength=sizeof(struct sockaddr_in6);
+		return(true);
+	}
+
+	/* IPv4:port, * for every address */
+	colon=strrchr(address, ':');
+	if ((port=_parsePort(colon+1))<0) {
+		return(false);
+	}
+	memcpy(host, address, colon-address);
+	host[colon-address]='\0';
+	if (strcmp(host, "*")==0) {
+		in->sin_addr.s_addr=htonl(INADDR_ANY);
+	} else if (inet_pton(AF_INET, host, &in->sin_addr)!=1) {
+		return(false);
+	}
+	in->sin_family=AF_INET;
+	in->sin_port=htons(port);
+	l->sockAddrLength=sizeof(struct sockaddr_in);
+	return(true);
+}
+
+
+void openListener(listener_t* l) {
+	/**
+	 * Create, bind and listen on <l>'s socket with its options. Options the
+	 * kernel refuses are warned about and skipped.
+	 *
+	 * Terminates with EBINDFAILED or ELISTEN if the socket cannot be bound
+	 * or listened on
+	 */
+	int family=l->sockAddr.ss_family;
+	struct sockaddr_in any;
+
+	l->fd=socket(family, SOCK_STREAM, 0);
+	if (l->fd<0&&l->wildcard&&errno==EAFNOSUPPORT) {
+		/* No IPv6 in this kernel, a bare port falls back to IPv4 */
+		memset(&any, 0, sizeof(any));
+		any.sin_family=AF_INET;
+		any.sin_addr.s_addr=htonl(INADDR_ANY);
+		any.sin_port=((struct sockaddr_in6*)&l->sockAddr)->sin6_port;
+		memcpy(&l->sockAddr, &any, sizeof(any));
+		l->sockAddrLength=sizeof(any);
+		family=AF_INET;
+		l->fd=socket(family, SOCK_STREAM, 0);
+	}
+	if (l->fd<0) {
+		logError("Could not create socket for %s: %s", l->address,
+				strerror(errno));
+		exit(EBINDFAILED);
+	}
+
+	if (family==AF_UNIX) {
+		_removeStaleSocket(((struct sockaddr_un*)&l->sockAddr)->sun_path);
+	} else {
+		_setOption(l, SOL_SOCKET, SO_REUSEADDR, 1, "SO_REUSEADDR");
+		if (family==AF_INET6) {
+			_setOption(l, IPPROTO_IPV6, IPV6_V6ONLY, l->ipv6Only,
+					"IPV6_V6ONLY");
+		}
+	}
+
+	/* Buffer sizes are inherited by accepted sockets, and the window scale
+	 * is fixed at the handshake, so they must be set before listening */
+	if (l->sendBuffer>0) {
+		_setOption(l, SOL_SOCKET, SO_SNDBUF, l->sendBuffer, "SO_SNDBUF");
+	}
+	if (l->receiveBuffer>0) {
+		_setOption(l, SOL_SOCKET, SO_RCVBUF, l->receiveBuffer, "SO_RCVBUF");
+	}
+
+	if (bind(l->fd, (struct sockaddr*)&l->sockAddr, l->sockAddrLength)!=0) {
+		logError("Could not bind %s: %s", l->address, strerror(errno));
+		exit(EBINDFAILED);
+	}
+
+	if (family!=AF_UNIX) {
+		if (l->noDelay) {
+			_setOption(l, IPPROTO_TCP, TCP_NODELAY, 1, "TCP_NODELAY");
+		}
+		if (l->deferAccept>0) {
+			_setOption(l, IPPROTO_TCP, TCP_DEFER_ACCEPT, l->deferAccept,
+					"TCP_DEFER_ACCEPT");
+		}
+		if (l->fastOpen>0) {
+			_setOption(l, IPPROTO_TCP, TCP_FASTOPEN, l->fastOpen,
+					"TCP_FASTOPEN");
+		}
+	}
+
+	if (listen(l->fd, l->backlog)!=0) {
+		logError("Could not listen on %s: %s", l->address, strerror(errno));
+		exit(ELISTEN);
+	}
+	fcntl(l->fd, F_SETFL, fcntl(l->fd, F_GETFL)|O_NONBLOCK);
+	logInfo("Listening on %s%s, backlog %d", l->address, l->tls?" (ssl)":"",
+			l->backlog);
+}
+
+
+int acceptConnection(listener_t* l, struct sockaddr_storage* peer) {
+	/**
+	 * Accept a pending connection on <l>, writing the client's address into
+	 * <peer>. The accepted socket is blocking whatever the listener is.
+	 *
+	 * RETURN:
+	 * 	socket fd, -1 if none was pending or the client already went away
+	 */
+	socklen_t length=sizeof(struct sockaddr_storage);
+	int socketFd=accept(l->fd, (struct sockaddr*)peer, &length);
+	if (socketFd<0&&errno!=EAGAIN&&errno!=EWOULDBLOCK&&errno!=ECONNABORTED
+			&&errno!=EINTR) {
+		logWarn("Could not accept on %s: %s", l->address, strerror(errno));
+	}
+	return(socketFd);
+}
+
+
+int _parsePort(char* s) {
+	/* Port in [1, 65535], -1 if <s> is not one */
+	char* end;
+	long port=strtol(s, &end, 10);
+	if (end==s||*end!='\0'||port<1||port>65535) {
+		return(-1);
+	}
+	return(port);
+}
+
+
+void _setOption(listener_t* l, int level, int option, int value, char* name) {
+	if (setsockopt(l->fd, level, option, &value, sizeof(value))!=0) {
+		logWarn("Could not set %s on %s: %s", name, l->address,
+				strerror(errno));
+	}
+}
+
+
+void _removeStaleSocket(char* path) {
+	/**
+	 * Unlink a socket file left by an earlier run. Nothing else is removed;
+	 * not other files, nor a socket something still accepts on, so the
+	 * bind() fails for those instead.
+	 */
+	struct sockaddr_un address;
+	struct stat st;
+	int probe;
+
+	if (lstat(path, &st)!=0||!S_ISSOCK(st.st_mode)) {
+		return;
+	}
+	memset(&address, 0, sizeof(address));
+	address.sun_family=AF_UNIX;
+	strcpy(address.sun_path, path);
+	probe=socket(AF_UNIX, SOCK_STREAM, 0);
+	if (connect(probe, (struct sockaddr*)&address, sizeof(address))!=0
+			&&errno==ECONNREFUSED) {
+		unlink(path);
+	}
+	close(probe);
+}
@@ -0,0 +1,44 @@
+/*
+ * Author: 			Ben Tomlin
+ * Student Id:		btomlin
+ * Student Nbr:		834198
+ * Date:			Oct 2026
+ */
+
+#ifndef UTILITY_LISTENER_H_
+#define UTILITY_LISTENER_H_
+
+#include <sys/socket.h>
+
+#define LISTEN_BACKLOG	  511	 // Default listen() backlog
+#define LISTEN_MAXADDRESS 128	 // Longest address as written in the config
+#define UNIX_PREFIX		  "unix:" // Address prefix of a Unix domain socket path
+
+#define EBINDFAILED		  7
+#define ELISTEN			  11
+
+typedef struct listener listener_t;
+
+struct listener {		// A listening socket and the options it was opened with
+	char address[LISTEN_MAXADDRESS];	// As configured, for messages
+	struct sockaddr_storage sockAddr;
+	socklen_t sockAddrLength;
+	int wildcard;		// [::] given as a bare port, IPv4 only if no IPv6
+	int ipv6Only;		// IPV6_V6ONLY, otherwise IPv6 listeners are dual stack
+	int backlog;
+	int noDelay;		// TCP_NODELAY, inherited by accepted sockets
+	int deferAccept;	// TCP_DEFER_ACCEPT [seconds], 0 off
+	int fastOpen;		// TCP_FASTOPEN queue length, 0 off
+	int sendBuffer;		// SO_SNDBUF [bytes], 0 system default
+	int receiveBuffer;	// SO_RCVBUF [bytes], 0 system default
+	int tls;			// Connections handshake TLS before the request
+	int fd;				// -1 until opened
+	listener_t* next;
+};
+
+listener_t* initListener();
+int parseListenAddress(char* address, listener_t* l);
+void openListener(listener_t* l);
+int acceptConnection(listener_t* l, struct sockaddr_storage* peer);
+
+#endif /* UTILITY_LISTENER_H_ */
@@ -3,11 +3,299 @@
  * Student Id:		btomlin
  * Student Nbr:		834198
  * Date:			Apr 2018
+ *
+ * Levelled, asynchronous logging.
+ *
+ * Each thread that logs claims one of LOG_RINGS single producer, single
+ * consumer ring buffers and appends records to it without locking. A
+ * background writer drains all rings and writes the formatted records in
+ * large batches, so request threads never contend on or block in a write to
+ * the terminal. A full ring drops the record (counted and reported) rather
+ * than stall the request. Before initLogger(), and for threads that find no
+ * free ring, records are written in line.
+ *
+ * SIGUSR1 makes logging one level more verbose, SIGUSR2 one level less, so
+ * debug records can be turned on in a running server and off again.
  */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdarg.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <time.h>
 
-void
-mylog(char* m) {
-	printf("%s\n",m);
+#include "logger.h"
+#include "bool.h"
+
+typedef struct logRecord {
+	struct timespec time;
+	int level;
+	int length;
+	char text[LOG_MAXLINE];
+} logRecord_t;
+
+typedef struct logRing {
+	atomic_int owned;		// Claimed by a live thread
+	atomic_uint head;		// Next slot the producer writes
+	atomic_uint tail;		// Next slot the writer reads
+	atomic_ulong dropped;	// Records lost to a full ring
+	logRecord_t slots[LOG_RING_SLOTS];
+} logRing_t;
+
+volatile int logLevel=LOG_INFO;
+
+static char* levelNames[]={"ERROR", "WARN", "INFO", "DEBUG"};
+static logRing_t rings[LOG_RINGS];
+static int logFd=STDOUT_FILENO;
+static int running=false;
+static pthread_t writer;
+static pthread_key_t threadRing;
+static pthread_once_t keyOnce=PTHREAD_ONCE_INIT;
+static pthread_mutex_t drainLock=PTHREAD_MUTEX_INITIALIZER;
+static volatile sig_atomic_t levelChanged; // By signal, the writer reports it
+
+void _createKey();
+void _onLevelSignal(int signal);
+void _releaseRing(void* ring);
+logRing_t* _getRing();
+int _formatRecord(logRecord_t* r, char* out, int outSize);
+int _batchRecord(logRecord_t* r, char* batch, int used);
+void _writeAll(char* bytes, int length);
+int _drainRings();
+void* _logWriter(void* unused);
+
+
+void initLogger(int fd) {
+	/**
+	 * Start the background writer, logging to <fd> from then on. Records
+	 * still queued when the process exits are flushed by an atexit handler.
+	 */
+	struct sigaction level;
+
+	logFd=fd;
+	pthread_once(&keyOnce, _createKey);
+	running=true;
+	atexit(flushLog);
+
+	memset(&level, 0, sizeof(level));
+	level.sa_handler=_onLevelSignal;
+	level.sa_flags=SA_RESTART;
+	sigaction(SIGUSR1, &level, NULL);
+	sigaction(SIGUSR2, &level, NULL);
+	pthread_create(&writer, NULL, _logWriter, NULL);
+}
+
+
+void setLogLevel(int level) {
+	/* Change the most verbose level logged, takes effect immediately */
+	logLevel=level;
+}
+
+
+void _onLevelSignal(int signal) {
+	/* Step the level, SIGUSR1 towards debug, SIGUSR2 towards error */
+	if (signal==SIGUSR1&&logLevel<LOG_DEBUG) {
+		logLevel++;
+	} else if (signal==SIGUSR2&&logLevel>LOG_ERROR) {
+		logLevel--;
+	}
+	levelChanged=true;
+}
+
+
+int parseLogLevel(char* name) {
+	/* Level named <name> (error, warn, info, debug), -1 if unknown */
+	int i;
+	for (i=LOG_ERROR; i<=LOG_DEBUG; i++) {
+		if (strcasecmp(name, levelNames[i])==0) {
+			return(i);
+		}
+	}
+	return(-1);
+}
+
+
+void logWrite(int level, const char* format, ...) {
+	/**
+	 * Log a printf style message at <level>. Use the logError() ...
+	 * logDebug() macros, which skip the call when the level is disabled.
+	 */
+	logRecord_t inLine;
+	logRecord_t* r=&inLine;
+	logRing_t* ring=running?_getRing():NULL;
+	char line[LOG_MAXLINE+64];
+	unsigned int head;
+	va_list args;
+
+	if (ring!=NULL) {
+		head=atomic_load_explicit(&ring->head, memory_order_relaxed);
+		if (head-atomic_load_explicit(&ring->tail, memory_order_acquire)
+				>=LOG_RING_SLOTS) {
+			atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+			return;
+		}
+		r=&ring->slots[head&(LOG_RING_SLOTS-1)];
+	}
+
+	clock_gettime(CLOCK_REALTIME_COARSE, &r->time);
+	r->level=level;
+	va_start(args, format);
+	r->length=vsnprintf(r->text, LOG_MAXLINE, format, args);
+	va_end(args);
+	if (r->length>=LOG_MAXLINE) {
+		r->length=LOG_MAXLINE-1;
+	}
+
+	/* Publish the record to the writer */
+	if (ring!=NULL) {
+		atomic_store_explicit(&ring->head, head+1, memory_order_release);
+		return;
+	}
+	_writeAll(line, _formatRecord(r, line, sizeof(line)));
+}
+
+
+void flushLog() {
+	/* Write out everything queued so far from the calling thread */
+	while (_drainRings()>0);
+}
+
+
+void _createKey() {
+	pthread_key_create(&threadRing, _releaseRing);
+}
+
+
+logRing_t* _getRing() {
+	/* Ring owned by the calling thread, claiming a free one on first use */
+	logRing_t* ring=pthread_getspecific(threadRing);
+	int expected;
+	int i;
+
+	if (ring!=NULL) {
+		return(ring);
+	}
+	for (i=0; i<LOG_RINGS; i++) {
+		expected=false;
+		if (atomic_compare_exchange_strong(&rings[i].owned, &expected, true)) {
+			pthread_setspecific(threadRing, &rings[i]);
+			return(&rings[i]);
+		}
+	}
+	return(NULL);
+}
+
+
+void _releaseRing(void* ring) {
+	/* Thread exit, the ring (and anything still queued in it) is handed on */
+	atomic_store_explicit(&((logRing_t*)ring)->owned, false,
+			memory_order_release);
+}
+
+
+int _formatRecord(logRecord_t* r, char* out, int outSize) {
+	/* Render "<time> <LEVEL> <text>\n" into <out>, return its length */
+	struct tm t;
+	int n;
+
+	localtime_r(&r->time.tv_sec, &t);
+	n=strftime(out, outSize, "%Y-%m-%d %H:%M:%S", &t);
+	n+=snprintf(out+n, outSize-n, ".%03ld %-5s %.*s\n",
+			r->time.tv_nsec/1000000, levelNames[r->level], r->length, r->text);
+	return(n<outSize?n:outSize-1);
+}
+
+
+void _writeAll(char* bytes, int length) {
+	ssize_t written;
+	while (length>0) {
+		written=write(logFd, bytes, length);
+		if (written<=0) {
+			return;
+		}
+		bytes+=written;
+		length-=written;
+	}
+}
+
+
+int _batchRecord(logRecord_t* r, char* batch, int used) {
+	/**
+	 * Append <r> to the LOG_BATCH byte <batch> holding <used> bytes, first
+	 * writing the batch out if a whole line might not fit.
+	 *
+	 * RETURN:
+	 * 	bytes now used
+	 */
+	if (LOG_BATCH-used<LOG_MAXLINE+64) {
+		_writeAll(batch, used);
+		used=0;
+	}
+	return(used+_formatRecord(r, batch+used, LOG_BATCH-used));
+}
+
+
+int _drainRings() {
+	/**
+	 * Move every queued record into a batch buffer, writing it out whenever
+	 * it fills and once at the end.
+	 *
+	 * RETURN:
+	 * 	number of records written
+	 */
+	static char batch[LOG_BATCH];
+	logRecord_t lost;
+	logRing_t* ring;
+	unsigned int head;
+	unsigned int tail;
+	unsigned long dropped;
+	int used=0;
+	int count=0;
+	int i;
+
+	pthread_mutex_lock(&drainLock);
+	for (i=0; i<LOG_RINGS; i++) {
+		ring=&rings[i];
+		head=atomic_load_explicit(&ring->head, memory_order_acquire);
+		tail=atomic_load_explicit(&ring->tail, memory_order_relaxed);
+		for (; tail!=head; tail++, count++) {
+			used=_batchRecord(&ring->slots[tail&(LOG_RING_SLOTS-1)], batch,
+					used);
+		}
+		atomic_store_explicit(&ring->tail, tail, memory_order_release);
+
+		dropped=atomic_exchange_explicit(&ring->dropped, 0,
+				memory_order_relaxed);
+		if (dropped>0) {
+			clock_gettime(CLOCK_REALTIME_COARSE, &lost.time);
+			lost.level=LOG_WARN;
+			lost.length=snprintf(lost.text, LOG_MAXLINE,
+					"%lu log records dropped, ring full", dropped);
+			used=_batchRecord(&lost, batch, used);
+		}
+	}
+	_writeAll(batch, used);
+	pthread_mutex_unlock(&drainLock);
+	return(count);
+}
+
+
+void* _logWriter(void* unused) {
+	/* Background writer, drain the rings forever, idling when they are empty */
+	while (true) {
+		if (levelChanged) {
+			levelChanged=false;
+			/* At the new level, so it is written whichever way it moved */
+			logWrite(logLevel, "Log level now %s", levelNames[logLevel]);
+		}
+		if (_drainRings()==0) {
+			usleep(LOG_IDLE_US);
+		}
+	}
+	return(NULL);
 }
@@ -7,5 +7,39 @@
 
 #ifndef UTILITY_LOGGER_H_
 #define UTILITY_LOGGER_H_
-void mylog(char* m);
+
+#define LOG_ERROR 0
+#define LOG_WARN  1
+#define LOG_INFO  2
+#define LOG_DEBUG 3
+
+#define LOG_RINGS	   32	  // Per thread rings, threads beyond these log in line
+#define LOG_RING_SLOTS 256	  // Records a ring holds, a power of two
+#define LOG_MAXLINE	   240	  // Longer messages are truncated
+#define LOG_BATCH	   65536  // Bytes written by the background writer at once
+#define LOG_IDLE_US	   10000  // Writer sleep when every ring is empty
+
+/* Messages above this level are discarded before being formatted */
+extern volatile int logLevel;
+
+#define _logAt(level, ...) \
+	do { if ((level)<=logLevel) logWrite((level), __VA_ARGS__); } while (0)
+#define logError(...) _logAt(LOG_ERROR, __VA_ARGS__)
+#define logWarn(...)  _logAt(LOG_WARN, __VA_ARGS__)
+#define logInfo(...)  _logAt(LOG_INFO, __VA_ARGS__)
+
+/* Debug logs are compiled out of release (-DNDEBUG) builds */
+#ifdef NDEBUG
+#define logDebug(...) do {} while (0)
+#else
+#define logDebug(...) _logAt(LOG_DEBUG, __VA_ARGS__)
+#endif
+
+void initLogger(int fd);
+void setLogLevel(int level);
+int parseLogLevel(char* name);
+void logWrite(int level, const char* format, ...)
+		__attribute__((format(printf, 2, 3)));
+void flushLog();
+
 #endif
@@ -0,0 +1,324 @@
+/*
+ * Author: 			Ben Tomlin
+ * Student Id:		btomlin
+ * Student Nbr:		834198
+ * Date:			Oct 2026
+ *
+ * Latency histograms and counters for the status page.
+ *
+ * Every thread that records claims one of METRICS_SLOTS slots and only ever
+ * adds to its own, so recording does not contend; threads beyond the slots
+ * share slot 0. Slots outlive their threads and are summed when a snapshot
+ * is taken, so recording never waits on a reader.
+ *
+ * Live allocations are counted the same way, each slot holding what its
+ * threads allocated less what they freed; only the sum over slots is the
+ * amount live, as one thread may free what another allocated.
+ */
+
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "metrics.h"
+#include "bool.h"
+
+typedef struct metricsSlot {
+	atomic_int owned;
+	atomic_ulong stageCount[N_STAGES];
+	atomic_ulong stageSum[N_STAGES];
+	atomic_ulong stageMax[N_STAGES];
+	atomic_ulong stageBuckets[N_STAGES][METRICS_BUCKETS];
+	atomic_ulong counters[N_COUNTERS];
+	atomic_ulong statuses[METRICS_MAX_STATUS-METRICS_MIN_STATUS+1];
+	atomic_long memCount[N_MEM];
+	atomic_long memBytes[N_MEM];
+} metricsSlot_t;
+
+char* stageNames[N_STAGES]={"accept", "queue", "parse", "resolve", "header",
+	"body", "connection", "upstream", "disk"};
+char* counterNames[N_COUNTERS]={"requests", "bytes_sent", "open_file_hit",
+	"open_file_miss", "gzip_hit", "gzip_miss", "dir_listing_hit",
+	"dir_listing_miss", "timeouts", "limited", "response_hit",
+	"response_miss", "tls_handshakes", "tls_resumed", "tls_ktls",
+	"upstream_reused", "upstream_failed", "disk_cold", "not_found_hit",
+	"not_found_miss"};
+char* memNames[N_MEM]={"request", "readahead", "open_file", "gzip",
+	"dir_listing", "response", "upstream", "thread", "not_found"};
+
+static metricsSlot_t slots[METRICS_SLOTS];
+static atomic_long activeConnections;
+static time_t started;
+static pthread_key_t threadSlot;
+static pthread_once_t keyOnce=PTHREAD_ONCE_INIT;
+
+void _createMetricsKey();
+void _metricsSlotRelease(void* slot);
+metricsSlot_t* _metricsSlot();
+int _bucketOf(unsigned long value);
+long _residentBytes();
+
+
+void initMetrics() {
+	started=time(NULL);
+	pthread_once(&keyOnce, _createMetricsKey);
+}
+
+
+long metricsNow() {
+	/* Monotonic clock [ns], to pass as the start of a stage */
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return(t.tv_sec*1000000000L+t.tv_nsec);
+}
+
+
+long metricsRecord(int stage, long start) {
+	/**
+	 * Record that <stage> ran from <start> (a metricsNow() time) until now
+	 *
+	 * RETURN:
+	 * 	now, so consecutive stages can be chained
+	 */
+	metricsSlot_t* s=_metricsSlot();
+	long now=metricsNow();
+	unsigned long elapsed=(now>start)?now-start:0;
+	unsigned long max;
+
+	atomic_fetch_add_explicit(&s->stageCount[stage], 1, memory_order_relaxed);
+	atomic_fetch_add_explicit(&s->stageSum[stage], elapsed,
+			memory_order_relaxed);
+	atomic_fetch_add_explicit(&s->stageBuckets[stage][_bucketOf(elapsed)], 1,
+			memory_order_relaxed);
+	max=atomic_load_explicit(&s->stageMax[stage], memory_order_relaxed);
+	while (elapsed>max&&!atomic_compare_exchange_weak_explicit(
+			&s->stageMax[stage], &max, elapsed, memory_order_relaxed,
+			memory_order_relaxed));
+	return(now);
+}
+
+
+void metricsCount(int counter, long n) {
+	atomic_fetch_add_explicit(&_metricsSlot()->counters[counter], n,
+			memory_order_relaxed);
+}
+
+
+void metricsStatus(int code) {
+	/* Count a response sent with status <code> */
+	if (code<METRICS_MIN_STATUS||code>METRICS_MAX_STATUS) {
+		return;
+	}
+	atomic_fetch_add_explicit(
+			&_metricsSlot()->statuses[code-METRICS_MIN_STATUS], 1,
+			memory_order_relaxed);
+}
+
+
+void metricsConnectionOpened() {
+	atomic_fetch_add_explicit(&activeConnections, 1, memory_order_relaxed);
+}
+
+
+void metricsConnectionClosed() {
+	atomic_fetch_sub_explicit(&activeConnections, 1, memory_order_relaxed);
+}
+
+
+void metricsAllocated(int pool, long bytes) {
+	/* Count an allocation of <bytes> held by subsystem <pool> */
+	metricsSlot_t* slot=_metricsSlot();
+	atomic_fetch_add_explicit(&slot->memCount[pool], 1, memory_order_relaxed);
+	atomic_fetch_add_explicit(&slot->memBytes[pool], bytes,
+			memory_order_relaxed);
+}
+
+
+void metricsFreed(int pool, long bytes) {
+	/* Count the release of an allocation counted with metricsAllocated() */
+	metricsSlot_t* slot=_metricsSlot();
+	atomic_fetch_sub_explicit(&slot->memCount[pool], 1, memory_order_relaxed);
+	atomic_fetch_sub_explicit(&slot->memBytes[pool], bytes,
+			memory_order_relaxed);
+}
+
+
+void metricsSnapshot(metricsSnapshot_t* s) {
+	/**
+	 * Sum every slot into <s>. Slots are read while being written, so the
+	 * snapshot is consistent per value but not across values.
+	 */
+	metricsSlot_t* slot;
+	unsigned long max;
+	int i;
+	int stage;
+	int j;
+
+	memset(s, 0, sizeof(metricsSnapshot_t));
+	for (i=0; i<METRICS_SLOTS; i++) {
+		slot=&slots[i];
+		for (stage=0; stage<N_STAGES; stage++) {
+			s->stages[stage].count+=atomic_load_explicit(
+					&slot->stageCount[stage], memory_order_relaxed);
+			s->stages[stage].sum+=atomic_load_explicit(
+					&slot->stageSum[stage], memory_order_relaxed);
+			max=atomic_load_explicit(&slot->stageMax[stage],
+					memory_order_relaxed);
+			if (max>s->stages[stage].max) {
+				s->stages[stage].max=max;
+			}
+			for (j=0; j<METRICS_BUCKETS; j++) {
+				s->stages[stage].buckets[j]+=atomic_load_explicit(
+						&slot->stageBuckets[stage][j], memory_order_relaxed);
+			}
+		}
+		for (j=0; j<N_COUNTERS; j++) {
+			s->counters[j]+=atomic_load_explicit(&slot->counters[j],
+					memory_order_relaxed);
+		}
+		for (j=0; j<=METRICS_MAX_STATUS-METRICS_MIN_STATUS; j++) {
+			s->statuses[j]+=atomic_load_explicit(&slot->statuses[j],
+					memory_order_relaxed);
+		}
+		for (j=0; j<N_MEM; j++) {
+			s->memCount[j]+=atomic_load_explicit(&slot->memCount[j],
+					memory_order_relaxed);
+			s->memBytes[j]+=atomic_load_explicit(&slot->memBytes[j],
+					memory_order_relaxed);
+		}
+	}
+	s->residentBytes=_residentBytes();
+	s->activeConnections=atomic_load(&activeConnections);
+	s->uptime=time(NULL)-started;
+}
+
+
+void histogramRecord(histogram_t* h, unsigned long value) {
+	/* Add <value> [ns] to a histogram owned by the calling thread */
+	h->count++;
+	h->sum+=value;
+	h->buckets[_bucketOf(value)]++;
+	if (value>h->max) {
+		h->max=value;
+	}
+}
+
+
+void histogramMerge(histogram_t* into, histogram_t* from) {
+	int i;
+	into->count+=from->count;
+	into->sum+=from->sum;
+	if (from->max>into->max) {
+		into->max=from->max;
+	}
+	for (i=0; i<METRICS_BUCKETS; i++) {
+		into->buckets[i]+=from->buckets[i];
+	}
+}
+
+
+unsigned long histogramPercentile(histogram_t* h, double percentile) {
+	/**
+	 * Value at or below which <percentile> (0 to 100) of the samples in <h>
+	 * fall, to within the bucket precision.
+	 *
+	 * RETURN:
+	 * 	the upper bound of the bucket holding that sample [ns], 0 if empty
+	 */
+	unsigned long rank=(unsigned long)(h->count*percentile/100.0+0.5);
+	unsigned long seen=0;
+	int i;
+
+	if (h->count==0) {
+		return(0);
+	}
+	if (rank==0) {
+		rank=1;
+	}
+	for (i=0; i<METRICS_BUCKETS; i++) {
+		seen+=h->buckets[i];
+		if (seen>=rank) {
+			return(histogramBucketUpper(i)<h->max?histogramBucketUpper(i):
+					h->max);
+		}
+	}
+	return(h->max);
+}
+
+
+unsigned long histogramBucketUpper(int bucket) {
+	/* Largest value [ns] counted in <bucket> */
+	int shift;
+	if (bucket<METRICS_SUB_COUNT) {
+		return(bucket);
+	}
+	shift=bucket/METRICS_SUB_COUNT-1;
+	return(((unsigned long)(METRICS_SUB_COUNT+bucket%METRICS_SUB_COUNT+1)
+			<<shift)-1);
+}
+
+
+long _residentBytes() {
+	/* Resident set size of the process, from /proc */
+	FILE* statm=fopen("/proc/self/statm", "r");
+	long size;
+	long resident=0;
+
+	if (statm==NULL) {
+		return(0);
+	}
+	if (fscanf(statm, "%ld %ld", &size, &resident)!=2) {
+		resident=0;
+	}
+	fclose(statm);
+	return(resident*sysconf(_SC_PAGESIZE));
+}
+
+
+void _createMetricsKey() {
+	pthread_key_create(&threadSlot, _metricsSlotRelease);
+}
+
+
+void _metricsSlotRelease(void* slot) {
+	atomic_store_explicit(&((metricsSlot_t*)slot)->owned, false,
+			memory_order_release);
+}
+
+
+metricsSlot_t* _metricsSlot() {
+	/* Slot of the calling thread, claiming one on first use */
+	metricsSlot_t* s=pthread_getspecific(threadSlot);
+	int expected;
+	int i;
+
+	if (s!=NULL) {
+		return(s);
+	}
+	for (i=1; i<METRICS_SLOTS; i++) {
+		expected=false;
+		if (atomic_compare_exchange_strong(&slots[i].owned, &expected, true)) {
+			pthread_setspecific(threadSlot, &slots[i]);
+			return(&slots[i]);
+		}
+	}
+	return(&slots[0]);
+}
+
+
+int _bucketOf(unsigned long value) {
+	/* Histogram bucket counting <value> [ns] */
+	int msb;
+	int bucket;
+
+	if (value<METRICS_SUB_COUNT) {
+		return(value);
+	}
+	msb=63-__builtin_clzl(value);
+	bucket=(msb-METRICS_SUB_BITS+1)*METRICS_SUB_COUNT+
+			((value>>(msb-METRICS_SUB_BITS))&(METRICS_SUB_COUNT-1));
+	return(bucket<METRICS_BUCKETS?bucket:METRICS_BUCKETS-1);
+}
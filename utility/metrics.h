@@ -0,0 +1,107 @@
+/*
+ * Author: 			Ben Tomlin
+ * Student Id:		btomlin
+ * Student Nbr:		834198
+ * Date:			Oct 2026
+ */
+
+#ifndef UTILITY_METRICS_H_
+#define UTILITY_METRICS_H_
+
+/* Timed stages of a connection, each kept as a latency histogram */
+#define STAGE_ACCEPT	 0 // Concierge blocked in accept()
+#define STAGE_QUEUE		 1 // Concierge waiting for a free worker thread
+#define STAGE_PARSE		 2 // Reading and parsing the request
+#define STAGE_RESOLVE	 3 // URI to path and open file lookup
+#define STAGE_HEADER	 4 // Sending the status line and headers
+#define STAGE_BODY		 5 // Sending the entity
+#define STAGE_CONNECTION 6 // accept() to closeSocket()
+#define STAGE_UPSTREAM	 7 // Proxied or FastCGI request to response header
+#define STAGE_DISK		 8 // Waiting for cold file data to be read
+#define N_STAGES		 9
+
+/* Event counters */
+#define COUNT_REQUESTS		  0
+#define COUNT_BYTES_SENT	  1 // Entity bytes
+#define COUNT_OPENFILE_HIT	  2
+#define COUNT_OPENFILE_MISS	  3
+#define COUNT_GZIP_HIT		  4
+#define COUNT_GZIP_MISS		  5
+#define COUNT_DIRLISTING_HIT  6
+#define COUNT_DIRLISTING_MISS 7
+#define COUNT_TIMEOUTS		  8 // Connections shut down at a deadline
+#define COUNT_LIMITED		  9 // Connections refused by a per client limit
+#define COUNT_RESPONSE_HIT	  10
+#define COUNT_RESPONSE_MISS	  11
+#define COUNT_TLS_HANDSHAKES  12 // Completed, whether full or resumed
+#define COUNT_TLS_RESUMED	  13
+#define COUNT_TLS_KTLS		  14 // Connections whose records the kernel sends
+#define COUNT_UPSTREAM_REUSED 15 // Proxied requests on a pooled connection
+#define COUNT_UPSTREAM_FAILED 16 // Proxied or FastCGI requests given 502/504
+#define COUNT_DISK_COLD		  17 // File ranges read by the disk threads
+#define COUNT_NOTFOUND_HIT	  18 // 404s answered by the not found cache
+#define COUNT_NOTFOUND_MISS	  19 // 404s resolved through the filesystem
+#define N_COUNTERS			  20
+
+/* Live allocations, by the subsystem holding them */
+#define MEM_REQUEST		0 // Parsed requests and their responses
+#define MEM_READAHEAD	1 // Bytes read past a line, kept per thread
+#define MEM_OPENFILE	2 // Open file cache entries
+#define MEM_GZIP		3 // Compressed entities
+#define MEM_DIRLISTING	4 // Generated directory listings
+#define MEM_RESPONSE	5 // Serialized responses
+#define MEM_UPSTREAM	6 // Proxy and FastCGI connections
+#define MEM_THREAD		7 // Worker threads, by stack size
+#define MEM_NOTFOUND	8 // Not found cache entries and filter
+#define N_MEM			9
+
+/* Log-linear (HDR style) buckets over nanoseconds; 2^METRICS_SUB_BITS
+ * buckets per power of two, a relative error of 1/2^METRICS_SUB_BITS */
+#define METRICS_SUB_BITS	3
+#define METRICS_SUB_COUNT	(1<<METRICS_SUB_BITS)
+#define METRICS_BUCKETS		320	// Values up to ~73 minutes
+#define METRICS_SLOTS		16	// Per thread slots, slot 0 is shared
+#define METRICS_MIN_STATUS	100
+#define METRICS_MAX_STATUS	599
+
+typedef struct histogram histogram_t;
+typedef struct metricsSnapshot metricsSnapshot_t;
+
+struct histogram {
+	unsigned long count;
+	unsigned long sum;			// [ns]
+	unsigned long max;			// [ns]
+	unsigned long buckets[METRICS_BUCKETS];
+};
+
+struct metricsSnapshot {
+	histogram_t stages[N_STAGES];
+	unsigned long counters[N_COUNTERS];
+	unsigned long statuses[METRICS_MAX_STATUS-METRICS_MIN_STATUS+1];
+	long memCount[N_MEM];		// Live allocations
+	long memBytes[N_MEM];
+	long residentBytes;			// Of the process, 0 if unknown
+	long activeConnections;
+	long uptime;				// [s]
+};
+
+extern char* stageNames[N_STAGES];
+extern char* counterNames[N_COUNTERS];
+extern char* memNames[N_MEM];
+
+void initMetrics();
+long metricsNow();
+long metricsRecord(int stage, long start);
+void metricsCount(int counter, long n);
+void metricsStatus(int code);
+void metricsConnectionOpened();
+void metricsConnectionClosed();
+void metricsAllocated(int pool, long bytes);
+void metricsFreed(int pool, long bytes);
+void metricsSnapshot(metricsSnapshot_t* s);
+void histogramRecord(histogram_t* h, unsigned long value);
+void histogramMerge(histogram_t* into, histogram_t* from);
+unsigned long histogramPercentile(histogram_t* h, double percentile);
+unsigned long histogramBucketUpper(int bucket);
+
+#endif /* UTILITY_METRICS_H_ */
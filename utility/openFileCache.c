@@ -0,0 +1,304 @@
+/*
+ * Author: 			Ben Tomlin
+ * Student Id:		btomlin
+ * Student Nbr:		834198
+ * Date:			Oct 2026
+ *
+ * Cache of open file descriptors and their fstat() metadata, in the spirit of
+ * nginx's open_file_cache. A hot file is served without any open() or stat()
+ * calls; entries are revalidated with a stat() once they are older than the
+ * validity period, and closed once unused for the inactive period or evicted
+ * least recently used first.
+ *
+ * Failures (missing file, directory, no permission) are cached the same way,
+ * so repeated lookups of absent precompressed siblings are also free.
+ *
+ * Descriptors are shared between threads, so holders must only read them at
+ * explicit offsets (pread, sendfile with an offset), never through the file
+ * position.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "openFileCache.h"
+#include "hash.h"
+#include "bool.h"
+#include "metrics.h"
+
+static openFile_t* buckets[OPENFILE_BUCKETS];
+static openFile_t* lruHead; // Most recently used
+static openFile_t* lruTail;
+static int nEntries;
+static int maxEntries;		// Zero disables caching, every lookup opens
+static int validSeconds;
+static int inactiveSeconds;
+static pthread_mutex_t cacheLock=PTHREAD_MUTEX_INITIALIZER;
+
+openFile_t* _openFile(char* path);
+int _openFileIsSame(openFile_t* f, struct stat* s, int statError);
+openFile_t* _openFileFind(char* path);
+void _openFileInsert(openFile_t* f);
+void _openFileUnlink(openFile_t* f);
+void _openFileEvict(time_t now);
+void _openFileLruPushFront(openFile_t* f);
+void _openFileLruRemove(openFile_t* f);
+void _openFileClose(openFile_t* f);
+
+
+void openFileCacheInit(int max, int valid, int inactive) {
+	/**
+	 * Set cache limits. Call once before any openFileAcquire()
+	 *
+	 * ARGUMENT:
+	 * 	max - most files held open, 0 disables the cache
+	 * 	valid - seconds an entry is trusted before it is stat()ed again
+	 * 	inactive - seconds an unused entry is kept open
+	 */
+	maxEntries=max;
+	validSeconds=valid;
+	inactiveSeconds=inactive;
+}
+
+
+openFile_t* openFileAcquire(char* path) {
+	/**
+	 * Get an open read only descriptor and metadata for regular file <path>
+	 *
+	 * RETURN:
+	 * 	Entry to be handed back with openFileRelease(). NULL if the file
+	 * 	cannot be opened or is not a regular file, with errno set.
+	 */
+	openFile_t* f;
+	openFile_t* existing;
+	struct stat s;
+	int statError;
+	int unused;
+	time_t now=time(NULL);
+
+	pthread_mutex_lock(&cacheLock);
+	f=(maxEntries>0)?_openFileFind(path):NULL;
+
+	/* Revalidate an old entry, without holding the lock over the stat */
+	if (f!=NULL&&now-f->validated>=validSeconds) {
+		f->refCount++;
+		pthread_mutex_unlock(&cacheLock);
+		statError=(stat(path, &s)==0)?0:errno;
+		pthread_mutex_lock(&cacheLock);
+		f->refCount--;
+		if (f->linked&&_openFileIsSame(f, &s, statError)) {
+			f->validated=now;
+		} else {
+			if (f->linked) {
+				_openFileUnlink(f);
+			} else if (f->refCount==0) {
+				_openFileClose(f);
+			}
+			f=NULL;
+		}
+	}
+
+	/* Hit */
+	if (f!=NULL) {
+		metricsCount(COUNT_OPENFILE_HIT, 1);
+		f->lastUsed=now;
+		_openFileLruRemove(f);
+		_openFileLruPushFront(f);
+		if (f->fd<0) {
+			errno=f->error;
+			pthread_mutex_unlock(&cacheLock);
+			return(NULL);
+		}
+		f->refCount++;
+		pthread_mutex_unlock(&cacheLock);
+		return(f);
+	}
+	pthread_mutex_unlock(&cacheLock);
+	metricsCount(COUNT_OPENFILE_MISS, 1);
+
+	/* Miss, open outside the lock */
+	f=_openFile(path);
+	f->validated=now;
+	f->lastUsed=now;
+	if (maxEntries==0) {
+		if (f->fd<0) {
+			errno=f->error;
+			_openFileClose(f);
+			return(NULL);
+		}
+		f->refCount=1;
+		return(f);
+	}
+
+	pthread_mutex_lock(&cacheLock);
+
+	/* Lost a race with another miss on the same path, use its entry */
+	existing=_openFileFind(path);
+	if (existing!=NULL) {
+		_openFileClose(f);
+		f=existing;
+		f->refCount++;
+	} else {
+
+		/* Held over the eviction, which may unlink <f> itself */
+		_openFileInsert(f);
+		f->refCount++;
+		_openFileEvict(now);
+	}
+	if (f->fd<0) {
+		statError=f->error;
+		f->refCount--;
+		unused=(f->refCount==0&&!f->linked);
+		pthread_mutex_unlock(&cacheLock);
+		if (unused) {
+			_openFileClose(f);
+		}
+		errno=statError;
+		return(NULL);
+	}
+	pthread_mutex_unlock(&cacheLock);
+	return(f);
+}
+
+
+void openFileRelease(openFile_t* f) {
+	/* Drop a reference taken by openFileAcquire() */
+	int unused;
+	if (f==NULL) {
+		return;
+	}
+	pthread_mutex_lock(&cacheLock);
+	f->refCount--;
+	unused=(f->refCount==0&&!f->linked);
+	pthread_mutex_unlock(&cacheLock);
+
+	if (unused) {
+		_openFileClose(f);
+	}
+}
+
+
+openFile_t* _openFile(char* path) {
+	/* Open <path> into a new unlinked entry, recording any failure in it */
+	openFile_t* f=calloc(1, sizeof(openFile_t));
+	f->path=strdup(path);
+	metricsAllocated(MEM_OPENFILE, sizeof(openFile_t)+strlen(path)+1);
+	f->fd=open(path, O_RDONLY|O_CLOEXEC);
+
+	if (f->fd<0) {
+		f->error=errno;
+		if (stat(path, &f->st)!=0) {
+			memset(&f->st, 0, sizeof(f->st));
+		}
+		return(f);
+	}
+
+	fstat(f->fd, &f->st);
+	if (!S_ISREG(f->st.st_mode)) {
+		close(f->fd);
+		f->fd=-1;
+		f->error=S_ISDIR(f->st.st_mode)?EISDIR:EACCES;
+	}
+	return(f);
+}
+
+
+int _openFileIsSame(openFile_t* f, struct stat* s, int statError) {
+	/* True if a fresh stat() of the path matches what <f> recorded */
+	if (statError!=0) {
+		return(f->fd<0&&f->st.st_ino==0);
+	}
+	return(s->st_ino==f->st.st_ino&&s->st_dev==f->st.st_dev
+			&&s->st_size==f->st.st_size
+			&&s->st_mtime==f->st.st_mtime
+			&&s->st_mode==f->st.st_mode);
+}
+
+
+openFile_t* _openFileFind(char* path) {
+	openFile_t* f=buckets[hashString(path)%OPENFILE_BUCKETS];
+	for (; f!=NULL; f=f->hashNext) {
+		if (strcmp(f->path, path)==0) {
+			return(f);
+		}
+	}
+	return(NULL);
+}
+
+
+void _openFileInsert(openFile_t* f) {
+	unsigned long b=hashString(f->path)%OPENFILE_BUCKETS;
+	f->hashNext=buckets[b];
+	buckets[b]=f;
+	f->linked=true;
+	nEntries++;
+	_openFileLruPushFront(f);
+}
+
+
+void _openFileUnlink(openFile_t* f) {
+	/* Remove <f> from the cache, closing it now if no sender holds it */
+	openFile_t** p=&buckets[hashString(f->path)%OPENFILE_BUCKETS];
+	while (*p!=f) {
+		p=&((*p)->hashNext);
+	}
+	*p=f->hashNext;
+	_openFileLruRemove(f);
+	f->linked=false;
+	nEntries--;
+	if (f->refCount==0) {
+		_openFileClose(f);
+	}
+}
+
+
+void _openFileEvict(time_t now) {
+	/* Drop least recently used entries over the limit or inactive too long */
+	while (lruTail!=NULL&&(nEntries>maxEntries
+			||now-lruTail->lastUsed>=inactiveSeconds)) {
+		_openFileUnlink(lruTail);
+	}
+}
+
+
+void _openFileLruPushFront(openFile_t* f) {
+	f->lruPrev=NULL;
+	f->lruNext=lruHead;
+	if (lruHead!=NULL) {
+		lruHead->lruPrev=f;
+	}
+	lruHead=f;
+	if (lruTail==NULL) {
+		lruTail=f;
+	}
+}
+
+
+void _openFileLruRemove(openFile_t* f) {
+	if (f->lruPrev!=NULL) {
+		f->lruPrev->lruNext=f->lruNext;
+	} else {
+		lruHead=f->lruNext;
+	}
+	if (f->lruNext!=NULL) {
+		f->lruNext->lruPrev=f->lruPrev;
+	} else {
+		lruTail=f->lruPrev;
+	}
+	f->lruPrev=NULL;
+	f->lruNext=NULL;
+}
+
+
+void _openFileClose(openFile_t* f) {
+	if (f->fd>=0) {
+		close(f->fd);
+	}
+	metricsFreed(MEM_OPENFILE, sizeof(openFile_t)+strlen(f->path)+1);
+	free(f->path);
+	free(f);
+}
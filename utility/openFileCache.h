@@ -0,0 +1,36 @@
+/*
+ * Author: 			Ben Tomlin
+ * Student Id:		btomlin
+ * Student Nbr:		834198
+ * Date:			Oct 2026
+ */
+
+#ifndef UTILITY_OPENFILECACHE_H_
+#define UTILITY_OPENFILECACHE_H_
+
+#include <time.h>
+#include <sys/stat.h>
+
+#define OPENFILE_BUCKETS 1024
+
+typedef struct openFile openFile_t;
+
+struct openFile {	  // Open descriptor & metadata of a file, shared by senders
+	char* path;
+	int fd;			  // -1 for a cached failure, error then holds the errno
+	int error;
+	struct stat st;	  // fstat() of fd, or stat() of path for a failure
+	time_t validated; // When st was last checked against the filesystem
+	time_t lastUsed;
+	int refCount;	  // Holders of fd. Closed at zero once unlinked
+	int linked;		  // Still reachable through the cache
+	openFile_t *hashNext;
+	openFile_t *lruPrev;
+	openFile_t *lruNext;
+};
+
+void openFileCacheInit(int maxEntries, int validSeconds, int inactiveSeconds);
+openFile_t* openFileAcquire(char* path);
+void openFileRelease(openFile_t* f);
+
+#endif /* UTILITY_OPENFILECACHE_H_ */
@@ -0,0 +1,70 @@
+/*
+ * Author: 			Ben Tomlin
+ * Student Id:		btomlin
+ * Student Nbr:		834198
+ * Date:			Oct 2026
+ *
+ * USDT (user level statically defined tracing) probes on the request
+ * lifecycle, provider "httpserver". A probe is a single nop until a tracer
+ * attaches to it, so they are always compiled in when <sys/sdt.h> (package
+ * systemtap-sdt-dev) is available, and compile to nothing otherwise or when
+ * built with -DNO_USDT. List them with
+ *
+ * 	bpftrace -l 'usdt:./server:httpserver:*'
+ *
+ * Example scripts are in tools/bpftrace.
+ */
+
+#ifndef UTILITY_PROBES_H_
+#define UTILITY_PROBES_H_
+
+#if !defined(NO_USDT) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define USDT_ENABLED 1
+#endif
+#endif
+
+#ifdef USDT_ENABLED
+
+/* Connection accepted: fd */
+#define PROBE_CONNECTION_ACCEPT(fd) \
+	DTRACE_PROBE1(httpserver, connection_accept, fd)
+
+/* Request line and headers read: fd, method, uri */
+#define PROBE_REQUEST_PARSED(fd, method, uri) \
+	DTRACE_PROBE3(httpserver, request_parsed, fd, method, uri)
+
+/* URI resolved to a path: uri, path, found (1 if it opened) */
+#define PROBE_PATH_RESOLVED(uri, path, found) \
+	DTRACE_PROBE3(httpserver, path_resolved, uri, path, found)
+
+/* Response status decided: fd, status code, uri */
+#define PROBE_RESPONSE_STATUS(fd, status, uri) \
+	DTRACE_PROBE3(httpserver, response_status, fd, status, uri)
+
+/* Entity send started: fd, bytes to send (-1 if unknown) */
+#define PROBE_SEND_START(fd, length) \
+	DTRACE_PROBE2(httpserver, send_start, fd, length)
+
+/* Entity send finished: fd, bytes sent */
+#define PROBE_SEND_END(fd, sent) \
+	DTRACE_PROBE2(httpserver, send_end, fd, sent)
+
+/* Connection about to be closed: fd */
+#define PROBE_CONNECTION_CLOSE(fd) \
+	DTRACE_PROBE1(httpserver, connection_close, fd)
+
+#else
+
+#define PROBE_CONNECTION_ACCEPT(fd) do {} while (0)
+#define PROBE_REQUEST_PARSED(fd, method, uri) do {} while (0)
+#define PROBE_PATH_RESOLVED(uri, path, found) do {} while (0)
+#define PROBE_RESPONSE_STATUS(fd, status, uri) do {} while (0)
+#define PROBE_SEND_START(fd, length) do {} while (0)
+#define PROBE_SEND_END(fd, sent) do {} while (0)
+#define PROBE_CONNECTION_CLOSE(fd) do {} while (0)
+
+#endif
+
+#endif /* UTILITY_PROBES_H_ */
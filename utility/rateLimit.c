@@ -0,0 +1,275 @@
+/*
+ * Author: 			Ben Tomlin
+ * Student Id:		btomlin
+ * Student Nbr:		834198
+ * Date:			Oct 2026
+ *
+ * Per client address connection caps and request rates, checked by the
+ * concierge as each connection is accepted, before a worker thread is taken
+ * or a byte of the request is read. This server answers one request per
+ * connection, so the request rate is the connection rate.
+ *
+ * Clients are IPv4 addresses or IPv6 /64 prefixes (what one host is usually
+ * given), IPv4 mapped IPv6 addresses counted as IPv4. Unix domain socket
+ * peers are not limited.
+ *
+ * Clients live in a fixed, sharded open addressing table of atomics; no
+ * locks are taken. A slot is claimed by a compare and swap of its key, and a
+ * slot whose client has no connections and has been idle for
+ * RATELIMIT_IDLE_NS is reclaimed by the next client probing past it, so
+ * expiry costs nothing until the space is wanted. A reclaim that races the
+ * slot's own client coming back is undone: the reclaimer swaps the key then
+ * checks the slot is still unused, the client counts its connection then
+ * checks the key is still its own, so at least one of them sees the other. If every slot a client
+ * could use is live it is let through rather than refused.
+ *
+ * The request rate is a token bucket of <burst> tokens refilled at <rate>
+ * per second, kept as its generic cell rate algorithm equivalent; a single
+ * theoretical arrival time, updated with one compare and swap.
+ */
+
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#include "rateLimit.h"
+#include "hash.h"
+#include "bool.h"
+
+static client_t table[RATELIMIT_SHARDS][RATELIMIT_SHARD_SIZE];
+static int maxConnections;	// 0 for no cap
+static long interval;		// Nanoseconds per token, 0 for no rate limit
+static long tolerance;		// interval*burst
+static int response;
+static char* tooManyRequests=
+	"HTTP/1.0 429 Too Many Requests\r\n"
+	"Retry-After: 1\r\n"
+	"Content-Length: 0\r\n"
+	"\r\n";
+
+unsigned long _clientKey(struct sockaddr_storage* peer);
+client_t* _findClient(unsigned long key, long now);
+int _takeToken(client_t* c, long now);
+long _nowNs();
+
+
+void initRateLimit(int connections, int rate, int burst, int onLimit) {
+	/**
+	 * ARGUMENT:
+	 * 	connections - most concurrent connections per client, 0 unlimited
+	 * 	rate - requests per second per client, 0 unlimited
+	 * 	burst - requests a client may make at once, above <rate>
+	 * 	onLimit - LIMIT_RESPONSE_429 or LIMIT_RESPONSE_CLOSE
+	 */
+	maxConnections=connections;
+	interval=rate>0?1000000000L/rate:0;
+	tolerance=interval*(burst>0?burst:1);
+	response=onLimit;
+}
+
+
+int rateLimitEnabled() {
+	return(maxConnections>0||interval>0);
+}
+
+
+int rateLimitAdmit(struct sockaddr_storage* peer, client_t** client) {
+	/**
+	 * Count a new connection from <peer> against its limits.
+	 *
+	 * ARGUMENT:
+	 * 	client - set to the client to rateLimitRelease() when the connection
+	 * 	closes, or NULL if there is nothing to release
+	 *
+	 * RETURN:
+	 * 	LIMIT_OK, or why the connection is refused
+	 */
+	unsigned long key=_clientKey(peer);
+	long now=_nowNs();
+	client_t* c;
+	int previous;
+
+	*client=NULL;
+	if (key==0||(c=_findClient(key, now))==NULL) {
+		return(LIMIT_OK);
+	}
+	previous=atomic_fetch_add(&c->connections, 1);
+
+	/* Reclaimed for another client since it was found, let through */
+	if (atomic_load(&c->key)!=key) {
+		atomic_fetch_sub(&c->connections, 1);
+		return(LIMIT_OK);
+	}
+	if (maxConnections>0&&previous>=maxConnections) {
+		atomic_fetch_sub(&c->connections, 1);
+		return(LIMIT_CONN);
+	}
+	if (!_takeToken(c, now)) {
+		atomic_fetch_sub(&c->connections, 1);
+		return(LIMIT_RATE);
+	}
+	*client=c;
+	return(LIMIT_OK);
+}
+
+
+void rateLimitRelease(client_t* client) {
+	/* A connection counted by rateLimitAdmit() has closed */
+	if (client!=NULL) {
+		atomic_fetch_sub(&client->connections, 1);
+	}
+}
+
+
+void rateLimitReject(int socketFd) {
+	/**
+	 * Refuse and close an over limit connection without blocking. Request
+	 * bytes already received are discarded unread first, as closing with
+	 * them pending would reset the connection before the 429 is read.
+	 */
+	char discard[RATELIMIT_DRAIN];
+
+	if (response==LIMIT_RESPONSE_429) {
+		while (recv(socketFd, discard, RATELIMIT_DRAIN, MSG_DONTWAIT)
+				==RATELIMIT_DRAIN);
+		send(socketFd, tooManyRequests, strlen(tooManyRequests),
+				MSG_DONTWAIT|MSG_NOSIGNAL);
+	}
+	close(socketFd);
+}
+
+
+int parseLimitResponse(char* name) {
+	/* "429" or "close", -1 if neither */
+	if (strcmp(name, "429")==0) {
+		return(LIMIT_RESPONSE_429);
+	} else if (strcasecmp(name, "close")==0) {
+		return(LIMIT_RESPONSE_CLOSE);
+	}
+	return(-1);
+}
+
+
+unsigned long _clientKey(struct sockaddr_storage* peer) {
+	/* Hash of the client <peer> belongs to, 0 if it is not limited */
+	unsigned char address[1+8];		// Family tag, then the address
+	struct sockaddr_in6* in6=(struct sockaddr_in6*)peer;
+	unsigned long key;
+	int length;
+
+	if (peer->ss_family==AF_INET) {
+		address[0]=4;
+		memcpy(address+1, &((struct sockaddr_in*)peer)->sin_addr, 4);
+		length=1+4;
+	} else if (peer->ss_family==AF_INET6
+			&&IN6_IS_ADDR_V4MAPPED(&in6->sin6_addr)) {
+		address[0]=4;
+		memcpy(address+1, in6->sin6_addr.s6_addr+12, 4);
+		length=1+4;
+	} else if (peer->ss_family==AF_INET6) {
+		address[0]=6;
+		memcpy(address+1, in6->sin6_addr.s6_addr, 8);
+		length=1+8;
+	} else {
+		return(0);
+	}
+	key=hashBytes(address, length);
+	return(key!=0?key:1);
+}
+
+
+client_t* _findClient(unsigned long key, long now) {
+	/**
+	 * Slot of client <key>, claiming a free or reclaimable slot if it has
+	 * none.
+	 *
+	 * RETURN:
+	 * 	NULL if every slot the client could use is live
+	 */
+	client_t* shard=table[key%RATELIMIT_SHARDS];
+	unsigned long start=(key/RATELIMIT_SHARDS)&(RATELIMIT_SHARD_SIZE-1);
+	client_t* reclaim=NULL;
+	unsigned long reclaimKey=0;
+	unsigned long expected;
+	long tat;
+	client_t* c;
+	int i;
+
+	for (i=0; i<RATELIMIT_PROBE; i++) {
+		c=&shard[(start+i)&(RATELIMIT_SHARD_SIZE-1)];
+		expected=atomic_load(&c->key);
+		if (expected==key) {
+			return(c);
+		}
+
+		/* Free, claim it */
+		if (expected==0) {
+			if (atomic_compare_exchange_strong(&c->key, &expected, key)) {
+				atomic_store(&c->tat, now);
+				return(c);
+			}
+			if (expected==key) {
+				return(c);
+			}
+		}
+
+		/* First idle client in the way, claimed if this one is not found */
+		if (reclaim==NULL&&atomic_load(&c->connections)==0
+				&&atomic_load(&c->tat)<now-RATELIMIT_IDLE_NS) {
+			reclaim=c;
+			reclaimKey=expected;
+		}
+	}
+	if (reclaim==NULL) {
+		return(NULL);
+	}
+
+	/* Only from the client seen idle, and only if it still is once taken */
+	expected=reclaimKey;
+	if (!atomic_compare_exchange_strong(&reclaim->key, &expected, key)) {
+		return(NULL);
+	}
+	tat=atomic_load(&reclaim->tat);
+	if (atomic_load(&reclaim->connections)==0&&tat<now-RATELIMIT_IDLE_NS
+			&&atomic_compare_exchange_strong(&reclaim->tat, &tat, now)) {
+		return(reclaim);
+	}
+	expected=key;
+	atomic_compare_exchange_strong(&reclaim->key, &expected, reclaimKey);
+	return(NULL);
+}
+
+
+int _takeToken(client_t* c, long now) {
+	/**
+	 * Take a token from <c>'s bucket. Without a rate limit this only records
+	 * when the client was last seen.
+	 *
+	 * RETURN:
+	 * 	false if the bucket is empty
+	 */
+	long tat=atomic_load(&c->tat);
+	long next;
+
+	do {
+		if (interval==0) {
+			next=now>tat?now:tat;
+		} else {
+			next=(tat>now?tat:now)+interval;
+			if (next-now>tolerance) {
+				return(false);
+			}
+		}
+	} while (!atomic_compare_exchange_weak(&c->tat, &tat, next));
+	return(true);
+}
+
+
+long _nowNs() {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return(t.tv_sec*1000000000L+t.tv_nsec);
+}
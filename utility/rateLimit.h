@@ -0,0 +1,42 @@
+/*
+ * Author: 			Ben Tomlin
+ * Student Id:		btomlin
+ * Student Nbr:		834198
+ * Date:			Oct 2026
+ */
+
+#ifndef UTILITY_RATELIMIT_H_
+#define UTILITY_RATELIMIT_H_
+
+#include <stdatomic.h>
+#include <sys/socket.h>
+
+#define RATELIMIT_SHARDS	  16
+#define RATELIMIT_SHARD_SIZE  4096	// Clients per shard, a power of two
+#define RATELIMIT_PROBE		  16	// Slots searched for a client
+#define RATELIMIT_IDLE_NS	  (60*1000000000L) // Idle clients become reclaimable
+#define RATELIMIT_DRAIN		  4096	// Request bytes discarded before a 429
+
+#define LIMIT_OK		 0
+#define LIMIT_CONN		 1	// Too many concurrent connections
+#define LIMIT_RATE		 2	// Connecting faster than the request rate
+
+#define LIMIT_RESPONSE_429	 0	// Reject with 429 Too Many Requests
+#define LIMIT_RESPONSE_CLOSE 1	// Reject by closing the connection
+
+typedef struct client client_t;
+
+struct client {				// One peer address (an IPv6 /64) being limited
+	atomic_ulong key;		// Hash of the address, 0 for a free slot
+	atomic_int connections;
+	atomic_long tat;		// GCRA theoretical arrival time [ns], last seen
+};
+
+void initRateLimit(int maxConnections, int rate, int burst, int response);
+int rateLimitEnabled();
+int rateLimitAdmit(struct sockaddr_storage* peer, client_t** client);
+void rateLimitRelease(client_t* client);
+void rateLimitReject(int socketFd);
+int parseLimitResponse(char* name);
+
+#endif /* UTILITY_RATELIMIT_H_ */
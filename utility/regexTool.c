@@ -46,8 +46,7 @@ extractMatch(char* regex, char* searchString, char** destination) {
 	if(error!=0){
 		char errorMessage[errSize];
 		regerror(error,&rx,errorMessage,errSize);
-		mylog("Regex compilation error");
-		mylog(errorMessage);
+		logError("Regex compilation error: %s", errorMessage);
 		exit(EREGCOMP);
 	}
 
@@ -82,8 +81,7 @@ int isMatch(char* regex, char* searchString){
 	if(error!=0){
 		char errorMessage[errSize];
 		regerror(error,&rx,errorMessage,errSize);
-		mylog("Regex compilation error");
-		mylog(errorMessage);
+		logError("Regex compilation error: %s", errorMessage);
 		exit(EREGCOMP);
 	}
 
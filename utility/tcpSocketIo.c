@@ -6,6 +6,7 @@
  */
 
 #include <sys/socket.h>
+#include <sys/sendfile.h>
 #include <netinet/in.h>
 #include <errno.h>
 #include <stdlib.h>
@@ -19,38 +20,45 @@
 #include "logger.h"
 #include "byteString.h"
 #include "filesystem.h"
+#include "deadline.h"
+#include "tls.h"
+#include "metrics.h"
+#include "diskIo.h"
 
 
-/* Setting up listening sockets */
-void _bindSocket(int socketFd, const struct sockaddr_in *socketAddr);
-struct sockaddr_in *_getSocketAddress(in_addr_t ipaddress, int port);
-void _listenSocket(int socketFd, int backlog);
-
 /* Per thread buffers & fd locking to prevent lefover cross contamination */
 void _moduleInit();
+void _createKeys();
 int *_getFdPointer();
 int _setFd(int fd);
 int _isLocked(int fd);
 byteString_t* _getFdBuffer();
 int _setFdBuffer(char* string, int len);
 void _unsetFdBuffer();
+void _freeFdBuffer(void* b);
 int _sendByte(int socketFd, char* bytes, int length);
+ssize_t _receive(int fd, char* buffer, size_t length);
+ssize_t _transmit(int socketFd, char* bytes, size_t length);
 void _sliceByteStringCacheLeftover(byteString_t *b, int sliceIndex);
 
 void _handleSendError();
+off_t _ensureResident(int fd, off_t offset, long length);
 
 static pthread_key_t tFd;
 static pthread_key_t tBuf;
+static pthread_once_t keysOnce=PTHREAD_ONCE_INIT;
 
 
 void _moduleInit() {
 	/* Initiliaze thread storage keys. Run once only */
-	static int initialized=false;
-	if(!initialized) {
-		initialized=true;
-		pthread_key_create(&tFd, free);
-		pthread_key_create(&tBuf, bsDestruct);
-	}
+	pthread_once(&keysOnce, _createKeys);
+}
+
+
+void _createKeys() {
+	/* A thread's fd lock and leftover are freed when it exits */
+	pthread_key_create(&tFd, free);
+	pthread_key_create(&tBuf, _freeFdBuffer);
 }
 
 
@@ -141,15 +149,16 @@ int _setFdBuffer(char*  byteString, int len) {
 	 * 		Set bytestring to NULL if zero length. Else creare bytestring_t
 	 *
 	 */
-	byteString_t *fdBuffer=bsInit();
+	byteString_t *fdBuffer=NULL;
 	if (len>0) {
+		fdBuffer=bsInit();
 		bsWrite(fdBuffer, byteString, len);
-	} else {
-		fdBuffer=NULL;
+		metricsAllocated(MEM_READAHEAD, len);
 	}
 
-	/* Free the old fdBuffer & set the new one */
-	bsFree(_getFdBuffer());
+	/* Free the old fdBuffer & set the new one. <byteString> may be part of
+	 * the old one, so it is copied first */
+	_freeFdBuffer(_getFdBuffer());
 	return(pthread_setspecific(tBuf, (void*)fdBuffer));
 }
 
@@ -158,89 +167,26 @@ void _unsetFdBuffer() {
 	/**
 	 * Set the fdBuffer to null (& implicitly its length to zero)
 	 */
-	bsFree(_getFdBuffer());
+	_freeFdBuffer(_getFdBuffer());
 	pthread_setspecific(tBuf, NULL);
 }
 
 
-int _getFdBufferLength() {
-	/** Get the length of the fdBuffer. defined as zero if there is no fdBuffer*/
-	byteString_t *b = _getFdBuffer();
-	if (b==NULL) {return 0;} else {return b->length;}
-}
-
-
-void _bindSocket(int socketFd, const struct sockaddr_in *socketAddr) {
-	/**
-	 * Given an address and socket fd - bind the two. Print error messages on
-	 * failure and exit the program
-	 */
-	int e = bind(socketFd, (struct sockaddr *) socketAddr, sizeof(struct sockaddr_in));;
-	if(e==0){
-		return;
-	} else if (e==-1) {
-
-		switch(e) {
-		case EADDRINUSE:
-			mylog("Could not bind socket. Address given already in use");
-			break;
-		default:
-			mylog("Could not bind socket.");
-		}
-		exit(EBINDFAILED);
-	}
-}
-
-
-void _listenSocket(int socketFd, int backlog) {
-	/**
-	 * Given a socket and backlog, execute primitive to listen for connections
-	 * on error - print error and exit.
-	 */
-	int e = listen(socketFd, backlog);
-	if(e==0){
-		return;
-	} else if (e==-1) {
-		switch(e) {
-		default:
-			mylog("Could not listen on socket.");
-		}
-		exit(ELISTEN);
+void _freeFdBuffer(void* b) {
+	/* Free a leftover buffer, also at thread exit */
+	byteString_t* fdBuffer=b;
+	if (fdBuffer!=NULL) {
+		metricsFreed(MEM_READAHEAD, fdBuffer->length);
+		bsFree(fdBuffer);
+		free(fdBuffer);
 	}
 }
 
 
-struct sockaddr_in *_getSocketAddress(in_addr_t ipaddress, int port){
-	/***
-	 * Return a TCP/IP socket address at <ipaddress>:<port>
-	 *
-	 * ARGUMENT:
-	 * 		ipaddress - a single ip addr or range of addr which the address could
-	 * 		be bound to.
-	 *
-	 * 		port - port to bind to
-	 */
-	struct sockaddr_in *address =malloc(sizeof(struct sockaddr_in));
-	bzero(address, sizeof(*address));
-	address->sin_family=AF_INET;			/* State IP Socket */
-	address->sin_addr.s_addr=htonl(ipaddress);
-	address->sin_port=htons(port);		/* Port in network compatible form */
-	return(address);
-}
-
-
-int getListeningSocket(int port) {
-	/**
-	 * return a fd for a tcp socket listening on any ip address, and the
-	 * given port
-	 */
-
-	/* TCP socket atop IP network layer */
-	int socketFd = socket(AF_INET, SOCK_STREAM, 0);
-	struct sockaddr_in *socketAddr = _getSocketAddress(INADDR_ANY, port);
-	_bindSocket(socketFd, socketAddr);
-	_listenSocket(socketFd, MAX_BACKLOG);
-	return(socketFd);
+int _getFdBufferLength() {
+	/** Get the length of the fdBuffer. defined as zero if there is no fdBuffer*/
+	byteString_t *b = _getFdBuffer();
+	if (b==NULL) {return 0;} else {return b->length;}
 }
 
 
@@ -252,7 +198,7 @@ byteString_t *fdReadBytes(int fd, int byteCount){
 	/* Do nothing if locked */
 	if (_isLocked(fd)||byteCount<=0) {return NULL;}
 
-	byteString_t *line;
+	byteString_t *line=bsInit();
 	int leftoverSize=_getFdBufferLength();
 	int fdBytesToRead = byteCount;
 
@@ -260,7 +206,7 @@ byteString_t *fdReadBytes(int fd, int byteCount){
 	/* Use up leftover from prior calls for the fd (if there is any) */
 	if(leftoverSize>0) {
 
-		line = bsCopy(_getFdBuffer());
+		bsWrite(line, _getFdBuffer()->string, leftoverSize);
 
 		/* Leftover has enough bytes to satisfy the request*/
 		if(byteCount<=leftoverSize){
@@ -273,15 +219,19 @@ byteString_t *fdReadBytes(int fd, int byteCount){
 		/* Leftover partially satisfies the request */
 		} else {
 			fdBytesToRead-=leftoverSize;
-			bsFree(_getFdBuffer());
+			_unsetFdBuffer();
 		}
 	}
 
 	/* Read remaining bytes required to satisfy the request from the file desc*/
 	char* readBuffer=malloc(fdBytesToRead);
-	if(read(fd, readBuffer, fdBytesToRead)!=fdBytesToRead) {
+	if(_receive(fd, readBuffer, fdBytesToRead)!=fdBytesToRead) {
 		/* This should not happen for regular files as per the man page */
-		mylog("Could not read enough bytes from file descriptor");
+		logWarn("Could not read enough bytes from file descriptor");
+		free(readBuffer);
+		bsFree(line);
+		free(line);
+		_unlock();
 		return(NULL);
 	}
 
@@ -322,6 +272,10 @@ void _sliceByteStringCacheLeftover(byteString_t *b, int sliceIndex) {
 	int leftoverLen=byteStringLength-sliceLen;
 	if (leftoverLen!=0) {
 		_setFdBuffer(byteString+sliceIndex, leftoverLen);
+
+	/* Leftover fully consumed, dont hand it out again */
+	} else {
+		_unsetFdBuffer();
 	}
 
 	/* Shrink byteString to slice size */
@@ -342,10 +296,14 @@ char* fdReadLine(int fd) {
 	 * 		char* line -
 	 * 					Newline demarcated Line read from file descriptor.
 	 *
-	 * 					If no bytes can be read, the program will exit with an
-	 * 					ESOCKETREAD error.
+	 * 					If the fd cannot be read, return null.
+	 *
+	 * 					If there are no lines remaining (end of file before
+	 * 					a newline), return null,
 	 *
-	 * 					If there are no lines remaining, return null,
+	 * 					If no newline is found in MAXLINE bytes, return
+	 * 					null with errno set to EMSGSIZE. The line so far is
+	 * 					dropped, so one client cannot hold unbounded memory
 	 *
 	 * 					!!This return string should be FREEd by the caller
 	 *
@@ -373,7 +331,6 @@ char* fdReadLine(int fd) {
 	int lineLength;
 	int newLineIx;
 	char* newLineLocation;
-	int leftoverSize;
 	int readFailCount=0;
 	char buffer[BUFFER];
 
@@ -403,6 +360,9 @@ char* fdReadLine(int fd) {
 
 			returnLine=__convertBsToString(leftover);
 			bsFree(leftover);
+			free(leftover);
+			bsFree(line);
+			free(line);
 			return(returnLine);
 
 		/* Line not found. Empty leftover buffer and unlock (since we have used it)*/
@@ -410,56 +370,75 @@ char* fdReadLine(int fd) {
 			_unlock();
 		}
 
+		/* The line continues from the leftover */
 		bsFree(line);
-		line=bsCopy(leftover);
-		bsFree(leftover);
+		free(line);
+		line=leftover;
 	}
 
-	/* Read from fd untill a newline is found (or the socket is emptied) */
+	/* Read from fd untill a newline is found, end of file or repeated errors */
+	newLineLocation=NULL;
 	do{
-		bytesRead = read(fd, buffer, BUFFER);
+		bytesRead = _receive(fd, buffer, BUFFER);
 
-		// Retry if an error occured on reading, shortcircuit if EOF
-		if(bytesRead<=0){
-			(bytesRead<0)&&readFailCount++;
+		// Retry if an error occured on reading, stop at EOF
+		if(bytesRead<0){
+			if (errno!=EINTR) {
+				readFailCount++;
+			}
 			continue;
+		} else if (bytesRead==0) {
+			break;
 		}
+		deadlineProgress();
 
 		/* Scan bufer for newline, ignoring null bytes */
 		newLineLocation = memchr(buffer, '\n', bytesRead);
 
 		bsAppend(line, buffer, bytesRead);
+		if (newLineLocation==NULL&&line->length>=MAXLINE) {
+			logWarn("Line longer than %d bytes, dropped", MAXLINE);
+			bsFree(line);
+			free(line);
+			_unlock();
+			errno=EMSGSIZE;
+			return(NULL);
+		}
 
-	} while (newLineLocation== NULL && ((bytesRead==BUFFER)
-											||readFailCount<=READ_REATTEMPT
-											||bytesRead==0));
+	} while (newLineLocation==NULL&&readFailCount<=READ_REATTEMPT);
 
 
-	// The fd had repeated read errors.
+	// The fd had repeated read errors. Only this connection is affected
 	if(bytesRead<0){
 
-		mylog("The socket could not be read from");
-		exit(ESOCKETREAD);
+		logWarn("The socket could not be read from");
+		bsFree(line);
+		free(line);
+		_unlock();
+		return(NULL);
 	}
 
 	/* Line found. Assemble and return */
 	if (newLineLocation!=NULL) {
 
-		newLineIx=newLineLocation-buffer;
+		/* Index is relative to the line, which may hold earlier reads */
+		newLineIx=(line->length-bytesRead)+(newLineLocation-buffer);
 		_sliceByteStringCacheLeftover(line, newLineIx+1);
 		returnLine=__convertBsToString(line);
 		bsFree(line);
+		free(line);
 		return(returnLine);
 
 	/* Nothing found, so just cache the leftover */
 	} else {
 		if(line->length>0){
 			_sliceByteStringCacheLeftover(line,0);
-			bsFree(line);
 		} else {
 			/* Nothing in buffer */
 			_unlock();
 		}
+		bsFree(line);
+		free(line);
 		return(NULL);
 	}
 }
@@ -470,6 +449,24 @@ void closeSocket(int s) {
 }
 
 
+ssize_t _receive(int fd, char* buffer, size_t length) {
+	/* read() from <fd>, through the thread's TLS session if it has one */
+	if (tlsActive()) {
+		return(tlsRead(buffer, length));
+	}
+	return(read(fd, buffer, length));
+}
+
+
+ssize_t _transmit(int socketFd, char* bytes, size_t length) {
+	/* send() on <socketFd>, through the thread's TLS session if it has one */
+	if (tlsActive()) {
+		return(tlsWrite(bytes, length));
+	}
+	return(send(socketFd, bytes, length, 0));
+}
+
+
 int sendString(int socketFd, char* s, char* c) {
 	/**
 	 * Send a string into the socket.
@@ -514,11 +511,14 @@ int _sendByte(int socketFd, char* bytes, int length) {
 	int sent;
 	int sendLength=length;
 	while (sentCount!=length) {
-		sent = send(socketFd, bytes+sentCount, sendLength, 0);
-		if (sent==-1) {
+		sent = _transmit(socketFd, bytes+sentCount, sendLength);
+		if (sent==-1&&errno==EINTR) {
+			continue;
+		} else if (sent==-1) {
 			_handleSendError();
 			return(ESEND);
 		}
+		deadlineProgress();
 		sentCount+=sent;
 		sendLength-=sent;
 	}
@@ -526,26 +526,47 @@ int _sendByte(int socketFd, char* bytes, int length) {
 }
 
 
+off_t _ensureResident(int fd, off_t offset, long length) {
+	/* Bring the next chunk of <length> remaining from <offset> into the page
+	 * cache, returning where it ends */
+	long chunk=length<SENDFILE_CHUNK?length:SENDFILE_CHUNK;
+	diskEnsureResident(fd, offset, chunk);
+	return(offset+chunk);
+}
+
+
 void _handleSendError(){
 	/**
 	 * Handle a send error with a message and program termination
 	 */
 	switch(errno){
 		case(EBADF):
-			mylog("Send attempted with invalid fd");
+			logWarn("Send attempted with invalid fd");
 			break;
 		case(ECONNRESET):
-			mylog("Peer reset connection during send");
+			logDebug("Peer reset connection during send");
+			break;
+		case(EPIPE):
+			logDebug("Connection shut down during send");
 			break;
 		case(ENOTCONN):
-			mylog("Send attempted with non-connected socket");
+			logWarn("Send attempted with non-connected socket");
 			break;
 		default:
-			mylog("An error occured while sending data");
+			logWarn("An error occured while sending data");
 	}
 }
 
 
+int sendBytes(int socketFd, char* bytes, int length) {
+	/**
+	 * Send <length> bytes of <bytes> through <socketFd>. Null bytes have no
+	 * special significance.
+	 */
+	return(_sendByte(socketFd, bytes, length));
+}
+
+
 int sendChar(int socketFd, char* s) {
 	/**
 	 * Send a single character <s> throught <socketFd>
@@ -557,38 +578,76 @@ int sendChar(int socketFd, char* s) {
 }
 
 
-int sendFile(int socketFd, FILE *f, long fSize) {
+int sendFile(int socketFd, int fd, off_t offset, long length) {
 	/**
-	 * Send a binary file through the network.
+	 * Send <length> bytes of a file from <offset> through the network.
+	 *
+	 * The copy is done in kernel with sendfile(), falling back to pread() and
+	 * send() where the descriptors do not support it. TLS connections use
+	 * sendfile() only where the kernel encrypts the records (kTLS). Each
+	 * SENDFILE_CHUNK is brought into the page cache before it is sent, so
+	 * neither blocks the worker on the disk (see diskIo.c).
 	 *
 	 * ARGUMENT
 	 * 	socketFd - socket to send via
-	 * 	f - file to send.
-	 * 	fSize - size of file in bytes
-	 *
-	 * ASSUMPTION
-	 * 	f is @ zero offset, or else only part of the file will be sent
+	 * 	fd - file to send. Its file position is neither used nor changed, so
+	 * 	the descriptor may be shared between threads
+	 * 	offset - where in the file to start
+	 * 	length - bytes to send
 	 */
 	char buffer[SENDBUFFER];
-	size_t nRead;
+	off_t resident=offset;	// Sent from the page cache up to here
+	ssize_t sent;
+	ssize_t nRead;
 
-	/* Send groups of bytes until the EOF is reached */
-	while(feof(f)==0){
+	while (length>0) {
+		if (offset>=resident) {
+			resident=_ensureResident(fd, offset, length);
+		}
+		if (tlsActive()) {
+			sent=tlsSendFile(fd, offset, length<SENDFILE_CHUNK?length:
+					SENDFILE_CHUNK);
+			offset+=sent>0?sent:0;
+		} else {
+			sent=sendfile(socketFd, fd, &offset, length<SENDFILE_CHUNK?length:
+					SENDFILE_CHUNK);
+		}
+		if (sent>0) {
+			deadlineProgress();
+			length-=sent;
+			continue;
+		}
+		if (sent<0&&errno==EINTR) {
+			continue;
+		}
 
-		/* Handle file read errors if present */
-		nRead=fread(buffer, SENDBUFFER, 1, f);
-		if (ferror(f)!=0) {
+		/* Not supported for these descriptors, copy through user space */
+		if (sent<0&&(errno==EINVAL||errno==ENOSYS)) {
+			break;
+		}
+		if (sent==0) {
+			handleFileReadError(); // File shrank underneath us
+		} else {
+			_handleSendError();
+		}
+		return(ESEND);
+	}
+
+	while (length>0) {
+		if (offset>=resident) {
+			resident=_ensureResident(fd, offset, length);
+		}
+		nRead=pread(fd, buffer, length<SENDBUFFER?length:SENDBUFFER, offset);
+		if (nRead<=0) {
 			handleFileReadError();
 			return(ESEND);
 		}
-
-		if(_sendByte(socketFd, buffer, nRead*SENDBUFFER)==ESEND) {
+		if (_sendByte(socketFd, buffer, nRead)==ESEND) {
 			return(ESEND);
 		}
-		fSize-=(nRead*SENDBUFFER);
+		offset+=nRead;
+		length-=nRead;
 	}
-
-	/* Send remainder of file */
-	return(_sendByte(socketFd, buffer, fSize));
+	return(SENDOK);
 }
 
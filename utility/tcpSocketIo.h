@@ -8,16 +8,17 @@
 #ifndef UTILITY_TCPSOCKETIO_H_
 #define UTILITY_TCPSOCKETIO_H_
 
+#include <sys/types.h>
 #include "byteString.h" // fdReadBytes returns a bytestring
 
 
 #define BUFFER		  256			// Read buffer [bytes]
 #define SENDBUFFER	  1024			// Send buffer [bytes]
+#define SENDFILE_CHUNK (256*1024)	// Most sent per sendfile(), between deadline renewals
 #define READ_REATTEMPT 3
-#define MAX_BACKLOG  64				// Max listen backlog
+#define MAXLINE		  (8*1024)		// Longest line fdReadLine() reads [bytes]
 
 
-int getListeningSocket(int port);			// Get a TCP/IP listening socket
 char* fdReadLine(int fd);			// Read a line
 byteString_t *fdReadBytes(int fd, int byteCount); // read set amt of bytes
 void flushFdBuffer();				// Unlock module for use with other fd's
@@ -25,12 +26,11 @@ void closeSocket(int s);
 
 int sendString(int socketFd, char* s, char* c);
 int sendChar(int socketFd, char* s);
-int sendFile(int socketFd, FILE *f, long fSize);
+int sendBytes(int socketFd, char* bytes, int length);
+int sendFile(int socketFd, int fd, off_t offset, long length);
 
 
-#define EBINDFAILED	  7
 #define ESOCKETREAD	  17 // Could not read from socket
-#define ELISTEN		  11
 #define EREADDEFICIT	  99 // fd did not have as many bytes as requested
 #define ESEND 		  101
 #define SENDOK		  842972
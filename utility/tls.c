@@ -0,0 +1,252 @@
+/*
+ * Author: 			Ben Tomlin
+ * Student Id:		btomlin
+ * Student Nbr:		834198
+ * Date:			Oct 2026
+ *
+ * TLS termination for listeners opened with the ssl option, using OpenSSL.
+ *
+ * A worker thread handshakes on its connection with tlsAccept(), after which
+ * the session is bound to the thread (as tcpSocketIo binds its read buffer)
+ * and the socket io module reads and sends through it until tlsEnd().
+ *
+ * Sessions resume from tickets, or the server side session cache for clients
+ * without them, skipping the full handshake. Where the kernel supports it
+ * the record layer is handed to the kernel (kTLS) once the handshake is
+ * done, so files are still sent with sendfile(), encrypted in kernel; other
+ * connections have files copied through SSL_write().
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+
+#include "tls.h"
+#include "bool.h"
+#include "logger.h"
+#include "metrics.h"
+
+typedef struct tlsSession {	// The connection a worker thread is serving
+	SSL* ssl;
+	int failed;				// A fatal error occured, no close_notify is sent
+} tlsSession_t;
+
+static SSL_CTX* context;
+static pthread_key_t tSession;
+
+ssize_t _tlsResult(tlsSession_t* t, int result);
+char* _tlsError(char* message, int size);
+
+
+void initTls(char* certificate, char* key, int sessionCache,
+		int sessionTimeout, int tickets, int kernelTls) {
+	/**
+	 * Load the server certificate and configure session resumption. Call
+	 * once before any tlsAccept().
+	 *
+	 * ARGUMENT:
+	 * 	certificate - PEM certificate chain, the server's first
+	 * 	key - PEM private key, NULL if it is in <certificate>
+	 * 	sessionCache - sessions held for resumption by id, 0 disables
+	 * 	sessionTimeout - seconds a session may be resumed for
+	 * 	tickets - resume from session tickets held by clients
+	 * 	kernelTls - hand the record layer to the kernel where supported
+	 *
+	 * Terminates with ETLS if the certificate or key cannot be loaded
+	 */
+	char message[TLS_MAXERROR];
+
+	if (certificate==NULL) {
+		logError("An ssl listener needs ssl_certificate");
+		exit(ETLS);
+	}
+	context=SSL_CTX_new(TLS_server_method());
+	SSL_CTX_set_min_proto_version(context, TLS1_2_VERSION);
+	if (SSL_CTX_use_certificate_chain_file(context, certificate)!=1
+			||SSL_CTX_use_PrivateKey_file(context, key!=NULL?key:certificate,
+			SSL_FILETYPE_PEM)!=1
+			||SSL_CTX_check_private_key(context)!=1) {
+		logError("Could not load certificate %s: %s", certificate,
+				_tlsError(message, TLS_MAXERROR));
+		exit(ETLS);
+	}
+
+	SSL_CTX_set_session_id_context(context,
+			(unsigned char*)TLS_SESSION_CONTEXT, strlen(TLS_SESSION_CONTEXT));
+	SSL_CTX_set_timeout(context, sessionTimeout);
+	if (sessionCache>0) {
+		SSL_CTX_set_session_cache_mode(context, SSL_SESS_CACHE_SERVER);
+		SSL_CTX_sess_set_cache_size(context, sessionCache);
+	} else {
+		SSL_CTX_set_session_cache_mode(context, SSL_SESS_CACHE_OFF);
+	}
+	if (!tickets) {
+		SSL_CTX_set_options(context, SSL_OP_NO_TICKET);
+	}
+#ifdef SSL_OP_ENABLE_KTLS
+	if (kernelTls) {
+		SSL_CTX_set_options(context, SSL_OP_ENABLE_KTLS);
+	}
+#endif
+
+	pthread_key_create(&tSession, NULL);
+}
+
+
+int tlsAccept(int socketFd) {
+	/**
+	 * Handshake with the client on <socketFd> and bind the session to the
+	 * calling thread.
+	 *
+	 * RETURN:
+	 * 	false if the handshake failed, the connection should be closed
+	 */
+	char message[TLS_MAXERROR];
+	tlsSession_t* t;
+	SSL* ssl=SSL_new(context);
+
+	SSL_set_fd(ssl, socketFd);
+	if (SSL_accept(ssl)!=1) {
+		logDebug("TLS handshake failed: %s",
+				_tlsError(message, TLS_MAXERROR));
+		SSL_free(ssl);
+		return(false);
+	}
+
+	t=malloc(sizeof(tlsSession_t));
+	t->ssl=ssl;
+	t->failed=false;
+	pthread_setspecific(tSession, t);
+
+	metricsCount(COUNT_TLS_HANDSHAKES, 1);
+	if (SSL_session_reused(ssl)) {
+		metricsCount(COUNT_TLS_RESUMED, 1);
+	}
+	if (BIO_get_ktls_send(SSL_get_wbio(ssl))) {
+		metricsCount(COUNT_TLS_KTLS, 1);
+	}
+	return(true);
+}
+
+
+int tlsActive() {
+	/* True if the calling thread's connection is TLS */
+	return(context!=NULL&&pthread_getspecific(tSession)!=NULL);
+}
+
+
+ssize_t tlsRead(char* buffer, size_t length) {
+	/**
+	 * Read up to <length> bytes of application data, as read() does.
+	 *
+	 * RETURN:
+	 * 	bytes read, 0 at the end of the stream, -1 on error with errno set
+	 */
+	tlsSession_t* t=pthread_getspecific(tSession);
+	errno=0;
+	return(_tlsResult(t, SSL_read(t->ssl, buffer,
+			length>INT_MAX?INT_MAX:length)));
+}
+
+
+ssize_t tlsWrite(char* bytes, size_t length) {
+	/**
+	 * Send up to <length> bytes of application data, as send() does.
+	 *
+	 * RETURN:
+	 * 	bytes sent, -1 on error with errno set
+	 */
+	tlsSession_t* t=pthread_getspecific(tSession);
+	errno=0;
+	return(_tlsResult(t, SSL_write(t->ssl, bytes,
+			length>INT_MAX?INT_MAX:length)));
+}
+
+
+ssize_t tlsSendFile(int fd, off_t offset, size_t length) {
+	/**
+	 * Send up to <length> bytes of file <fd> from <offset> with sendfile(),
+	 * encrypted by the kernel.
+	 *
+	 * RETURN:
+	 * 	bytes sent, -1 on error with errno set. errno is EINVAL if the
+	 * 	connection does not have kTLS; send the file with tlsWrite()
+	 */
+	tlsSession_t* t=pthread_getspecific(tSession);
+	ossl_ssize_t sent;
+
+	if (!BIO_get_ktls_send(SSL_get_wbio(t->ssl))) {
+		errno=EINVAL;
+		return(-1);
+	}
+	sent=SSL_sendfile(t->ssl, fd, offset, length, 0);
+	if (sent<0) {
+		t->failed=true;
+		ERR_clear_error();
+	}
+	return(sent);
+}
+
+
+void tlsEnd() {
+	/* Close the calling thread's session, if any, and unbind it */
+	tlsSession_t* t;
+
+	if (context==NULL||(t=pthread_getspecific(tSession))==NULL) {
+		return;
+	}
+
+	/* Only our close_notify is sent, the socket is closed without waiting
+	 * for the client's */
+	if (!t->failed) {
+		SSL_shutdown(t->ssl);
+	}
+	SSL_free(t->ssl);
+	free(t);
+	pthread_setspecific(tSession, NULL);
+	ERR_clear_error();
+}
+
+
+ssize_t _tlsResult(tlsSession_t* t, int result) {
+	/* Map an SSL_read() or SSL_write() result to read() or send() style */
+	int error;
+
+	if (result>0) {
+		return(result);
+	}
+	error=SSL_get_error(t->ssl, result);
+	ERR_clear_error();
+	switch (error) {
+		case SSL_ERROR_ZERO_RETURN:		// close_notify from the client
+			return(0);
+		case SSL_ERROR_WANT_READ:		// Interrupted, call again
+		case SSL_ERROR_WANT_WRITE:
+			errno=EINTR;
+			return(-1);
+		case SSL_ERROR_SYSCALL:			// errno is the socket's error
+			t->failed=true;
+			if (errno==0) {				// Closed without close_notify
+				return(0);
+			}
+			return(-1);
+		default:
+			t->failed=true;
+			errno=EIO;
+			return(-1);
+	}
+}
+
+
+char* _tlsError(char* message, int size) {
+	/* Most recent OpenSSL error of the calling thread, clearing the queue */
+	unsigned long error=ERR_get_error();
+
+	ERR_error_string_n(error, message, size);
+	ERR_clear_error();
+	return(error!=0?message:"connection closed");
+}
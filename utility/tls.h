@@ -0,0 +1,26 @@
+/*
+ * Author: 			Ben Tomlin
+ * Student Id:		btomlin
+ * Student Nbr:		834198
+ * Date:			Oct 2026
+ */
+
+#ifndef UTILITY_TLS_H_
+#define UTILITY_TLS_H_
+
+#include <sys/types.h>
+
+#define TLS_SESSION_CONTEXT "httpserver" // Sessions resume only on this server
+#define TLS_MAXERROR	   256 // Longest OpenSSL error message logged
+#define ETLS			   41 // Certificate or key could not be loaded
+
+void initTls(char* certificate, char* key, int sessionCache,
+		int sessionTimeout, int tickets, int kernelTls);
+int tlsAccept(int socketFd);
+int tlsActive();
+ssize_t tlsRead(char* buffer, size_t length);
+ssize_t tlsWrite(char* bytes, size_t length);
+ssize_t tlsSendFile(int fd, off_t offset, size_t length);
+void tlsEnd();
+
+#endif /* UTILITY_TLS_H_ */